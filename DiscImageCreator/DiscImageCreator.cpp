@@ -19,6 +19,7 @@
 #include "struct.h"
 #include "calcHash.h"
 #include "check.h"
+#include "execImage.h"
 #include "execIoctl.h"
 #include "execScsiCmd.h"
 #include "execScsiCmdforCD.h"
@@ -27,12 +28,16 @@
 #include "get.h"
 #include "init.h"
 #include "output.h"
+#include "outputProgress.h"
+#include "sparseFile.h"
 #include "xml.h"
 #include "_external\prngcd.h"
 
 #define DEFAULT_REREAD_VAL			(4000)
 #define DEFAULT_CACHE_DELETE_VAL	(1)
 #define DEFAULT_SPTD_TIMEOUT_VAL	(60)
+#define DEFAULT_READ_QUEUE_DEPTH	(4)
+#define DEFAULT_SKIP_ERROR_NUM		(3)
 
 BYTE g_aSyncHeader[SYNC_SIZE] = {
 	0x00, 0xff, 0xff, 0xff, 0xff, 0xff,
@@ -51,6 +56,7 @@ static DWORD s_dwFix = 0;
 static DWORD s_dwSpeed = 0;
 static INT s_nStartLBA = 0;
 static INT s_nEndLBA = 0;
+static INT s_nOfflineImageNum = 0;
 
 #define playtime (200)
 #define c4 (262)
@@ -142,6 +148,70 @@ int soundBeep(int nRet)
 	return TRUE;
 }
 
+// Each image is analyzed by the child process because the logs and the
+// settings are held globally. The processes run as many as the processors.
+int execOfflineInParallel(_TCHAR* argv[])
+{
+	_TCHAR szExe[_MAX_PATH] = { 0 };
+	if (!GetModuleFileName(NULL, szExe, sizeof(szExe) / sizeof(szExe[0]))) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	SYSTEM_INFO sysInfo = { 0 };
+	GetSystemInfo(&sysInfo);
+	DWORD dwMaxProcNum = min(sysInfo.dwNumberOfProcessors, (DWORD)MAXIMUM_WAIT_OBJECTS);
+	HANDLE hProc[MAXIMUM_WAIT_OBJECTS] = { 0 };
+	INT nImageIdx[MAXIMUM_WAIT_OBJECTS] = { 0 };
+	DWORD dwProcNum = 0;
+	INT nErrNum = 0;
+
+	for (INT i = 0; i < s_nOfflineImageNum || dwProcNum > 0;) {
+		while (i < s_nOfflineImageNum && dwProcNum < dwMaxProcNum) {
+			_TCHAR szCmd[_MAX_PATH * 2 + 16] = { 0 };
+			_sntprintf(szCmd, sizeof(szCmd) / sizeof(szCmd[0])
+				, _T("\"%s\" offline \"%s\""), szExe, argv[2 + i]);
+			STARTUPINFO si = { 0 };
+			si.cb = sizeof(STARTUPINFO);
+			PROCESS_INFORMATION pi = { 0 };
+			if (!CreateProcess(NULL, szCmd, NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				OutputString(_T("%s: failed\n"), argv[2 + i]);
+				nErrNum++;
+				i++;
+				continue;
+			}
+			CloseHandle(pi.hThread);
+			hProc[dwProcNum] = pi.hProcess;
+			nImageIdx[dwProcNum] = i++;
+			dwProcNum++;
+		}
+		if (dwProcNum == 0) {
+			break;
+		}
+		DWORD dwIdx = WaitForMultipleObjects(dwProcNum, hProc, FALSE, INFINITE) - WAIT_OBJECT_0;
+		if (dwIdx >= dwProcNum) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			for (DWORD j = 0; j < dwProcNum; j++) {
+				CloseHandle(hProc[j]);
+			}
+			return FALSE;
+		}
+		DWORD dwExitCode = EXIT_FAILURE;
+		GetExitCodeProcess(hProc[dwIdx], &dwExitCode);
+		CloseHandle(hProc[dwIdx]);
+		OutputString(_T("%s: %s\n"), argv[2 + nImageIdx[dwIdx]]
+			, dwExitCode == EXIT_SUCCESS ? _T("done") : _T("failed"));
+		if (dwExitCode != EXIT_SUCCESS) {
+			nErrNum++;
+		}
+		dwProcNum--;
+		hProc[dwIdx] = hProc[dwProcNum];
+		nImageIdx[dwIdx] = nImageIdx[dwProcNum];
+	}
+	OutputString(_T("Analyzed %d images, %d failed\n"), s_nOfflineImageNum, nErrNum);
+	return nErrNum == 0;
+}
+
 int exec(_TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _TCHAR* pszFullPath)
 {
 	BOOL bRet = FALSE;
@@ -153,6 +223,26 @@ int exec(_TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _TCHAR* pszFull
 	else if (*pExecType == mds) {
 		bRet = WriteParsingMdsfile(pszFullPath);
 	}
+	else if (*pExecType == sparse) {
+		bRet = CopySparseFile(pszFullPath, argv[3]);
+	}
+	else if (*pExecType == offline) {
+		if (s_nOfflineImageNum > 1) {
+			bRet = execOfflineInParallel(argv);
+		}
+		else {
+#ifndef _DEBUG
+			if (!InitLogFile(pExecType, pExtArg, pszFullPath)) {
+				return FALSE;
+			}
+#endif
+			bRet = ReadImageForAnalysis(pExecType, pExtArg, pszFullPath, s_szExt);
+			FlushLog();
+#ifndef _DEBUG
+			TerminateLogFile(pExecType, pExtArg);
+#endif
+		}
+	}
 	else {
 		CONST size_t bufSize = 8;
 		_TCHAR szBuf[bufSize] = { 0 };
@@ -204,6 +294,11 @@ int exec(_TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _TCHAR* pszFull
 					}
 				}
 #endif
+				if (pExtArg->byProgressEvent) {
+					if (!InitProgressEvent(pszFullPath)) {
+						throw FALSE;
+					}
+				}
 				if (!TestUnitReady(pExtArg, &device)) {
 					throw FALSE;
 				}
@@ -241,12 +336,9 @@ int exec(_TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _TCHAR* pszFull
 							if (!InitProtectData(&pDisc)) {
 								throw FALSE;
 							}
-							make_scrambled_table();
-							make_crc_table();
-							make_crc16_table();
-#if 0
-							make_crc6_table();
-#endif
+							if (!InitDpm(&pDisc)) {
+								throw FALSE;
+							}
 							CDFLAG::_READ_CD::_ERROR_FLAGS c2 = CDFLAG::_READ_CD::NoC2;
 							ReadCDForCheckingByteOrder(pExtArg, &device, &c2);
 							if (pExtArg->byC2) {
@@ -454,6 +546,7 @@ int exec(_TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _TCHAR* pszFull
 			TerminateLBAPerTrack(&pDisc);
 			TerminateSubData(pExecType, &pDisc);
 			TerminateProtectData(&pDisc);
+			TerminateDpm(&pDisc);
 			TerminateTocFullData(&pDisc);
 			if (device.bySuccessReadToc) {
 				TerminateTocTextData(pExecType, &device, &pDisc);
@@ -463,6 +556,7 @@ int exec(_TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _TCHAR* pszFull
 				FcloseAndNull(fpC2);
 				TerminateC2(&pDisc);
 			}
+			TerminateProgressEvent();
 #ifndef _DEBUG
 			TerminateLogFile(pExecType, pExtArg);
 #endif
@@ -561,6 +655,69 @@ int SetOptionS(int argc, _TCHAR* argv[], PEXT_ARG pExtArg, int* i)
 	return TRUE;
 }
 
+int SetOptionSv(int argc, _TCHAR* argv[], PEXT_ARG pExtArg, int* i)
+{
+	_TCHAR* endptr = NULL;
+	if (argc > *i && _tcsncmp(argv[*i], _T("/"), 1)) {
+		pExtArg->dwSubQVoteNum = _tcstoul(argv[(*i)++], &endptr, 10);
+		if (*endptr) {
+			OutputErrorString(_T("[%s] is invalid argument. Please input integer.\n"), endptr);
+			return FALSE;
+		}
+		if (pExtArg->dwSubQVoteNum < SUB_Q_VOTE_MIN || SUB_Q_VOTE_MAX < pExtArg->dwSubQVoteNum) {
+			OutputErrorString(_T("/sv val must be %d to %d\n"), SUB_Q_VOTE_MIN, SUB_Q_VOTE_MAX);
+			return FALSE;
+		}
+	}
+	else {
+		pExtArg->dwSubQVoteNum = 5;
+		OutputString(_T("/sv val is omitted. set [%d]\n"), 5);
+	}
+	return TRUE;
+}
+
+int SetOptionQd(int argc, _TCHAR* argv[], PEXT_ARG pExtArg, int* i)
+{
+	_TCHAR* endptr = NULL;
+	if (argc > *i && _tcsncmp(argv[*i], _T("/"), 1)) {
+		pExtArg->dwReadQueueDepth = _tcstoul(argv[(*i)++], &endptr, 10);
+		if (*endptr) {
+			OutputErrorString(_T("[%s] is invalid argument. Please input integer.\n"), endptr);
+			return FALSE;
+		}
+		if (pExtArg->dwReadQueueDepth < 1 || READ_QUEUE_DEPTH_MAX < pExtArg->dwReadQueueDepth) {
+			OutputErrorString(_T("/qd val must be 1 to %d\n"), READ_QUEUE_DEPTH_MAX);
+			return FALSE;
+		}
+	}
+	else {
+		pExtArg->dwReadQueueDepth = DEFAULT_READ_QUEUE_DEPTH;
+		OutputString(_T("/qd val is omitted. set [%d]\n"), DEFAULT_READ_QUEUE_DEPTH);
+	}
+	return TRUE;
+}
+
+int SetOptionSk(int argc, _TCHAR* argv[], PEXT_ARG pExtArg, int* i)
+{
+	_TCHAR* endptr = NULL;
+	if (argc > *i && _tcsncmp(argv[*i], _T("/"), 1)) {
+		pExtArg->dwSkipErrorNum = _tcstoul(argv[(*i)++], &endptr, 10);
+		if (*endptr) {
+			OutputErrorString(_T("[%s] is invalid argument. Please input integer.\n"), endptr);
+			return FALSE;
+		}
+		if (pExtArg->dwSkipErrorNum < 1) {
+			OutputErrorString(_T("/sk val must be 1 or more\n"));
+			return FALSE;
+		}
+	}
+	else {
+		pExtArg->dwSkipErrorNum = DEFAULT_SKIP_ERROR_NUM;
+		OutputString(_T("/sk val is omitted. set [%d]\n"), DEFAULT_SKIP_ERROR_NUM);
+	}
+	return TRUE;
+}
+
 int SetOptionSf(int argc, _TCHAR* argv[], PEXT_ARG pExtArg, int* i)
 {
 	_TCHAR* endptr = NULL;
@@ -727,6 +884,9 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 				if (cmdLen == 2 && !_tcsncmp(argv[i - 1], _T("/q"), 2)) {
 					pExtArg->byQuiet = TRUE;
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/ps"), 3)) {
+					pExtArg->byProgressEvent = TRUE;
+				}
 				else if (cmdLen == 2 && !_tcsncmp(argv[i - 1], _T("/a"), 2)) {
 					if (!SetOptionA(argc, argv, pExtArg, &i)) {
 						return FALSE;
@@ -771,6 +931,15 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/ms"), 3)) {
 					pExtArg->byMultiSession = TRUE;
 				}
+				else if (cmdLen == 4 && !_tcsncmp(argv[i - 1], _T("/mds"), 4)) {
+					pExtArg->byMds = TRUE;
+				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/dw"), 3)) {
+					pExtArg->byDirectWrite = TRUE;
+				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/ni"), 3)) {
+					pExtArg->byNonInteractive = TRUE;
+				}
 				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/np"), 3)) {
 					pExtArg->bySkipSubP = TRUE;
 				}
@@ -791,9 +960,19 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 						return FALSE;
 					}
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/sv"), 3)) {
+					if (!SetOptionSv(argc, argv, pExtArg, &i)) {
+						return FALSE;
+					}
+				}
 				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/74"), 3)) {
 					pExtArg->by74Min = TRUE;
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/sk"), 3)) {
+					if (!SetOptionSk(argc, argv, pExtArg, &i)) {
+						return FALSE;
+					}
+				}
 				else {
 					OutputErrorString(_T("Unknown option: [%s]\n"), argv[i - 1]);
 					return FALSE;
@@ -813,6 +992,9 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 				if (cmdLen == 2 && !_tcsncmp(argv[i - 1], _T("/q"), 2)) {
 					pExtArg->byQuiet = TRUE;
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/ps"), 3)) {
+					pExtArg->byProgressEvent = TRUE;
+				}
 				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/be"), 3)) {
 					if (!SetOptionBe(argc, argv, pExtArg, &i)) {
 						return FALSE;
@@ -832,6 +1014,12 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 						return FALSE;
 					}
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/dw"), 3)) {
+					pExtArg->byDirectWrite = TRUE;
+				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/ni"), 3)) {
+					pExtArg->byNonInteractive = TRUE;
+				}
 				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/np"), 3)) {
 					pExtArg->bySkipSubP = TRUE;
 				}
@@ -846,6 +1034,11 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 						return FALSE;
 					}
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/sv"), 3)) {
+					if (!SetOptionSv(argc, argv, pExtArg, &i)) {
+						return FALSE;
+					}
+				}
 				else {
 					OutputErrorString(_T("Unknown option: [%s]\n"), argv[i - 1]);
 					return FALSE;
@@ -873,6 +1066,11 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 				else if (cmdLen == 4 && !_tcsncmp(argv[i - 1], _T("/raw"), 4)) {
 					pExtArg->byRawDump = TRUE;
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/qd"), 3)) {
+					if (!SetOptionQd(argc, argv, pExtArg, &i)) {
+						return FALSE;
+					}
+				}
 				else if (cmdLen == 4 && !_tcsncmp(argv[i - 1], _T("/fix"), 4)) {
 					pExtArg->byFix = TRUE;
 					s_dwFix = _tcstoul(argv[i++], &endptr, 10);
@@ -880,9 +1078,15 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/re"), 3)) {
 					pExtArg->byResume = TRUE;
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/dw"), 3)) {
+					pExtArg->byDirectWrite = TRUE;
+				}
 				else if (cmdLen == 2 && !_tcsncmp(argv[i - 1], _T("/q"), 2)) {
 					pExtArg->byQuiet = TRUE;
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/ps"), 3)) {
+					pExtArg->byProgressEvent = TRUE;
+				}
 				else {
 					OutputErrorString(_T("Unknown option: [%s]\n"), argv[i - 1]);
 					return FALSE;
@@ -906,9 +1110,23 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 						return FALSE;
 					}
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/qd"), 3)) {
+					if (!SetOptionQd(argc, argv, pExtArg, &i)) {
+						return FALSE;
+					}
+				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/re"), 3)) {
+					pExtArg->byResume = TRUE;
+				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/dw"), 3)) {
+					pExtArg->byDirectWrite = TRUE;
+				}
 				else if (cmdLen == 2 && !_tcsncmp(argv[i - 1], _T("/q"), 2)) {
 					pExtArg->byQuiet = TRUE;
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/ps"), 3)) {
+					pExtArg->byProgressEvent = TRUE;
+				}
 				else {
 					OutputErrorString(_T("Unknown option: [%s]\n"), argv[i - 1]);
 					return FALSE;
@@ -939,6 +1157,9 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 				if (cmdLen == 2 && !_tcsncmp(argv[i - 1], _T("/q"), 2)) {
 					pExtArg->byQuiet = TRUE;
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/ps"), 3)) {
+					pExtArg->byProgressEvent = TRUE;
+				}
 				else if (cmdLen == 2 && !_tcsncmp(argv[i - 1], _T("/a"), 2)) {
 					if (!SetOptionA(argc, argv, pExtArg, &i)) {
 						return FALSE;
@@ -975,6 +1196,12 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/ms"), 3)) {
 					pExtArg->byMultiSession = TRUE;
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/dw"), 3)) {
+					pExtArg->byDirectWrite = TRUE;
+				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/ni"), 3)) {
+					pExtArg->byNonInteractive = TRUE;
+				}
 				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/np"), 3)) {
 					pExtArg->bySkipSubP = TRUE;
 				}
@@ -989,6 +1216,11 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 						return FALSE;
 					}
 				}
+				else if (cmdLen == 3 && !_tcsncmp(argv[i - 1], _T("/sv"), 3)) {
+					if (!SetOptionSv(argc, argv, pExtArg, &i)) {
+						return FALSE;
+					}
+				}
 				else {
 					OutputErrorString(_T("Unknown option: [%s]\n"), argv[i - 1]);
 					return FALSE;
@@ -1002,11 +1234,23 @@ int checkArg(int argc, _TCHAR* argv[], PEXEC_TYPE pExecType, PEXT_ARG pExtArg, _
 			}
 			printAndSetPath(argv[3], pszFullPath);
 		}
+		else if (argc >= 3 && cmdLen == 7 && !_tcsncmp(argv[1], _T("offline"), 7)) {
+			*pExecType = offline;
+			pExtArg->byQuiet = TRUE;
+			s_nOfflineImageNum = argc - 2;
+			if (s_nOfflineImageNum == 1) {
+				printAndSetPath(argv[2], pszFullPath);
+			}
+		}
 		else if (argc == 4) {
 			if (_tcslen(argv[1]) == 2 && !_tcsncmp(argv[1], _T("fd"), 2)) {
 				*pExecType = fd;
 				printAndSetPath(argv[3], pszFullPath);
 			}
+			else if (_tcslen(argv[1]) == 6 && !_tcsncmp(argv[1], _T("sparse"), 6)) {
+				*pExecType = sparse;
+				printAndSetPath(argv[2], pszFullPath);
+			}
 			else {
 				OutputErrorString(_T("Invalid argument\n"));
 				return FALSE;
@@ -1079,37 +1323,42 @@ void printUsage(void)
 {
 	OutputString(
 		_T("Usage\n")
-		_T("\tcd <DriveLetter> <Filename> <DriveSpeed(0-72)> [/q] [/a (val)]\n")
+		_T("\tcd <DriveLetter> <Filename> <DriveSpeed(0-72)> [/q] [/a (val)] [/ni]\n")
 		_T("\t   [/be (str) or /d8] [/c2 (val1) (val2) (val3) (val4)] [/f (val)] [/m]\n")
 		_T("\t   [/p] [/ms] [/sf (val)] [/ss] [/np] [/nq] [/nr] [/ns] [/s (val)]\n")
+		_T("\t   [/sk (val)] [/dw]\n")
 		_T("\t\tDump a CD from A to Z\n")
 		_T("\t\tFor PLEXTOR or drive that can scramble Dumping\n")
-		_T("\tswap <DriveLetter> <Filename> <DriveSpeed(0-72)> [/q] [/a (val)]\n")
+		_T("\tswap <DriveLetter> <Filename> <DriveSpeed(0-72)> [/q] [/a (val)] [/ni]\n")
 		_T("\t   [/be (str) or /d8] [/c2 (val1) (val2) (val3) (val4)] [/f (val)] [/m]\n")
 		_T("\t   [/p] [/ms] [/sf (val)] [/ss] [/np] [/nq] [/nr] [/ns] [/s (val)] [/74]\n")
+		_T("\t   [/dw]\n")
 		_T("\t\tDump a CD from A to Z using swap trick\n")
 		_T("\t\tFor no PLEXTOR or drive that can't scramble dumping\n")
 		_T("\tdata <DriveLetter> <Filename> <DriveSpeed(0-72)> <StartLBA> <EndLBA+1>\n")
-		_T("\t     [/q] [/be (str) or /d8] [/c2 (val1) (val2) (val3) (val4)]\n")
-		_T("\t     [/sf (val)] [/ss] [/r] [/np] [/nq] [/nr] [/ns] [/s (val)]\n")
+		_T("\t     [/q] [/be (str) or /d8] [/c2 (val1) (val2) (val3) (val4)] [/ni]\n")
+		_T("\t     [/sf (val)] [/ss] [/r] [/np] [/nq] [/nr] [/ns] [/s (val)] [/dw]\n")
 		_T("\t\tDump a CD from start to end (using 'all' flag)\n")
 		_T("\t\tFor no PLEXTOR or drive that can't scramble dumping\n")
 		_T("\taudio <DriveLetter> <Filename> <DriveSpeed(0-72)> <StartLBA> <EndLBA+1>\n")
-		_T("\t      [/q] [/a (val)] [/c2 (val1) (val2) (val3) (val4)]\n")
+		_T("\t      [/q] [/a (val)] [/c2 (val1) (val2) (val3) (val4)] [/ni]\n")
 		_T("\t      [/be (str) or /d8] [/sf (val)] [/np] [/nq] [/nr] [/ns] [/s (val)]\n")
+		_T("\t      [/dw]\n")
 		_T("\t\tDump a CD from start to end (using 'cdda' flag)\n")
 	);
 	_tsystem(_T("pause"));
 	OutputString(
 		_T("\t\tFor dumping a lead-in, lead-out mainly\n")
-		_T("\tgd <DriveLetter> <Filename> <DriveSpeed(0-72)> [/q] [/be (str) or /d8]\n")
+		_T("\tgd <DriveLetter> <Filename> <DriveSpeed(0-72)> [/q] [/be (str) or /d8] [/ni]\n")
 		_T("\t   [/c2 (val1) (val2) (val3) (val4)] [/np] [/nq] [/nr] [/ns] [/s (val)]\n")
+		_T("\t   [/dw]\n")
 		_T("\t\tDump a HD area of GD from A to Z\n")
 		_T("\tdvd <DriveLetter> <Filename> <DriveSpeed(0-16)> [/c] [/f (val)] [/raw] [/q]\n")
+		_T("\t   [/qd (val)] [/re] [/dw]\n")
 		_T("\t\tDump a DVD from A to Z\n")
-		_T("\txbox <DriveLetter> <Filename> [/f (val)] [/q]\n")
+		_T("\txbox <DriveLetter> <Filename> [/f (val)] [/q] [/qd (val)] [/dw]\n")
 		_T("\t\tDump a disc from A to Z\n")
-		_T("\tbd <DriveLetter> <Filename> [/f (val)] [/q]\n")
+		_T("\tbd <DriveLetter> <Filename> [/f (val)] [/q] [/qd (val)] [/re] [/dw]\n")
 		_T("\t\tDump a BD from A to Z\n")
 		_T("\tfd <DriveLetter> <Filename>\n")
 		_T("\t\tDump a floppy disk\n")
@@ -1132,10 +1381,19 @@ void printUsage(void)
 		_T("\t\tParse CloneCD sub file and output to readable format\n")
 		_T("\tmds <Mdsfile>\n")
 		_T("\t\tParse Alchohol 120/52 mds file and output to readable format\n")
+		_T("\toffline <Imagefile> [<Imagefile> ...]\n")
+		_T("\t\tAnalyze the file system and the protection of .img, .bin or .iso\n")
+		_T("\t\twithout the drive. The result is output to *_offline_*.txt\n")
+		_T("\t\tIf the images are specified more than one, they are analyzed in parallel\n")
+		_T("\tsparse <Imagefile> <Copyfile>\n")
+		_T("\t\tCopy the image leaving the blocks of zero as the holes of the sparse file\n")
 		_T("Option (generic)\n")
 		_T("\t/f\tUse 'Force Unit Access' flag to delete the drive cache\n")
 		_T("\t\t\tval\tdelete per specified value (default: 1)\n")
 		_T("\t/q\tDisable beep\n")
+		_T("\t/ps\tOutput the progress to _progress.jsonl per second\n")
+		_T("\t/dw\tWrite the images of the dump without the cache of the file system\n")
+		_T("\t   \t(FILE_FLAG_NO_BUFFERING)\n")
 		_T("Option (for CD read mode)\n")
 		_T("\t/a\tAdd CD offset manually (Only Audio CD)\n")
 		_T("\t\t\tval\tsamples value\n")
@@ -1152,6 +1410,8 @@ void printUsage(void)
 		_T("\t\t\t    \tval3, 4 is used when val2 is 1\n")
 		_T("\t/m\tUse if MCN exists in the first pregap sector of the track\n")
 		_T("\t\t\tFor some PC-Engine\n")
+		_T("\t/ni\tDon't ask the drive offset if the drive isn't in driveOffset.txt\n")
+		_T("\t\t\tThe offset is got from the data track. If it doesn't exist, stop dumping\n")
 	);
 	_tsystem(_T("pause"));
 	OutputString(
@@ -1165,6 +1425,9 @@ void printUsage(void)
 		_T("\t\t\tFor Multi-session\n")
 		_T("\t/74\tRead the lead-out about 74:00:00\n")
 		_T("\t\t\tFor ring data (a.k.a Saturn Ring) of Sega Saturn)\n")
+		_T("\t/sk\tSkip the unreadable region after the consecutive read errors,\n")
+		_T("\t   \tand retry the skipped sectors after dumping (see .map)\n")
+		_T("\t\t\tval\tnumber of the consecutive errors (default: 3)\n")
 		_T("\t/sf\tScan file to detect protect. If reading error exists,\n")
 		_T("\t   \tcontinue reading and ignore c2 error on specific sector\n")
 		_T("\t\t\tFor CodeLock, LaserLock, RingProtect, RingPROTECH\n")
@@ -1175,6 +1438,8 @@ void printUsage(void)
 		_T("\t\t\tFor ProtectCD-VOB\n")
 		_T("\t/am\tScan anti-mod string\n")
 		_T("\t\t\tFor PlayStation\n")
+		_T("\t/mds\tCreate .mds and .mdf (2448 byte/sector) after dumping\n")
+		_T("\t\t\tDPM (read time per 50 sectors) of the dump is stored to .mds\n")
 		_T("Option (for CD SubChannel)\n")
 		_T("\t/np\tNot fix SubP\n")
 		_T("\t/nq\tNot fix SubQ\n")
@@ -1192,6 +1457,9 @@ void printUsage(void)
 		_T("\t\t\tval\t0: no read next sub (fast, but lack precision)\n")
 		_T("\t\t\t   \t1: read next sub (normal, this val is default)\n")
 		_T("\t\t\t   \t2: read next & next next sub (slow, precision)\n")
+		_T("\t/sv\tReread the sector if the crc16 of SubQ is bad, and use\n")
+		_T("\t   \tthe majority of each bit of the rereads\n")
+		_T("\t\t\tval\tnumber of the read (2 to 16, default: 5)\n")
 		_T("Option (for DVD)\n")
 		_T("\t/c\tLog Copyright Management Information\n")
 		_T("\t/raw\tDumping DVD by raw (2064 byte/sector)\n")
@@ -1199,6 +1467,11 @@ void printUsage(void)
 		_T("\t\t\t               Hitachi-LG GDR, GCC\n")
 		_T("\t\t\t -> GDR (8082N, 8161B to 8164B) and GCC (4160N, 4240N to 4247N)\n")
 		_T("\t\t\t    supports GC/Wii dumping\n")
+		_T("\t/qd\tIssue the next reads before the previous ones complete,\n")
+		_T("\t   \tand write the image while the next sectors are read\n")
+		_T("\t\t\tval\tnumber of the reads in flight (1 to 16, default: 4)\n")
+		_T("\t/re\tResume the dump. The bad and untried sectors in <Filename>.map\n")
+		_T("\t   \tare read (with /raw, it continues from the end of the .raw)\n")
 	);
 	_tsystem(_T("pause"));
 }
@@ -1251,6 +1524,7 @@ int _tmain(int argc, _TCHAR* argv[])
 		EXEC_TYPE execType;
 		EXT_ARG extArg = { 0 };
 		extArg.dwCacheDelNum = DEFAULT_CACHE_DELETE_VAL;
+		extArg.dwReadQueueDepth = DEFAULT_READ_QUEUE_DEPTH;
 		_TCHAR szFullPath[_MAX_PATH + 1] = { 0 };
 		if (!checkArg(argc, argv, &execType, &extArg, szFullPath)) {
 			printUsage();
@@ -1266,7 +1540,9 @@ int _tmain(int argc, _TCHAR* argv[])
 			_tcsftime(szBuf, sizeof(szBuf) / sizeof(szBuf[0]), _T("%Y/%m/%d(%a) %H:%M:%S"), ts);
 			OutputString(_T("StartTime: %s\n"), szBuf);
 
-			nRet = createCmdFile(argc, argv, szFullPath, szDateTime);
+			if (execType != offline && execType != sparse) {
+				nRet = createCmdFile(argc, argv, szFullPath, szDateTime);
+			}
 			if (nRet) {
 				nRet = exec(argv, &execType, &extArg, szFullPath);
 			}
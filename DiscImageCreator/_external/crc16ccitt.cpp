@@ -13,20 +13,32 @@
 ***********************************************************/
 #include <limits.h>
 #define CRCPOLY1  0x1021U  /* x^{16}+x^{12}+x^5+1 */
-unsigned int crctable[UCHAR_MAX + 1];
+/* Modified: table generated at compile time */
+struct crctable_t {
+	unsigned int v[UCHAR_MAX + 1];
+	constexpr crctable_t() : v() {
+		for (unsigned int i = 0; i <= UCHAR_MAX; i++) {
+			unsigned int r = i << (16 - CHAR_BIT);
+			for (unsigned int j = 0; j < CHAR_BIT; j++) {
+				if (r & 0x8000U) r = (r << 1) ^ CRCPOLY1;
+				else             r <<= 1;
+			}
+			v[i] = r & 0xFFFFU;
+		}
+	}
+};
 
-void make_crc16_table(void)
-{
-	unsigned int i, j, r;
+static constexpr crctable_t crctable{};
 
-	for (i = 0; i <= UCHAR_MAX; i++) {
-		r = i << (16 - CHAR_BIT);
-		for (j = 0; j < CHAR_BIT; j++)
-			if (r & 0x8000U) r = (r << 1) ^ CRCPOLY1;
-			else             r <<= 1;
-			crctable[i] = r & 0xFFFFU;
-	}
+static constexpr unsigned int check_crc16(const char *c, int n)
+{
+	unsigned int r = 0;
+	for (int i = 0; i < n; i++)
+		r = (r << CHAR_BIT) ^ crctable.v[(byte)(r >> (16 - CHAR_BIT)) ^ (byte)c[i]];
+	return r & 0xFFFFU;
 }
+static_assert(crctable.v[1] == 0x1021U && crctable.v[UCHAR_MAX] == 0x1EF0U &&
+	check_crc16("123456789", 9) == 0x31C3U, "crctable is broken");
 
 unsigned int update_crc16(int n, byte c[])
 {
@@ -35,7 +47,7 @@ unsigned int update_crc16(int n, byte c[])
 //	r = 0xFFFFU;
 	r = 0;
 	while (--n >= 0)
-		r = (r << CHAR_BIT) ^ crctable[(byte)(r >> (16 - CHAR_BIT)) ^ *c++];
+		r = (r << CHAR_BIT) ^ crctable.v[(byte)(r >> (16 - CHAR_BIT)) ^ *c++];
 	return ~r & 0xFFFFU;
 }
 #pragma warning(pop)
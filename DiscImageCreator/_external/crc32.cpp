@@ -14,30 +14,38 @@
  */
 #include "crc32.h"
 
+/* Modified: table generated at compile time, so make_crc_table and
+   crc_table_computed are removed. */
+
 /* Table of CRCs of all 8-bit messages. */
-unsigned long crc_table[256];
+struct crc_table_t {
+  unsigned long v[256];
+  constexpr crc_table_t() : v() {
+    for (int n = 0; n < 256; n++) {
+      unsigned long c = (unsigned long) n;
+      for (int k = 0; k < 8; k++) {
+        if (c & 1) {
+          c = 0xedb88320L ^ (c >> 1);
+        } else {
+          c = c >> 1;
+        }
+      }
+      v[n] = c;
+    }
+  }
+};
 
-/* Flag: has the table been computed? Initially false. */
-int crc_table_computed = 0;
+static constexpr crc_table_t crc_table{};
 
-/* Make the table for a fast CRC. */
-void make_crc_table(void)
+static constexpr unsigned long check_crc(const char *buf, int len)
 {
-  unsigned long c;
-  int n, k;
-  for (n = 0; n < 256; n++) {
-    c = (unsigned long) n;
-    for (k = 0; k < 8; k++) {
-      if (c & 1) {
-        c = 0xedb88320L ^ (c >> 1);
-      } else {
-        c = c >> 1;
-      }
-    }
-    crc_table[n] = c;
+  unsigned long c = 0xffffffffL;
+  for (int n = 0; n < len; n++) {
+    c = crc_table.v[(c ^ (unsigned char)buf[n]) & 0xff] ^ (c >> 8);
   }
-  crc_table_computed = 1;
+  return c ^ 0xffffffffL;
 }
+static_assert(check_crc("123456789", 9) == 0xcbf43926L, "crc_table is broken");
 
 /*
    Update a running crc with the bytes buf[0..len-1] and return
@@ -58,10 +66,8 @@ unsigned long update_crc(unsigned long crc,
   unsigned long c = crc ^ 0xffffffffL;
   int n;
 
-  if (!crc_table_computed)
-    make_crc_table();
   for (n = 0; n < len; n++) {
-    c = crc_table[(c ^ buf[n]) & 0xff] ^ (c >> 8);
+    c = crc_table.v[(c ^ buf[n]) & 0xff] ^ (c >> 8);
   }
   return c ^ 0xffffffffL;
 }
@@ -1,4 +1,3 @@
 #pragma once
 
-void make_crc_table(void);
 unsigned long update_crc(unsigned long crc,	unsigned char* buf,	int len);
@@ -15,32 +15,43 @@
  */
 #include "crc32ecma267.h"
 
-unsigned long crc32_table[256];
-
 // 0x80000011  /* x^32 + x^31 + x^4 + 1 */
-void make_crc32ecma267_table(void)
-{
-	for (unsigned long n = 0; n < 256; n++) {
-		unsigned long c = n << 24;
-		for (unsigned long k = 0; k < 8; k++) {
-			c = (c << 1) ^ ((c & 0x80000000) ? 0x80000011 : 0);
+// The table is generated at compile time, so it can be used from any thread.
+struct crc32ecma267_table_t {
+	unsigned long v[256];
+	constexpr crc32ecma267_table_t() : v() {
+		for (unsigned long n = 0; n < 256; n++) {
+			unsigned long c = n << 24;
+			for (unsigned long k = 0; k < 8; k++) {
+				c = ((c << 1) ^ ((c & 0x80000000) ? 0x80000011 : 0)) & 0xffffffff;
+			}
+			v[n] = c;
 		}
-		crc32_table[n] = c;
 	}
-#if 0
-	for (int i = 0; i < 256; i += 8) {
+};
+
+static constexpr crc32ecma267_table_t crc32ecma267_table{};
+
+// Compares the table with the bitwise crc of "123456789"
+static constexpr bool check_crc32ecma267(const char *buf, int len)
+{
+	unsigned long r = 0;
+	unsigned long c = 0;
+	for (int i = 0; i < len; i++) {
+		r ^= (unsigned long)(unsigned char)buf[i] << 24;
 		for (int k = 0; k < 8; k++) {
-			OutputString("%08x, ", crc32_table[k + i]);
+			r = ((r << 1) ^ ((r & 0x80000000) ? 0x80000011 : 0)) & 0xffffffff;
 		}
-		OutputString("\n");
+		c = ((c << 8) ^ crc32ecma267_table.v[((c >> 24) ^ (unsigned char)buf[i]) & 0xff]) & 0xffffffff;
 	}
-#endif
+	return r == c;
 }
+static_assert(check_crc32ecma267("123456789", 9), "crc32ecma267_table is broken");
 
 unsigned long update_crc32ecma267(unsigned long crc, unsigned char *buf, int len) {
 	unsigned long c = crc;
 	for (int i = 0; i < len; i++) {
-		c = (c << 8) ^ crc32_table[((c >> 24) ^ buf[i]) & 0xff];
+		c = ((c << 8) ^ crc32ecma267_table.v[((c >> 24) ^ buf[i]) & 0xff]) & 0xffffffff;
 	}
 	return c;
 }
@@ -15,5 +15,4 @@
 */
 #pragma once
 
-void make_crc32ecma267_table(void);
 unsigned long update_crc32ecma267(unsigned long crc, unsigned char *buf, int len);
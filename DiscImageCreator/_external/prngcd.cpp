@@ -13,37 +13,28 @@ Redistribution and use in source and binary forms, with or without modification,
 THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-// #include "stdio.h"
-unsigned char scrambled_table[2352];
-
-// int main()
-void make_scrambled_table(void)
-{
-	long counter = 0x0001; //counter starts at 0001
-	char newval = 0;
-	unsigned long outval = 0;
-	int loopcounter;
-	// output exactly 12 zeroes first, which corresponds to the sync portion of the sector, see ECMA-130
-	for (loopcounter=0; loopcounter < 12; loopcounter++)
-//		printf("0x00 ");
-		scrambled_table[loopcounter] = 0;
-	int newcounter = loopcounter;
-	// now the actual scramble lfsr:
-	for (loopcounter=0; loopcounter < 2340*8; loopcounter++)
-	{
-		newval = (((counter&1)?1:0)^((counter&2)?1:0));
-		//fprintf(stderr,"%d",counter&1);
-		outval |= (counter&1)?0x8000:0; // outval is 16 bits, counter is only 15 bits!
-		if ((loopcounter%16)==15)
-		{
-			//fprintf(stderr, " 0x%04x\n",outval);
-//			printf("0x%02x ", outval&0xFF);
-//			printf("0x%02x ", (outval>>8)&0xFF);
-			scrambled_table[newcounter++] = outval & 0xFF;
-			scrambled_table[newcounter++] = (outval >> 8) & 0xFF;
+#include "prngcd.h"
+
+// Modified: table generated at compile time.
+// The 15-bit lfsr is advanced 8 bits at once. Bit n of the sequence is
+// bit n - 15 ^ bit n - 14, so the next 8 bits are the low 8 bits of
+// counter ^ (counter >> 1).
+struct scrambled_table_t {
+	unsigned char v[2352];
+	constexpr scrambled_table_t() : v() {
+		unsigned int counter = 0x0001; //counter starts at 0001
+		// the first 12 bytes stay zero, which corresponds to the sync portion of the sector, see ECMA-130
+		for (int i = 12; i < 2352; i++) {
+			v[i] = (unsigned char)(counter & 0xff);
+			counter = ((counter >> 8) | (((counter ^ (counter >> 1)) & 0xff) << 7)) & 0x7fff;
 		}
-		outval >>= 1;
-		counter >>= 1;
-		if (newval == 1) counter |= 0x4000; // ECMA-130 diagram is wrong and shows this as counter |= 0x8000; the text is correct.
 	}
-}
+};
+
+static constexpr scrambled_table_t s_scrambled_table{};
+static_assert(s_scrambled_table.v[11] == 0x00 && s_scrambled_table.v[12] == 0x01 &&
+	s_scrambled_table.v[13] == 0x80 && s_scrambled_table.v[14] == 0x00 &&
+	s_scrambled_table.v[15] == 0x60 && s_scrambled_table.v[17] == 0x28 &&
+	s_scrambled_table.v[2350] == 0xe5 && s_scrambled_table.v[2351] == 0x99, "scrambled_table is broken");
+
+const unsigned char (&scrambled_table)[2352] = s_scrambled_table.v;
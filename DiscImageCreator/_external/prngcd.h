@@ -1,3 +1,4 @@
 #pragma once
 
-void make_scrambled_table(void);
+// ECMA-130 Annex B, generated at compile time
+extern const unsigned char (&scrambled_table)[2352];
@@ -32,6 +32,98 @@ WORD GetCrc16CCITT(
 	return (WORD)update_crc16(len, lpBuf);
 }
 
+// The crc16 of the sub-Q is always 10 bytes, so the table has the value of
+// each byte at each position (slicing-by-10). The 10 lookups don't depend on
+// each other unlike update_crc16.
+// The table is generated at compile time, so it can be used from any thread.
+struct CRC16_SUBQ_TABLE {
+	WORD v[SUBQ_CRC_DATA_SIZE][UCHAR_MAX + 1];
+	constexpr CRC16_SUBQ_TABLE() : v() {
+		for (INT i = 0; i <= UCHAR_MAX; i++) {
+			UINT r = (UINT)i << 8;
+			for (INT j = 0; j < CHAR_BIT; j++) {
+				r = (r & 0x8000U) ? (r << 1) ^ 0x1021U : r << 1;
+			}
+			v[SUBQ_CRC_DATA_SIZE - 1][i] = (WORD)r;
+		}
+		// the value of the byte followed by n zero bytes
+		for (INT k = SUBQ_CRC_DATA_SIZE - 2; k >= 0; k--) {
+			for (INT i = 0; i <= UCHAR_MAX; i++) {
+				WORD r = v[k + 1][i];
+				v[k][i] = (WORD)(r << 8 ^ v[SUBQ_CRC_DATA_SIZE - 1][r >> 8]);
+			}
+		}
+	}
+};
+
+static constexpr CRC16_SUBQ_TABLE s_crc16SubQTable{};
+
+// Compares the table with the bitwise crc16 of the sub-Q of
+// track 1, index 1, 00:00:00, AMSF 00:02:00
+static constexpr BOOL CheckCrc16SubQTable(
+	VOID
+) {
+	CONST BYTE aSubQ[SUBQ_CRC_DATA_SIZE] = { 0x41, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00 };
+	UINT r = 0;
+	WORD w = 0;
+	for (INT i = 0; i < SUBQ_CRC_DATA_SIZE; i++) {
+		r ^= (UINT)aSubQ[i] << 8;
+		for (INT j = 0; j < CHAR_BIT; j++) {
+			r = (r & 0x8000U) ? (r << 1) ^ 0x1021U : r << 1;
+		}
+		w ^= s_crc16SubQTable.v[i][aSubQ[i]];
+	}
+	return (WORD)r == w;
+}
+static_assert(CheckCrc16SubQTable(), "crc16 table of the sub-Q is broken");
+
+WORD GetCrc16SubQ(
+	LPBYTE lpSubQ
+) {
+	WORD r = (WORD)(
+		s_crc16SubQTable.v[0][lpSubQ[0]] ^ s_crc16SubQTable.v[1][lpSubQ[1]] ^
+		s_crc16SubQTable.v[2][lpSubQ[2]] ^ s_crc16SubQTable.v[3][lpSubQ[3]] ^
+		s_crc16SubQTable.v[4][lpSubQ[4]] ^ s_crc16SubQTable.v[5][lpSubQ[5]] ^
+		s_crc16SubQTable.v[6][lpSubQ[6]] ^ s_crc16SubQTable.v[7][lpSubQ[7]] ^
+		s_crc16SubQTable.v[8][lpSubQ[8]] ^ s_crc16SubQTable.v[9][lpSubQ[9]]);
+	return (WORD)~r;
+}
+
+// Replaces lpSubQ[nPos] with byNew and updates the crc16 of lpSubQ (12 bytes).
+// The crc16 is linear, so only the difference of the byte is added.
+VOID UpdateCrc16SubQ(
+	LPBYTE lpSubQ,
+	INT nPos,
+	BYTE byNew
+) {
+	WORD crc16 = (WORD)(MAKEWORD(lpSubQ[11], lpSubQ[10]) ^
+		s_crc16SubQTable.v[nPos][lpSubQ[nPos] ^ byNew]);
+	lpSubQ[nPos] = byNew;
+	lpSubQ[10] = HIBYTE(crc16);
+	lpSubQ[11] = LOBYTE(crc16);
+}
+
+// lpBuf points to the sub-Q (12 bytes) of the 1st frame, and the next frame is
+// dwStride bytes ahead. Bit n of the return value is on if the crc16 of frame n is valid.
+UINT64 GetValidSubQMask(
+	LPBYTE lpBuf,
+	DWORD dwStride,
+	INT nNum
+) {
+	UINT64 ullMask = 0;
+	if (nNum > 64) {
+		nNum = 64;
+	}
+	for (INT i = 0; i < nNum; i++) {
+		LPBYTE lpSubQ = lpBuf + dwStride * (DWORD)i;
+		WORD crc16 = GetCrc16SubQ(lpSubQ);
+		if (lpSubQ[10] == HIBYTE(crc16) && lpSubQ[11] == LOBYTE(crc16)) {
+			ullMask |= 1ULL << i;
+		}
+	}
+	return ullMask;
+}
+
 VOID GetCrc32(
 	LPDWORD crc,
 	LPBYTE lpBuf,
@@ -45,10 +137,7 @@ VOID GetCrc32Ecma267(
 	LPBYTE lpBuf,
 	DWORD dwSize
 ) {
-	UNREFERENCED_PARAMETER(crc);
-	UNREFERENCED_PARAMETER(lpBuf);
-	UNREFERENCED_PARAMETER(dwSize);
-//	*crc = update_crc32ecma267(*crc, lpBuf, (INT)dwSize);
+	*crc = update_crc32ecma267(*crc, lpBuf, (INT)dwSize);
 }
 
 BOOL CalcHash(
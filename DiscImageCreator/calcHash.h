@@ -25,11 +25,29 @@ VOID CalcInit(
 	SHA1Context* sha
 );
 
+#define SUBQ_CRC_DATA_SIZE	(10)
+
 WORD GetCrc16CCITT(
 	INT len,
 	LPBYTE lpBuf
 );
 
+WORD GetCrc16SubQ(
+	LPBYTE lpSubQ
+);
+
+VOID UpdateCrc16SubQ(
+	LPBYTE lpSubQ,
+	INT nPos,
+	BYTE byNew
+);
+
+UINT64 GetValidSubQMask(
+	LPBYTE lpBuf,
+	DWORD dwStride,
+	INT nNum
+);
+
 VOID GetCrc32(
 	LPDWORD crc,
 	LPBYTE lpBuf,
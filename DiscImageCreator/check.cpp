@@ -1043,33 +1043,120 @@ BOOL IsValidSubQAMSF(
 	return bRet;
 }
 
+static INT IsPopcntSupported(
+	VOID
+) {
+	INT aCpuInfo[4] = { 0 };
+	__cpuid(aCpuInfo, 1);
+	return (aCpuInfo[2] >> 23) & 0x01;
+}
+
+// Set before main() starts any thread
+static CONST INT s_nPopcnt = IsPopcntSupported();
+
+INT PopCount64(
+	UINT64 x
+) {
+	if (s_nPopcnt) {
+#ifdef _WIN64
+		return (INT)__popcnt64(x);
+#else
+		return (INT)(__popcnt((UINT)x) + __popcnt((UINT)(x >> 32)));
+#endif
+	}
+	x = x - ((x >> 1) & 0x5555555555555555ULL);
+	x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (INT)((x * 0x0101010101010101ULL) >> 56);
+}
+
+// x is big endian, so the msb of the 1st byte is bit 63. Returns the
+// position of the first (or last) set bit counted from bit 63
+INT GetFirstBitFromMsb64(
+	UINT64 x
+) {
+	DWORD dwBit = 0;
+#ifdef _WIN64
+	_BitScanReverse64(&dwBit, x);
+	return 63 - (INT)dwBit;
+#else
+	if (_BitScanReverse(&dwBit, (DWORD)(x >> 32))) {
+		return 31 - (INT)dwBit;
+	}
+	_BitScanReverse(&dwBit, (DWORD)x);
+	return 63 - (INT)dwBit;
+#endif
+}
+
+INT GetLastBitFromMsb64(
+	UINT64 x
+) {
+	return 63 - GetFirstBitFromLsb64(x);
+}
+
+// Returns the position of the first set bit counted from bit 0
+INT GetFirstBitFromLsb64(
+	UINT64 x
+) {
+	DWORD dwBit = 0;
+#ifdef _WIN64
+	_BitScanForward64(&dwBit, x);
+	return (INT)dwBit;
+#else
+	if (_BitScanForward(&dwBit, (DWORD)x)) {
+		return (INT)dwBit;
+	}
+	_BitScanForward(&dwBit, (DWORD)(x >> 32));
+	return 32 + (INT)dwBit;
+#endif
+}
+
+BOOL AnalyzeC2Error(
+	LPBYTE lpC2,
+	PC2_ERROR_INFO pC2Info
+) {
+	ZeroMemory(pC2Info, sizeof(C2_ERROR_INFO));
+	pC2Info->nFirstErrorByte = -1;
+	pC2Info->nLastErrorByte = -1;
+	// 294 bytes = 8 bytes * 36 + 6 bytes
+	for (INT nPos = 0; nPos < CD_RAW_READ_C2_294_SIZE; nPos += sizeof(UINT64)) {
+		INT nSize = CD_RAW_READ_C2_294_SIZE - nPos;
+		if (nSize > (INT)sizeof(UINT64)) {
+			nSize = sizeof(UINT64);
+		}
+		UINT64 x = 0;
+		memcpy(&x, lpC2 + nPos, (size_t)nSize);
+		if (x == 0) {
+			continue;
+		}
+		pC2Info->dwErrorBitNum += (DWORD)PopCount64(x);
+		// lsb of each byte is on if the byte isn't 0, and these 8 bits are
+		// gathered to the top byte (x is little endian, so byte 0 is bit 56)
+		UINT64 y = x | (x >> 4);
+		y |= y >> 2;
+		y |= y >> 1;
+		y &= 0x0101010101010101ULL;
+		pC2Info->ullSuspectByte[nPos / 64] |= ((y * 0x0102040810204080ULL) >> 56) << (nPos % 64);
+		// Ricoh based drives (+97 read offset, like the Aopen CD-RW CRW5232)
+		// use lsb points to 1st byte of main. 
+		// But almost drive is msb points to 1st byte of main.
+		// After swapping, bit 63 - n is the n-th byte of main in this word
+		x = _byteswap_uint64(x);
+		if (pC2Info->nFirstErrorByte == -1) {
+			pC2Info->nFirstErrorByte = nPos * CHAR_BIT + GetFirstBitFromMsb64(x);
+		}
+		pC2Info->nLastErrorByte = nPos * CHAR_BIT + GetLastBitFromMsb64(x);
+	}
+	return pC2Info->dwErrorBitNum ? RETURNED_EXIST_C2_ERROR : RETURNED_NO_C2_ERROR_1ST;
+}
+
 BOOL ContainsC2Error(
 	PDEVICE pDevice,
 	LPBYTE lpBuf,
 	LPDWORD lpdwC2errorNum
 ) {
-	BOOL bRet = RETURNED_NO_C2_ERROR_1ST;
-	*lpdwC2errorNum = 0;
-	for (WORD wC2ErrorPos = 0; wC2ErrorPos < CD_RAW_READ_C2_294_SIZE; wC2ErrorPos++) {
-		DWORD dwPos = pDevice->TRANSFER.dwBufC2Offset + wC2ErrorPos;
-		if (lpBuf[dwPos] != 0) {
-			// Ricoh based drives (+97 read offset, like the Aopen CD-RW CRW5232)
-			// use lsb points to 1st byte of main. 
-			// But almost drive is msb points to 1st byte of main.
-			//			INT nBit = 0x01;
-			INT nBit = 0x80;
-			for (INT n = 0; n < CHAR_BIT; n++) {
-				// exist C2 error
-				if (lpBuf[dwPos] & nBit) {
-					// wC2ErrorPos * CHAR_BIT => position of byte
-					// (position of byte) + n => position of bit
-					bRet = RETURNED_EXIST_C2_ERROR;
-					(*lpdwC2errorNum)++;
-				}
-//				nBit <<= 1;
-				nBit >>= 1;
-			}
-		}
-	}
+	C2_ERROR_INFO c2Info;
+	BOOL bRet = AnalyzeC2Error(lpBuf + pDevice->TRANSFER.dwBufC2Offset, &c2Info);
+	*lpdwC2errorNum = c2Info.dwErrorBitNum;
 	return bRet;
 }
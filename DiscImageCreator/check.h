@@ -145,6 +145,27 @@ BOOL IsValidSubQAMSF(
 	INT nLBA
 );
 
+INT PopCount64(
+	UINT64 x
+);
+
+INT GetFirstBitFromMsb64(
+	UINT64 x
+);
+
+INT GetLastBitFromMsb64(
+	UINT64 x
+);
+
+INT GetFirstBitFromLsb64(
+	UINT64 x
+);
+
+BOOL AnalyzeC2Error(
+	LPBYTE lpC2,
+	PC2_ERROR_INFO pC2Info
+);
+
 BOOL ContainsC2Error(
 	PDEVICE pDevice,
 	LPBYTE lpBuf,
@@ -46,7 +46,7 @@
 	//v(0x02)	//0x80 R6	//0x40 R5	//0x20 R4	//0x10 R3	//0x08 R2	//0x04 R1	//0x02 0	//0x01 L1
 	//w(0x01)	//0x80 R7	//0x40 R6	//0x20 R5	//0x10 R4	//0x08 R3	//0x04 R2	//0x02 R1	//0x01 0
 */
-BOOL AlignRowSubcode(
+BOOL AlignRowSubcodeScalar(
 	LPBYTE lpRowSubcode,
 	LPBYTE lpColumnSubcode
 ) {
@@ -100,7 +100,7 @@ BOOL AlignRowSubcode(
 	//v(0x02)	//0x80 R6	//0x40 R5	//0x20 R4	//0x10 R3	//0x08 R2	//0x04 R1	//0x02 0	//0x01 L1
 	//w(0x01)	//0x80 R7	//0x40 R6	//0x20 R5	//0x10 R4	//0x08 R3	//0x04 R2	//0x02 R1	//0x01 0
 */
-BOOL AlignColumnSubcode(
+BOOL AlignColumnSubcodeScalar(
 	LPBYTE lpColumnSubcode,
 	LPBYTE lpRowSubcode
 ) {
@@ -123,6 +123,58 @@ BOOL AlignColumnSubcode(
 	return TRUE;
 }
 
+// Transpose the 8x8 bit matrix (byte 0 is the most significant byte, bit 7 of
+// each byte is the column 0) by the 64-bit delta swap. Same result as the
+// *Scalar, but 3 swaps per 8 bytes instead of 64 shift & mask.
+UINT64 TransposeBitMatrix8x8(
+	UINT64 x
+) {
+	UINT64 t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+	x = x ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+	x = x ^ t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+	x = x ^ t ^ (t << 28);
+	return x;
+}
+
+BOOL AlignRowSubcode(
+	LPBYTE lpRowSubcode,
+	LPBYTE lpColumnSubcode
+) {
+	// 12 blocks of 8 bytes. lpColumnSubcode[8 * i + j] & (0x80 >> k)
+	// -> lpRowSubcode[12 * k + i] & (0x80 >> j)
+	for (INT i = 0; i < CD_RAW_READ_SUBCODE_SIZE / CHAR_BIT; i++) {
+		UINT64 x = 0;
+		for (INT j = 0; j < CHAR_BIT; j++) {
+			x |= (UINT64)lpColumnSubcode[CHAR_BIT * i + j] << (56 - CHAR_BIT * j);
+		}
+		x = TransposeBitMatrix8x8(x);
+		for (INT k = 0; k < CHAR_BIT; k++) {
+			lpRowSubcode[12 * k + i] = (BYTE)(x >> (56 - CHAR_BIT * k));
+		}
+	}
+	return TRUE;
+}
+
+BOOL AlignColumnSubcode(
+	LPBYTE lpColumnSubcode,
+	LPBYTE lpRowSubcode
+) {
+	for (INT i = 0; i < CD_RAW_READ_SUBCODE_SIZE / CHAR_BIT; i++) {
+		UINT64 x = 0;
+		for (INT k = 0; k < CHAR_BIT; k++) {
+			x |= (UINT64)lpRowSubcode[12 * k + i] << (56 - CHAR_BIT * k);
+		}
+		x = TransposeBitMatrix8x8(x);
+		for (INT j = 0; j < CHAR_BIT; j++) {
+			// OR as well as AlignColumnSubcodeScalar
+			lpColumnSubcode[CHAR_BIT * i + j] |= (BYTE)(x >> (56 - CHAR_BIT * j));
+		}
+	}
+	return TRUE;
+}
+
 BYTE BcdToDec(
 	BYTE bySrc
 ) {
@@ -25,6 +25,16 @@ BOOL AlignColumnSubcode(
 	LPBYTE lpRowSubcode
 );
 
+BOOL AlignRowSubcodeScalar(
+	LPBYTE lpRowSubcode,
+	LPBYTE lpColumnSubcode
+);
+
+BOOL AlignColumnSubcodeScalar(
+	LPBYTE lpColumnSubcode,
+	LPBYTE lpRowSubcode
+);
+
 BYTE BcdToDec(
 	BYTE bySrc
 );
@@ -0,0 +1,334 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "driveOffsetIndex.h"
+#include "output.h"
+
+// driveOffset.txt uses the other names for these vendors
+static LPCSTR s_lpVendorAlias[][2] = {
+	{ "HL-DT-ST", "LGELECTRONICS" },
+	{ "JLMS", "LITE-ON" },
+	{ "MATSHITA", "PANASONIC" },
+};
+
+// Copies the upper case string without the spaces
+static VOID NormalizeDriveOffsetWord(
+	LPCSTR pSrc,
+	size_t nSrcLen,
+	LPCH pDst,
+	size_t nDstSize
+) {
+	size_t j = 0;
+	for (size_t i = 0; i < nSrcLen && pSrc[i] != '\0' && j < nDstSize - 1; i++) {
+		if (pSrc[i] != ' ' && pSrc[i] != '\t') {
+			pDst[j++] = (CHAR)toupper((UCHAR)pSrc[i]);
+		}
+	}
+	pDst[j] = '\0';
+}
+
+// Copies the last word of the product, that is, the model (ex. PX-755A)
+static VOID GetDriveOffsetModel(
+	LPCSTR pSrc,
+	size_t nSrcLen,
+	LPCH pDst,
+	size_t nDstSize
+) {
+	while (nSrcLen > 0 && (pSrc[nSrcLen - 1] == ' ' || pSrc[nSrcLen - 1] == '\0')) {
+		nSrcLen--;
+	}
+	size_t nBegin = nSrcLen;
+	while (nBegin > 0 && pSrc[nBegin - 1] != ' ') {
+		nBegin--;
+	}
+	NormalizeDriveOffsetWord(&pSrc[nBegin], nSrcLen - nBegin, pDst, nDstSize);
+}
+
+// The revision is the suffix after the last digit (ex. 'B' of SH-S203B)
+static size_t GetDriveOffsetModelStemLen(
+	LPCSTR szModel
+) {
+	size_t nStemLen = 0;
+	for (size_t i = 0; szModel[i] != '\0'; i++) {
+		if (isdigit((UCHAR)szModel[i])) {
+			nStemLen = i + 1;
+		}
+	}
+	return nStemLen;
+}
+
+// Parses "Vendor - Product<tab>+Offset<tab>Submitted By<tab>Percentage Agree"
+static BOOL ParseDriveOffsetLine(
+	LPCH lpBuf,
+	DWORD dwLine,
+	PDRIVE_OFFSET_ENTRY pEntry
+) {
+	LPCH pTab = strchr(lpBuf, '\t');
+	if (!pTab) {
+		return FALSE;
+	}
+	LPCH pOffset = pTab + 1;
+	if (!strncmp(pOffset, "[Purged]", 8)) {
+		pEntry->byPurged = TRUE;
+		pEntry->nOffset = 0;
+	}
+	else {
+		LPCH pEnd = NULL;
+		pEntry->byPurged = FALSE;
+		pEntry->nOffset = strtol(pOffset, &pEnd, 10);
+		if (pEnd == pOffset || (*pEnd != '\t' && *pEnd != '\r' && *pEnd != '\n' && *pEnd != '\0')) {
+			return FALSE;
+		}
+	}
+	LPCH pProduct = NULL;
+	size_t nVendorLen = 0;
+	if (!strncmp(lpBuf, "- ", 2)) {
+		pProduct = lpBuf + 2;
+	}
+	else {
+		LPCH pSep = strstr(lpBuf, " - ");
+		if (!pSep || pSep > pTab) {
+			return FALSE;
+		}
+		nVendorLen = (size_t)(pSep - lpBuf);
+		pProduct = pSep + 3;
+	}
+	size_t nProductLen = (size_t)(pTab - pProduct);
+	NormalizeDriveOffsetWord(lpBuf, nVendorLen, pEntry->szVendor, sizeof(pEntry->szVendor));
+	NormalizeDriveOffsetWord(pProduct, nProductLen, pEntry->szProduct, sizeof(pEntry->szProduct));
+	GetDriveOffsetModel(pProduct, nProductLen, pEntry->szModel, sizeof(pEntry->szModel));
+	pEntry->dwLine = dwLine;
+	return pEntry->szModel[0] != '\0';
+}
+
+static int CompareDriveOffsetEntry(
+	const void* a,
+	const void* b
+) {
+	PDRIVE_OFFSET_ENTRY pA = (PDRIVE_OFFSET_ENTRY)a;
+	PDRIVE_OFFSET_ENTRY pB = (PDRIVE_OFFSET_ENTRY)b;
+	int nRet = strcmp(pA->szModel, pB->szModel);
+	if (nRet == 0) {
+		// keeps the order of driveOffset.txt in the same model
+		nRet = pA->dwLine < pB->dwLine ? -1 : pA->dwLine > pB->dwLine;
+	}
+	return nRet;
+}
+
+static BOOL BuildDriveOffsetIndex(
+	FILE* fpTxt,
+	PDRIVE_OFFSET_INDEX pIndex
+) {
+	CHAR lpBuf[1024] = { 0 };
+	DWORD dwLineNum = 0;
+	while (fgets(lpBuf, sizeof(lpBuf), fpTxt)) {
+		dwLineNum++;
+	}
+	rewind(fpTxt);
+	pIndex->pEntry = (PDRIVE_OFFSET_ENTRY)calloc(dwLineNum + 1, sizeof(DRIVE_OFFSET_ENTRY));
+	if (!pIndex->pEntry) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	pIndex->dwEntryNum = 0;
+	for (DWORD dwLine = 1; dwLine <= dwLineNum && fgets(lpBuf, sizeof(lpBuf), fpTxt); dwLine++) {
+		if (ParseDriveOffsetLine(lpBuf, dwLine, &pIndex->pEntry[pIndex->dwEntryNum])) {
+			pIndex->dwEntryNum++;
+		}
+	}
+	qsort(pIndex->pEntry, pIndex->dwEntryNum, sizeof(DRIVE_OFFSET_ENTRY), CompareDriveOffsetEntry);
+	return TRUE;
+}
+
+static BOOL ReadDriveOffsetIndex(
+	PDRIVE_OFFSET_INDEX_HEADER pExpected,
+	PDRIVE_OFFSET_INDEX pIndex
+) {
+	FILE* fpIdx = OpenProgrammabledFile(DRIVE_OFFSET_INDEX_FILE, _T("rb"));
+	if (!fpIdx) {
+		return FALSE;
+	}
+	BOOL bRet = FALSE;
+	DRIVE_OFFSET_INDEX_HEADER header = { 0 };
+	if (fread(&header, sizeof(header), 1, fpIdx) == 1 &&
+		!memcmp(&header, pExpected, offsetof(DRIVE_OFFSET_INDEX_HEADER, dwEntryNum))) {
+		pIndex->pEntry = (PDRIVE_OFFSET_ENTRY)calloc(header.dwEntryNum + 1, sizeof(DRIVE_OFFSET_ENTRY));
+		if (pIndex->pEntry &&
+			fread(pIndex->pEntry, sizeof(DRIVE_OFFSET_ENTRY), header.dwEntryNum, fpIdx) == header.dwEntryNum) {
+			pIndex->dwEntryNum = header.dwEntryNum;
+			bRet = TRUE;
+		}
+		else {
+			FreeAndNull(pIndex->pEntry);
+		}
+	}
+	fclose(fpIdx);
+	return bRet;
+}
+
+static VOID WriteDriveOffsetIndex(
+	PDRIVE_OFFSET_INDEX_HEADER pHeader,
+	PDRIVE_OFFSET_INDEX pIndex
+) {
+	// the directory of the executable may be read-only, then the index is only used in this run
+	FILE* fpIdx = OpenProgrammabledFile(DRIVE_OFFSET_INDEX_FILE, _T("wb"));
+	if (!fpIdx) {
+		return;
+	}
+	// a short write leaves fewer entries than dwEntryNum, so it is rebuilt at the next run
+	pHeader->dwEntryNum = pIndex->dwEntryNum;
+	if (fwrite(pHeader, sizeof(DRIVE_OFFSET_INDEX_HEADER), 1, fpIdx) == 1) {
+		fwrite(pIndex->pEntry, sizeof(DRIVE_OFFSET_ENTRY), pIndex->dwEntryNum, fpIdx);
+	}
+	fclose(fpIdx);
+}
+
+BOOL LoadDriveOffsetIndex(
+	PDRIVE_OFFSET_INDEX pIndex
+) {
+	pIndex->pEntry = NULL;
+	pIndex->dwEntryNum = 0;
+	FILE* fpTxt = OpenProgrammabledFile(_T("driveOffset.txt"), _T("r"));
+	if (!fpTxt) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	struct _stat64 statTxt = { 0 };
+	if (_fstat64(_fileno(fpTxt), &statTxt)) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		fclose(fpTxt);
+		return FALSE;
+	}
+	DRIVE_OFFSET_INDEX_HEADER header = { 0 };
+	memcpy(header.szMagic, "DOFS", sizeof(header.szMagic));
+	header.dwVersion = DRIVE_OFFSET_INDEX_VERSION;
+	header.dwEntrySize = sizeof(DRIVE_OFFSET_ENTRY);
+	header.llTxtSize = statTxt.st_size;
+	header.llTxtTime = statTxt.st_mtime;
+
+	BOOL bRet = TRUE;
+	if (!ReadDriveOffsetIndex(&header, pIndex)) {
+		bRet = BuildDriveOffsetIndex(fpTxt, pIndex);
+		if (bRet) {
+			WriteDriveOffsetIndex(&header, pIndex);
+		}
+	}
+	fclose(fpTxt);
+	return bRet;
+}
+
+VOID TerminateDriveOffsetIndex(
+	PDRIVE_OFFSET_INDEX pIndex
+) {
+	FreeAndNull(pIndex->pEntry);
+	pIndex->dwEntryNum = 0;
+}
+
+// Returns the first entry whose model is not less than szModel
+static DWORD LowerBoundDriveOffset(
+	PDRIVE_OFFSET_INDEX pIndex,
+	LPCSTR szModel,
+	size_t nLen
+) {
+	DWORD dwLow = 0;
+	DWORD dwHigh = pIndex->dwEntryNum;
+	while (dwLow < dwHigh) {
+		DWORD dwMid = dwLow + (dwHigh - dwLow) / 2;
+		if (strncmp(pIndex->pEntry[dwMid].szModel, szModel, nLen) < 0) {
+			dwLow = dwMid + 1;
+		}
+		else {
+			dwHigh = dwMid;
+		}
+	}
+	return dwLow;
+}
+
+BOOL LookUpDriveOffset(
+	PDRIVE_OFFSET_INDEX pIndex,
+	LPCSTR szVendorId,
+	LPCSTR szProductId,
+	LPINT lpDriveOffset
+) {
+	DRIVE_OFFSET_ENTRY key = { 0 };
+	NormalizeDriveOffsetWord(szVendorId, DRIVE_VENDOR_ID_SIZE, key.szVendor, sizeof(key.szVendor));
+	for (size_t i = 0; i < sizeof(s_lpVendorAlias) / sizeof(s_lpVendorAlias[0]); i++) {
+		if (!strcmp(key.szVendor, s_lpVendorAlias[i][0])) {
+			strncpy(key.szVendor, s_lpVendorAlias[i][1], sizeof(key.szVendor) - 1);
+			break;
+		}
+	}
+	NormalizeDriveOffsetWord(szProductId, DRIVE_PRODUCT_ID_SIZE, key.szProduct, sizeof(key.szProduct));
+	GetDriveOffsetModel(szProductId, DRIVE_PRODUCT_ID_SIZE, key.szModel, sizeof(key.szModel));
+	LPCSTR szModel = key.szModel;
+	if (szModel[0] == '\0') {
+		return FALSE;
+	}
+
+	// exact model. If it is listed by some vendors, the same product and vendor win
+	PDRIVE_OFFSET_ENTRY pBest = NULL;
+	INT nBestScore = -1;
+	for (DWORD i = LowerBoundDriveOffset(pIndex, szModel, sizeof(key.szModel));
+		i < pIndex->dwEntryNum && !strcmp(pIndex->pEntry[i].szModel, szModel); i++) {
+		INT nScore = (!strcmp(pIndex->pEntry[i].szProduct, key.szProduct) ? 2 : 0) +
+			(!strcmp(pIndex->pEntry[i].szVendor, key.szVendor) ? 1 : 0);
+		if (nScore > nBestScore) {
+			pBest = &pIndex->pEntry[i];
+			nBestScore = nScore;
+		}
+	}
+	if (pBest) {
+		if (pBest->byPurged) {
+			OutputLogA(standardOut | fileDrive
+				, "%s is [Purged] in driveOffset.txt (L:%lu)\n", szModel, pBest->dwLine);
+			return FALSE;
+		}
+		*lpDriveOffset = pBest->nOffset;
+		OutputLogA(standardOut | fileDrive
+			, "Drive offset of %s is %+d (driveOffset.txt L:%lu)\n", szModel, pBest->nOffset, pBest->dwLine);
+		return TRUE;
+	}
+
+	// other revisions of the model (ex. SH-S203D for SH-S203B) if all of them agree
+	size_t nStemLen = GetDriveOffsetModelStemLen(szModel);
+	if (nStemLen < 3) {
+		return FALSE;
+	}
+	UINT uiMatchNum = 0;
+	INT nOffset = 0;
+	for (DWORD i = LowerBoundDriveOffset(pIndex, szModel, nStemLen);
+		i < pIndex->dwEntryNum && !strncmp(pIndex->pEntry[i].szModel, szModel, nStemLen); i++) {
+		if (GetDriveOffsetModelStemLen(pIndex->pEntry[i].szModel) != nStemLen ||
+			pIndex->pEntry[i].byPurged) {
+			continue;
+		}
+		if (uiMatchNum > 0 && pIndex->pEntry[i].nOffset != nOffset) {
+			OutputLogA(standardOut | fileDrive
+				, "Drive offset of %.*s* doesn't agree between the revisions\n", (INT)nStemLen, szModel);
+			return FALSE;
+		}
+		nOffset = pIndex->pEntry[i].nOffset;
+		uiMatchNum++;
+	}
+	if (uiMatchNum == 0) {
+		return FALSE;
+	}
+	*lpDriveOffset = nOffset;
+	OutputLogA(standardOut | fileDrive
+		, "Drive offset of %s is %+d (the other revisions of %.*s* in driveOffset.txt)\n"
+		, szModel, nOffset, (INT)nStemLen, szModel);
+	return TRUE;
+}
@@ -0,0 +1,37 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// driveOffset.txt is compiled into this file next to the executable and
+// it is rebuilt when the size or the timestamp of driveOffset.txt changes
+#define DRIVE_OFFSET_INDEX_FILE		_T("driveOffset.idx")
+#define DRIVE_OFFSET_INDEX_VERSION	(1)
+
+BOOL LoadDriveOffsetIndex(
+	PDRIVE_OFFSET_INDEX pIndex
+);
+
+VOID TerminateDriveOffsetIndex(
+	PDRIVE_OFFSET_INDEX pIndex
+);
+
+BOOL LookUpDriveOffset(
+	PDRIVE_OFFSET_INDEX pIndex,
+	LPCSTR szVendorId,
+	LPCSTR szProductId,
+	LPINT lpDriveOffset
+);
@@ -0,0 +1,143 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "driveProfile.h"
+#include "output.h"
+
+static BOOL GetDriveProfilePath(
+	_TCHAR* szPath,
+	DWORD dwPathSize
+) {
+	if (!GetModuleFileName(NULL, szPath, dwPathSize)) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	if (!PathRemoveFileSpec(szPath)) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	if (!PathAppend(szPath, DRIVE_PROFILE_FILE)) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+// Copies the id of the inquiry data without the padding spaces
+static VOID TrimDriveId(
+	LPCSTR pSrc,
+	size_t nSrcLen,
+	LPCH pDst
+) {
+	size_t nLen = 0;
+	while (nLen < nSrcLen && pSrc[nLen] != '\0') {
+		nLen++;
+	}
+	while (nLen > 0 && pSrc[nLen - 1] == ' ') {
+		nLen--;
+	}
+	memcpy(pDst, pSrc, nLen);
+	pDst[nLen] = '\0';
+}
+
+// ex. [PLEXTOR DVDR PX-760A 1.07 0123456789]
+static VOID GetDriveProfileSection(
+	PDEVICE pDevice,
+	_TCHAR* szSection,
+	size_t nSectionSize
+) {
+	CHAR szVendor[DRIVE_VENDOR_ID_SIZE + 1] = { 0 };
+	CHAR szProduct[DRIVE_PRODUCT_ID_SIZE + 1] = { 0 };
+	CHAR szRevision[DRIVE_VERSION_ID_SIZE + 1] = { 0 };
+	TrimDriveId(pDevice->szVendorId, sizeof(pDevice->szVendorId), szVendor);
+	TrimDriveId(pDevice->szProductId, sizeof(pDevice->szProductId), szProduct);
+	TrimDriveId(pDevice->szProductRevisionLevel, sizeof(pDevice->szProductRevisionLevel), szRevision);
+	_sntprintf(szSection, nSectionSize, _T("%hs %hs %hs %hs")
+		, szVendor, szProduct, szRevision, pDevice->PROFILE.szSerialNumber);
+	szSection[nSectionSize - 1] = 0;
+}
+
+static VOID WriteDriveProfileInt(
+	LPCTSTR szSection,
+	LPCTSTR szKey,
+	INT nValue,
+	LPCTSTR szPath
+) {
+	_TCHAR szValue[16] = { 0 };
+	_sntprintf(szValue, sizeof(szValue) / sizeof(szValue[0]), _T("%d"), nValue);
+	szValue[15] = 0;
+	WritePrivateProfileString(szSection, szKey, szValue, szPath);
+}
+
+BOOL LoadDriveProfile(
+	PDEVICE pDevice
+) {
+	_TCHAR szPath[_MAX_PATH] = { 0 };
+	if (!GetDriveProfilePath(szPath, sizeof(szPath) / sizeof(szPath[0]))) {
+		return FALSE;
+	}
+	_TCHAR szSection[128] = { 0 };
+	GetDriveProfileSection(pDevice, szSection, sizeof(szSection) / sizeof(szSection[0]));
+
+	_DEVICE::_PROFILE* pProfile = &pDevice->PROFILE;
+	if (GetPrivateProfileInt(szSection, _T("Version"), 0, szPath) != DRIVE_PROFILE_VERSION) {
+		pProfile->byExist = FALSE;
+		return FALSE;
+	}
+	pProfile->byExist = TRUE;
+	pProfile->byC2Probed = (BYTE)GetPrivateProfileInt(szSection, _T("C2Probed"), FALSE, szPath);
+	pProfile->byC2OpCode = (BYTE)GetPrivateProfileInt(szSection, _T("C2OpCode"), 0, szPath);
+	pProfile->byC2Type = (BYTE)GetPrivateProfileInt(szSection, _T("C2Type"), CDFLAG::_READ_CD::NoC2, szPath);
+	pProfile->driveOrder = (DRIVE_DATA_ORDER)GetPrivateProfileInt(szSection, _T("DriveOrder"), DRIVE_DATA_ORDER::NoC2, szPath);
+	pProfile->byLeadIn = (BYTE)GetPrivateProfileInt(szSection, _T("LeadIn"), FALSE, szPath);
+	pProfile->byLeadOut = (BYTE)GetPrivateProfileInt(szSection, _T("LeadOut"), FALSE, szPath);
+	pProfile->byDriveOffset = (BYTE)GetPrivateProfileInt(szSection, _T("DriveOffsetDefined"), FALSE, szPath);
+	pProfile->nDriveSampleOffset = (INT)GetPrivateProfileInt(szSection, _T("DriveOffset"), 0, szPath);
+	pProfile->dwMaxTransferLength = GetPrivateProfileInt(szSection, _T("MaxTransferLength"), 0, szPath);
+	pProfile->dwBufferSize = GetPrivateProfileInt(szSection, _T("BufferSize"), 0, szPath);
+	pProfile->dwRawTransferLen = GetPrivateProfileInt(szSection, _T("RawTransferLength"), 0, szPath);
+	pProfile->nRawRereadMax = (INT)GetPrivateProfileInt(szSection, _T("RawRereadMax"), 0, szPath);
+	OutputLogA(standardOut | fileDrive, "This drive is found in driveProfile.ini\n");
+	return TRUE;
+}
+
+VOID SaveDriveProfile(
+	PDEVICE pDevice
+) {
+	_TCHAR szPath[_MAX_PATH] = { 0 };
+	if (!GetDriveProfilePath(szPath, sizeof(szPath) / sizeof(szPath[0]))) {
+		return;
+	}
+	_TCHAR szSection[128] = { 0 };
+	GetDriveProfileSection(pDevice, szSection, sizeof(szSection) / sizeof(szSection[0]));
+
+	// the directory of the executable may be read-only, then the probes only run again next time
+	_DEVICE::_PROFILE* pProfile = &pDevice->PROFILE;
+	WriteDriveProfileInt(szSection, _T("Version"), DRIVE_PROFILE_VERSION, szPath);
+	WriteDriveProfileInt(szSection, _T("C2Probed"), pProfile->byC2Probed, szPath);
+	WriteDriveProfileInt(szSection, _T("C2OpCode"), pProfile->byC2OpCode, szPath);
+	WriteDriveProfileInt(szSection, _T("C2Type"), pProfile->byC2Type, szPath);
+	WriteDriveProfileInt(szSection, _T("DriveOrder"), pProfile->driveOrder, szPath);
+	WriteDriveProfileInt(szSection, _T("LeadIn"), pProfile->byLeadIn, szPath);
+	WriteDriveProfileInt(szSection, _T("LeadOut"), pProfile->byLeadOut, szPath);
+	WriteDriveProfileInt(szSection, _T("DriveOffsetDefined"), pProfile->byDriveOffset, szPath);
+	WriteDriveProfileInt(szSection, _T("DriveOffset"), pProfile->nDriveSampleOffset, szPath);
+	WriteDriveProfileInt(szSection, _T("MaxTransferLength"), (INT)pProfile->dwMaxTransferLength, szPath);
+	WriteDriveProfileInt(szSection, _T("BufferSize"), (INT)pProfile->dwBufferSize, szPath);
+	WriteDriveProfileInt(szSection, _T("RawTransferLength"), (INT)pProfile->dwRawTransferLen, szPath);
+	WriteDriveProfileInt(szSection, _T("RawRereadMax"), pProfile->nRawRereadMax, szPath);
+	pProfile->byExist = TRUE;
+}
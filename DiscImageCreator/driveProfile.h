@@ -0,0 +1,30 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// The capabilities found by the probes are kept per drive
+// (vendor, product, revision and serial number) next to the executable
+#define DRIVE_PROFILE_FILE		_T("driveProfile.ini")
+#define DRIVE_PROFILE_VERSION	(1)
+
+BOOL LoadDriveProfile(
+	PDEVICE pDevice
+);
+
+VOID SaveDriveProfile(
+	PDEVICE pDevice
+);
@@ -0,0 +1,262 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "calcHash.h"
+#include "dvdUnscrambler.h"
+#include "execScsiCmdforDVD.h"
+
+// ECMA-267 Table 2: the initial value of the shift register
+// selected by the bits 7-4 of the sector num
+static CONST WORD s_wEcma267Seed[DVD_ECC_BLOCK_FRAME_NUM] = {
+	0x0001, 0x5500, 0x0002, 0x2a00, 0x0004, 0x5400, 0x0008, 0x2800,
+	0x0010, 0x5000, 0x0020, 0x2001, 0x0040, 0x4002, 0x0080, 0x0005
+};
+
+// ECMA-267 16.3: x^15 + x^11 + 1, the lower 8 bits of the register are
+// the scramble byte and the register shifts 8 bits per byte
+static VOID GenerateDvdScrambleStream(
+	WORD wSeed,
+	LPBYTE lpStream
+) {
+	UINT r = wSeed;
+	for (INT i = 0; i < DISC_RAW_READ_SIZE; i++) {
+		lpStream[i] = (BYTE)r;
+		for (INT j = 0; j < CHAR_BIT; j++) {
+			r = ((r << 1) | ((r >> 14 ^ r >> 10) & 0x01)) & 0x7fff;
+		}
+	}
+}
+
+// Both the scramble and the EDC are linear, so the EDC of the scrambled frame
+// xor its EDC field is the EDC of the stream, and it is the xor of the EDC of
+// the stream of each bit of the seed. The latter is kept as the basis to solve
+// the seed from a frame without knowing the sector num.
+VOID InitDvdUnscrambler(
+	PDVD_UNSCRAMBLER pUnsc,
+	BOOL bNintendo
+) {
+	ZeroMemory(pUnsc, sizeof(DVD_UNSCRAMBLER));
+	pUnsc->byNintendo = (BYTE)bNintendo;
+
+	BYTE lpStream[DISC_RAW_READ_SIZE] = { 0 };
+	for (INT i = 0; i < 15; i++) {
+		WORD wSeed = (WORD)(1 << i);
+		GenerateDvdScrambleStream(wSeed, lpStream);
+		DWORD dwEdc = 0;
+		GetCrc32Ecma267(&dwEdc, lpStream, DISC_RAW_READ_SIZE);
+		for (INT j = 31; j >= 0 && dwEdc; j--) {
+			if (dwEdc >> j & 0x01) {
+				if (!pUnsc->dwEdcBasis[j]) {
+					pUnsc->dwEdcBasis[j] = dwEdc;
+					pUnsc->wBasisSeed[j] = wSeed;
+					break;
+				}
+				dwEdc ^= pUnsc->dwEdcBasis[j];
+				wSeed ^= pUnsc->wBasisSeed[j];
+			}
+		}
+	}
+	if (!bNintendo) {
+		for (INT i = 0; i < DVD_ECC_BLOCK_FRAME_NUM; i++) {
+			pUnsc->wSeed[i] = s_wEcma267Seed[i];
+			GenerateDvdScrambleStream(pUnsc->wSeed[i], pUnsc->lpStream[i]);
+		}
+	}
+}
+
+// multiply by the primitive element of GF(2^8), x^8 + x^4 + x^3 + x^2 + 1
+static BYTE MultiplyAlpha(
+	BYTE by
+) {
+	return (BYTE)(by << 1 ^ (by & 0x80 ? 0x1d : 0));
+}
+
+// ECMA-267 16.2: IED is the remainder of ID * x^2 / (x + 1)(x + alpha)
+BOOL IsValidDvdId(
+	LPBYTE lpFrame
+) {
+	BYTE byR1 = 0;
+	BYTE byR0 = 0;
+	for (INT i = 0; i < DVD_FRAME_IED_OFFSET; i++) {
+		BYTE byFb = (BYTE)(lpFrame[i] ^ byR1);
+		byR1 = (BYTE)(byR0 ^ MultiplyAlpha(byFb) ^ byFb);
+		byR0 = MultiplyAlpha(byFb);
+	}
+	return lpFrame[DVD_FRAME_IED_OFFSET] == byR1 && lpFrame[DVD_FRAME_IED_OFFSET + 1] == byR0;
+}
+
+static BOOL GetDvdScrambleSeed(
+	PDVD_UNSCRAMBLER pUnsc,
+	DWORD dwEdc,
+	LPWORD lpSeed
+) {
+	WORD wSeed = 0;
+	for (INT i = 31; i >= 0 && dwEdc; i--) {
+		if (dwEdc >> i & 0x01) {
+			if (!pUnsc->dwEdcBasis[i]) {
+				return FALSE;
+			}
+			dwEdc ^= pUnsc->dwEdcBasis[i];
+			wSeed ^= pUnsc->wBasisSeed[i];
+		}
+	}
+	*lpSeed = wSeed;
+	return TRUE;
+}
+
+static DWORD GetDvdBlockNum(
+	LPBYTE lpFrame
+) {
+	DWORD dwSectorNum = MAKEDWORD(MAKEWORD(lpFrame[3], lpFrame[2]), MAKEWORD(lpFrame[1], 0));
+	return dwSectorNum / DVD_ECC_BLOCK_FRAME_NUM;
+}
+
+// Returns FALSE if the EDC of the frame doesn't match by any seed
+static BOOL GetDvdFrameSeed(
+	PDVD_UNSCRAMBLER pUnsc,
+	LPBYTE lpFrame,
+	LPWORD lpSeed
+) {
+	LPBYTE lpEdc = lpFrame + DVD_FRAME_EDC_OFFSET;
+	DWORD dwEdc = MAKEDWORD(MAKEWORD(lpEdc[3], lpEdc[2]), MAKEWORD(lpEdc[1], lpEdc[0]));
+	DWORD dwCrc = 0;
+	GetCrc32Ecma267(&dwCrc, lpFrame, DVD_FRAME_EDC_OFFSET);
+	return GetDvdScrambleSeed(pUnsc, dwCrc ^ dwEdc, lpSeed);
+}
+
+static VOID SetDvdBlockSeed(
+	PDVD_UNSCRAMBLER pUnsc,
+	DWORD dwBlock,
+	WORD wSeed
+) {
+	pUnsc->dwBlock = dwBlock;
+	if (pUnsc->wBlockSeed != wSeed) {
+		pUnsc->wBlockSeed = wSeed;
+		if (wSeed) {
+			GenerateDvdScrambleStream(wSeed, pUnsc->lpBlockStream);
+		}
+	}
+}
+
+// A frame whose EDC matches by the seed 0 isn't scrambled. The main data is
+// unscrambled by the seed of the ECC block even if the EDC doesn't match.
+static BOOL UnscrambleDvdFrameBySeed(
+	LPBYTE lpFrame,
+	LPBYTE lpMainData,
+	BOOL bSolved,
+	WORD wSeed,
+	WORD wBlockSeed,
+	LPBYTE lpStream
+) {
+	BOOL bRet = bSolved && (!wSeed || wSeed == wBlockSeed);
+	if (lpMainData) {
+		LPBYTE lpData = lpFrame + DVD_FRAME_DATA_OFFSET;
+		if ((bRet && !wSeed) || !wBlockSeed) {
+			memcpy(lpMainData, lpData, DISC_RAW_READ_SIZE);
+		}
+		else {
+			for (INT i = 0; i < DISC_RAW_READ_SIZE; i++) {
+				lpMainData[i] = (BYTE)(lpData[i] ^ lpStream[i]);
+			}
+		}
+	}
+	return bRet;
+}
+
+// Returns TRUE if the EDC matches. The main data is unscrambled to lpMainData
+// (if not NULL) even if it doesn't, by the seed of the ECC block if known.
+// The seed of the Nintendo disc changes per ECC block (the block 0 isn't
+// scrambled by the disc key but the others are), so it's taken from the first
+// valid frame of the block and isn't carried to the next one.
+BOOL UnscrambleDvdFrame(
+	PDVD_UNSCRAMBLER pUnsc,
+	LPBYTE lpFrame,
+	LPBYTE lpMainData
+) {
+	WORD wSeed = 0;
+	BOOL bSolved = GetDvdFrameSeed(pUnsc, lpFrame, &wSeed);
+	if (pUnsc->byNintendo) {
+		DWORD dwBlock = GetDvdBlockNum(lpFrame);
+		if (pUnsc->dwBlock != dwBlock) {
+			SetDvdBlockSeed(pUnsc, dwBlock, 0);
+		}
+		if (bSolved && wSeed && !pUnsc->wBlockSeed) {
+			SetDvdBlockSeed(pUnsc, dwBlock, wSeed);
+		}
+		return UnscrambleDvdFrameBySeed(lpFrame, lpMainData
+			, bSolved, wSeed, pUnsc->wBlockSeed, pUnsc->lpBlockStream);
+	}
+	INT nIdx = lpFrame[3] >> 4 & 0x0f;
+	return UnscrambleDvdFrameBySeed(lpFrame, lpMainData
+		, bSolved, wSeed, pUnsc->wSeed[nIdx], pUnsc->lpStream[nIdx]);
+}
+
+// Unscrambles the frames of an ECC block, and lpValidFlag is set per frame.
+// The seed of the Nintendo disc is solved by all the frames of the block, and
+// the one which the most of them solve is taken, so a broken frame which
+// happens to solve another seed can't decide it even if it's the first one.
+// Returns TRUE if all the frames agree with the seed.
+BOOL UnscrambleDvdBlock(
+	PDVD_UNSCRAMBLER pUnsc,
+	LPBYTE lpFrame,
+	INT nFrameNum,
+	LPBYTE lpMainData,
+	LPBYTE lpValidFlag
+) {
+	if (!pUnsc->byNintendo) {
+		BOOL bRet = TRUE;
+		for (INT i = 0; i < nFrameNum; i++) {
+			lpValidFlag[i] = (BYTE)UnscrambleDvdFrame(pUnsc
+				, lpFrame + DVD_RAW_READ * i, lpMainData + DISC_RAW_READ_SIZE * i);
+			bRet &= lpValidFlag[i];
+		}
+		return bRet;
+	}
+	WORD wSeed[DVD_ECC_BLOCK_FRAME_NUM] = {};
+	BOOL bSolved[DVD_ECC_BLOCK_FRAME_NUM] = {};
+	INT nBest = -1;
+	INT nBestNum = 0;
+	for (INT i = 0; i < nFrameNum; i++) {
+		bSolved[i] = GetDvdFrameSeed(pUnsc, lpFrame + DVD_RAW_READ * i, &wSeed[i]);
+		if (!bSolved[i] || !wSeed[i]) {
+			continue;
+		}
+		INT nNum = 0;
+		for (INT j = 0; j <= i; j++) {
+			if (bSolved[j] && wSeed[j] == wSeed[i]) {
+				nNum++;
+			}
+		}
+		if (nNum > nBestNum) {
+			nBest = i;
+			nBestNum = nNum;
+		}
+	}
+	if (nBest == -1) {
+		SetDvdBlockSeed(pUnsc, GetDvdBlockNum(lpFrame), 0);
+	}
+	else {
+		SetDvdBlockSeed(pUnsc, GetDvdBlockNum(lpFrame + DVD_RAW_READ * nBest), wSeed[nBest]);
+	}
+	BOOL bRet = TRUE;
+	for (INT i = 0; i < nFrameNum; i++) {
+		lpValidFlag[i] = (BYTE)UnscrambleDvdFrameBySeed(lpFrame + DVD_RAW_READ * i
+			, lpMainData + DISC_RAW_READ_SIZE * i, bSolved[i], wSeed[i]
+			, pUnsc->wBlockSeed, pUnsc->lpBlockStream);
+		bRet &= lpValidFlag[i];
+	}
+	return bRet;
+}
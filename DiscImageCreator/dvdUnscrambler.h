@@ -0,0 +1,58 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// the data frame of ECMA-267 (DVD_RAW_READ bytes)
+// ID (4), IED (2), CPR_MAI (6), main data (2048), EDC (4)
+#define DVD_FRAME_IED_OFFSET		(4)
+#define DVD_FRAME_DATA_OFFSET		(12)
+#define DVD_FRAME_EDC_OFFSET		(2060)
+// the seed of the scramble changes every ECC block
+#define DVD_ECC_BLOCK_FRAME_NUM		(16)
+
+// the return values of UnscrambleDvdRaw, same as unscrambler.exe
+// the num of the first ECC block which has an error is returned instead of 0
+#define UNSCRAMBLE_OK				(0)
+#define UNSCRAMBLE_OPEN_RAW_ERROR	(1)
+#define UNSCRAMBLE_OPEN_ISO_ERROR	(2)
+#define UNSCRAMBLE_MEMORY_ERROR		(3)
+// an error in the ECC block 0-6, whose num can't be returned
+#define UNSCRAMBLE_NO_SEED_ERROR	(4)
+#define UNSCRAMBLE_WRITE_ISO_ERROR	(6)
+
+VOID InitDvdUnscrambler(
+	PDVD_UNSCRAMBLER pUnsc,
+	BOOL bNintendo
+);
+
+BOOL IsValidDvdId(
+	LPBYTE lpFrame
+);
+
+BOOL UnscrambleDvdFrame(
+	PDVD_UNSCRAMBLER pUnsc,
+	LPBYTE lpFrame,
+	LPBYTE lpMainData
+);
+
+BOOL UnscrambleDvdBlock(
+	PDVD_UNSCRAMBLER pUnsc,
+	LPBYTE lpFrame,
+	INT nFrameNum,
+	LPBYTE lpMainData,
+	LPBYTE lpValidFlag
+);
@@ -0,0 +1,284 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "convert.h"
+#include "eccRtoW.h"
+
+// GF(2^6), primitive polynomial x^6 + x + 1
+// The table is generated at compile time, so it can be used from any thread.
+struct GF_TABLE {
+	BYTE byExp[63 * 2];
+	BYTE byLog[64];
+	constexpr GF_TABLE() : byExp(), byLog() {
+		UINT x = 1;
+		for (INT i = 0; i < 63; i++) {
+			byExp[i] = (BYTE)x;
+			byExp[i + 63] = (BYTE)x;
+			byLog[x] = (BYTE)i;
+			x <<= 1;
+			if (x & 0x40) {
+				x ^= 0x43;
+			}
+		}
+	}
+};
+
+static constexpr GF_TABLE s_gf{};
+
+static constexpr BOOL CheckGfTable(
+	VOID
+) {
+	for (INT i = 0; i < 63; i++) {
+		if (s_gf.byLog[s_gf.byExp[i]] != i) {
+			return FALSE;
+		}
+	}
+	return s_gf.byExp[6] == 0x03;
+}
+static_assert(CheckGfTable(), "GF(2^6) table is broken");
+// pack symbols are swapped before the delay (1 <-> 18, 2 <-> 5, 3 <-> 23)
+static CONST BYTE s_rtowSwapTable[RTOW_PACK_SIZE] = {
+	0, 18, 5, 23, 4, 2, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 1, 19, 20, 21, 22, 3
+};
+
+BYTE GfMul(
+	BYTE a,
+	BYTE b
+) {
+	if (a == 0 || b == 0) {
+		return 0;
+	}
+	return s_gf.byExp[s_gf.byLog[a] + s_gf.byLog[b]];
+}
+
+BYTE GfDiv(
+	BYTE a,
+	BYTE b
+) {
+	if (a == 0) {
+		return 0;
+	}
+	return s_gf.byExp[s_gf.byLog[a] + 63 - s_gf.byLog[b]];
+}
+
+// S(j) = c(a^j), symbol 0 is the coefficient of the highest degree
+BOOL GetRtoWSyndrome(
+	LPBYTE lpCode,
+	INT nLen,
+	INT nParity,
+	LPBYTE lpSyndrome
+) {
+	BYTE byOr = 0;
+	for (INT j = 0; j < nParity; j++) {
+		BYTE s = 0;
+		for (INT i = 0; i < nLen; i++) {
+			s = (BYTE)(GfMul(s, s_gf.byExp[j]) ^ lpCode[i]);
+		}
+		lpSyndrome[j] = s;
+		byOr |= s;
+	}
+	return byOr != 0;
+}
+
+// RS(nLen, nLen - nParity) corrects nParity / 2 symbols.
+// return: number of the corrected symbols or RTOW_UNCORRECTABLE
+INT CorrectRtoWCode(
+	LPBYTE lpCode,
+	INT nLen,
+	INT nParity
+) {
+	BYTE S[4] = { 0 };
+	if (!GetRtoWSyndrome(lpCode, nLen, nParity, S)) {
+		return 0;
+	}
+	BYTE byBackup[RTOW_PACK_SIZE] = { 0 };
+	memcpy(byBackup, lpCode, (size_t)nLen);
+	INT nCorrected = RTOW_UNCORRECTABLE;
+
+	// 1 symbol error: S(j + 1) = S(j) * X
+	if (S[0] != 0 && S[1] != 0) {
+		BYTE X = GfDiv(S[1], S[0]);
+		BOOL bSingle = TRUE;
+		for (INT j = 1; j + 1 < nParity; j++) {
+			if (GfMul(S[j], X) != S[j + 1]) {
+				bSingle = FALSE;
+				break;
+			}
+		}
+		INT nPos = nLen - 1 - s_gf.byLog[X];
+		if (bSingle && 0 <= nPos) {
+			lpCode[nPos] ^= S[0];
+			nCorrected = 1;
+		}
+	}
+	// 2 symbol errors: error locator 1 + L1 x + L2 x^2 by the Peterson's method
+	if (nCorrected == RTOW_UNCORRECTABLE && nParity == 4) {
+		BYTE det = (BYTE)(GfMul(S[1], S[1]) ^ GfMul(S[0], S[2]));
+		if (det != 0) {
+			BYTE L1 = GfDiv((BYTE)(GfMul(S[1], S[2]) ^ GfMul(S[0], S[3])), det);
+			BYTE L2 = GfDiv((BYTE)(GfMul(S[1], S[3]) ^ GfMul(S[2], S[2])), det);
+			INT nPos[2] = { 0 };
+			INT nRoot = 0;
+			// Chien search in the range of the code
+			for (INT i = 0; i < nLen; i++) {
+				BYTE Xinv = s_gf.byExp[(63 - (nLen - 1 - i)) % 63];
+				if ((1 ^ GfMul(L1, Xinv) ^ GfMul(L2, GfMul(Xinv, Xinv))) == 0) {
+					if (nRoot < 2) {
+						nPos[nRoot] = i;
+					}
+					nRoot++;
+				}
+			}
+			if (nRoot == 2) {
+				BYTE X1 = s_gf.byExp[nLen - 1 - nPos[0]];
+				BYTE X2 = s_gf.byExp[nLen - 1 - nPos[1]];
+				BYTE e1 = GfDiv((BYTE)(S[1] ^ GfMul(S[0], X2)), (BYTE)(X1 ^ X2));
+				BYTE e2 = (BYTE)(S[0] ^ e1);
+				lpCode[nPos[0]] ^= e1;
+				lpCode[nPos[1]] ^= e2;
+				nCorrected = 2;
+			}
+		}
+	}
+	// reject the miscorrection
+	if (nCorrected != RTOW_UNCORRECTABLE && GetRtoWSyndrome(lpCode, nLen, nParity, S)) {
+		nCorrected = RTOW_UNCORRECTABLE;
+	}
+	if (nCorrected == RTOW_UNCORRECTABLE) {
+		memcpy(lpCode, byBackup, (size_t)nLen);
+	}
+	return nCorrected;
+}
+
+// lpSymbol: 96 symbols (bit 0x3f of the raw sub-channel)
+VOID SetRtoWSymbolFromRowSubcode(
+	LPBYTE lpSymbol,
+	LPBYTE lpRowSubcode
+) {
+	ZeroMemory(lpSymbol, CD_RAW_READ_SUBCODE_SIZE);
+	AlignColumnSubcode(lpSymbol, lpRowSubcode);
+	for (INT i = 0; i < CD_RAW_READ_SUBCODE_SIZE; i++) {
+		lpSymbol[i] &= 0x3f;
+	}
+}
+
+// Inverse of SetRtoWSymbolFromRowSubcode. The P-Q of lpRowSubcode isn't changed
+VOID SetRowSubcodeFromRtoWSymbol(
+	LPBYTE lpRowSubcode,
+	LPBYTE lpSymbol
+) {
+	BYTE column[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+	AlignColumnSubcode(column, lpRowSubcode);
+	for (INT i = 0; i < CD_RAW_READ_SUBCODE_SIZE; i++) {
+		column[i] = (BYTE)((column[i] & 0xc0) | (lpSymbol[i] & 0x3f));
+	}
+	AlignRowSubcode(lpRowSubcode, column);
+}
+
+// lpSymbol: the symbols in the order of the disc. The pack nPackIdx needs
+// the symbols until the pack (nPackIdx + RTOW_INTERLEAVE_DELAY - 1)
+VOID DeinterleaveRtoW(
+	LPBYTE lpPack,
+	LPBYTE lpSymbol,
+	INT nPackIdx
+) {
+	for (INT i = 0; i < RTOW_PACK_SIZE; i++) {
+		lpPack[s_rtowSwapTable[i]] =
+			lpSymbol[(nPackIdx + i % RTOW_INTERLEAVE_DELAY) * RTOW_PACK_SIZE + i];
+	}
+}
+
+VOID InterleaveRtoW(
+	LPBYTE lpSymbol,
+	LPBYTE lpPack,
+	INT nPackIdx
+) {
+	for (INT i = 0; i < RTOW_PACK_SIZE; i++) {
+		lpSymbol[(nPackIdx + i % RTOW_INTERLEAVE_DELAY) * RTOW_PACK_SIZE + i] =
+			lpPack[s_rtowSwapTable[i]];
+	}
+}
+
+// lpPack: de-interleaved 24 symbols
+// return: number of the corrected symbols or RTOW_UNCORRECTABLE
+INT CorrectRtoWPack(
+	LPBYTE lpPack
+) {
+	BYTE byBackup[RTOW_PACK_SIZE] = { 0 };
+	memcpy(byBackup, lpPack, sizeof(byBackup));
+	INT nQ = 0;
+	INT nP = CorrectRtoWCode(lpPack, RTOW_PACK_SIZE, 4);
+	if (nP == RTOW_UNCORRECTABLE) {
+		// 3 or more errors. If one of them is in the symbol 0-3, Q can fix it
+		nQ = CorrectRtoWCode(lpPack, 4, 2);
+		if (nQ != RTOW_UNCORRECTABLE) {
+			nP = CorrectRtoWCode(lpPack, RTOW_PACK_SIZE, 4);
+		}
+	}
+	BYTE S[2] = { 0 };
+	if (nP == RTOW_UNCORRECTABLE || nQ == RTOW_UNCORRECTABLE ||
+		GetRtoWSyndrome(lpPack, 4, 2, S)) {
+		memcpy(lpPack, byBackup, sizeof(byBackup));
+		return RTOW_UNCORRECTABLE;
+	}
+	return nP + nQ;
+}
+
+// Correct the whole R-W of the disc at a time and write back to lpSymbol.
+// lpResult[n] (optional) is the return value of CorrectRtoWPack of the pack n.
+// The last (RTOW_INTERLEAVE_DELAY - 1) packs aren't checked because these are
+// not complete.
+// return: number of the checked packs
+INT CorrectRtoWSymbol(
+	LPBYTE lpSymbol,
+	INT nPackNum,
+	LPINT lpResult,
+	LPINT lpCorrectedPackNum,
+	LPINT lpUncorrectablePackNum
+) {
+	INT nCheckedNum = nPackNum - (RTOW_INTERLEAVE_DELAY - 1);
+	*lpCorrectedPackNum = 0;
+	*lpUncorrectablePackNum = 0;
+	for (INT n = 0; n < nPackNum; n++) {
+		if (lpResult) {
+			lpResult[n] = 0;
+		}
+	}
+	for (INT n = 0; n < nCheckedNum; n++) {
+		BYTE pack[RTOW_PACK_SIZE] = { 0 };
+		DeinterleaveRtoW(pack, lpSymbol, n);
+		BYTE byOr = 0;
+		for (INT i = 0; i < RTOW_PACK_SIZE; i++) {
+			byOr |= pack[i];
+		}
+		if (byOr == 0) {
+			// zero pack is a codeword, most of the disc is so
+			continue;
+		}
+		INT nRet = CorrectRtoWPack(pack);
+		if (lpResult) {
+			lpResult[n] = nRet;
+		}
+		if (nRet == RTOW_UNCORRECTABLE) {
+			(*lpUncorrectablePackNum)++;
+		}
+		else if (nRet > 0) {
+			InterleaveRtoW(lpSymbol, pack, n);
+			(*lpCorrectedPackNum)++;
+		}
+	}
+	return nCheckedNum < 0 ? 0 : nCheckedNum;
+}
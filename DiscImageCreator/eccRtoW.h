@@ -0,0 +1,60 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// R-W sub-channel of CD+G, CD+MIDI etc. (IEC 60908 17.5)
+// 1 sector = 4 packs, 1 pack = 24 symbols (6 bits).
+// Q parity: RS(4,2) of symbol 0-3, P parity: RS(24,20) of symbol 0-23 over GF(2^6)
+#define RTOW_PACK_SIZE			(24)
+#define RTOW_PACK_PER_SECTOR	(4)
+// symbol n of the pack is delayed (n % 8) packs on the disc
+#define RTOW_INTERLEAVE_DELAY	(8)
+#define RTOW_UNCORRECTABLE		(-1)
+
+VOID SetRtoWSymbolFromRowSubcode(
+	LPBYTE lpSymbol,
+	LPBYTE lpRowSubcode
+);
+
+VOID SetRowSubcodeFromRtoWSymbol(
+	LPBYTE lpRowSubcode,
+	LPBYTE lpSymbol
+);
+
+VOID DeinterleaveRtoW(
+	LPBYTE lpPack,
+	LPBYTE lpSymbol,
+	INT nPackIdx
+);
+
+VOID InterleaveRtoW(
+	LPBYTE lpSymbol,
+	LPBYTE lpPack,
+	INT nPackIdx
+);
+
+INT CorrectRtoWPack(
+	LPBYTE lpPack
+);
+
+INT CorrectRtoWSymbol(
+	LPBYTE lpSymbol,
+	INT nPackNum,
+	LPINT lpResult,
+	LPINT lpCorrectedPackNum,
+	LPINT lpUncorrectablePackNum
+);
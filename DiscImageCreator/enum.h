@@ -32,7 +32,9 @@ typedef enum _EXEC_TYPE {
 	reset,
 	drivespeed,
 	sub,
-	mds
+	mds,
+	offline,
+	sparse
 } EXEC_TYPE, *PEXEC_TYPE;
 
 typedef enum _LOG_TYPE {
@@ -0,0 +1,245 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "errorMap.h"
+#include "output.h"
+
+// The ranges are sorted by the LBA and cover 0 to nSectorNum - 1 without a gap.
+// The adjacent ranges always have the different status, so the map of a good
+// disc is only 1 range.
+static BOOL ReserveErrorMapRange(
+	PERROR_MAP pMap,
+	INT nRangeNum
+) {
+	if (pMap->nRangeNum + nRangeNum <= pMap->nRangeMax) {
+		return TRUE;
+	}
+	INT nRangeMax = max(pMap->nRangeMax * 2, pMap->nRangeNum + nRangeNum);
+	PERROR_MAP_RANGE pRange = (PERROR_MAP_RANGE)realloc(
+		pMap->pRange, sizeof(ERROR_MAP_RANGE) * (size_t)max(nRangeMax, 16));
+	if (!pRange) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	pMap->pRange = pRange;
+	pMap->nRangeMax = max(nRangeMax, 16);
+	return TRUE;
+}
+
+BOOL InitErrorMap(
+	PERROR_MAP pMap,
+	INT nSectorNum,
+	DWORD dwSectorSize
+) {
+	ZeroMemory(pMap, sizeof(ERROR_MAP));
+	if (!ReserveErrorMapRange(pMap, 1)) {
+		return FALSE;
+	}
+	pMap->nSectorNum = nSectorNum;
+	pMap->dwSectorSize = dwSectorSize;
+	pMap->pRange[0].nLBA = 0;
+	pMap->pRange[0].nSectorNum = nSectorNum;
+	pMap->pRange[0].cStatus = ERROR_MAP_UNTRIED;
+	pMap->nRangeNum = 1;
+	return TRUE;
+}
+
+BOOL SetErrorMapRange(
+	PERROR_MAP pMap,
+	INT nLBA,
+	INT nSectorNum,
+	CHAR cStatus
+) {
+	INT nEnd = min(nLBA + nSectorNum, pMap->nSectorNum);
+	nLBA = max(nLBA, 0);
+	if (nEnd <= nLBA) {
+		return TRUE;
+	}
+	// a range is split into 3 at most
+	if (!ReserveErrorMapRange(pMap, 2)) {
+		return FALSE;
+	}
+	PERROR_MAP_RANGE pRange = pMap->pRange;
+	// the ranges from i to j - 1 overlap nLBA to nEnd - 1
+	INT i = 0;
+	while (pRange[i].nLBA + pRange[i].nSectorNum <= nLBA) {
+		i++;
+	}
+	INT j = i;
+	while (j < pMap->nRangeNum && pRange[j].nLBA < nEnd) {
+		j++;
+	}
+	ERROR_MAP_RANGE aNew[3] = { 0 };
+	INT nNewNum = 0;
+	if (pRange[i].nLBA < nLBA) {
+		aNew[nNewNum].nLBA = pRange[i].nLBA;
+		aNew[nNewNum].nSectorNum = nLBA - pRange[i].nLBA;
+		aNew[nNewNum++].cStatus = pRange[i].cStatus;
+	}
+	aNew[nNewNum].nLBA = nLBA;
+	aNew[nNewNum].nSectorNum = nEnd - nLBA;
+	aNew[nNewNum++].cStatus = cStatus;
+	INT nLastEnd = pRange[j - 1].nLBA + pRange[j - 1].nSectorNum;
+	if (nEnd < nLastEnd) {
+		aNew[nNewNum].nLBA = nEnd;
+		aNew[nNewNum].nSectorNum = nLastEnd - nEnd;
+		aNew[nNewNum++].cStatus = pRange[j - 1].cStatus;
+	}
+	memmove(&pRange[i + nNewNum], &pRange[j], sizeof(ERROR_MAP_RANGE) * (size_t)(pMap->nRangeNum - j));
+	memcpy(&pRange[i], aNew, sizeof(ERROR_MAP_RANGE) * (size_t)nNewNum);
+	pMap->nRangeNum += nNewNum - (j - i);
+
+	// merges the neighbors of the same status
+	INT nFirst = max(i - 1, 0);
+	for (INT k = min(i + nNewNum, pMap->nRangeNum - 1); k > nFirst; k--) {
+		if (pRange[k - 1].cStatus == pRange[k].cStatus) {
+			pRange[k - 1].nSectorNum += pRange[k].nSectorNum;
+			memmove(&pRange[k], &pRange[k + 1], sizeof(ERROR_MAP_RANGE) * (size_t)(pMap->nRangeNum - k - 1));
+			pMap->nRangeNum--;
+		}
+	}
+	return TRUE;
+}
+
+// Gets the first sectors of cStatus from *lpLBA. The map can be changed between
+// the calls, so the caller goes forward by *lpLBA += *lpSectorNum.
+BOOL GetErrorMapRange(
+	PERROR_MAP pMap,
+	CHAR cStatus,
+	LPINT lpLBA,
+	LPINT lpSectorNum
+) {
+	for (INT i = 0; i < pMap->nRangeNum; i++) {
+		INT nEnd = pMap->pRange[i].nLBA + pMap->pRange[i].nSectorNum;
+		if (pMap->pRange[i].cStatus == cStatus && *lpLBA < nEnd) {
+			*lpLBA = max(*lpLBA, pMap->pRange[i].nLBA);
+			*lpSectorNum = nEnd - *lpLBA;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+INT GetErrorMapSectorNum(
+	PERROR_MAP pMap,
+	CHAR cStatus
+) {
+	INT nSectorNum = 0;
+	for (INT i = 0; i < pMap->nRangeNum; i++) {
+		if (pMap->pRange[i].cStatus == cStatus) {
+			nSectorNum += pMap->pRange[i].nSectorNum;
+		}
+	}
+	return nSectorNum;
+}
+
+// The mapfile of GNU ddrescue. The position and the size are byte (sector * dwSectorSize).
+//  # comment
+//  0x00000000     ?               <- current pos, current status
+//  0x00000000  0x00010000  +      <- pos, size, status
+//  ...
+BOOL LoadErrorMap(
+	PERROR_MAP pMap,
+	LPCTSTR pszPath
+) {
+	FILE* fp = _tfopen(pszPath, _T("r"));
+	if (!fp) {
+		return FALSE;
+	}
+	CHAR szBuf[256] = { 0 };
+	BOOL bCurrent = FALSE;
+	BOOL bRet = TRUE;
+	INT nEnd = 0;
+	while (bRet && fgets(szBuf, sizeof(szBuf), fp)) {
+		if (szBuf[0] == '#' || szBuf[0] == '\r' || szBuf[0] == '\n') {
+			continue;
+		}
+		if (!bCurrent) {
+			bCurrent = TRUE;
+			continue;
+		}
+		LPCH pEnd = NULL;
+		UINT64 ui64Pos = _strtoui64(szBuf, &pEnd, 16);
+		UINT64 ui64Size = _strtoui64(pEnd, &pEnd, 16);
+		while (*pEnd == ' ' || *pEnd == '\t') {
+			pEnd++;
+		}
+		CHAR cStatus = *pEnd;
+		if (cStatus != ERROR_MAP_GOOD && cStatus != ERROR_MAP_BAD) {
+			// '*' (non-trimmed), '/' (non-scraped) of ddrescue are regarded as untried
+			cStatus = ERROR_MAP_UNTRIED;
+		}
+		if (ui64Pos != (UINT64)nEnd * pMap->dwSectorSize || ui64Size % pMap->dwSectorSize ||
+			ui64Pos + ui64Size > (UINT64)pMap->nSectorNum * pMap->dwSectorSize) {
+			bRet = FALSE;
+			break;
+		}
+		bRet = SetErrorMapRange(pMap, nEnd, (INT)(ui64Size / pMap->dwSectorSize), cStatus);
+		nEnd += (INT)(ui64Size / pMap->dwSectorSize);
+	}
+	fclose(fp);
+	if (!bRet || nEnd != pMap->nSectorNum) {
+		OutputErrorString(_T("%s doesn't fit this disc\n"), pszPath);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL SaveErrorMap(
+	PERROR_MAP pMap,
+	LPCTSTR pszPath
+) {
+	FILE* fp = _tfopen(pszPath, _T("w"));
+	if (!fp) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	// '?' while copying, '-' while retrying, '+' when finished
+	CHAR cCurrent = ERROR_MAP_UNTRIED;
+	INT nCurrent = 0;
+	INT nSectorNum = 0;
+	if (!GetErrorMapRange(pMap, cCurrent, &nCurrent, &nSectorNum)) {
+		cCurrent = ERROR_MAP_BAD;
+		if (!GetErrorMapRange(pMap, cCurrent, &nCurrent, &nSectorNum)) {
+			cCurrent = ERROR_MAP_GOOD;
+			nCurrent = pMap->nSectorNum;
+		}
+	}
+	fprintf(fp, "# Mapfile. Created by DiscImageCreator\n"
+		"# current_pos  current_status\n"
+		"0x%08llx     %c\n"
+		"#      pos        size  status\n", (UINT64)nCurrent * pMap->dwSectorSize, cCurrent);
+	for (INT i = 0; i < pMap->nRangeNum; i++) {
+		fprintf(fp, "0x%08llx  0x%08llx  %c\n"
+			, (UINT64)pMap->pRange[i].nLBA * pMap->dwSectorSize
+			, (UINT64)pMap->pRange[i].nSectorNum * pMap->dwSectorSize, pMap->pRange[i].cStatus);
+	}
+	BOOL bRet = TRUE;
+	if (ferror(fp)) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		bRet = FALSE;
+	}
+	fclose(fp);
+	return bRet;
+}
+
+VOID TerminateErrorMap(
+	PERROR_MAP pMap
+) {
+	FreeAndNull(pMap->pRange);
+	pMap->nRangeNum = 0;
+	pMap->nRangeMax = 0;
+}
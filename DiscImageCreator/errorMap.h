@@ -0,0 +1,61 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// status of the range (same as the mapfile of GNU ddrescue)
+#define ERROR_MAP_UNTRIED	('?')
+#define ERROR_MAP_BAD		('-')
+#define ERROR_MAP_GOOD		('+')
+
+BOOL InitErrorMap(
+	PERROR_MAP pMap,
+	INT nSectorNum,
+	DWORD dwSectorSize
+);
+
+BOOL SetErrorMapRange(
+	PERROR_MAP pMap,
+	INT nLBA,
+	INT nSectorNum,
+	CHAR cStatus
+);
+
+BOOL GetErrorMapRange(
+	PERROR_MAP pMap,
+	CHAR cStatus,
+	LPINT lpLBA,
+	LPINT lpSectorNum
+);
+
+INT GetErrorMapSectorNum(
+	PERROR_MAP pMap,
+	CHAR cStatus
+);
+
+BOOL LoadErrorMap(
+	PERROR_MAP pMap,
+	LPCTSTR pszPath
+);
+
+BOOL SaveErrorMap(
+	PERROR_MAP pMap,
+	LPCTSTR pszPath
+);
+
+VOID TerminateErrorMap(
+	PERROR_MAP pMap
+);
@@ -0,0 +1,393 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "check.h"
+#include "convert.h"
+#include "execImage.h"
+#include "execScsiCmdforCDCheck.h"
+#include "get.h"
+#include "init.h"
+#include "output.h"
+#include "set.h"
+#include "_external/prngcd.h"
+
+// The image is used as the block source instead of the drive. While
+// pDevice->IMAGE.fp isn't NULL, ScsiPassThroughDirect passes the read commands
+// to ExecReadImage, so the analysis code runs as it is against the dump.
+FILE* OpenImageFile(
+	LPCTSTR pszFullPath,
+	LPCTSTR pszExt,
+	LPCTSTR pszMode
+) {
+	_TCHAR szPath[_MAX_PATH] = { 0 };
+	_TCHAR szDrive[_MAX_DRIVE] = { 0 };
+	_TCHAR szDir[_MAX_DIR] = { 0 };
+	_TCHAR szFname[_MAX_FNAME] = { 0 };
+	_tsplitpath(pszFullPath, szDrive, szDir, szFname, NULL);
+	_tmakepath(szPath, szDrive, szDir, szFname, pszExt);
+	if (!PathFileExists(szPath)) {
+		return NULL;
+	}
+	return _tfopen(szPath, pszMode);
+}
+
+BOOL OpenImage(
+	PDEVICE pDevice,
+	LPCTSTR pszFullPath,
+	LPCTSTR pszExt
+) {
+	if (NULL == (pDevice->IMAGE.fp = OpenImageFile(pszFullPath, pszExt, _T("rb")))) {
+		OutputErrorString(_T("Failed to open the image: %s\n"), pszFullPath);
+		return FALSE;
+	}
+	InitializeCriticalSection(&pDevice->IMAGE.cs);
+	if (!_tcsicmp(pszExt, _T(".iso"))) {
+		pDevice->IMAGE.dwSectorSize = DISC_RAW_READ_SIZE;
+	}
+	else {
+		pDevice->IMAGE.dwSectorSize = CD_RAW_SECTOR_SIZE;
+	}
+	UINT64 ullFileSize = GetFileSize64(0, pDevice->IMAGE.fp);
+	if (ullFileSize == 0 || ullFileSize % pDevice->IMAGE.dwSectorSize) {
+		OutputErrorString(_T("The size of the image isn't a multiple of %lu\n"), pDevice->IMAGE.dwSectorSize);
+		CloseImage(pDevice);
+		return FALSE;
+	}
+	pDevice->IMAGE.nSectorNum = (INT)(ullFileSize / pDevice->IMAGE.dwSectorSize);
+	if (pDevice->IMAGE.dwSectorSize == CD_RAW_SECTOR_SIZE) {
+		// optional. If it doesn't exist, the sub channel is filled with 0
+		pDevice->IMAGE.fpSub = OpenImageFile(pszFullPath, _T(".sub"), _T("rb"));
+	}
+	pDevice->dwMaxTransferLength = IMAGE_MAX_TRANSFER_LENGTH;
+	OutputDiscLogA(
+		OUTPUT_DHYPHEN_PLUS_STR(Image)
+		"\tSectorSize: %lu, SectorNum: %d, SubChannel: %s\n"
+		, pDevice->IMAGE.dwSectorSize, pDevice->IMAGE.nSectorNum, pDevice->IMAGE.fpSub ? "yes" : "no");
+	return TRUE;
+}
+
+VOID CloseImage(
+	PDEVICE pDevice
+) {
+	if (pDevice->IMAGE.fp) {
+		DeleteCriticalSection(&pDevice->IMAGE.cs);
+	}
+	FcloseAndNull(pDevice->IMAGE.fp);
+	FcloseAndNull(pDevice->IMAGE.fpSub);
+}
+
+VOID SetTrackDataForImage(
+	PDISC pDisc,
+	BYTE byTrackNum,
+	BYTE byControl,
+	INT nLBA
+) {
+	PTRACK_DATA pTrack = &pDisc->SCSI.toc.TrackData[byTrackNum == 0xaa ? pDisc->SCSI.toc.LastTrack : byTrackNum - 1];
+	pTrack->Control = (UCHAR)(byControl & 0x0f);
+	pTrack->Adr = ADR_ENCODES_CURRENT_POSITION;
+	pTrack->TrackNumber = byTrackNum;
+	REVERSE_BYTES(pTrack->Address, &nLBA);
+}
+
+// The TOC is made from the entries of the .ccd which is written with the image.
+// If it doesn't exist, the whole image is regarded as one track.
+BOOL ReadImageForToc(
+	PEXEC_TYPE pExecType,
+	PDEVICE pDevice,
+	PDISC pDisc,
+	LPCTSTR pszFullPath
+) {
+	BYTE byControl[MAXIMUM_NUMBER_TRACKS] = { 0 };
+	INT nTrackLBA[MAXIMUM_NUMBER_TRACKS] = { 0 };
+	BOOL bTrack[MAXIMUM_NUMBER_TRACKS] = { 0 };
+	BYTE byFirstTrack = 0xff;
+	BYTE byLastTrack = 0;
+
+	FILE* fpCcd = OpenImageFile(pszFullPath, _T(".ccd"), _T("r"));
+	if (fpCcd) {
+		CHAR szBuf[256] = { 0 };
+		INT nPoint = 0;
+		INT nControl = 0;
+		while (fgets(szBuf, sizeof(szBuf), fpCcd)) {
+			if (!strncmp(szBuf, "[Entry", 6)) {
+				nPoint = 0;
+				nControl = 0;
+			}
+			else if (!strncmp(szBuf, "Point=", 6)) {
+				nPoint = (INT)strtol(szBuf + 6, NULL, 16);
+			}
+			else if (!strncmp(szBuf, "Control=", 8)) {
+				nControl = (INT)strtol(szBuf + 8, NULL, 16);
+			}
+			else if (!strncmp(szBuf, "PLBA=", 5) && 1 <= nPoint && nPoint <= 99) {
+				byControl[nPoint - 1] = (BYTE)nControl;
+				nTrackLBA[nPoint - 1] = atoi(szBuf + 5);
+				bTrack[nPoint - 1] = TRUE;
+				byFirstTrack = min(byFirstTrack, (BYTE)nPoint);
+				byLastTrack = max(byLastTrack, (BYTE)nPoint);
+			}
+		}
+		FcloseAndNull(fpCcd);
+		for (BYTE i = byFirstTrack; i <= byLastTrack; i++) {
+			if (!bTrack[i - 1] || nTrackLBA[i - 1] < 0 || pDevice->IMAGE.nSectorNum <= nTrackLBA[i - 1]) {
+				OutputErrorString(_T("Track %u of the ccd doesn't fit the image\n"), i);
+				return FALSE;
+			}
+		}
+	}
+	if (byLastTrack == 0) {
+		byFirstTrack = 1;
+		byLastTrack = 1;
+		nTrackLBA[0] = 0;
+		if (pDevice->IMAGE.dwSectorSize == DISC_RAW_READ_SIZE) {
+			byControl[0] = AUDIO_DATA_TRACK;
+		}
+		else {
+			BYTE aBuf[CD_RAW_SECTOR_SIZE] = { 0 };
+			fseek(pDevice->IMAGE.fp, 0, SEEK_SET);
+			if (fread(aBuf, sizeof(BYTE), sizeof(aBuf), pDevice->IMAGE.fp) == sizeof(aBuf) &&
+				IsValidMainDataHeader(aBuf)) {
+				byControl[0] = AUDIO_DATA_TRACK;
+			}
+		}
+	}
+	pDisc->SCSI.toc.FirstTrack = byFirstTrack;
+	pDisc->SCSI.toc.LastTrack = byLastTrack;
+	for (BYTE i = byFirstTrack; i <= byLastTrack; i++) {
+		SetTrackDataForImage(pDisc, i, byControl[i - 1], nTrackLBA[i - 1]);
+	}
+	SetTrackDataForImage(pDisc, 0xaa, byControl[byLastTrack - 1], pDevice->IMAGE.nSectorNum);
+
+	if (!InitLBAPerTrack(pExecType, &pDisc)) {
+		return FALSE;
+	}
+	SetAndOutputToc(pDisc);
+	return TRUE;
+}
+
+VOID OutputImageError(
+	LPBYTE lpCdb,
+	INT nLBA,
+	LPCTSTR pszReason,
+	LPCTSTR pszFuncName,
+	LONG lLineNum
+) {
+	OutputLog(standardError | fileMainError
+		, _T("\rLBA[%06d, %#07x]: [F:%s][L:%ld]\n\tOpcode: %#02x\n\t%s\n")
+		, nLBA, nLBA, pszFuncName, lLineNum, lpCdb[0], pszReason);
+}
+
+// Emulates the read commands which the analysis uses.
+//  0x28, 0xa8: user data (2048 byte)
+//  0xbe      : main (2352 byte or user data) + c2 (filled with 0) + sub
+//  0xd8      : main + c2 (filled with 0) + sub
+// Like the drive, the data sector is returned scrambled when it's read as
+// CD-DA, and the audio sector can't be read as user data. Because the image
+// doesn't have the offset, MAIN.nCombinedOffset stays 0.
+static BOOL ExecReadImageCommand(
+	PDEVICE pDevice,
+	LPBYTE lpCdb,
+	LPBYTE lpBuf,
+	DWORD dwBufLen,
+	LPBYTE byScsiStatus,
+	LPCTSTR pszFuncName,
+	LONG lLineNum
+) {
+	INT nLBA = (INT)MAKELONG(MAKEWORD(lpCdb[5], lpCdb[4]), MAKEWORD(lpCdb[3], lpCdb[2]));
+	DWORD dwTransferLen = 0;
+	DWORD dwMainSize = CD_RAW_SECTOR_SIZE;
+	DWORD dwC2Size = 0;
+	DWORD dwSubSize = 0;
+	BOOL bScramble = FALSE;
+
+	*byScsiStatus = SCSISTAT_CHECK_CONDITION;
+	if (lpCdb[0] == SCSIOP_READ) {
+		dwTransferLen = MAKEWORD(lpCdb[8], lpCdb[7]);
+		dwMainSize = DISC_RAW_READ_SIZE;
+	}
+	else if (lpCdb[0] == SCSIOP_READ12) {
+		dwTransferLen = MAKELONG(MAKEWORD(lpCdb[9], lpCdb[8]), MAKEWORD(lpCdb[7], lpCdb[6]));
+		dwMainSize = DISC_RAW_READ_SIZE;
+	}
+	else if (lpCdb[0] == SCSIOP_READ_CD) {
+		dwTransferLen = MAKELONG(MAKEWORD(lpCdb[8], lpCdb[7]), MAKEWORD(lpCdb[6], 0));
+		bScramble = ((lpCdb[1] >> 2) & 0x07) == CDFLAG::_READ_CD::CDDA;
+		if ((lpCdb[9] & 0xf8) != 0xf8) {
+			// only user data
+			dwMainSize = DISC_RAW_READ_SIZE;
+		}
+		BYTE byC2 = (BYTE)((lpCdb[9] >> 1) & 0x03);
+		if (byC2 == CDFLAG::_READ_CD::byte294) {
+			dwC2Size = CD_RAW_READ_C2_294_SIZE;
+		}
+		else if (byC2 == CDFLAG::_READ_CD::byte296) {
+			dwC2Size = CD_RAW_READ_C2_294_SIZE + 2;
+		}
+		BYTE bySub = (BYTE)(lpCdb[10] & 0x07);
+		if (bySub == CDFLAG::_READ_CD::Raw || bySub == CDFLAG::_READ_CD::Pack) {
+			dwSubSize = CD_RAW_READ_SUBCODE_SIZE;
+		}
+		else if (bySub == CDFLAG::_READ_CD::Q) {
+			dwSubSize = 16;
+		}
+	}
+	else if (lpCdb[0] == SCSIOP_PLXTR_READ_CDDA) {
+		dwTransferLen = MAKELONG(MAKEWORD(lpCdb[9], lpCdb[8]), MAKEWORD(lpCdb[7], lpCdb[6]));
+		bScramble = TRUE;
+		if (lpCdb[10] == CDFLAG::_PLXTR_READ_CDDA::MainQ) {
+			dwSubSize = 16;
+		}
+		else if (lpCdb[10] == CDFLAG::_PLXTR_READ_CDDA::MainPack) {
+			dwSubSize = CD_RAW_READ_SUBCODE_SIZE;
+		}
+		else if (lpCdb[10] == CDFLAG::_PLXTR_READ_CDDA::Raw) {
+			dwMainSize = 0;
+			dwSubSize = CD_RAW_READ_SUBCODE_SIZE;
+		}
+		else if (lpCdb[10] == CDFLAG::_PLXTR_READ_CDDA::MainC2Raw) {
+			dwC2Size = CD_RAW_READ_C2_294_SIZE;
+			dwSubSize = CD_RAW_READ_SUBCODE_SIZE;
+		}
+	}
+	else {
+		OutputImageError(lpCdb, nLBA, _T("This opcode isn't supported for the image"), pszFuncName, lLineNum);
+		return TRUE;
+	}
+	DWORD dwSectorLen = dwMainSize + dwC2Size + dwSubSize;
+	if (dwSectorLen * dwTransferLen > dwBufLen) {
+		OutputImageError(lpCdb, nLBA, _T("The buffer is too small"), pszFuncName, lLineNum);
+		return TRUE;
+	}
+	if (dwMainSize == CD_RAW_SECTOR_SIZE && pDevice->IMAGE.dwSectorSize == DISC_RAW_READ_SIZE) {
+		OutputImageError(lpCdb, nLBA, _T("The raw sector can't be read from the iso"), pszFuncName, lLineNum);
+		return TRUE;
+	}
+	ZeroMemory(lpBuf, dwSectorLen * dwTransferLen);
+
+	for (DWORD i = 0; i < dwTransferLen; i++) {
+		INT n = nLBA + (INT)i;
+		LPBYTE lpOut = lpBuf + dwSectorLen * i;
+		if (n < 0 || pDevice->IMAGE.nSectorNum <= n) {
+			OutputImageError(lpCdb, n, _T("Out of the image"), pszFuncName, lLineNum);
+			return TRUE;
+		}
+		if (pDevice->IMAGE.lpErrorNum && pDevice->IMAGE.lpErrorNum[n]) {
+			// like the weak sector, it's read after it failed the times
+			if (pDevice->IMAGE.lpErrorNum[n] != 0xff) {
+				pDevice->IMAGE.lpErrorNum[n]--;
+			}
+			OutputImageError(lpCdb, n, _T("The injected read error"), pszFuncName, lLineNum);
+			return TRUE;
+		}
+		if (dwMainSize) {
+			BYTE aBuf[CD_RAW_SECTOR_SIZE] = { 0 };
+			_fseeki64(pDevice->IMAGE.fp, (INT64)n * pDevice->IMAGE.dwSectorSize, SEEK_SET);
+			if (fread(aBuf, sizeof(BYTE), pDevice->IMAGE.dwSectorSize, pDevice->IMAGE.fp)
+				!= pDevice->IMAGE.dwSectorSize) {
+				OutputLastErrorNumAndString(pszFuncName, lLineNum);
+				return FALSE;
+			}
+			if (pDevice->IMAGE.dwSectorSize == DISC_RAW_READ_SIZE) {
+				memcpy(lpOut, aBuf, DISC_RAW_READ_SIZE);
+			}
+			else if (dwMainSize == DISC_RAW_READ_SIZE) {
+				if (!IsValidMainDataHeader(aBuf)) {
+					OutputImageError(lpCdb, n, _T("The audio sector can't be read as user data"), pszFuncName, lLineNum);
+					return TRUE;
+				}
+				// mode 2 is regarded as form 1
+				memcpy(lpOut, aBuf + (aBuf[15] == DATA_BLOCK_MODE2 ? 24 : 16), DISC_RAW_READ_SIZE);
+			}
+			else {
+				if (bScramble && IsValidMainDataHeader(aBuf)) {
+					for (INT j = 0; j < CD_RAW_SECTOR_SIZE; j++) {
+						aBuf[j] ^= scrambled_table[j];
+					}
+				}
+				memcpy(lpOut, aBuf, CD_RAW_SECTOR_SIZE);
+			}
+		}
+		if (dwSubSize && pDevice->IMAGE.fpSub) {
+			BYTE aSub[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+			_fseeki64(pDevice->IMAGE.fpSub, (INT64)n * CD_RAW_READ_SUBCODE_SIZE, SEEK_SET);
+			if (fread(aSub, sizeof(BYTE), sizeof(aSub), pDevice->IMAGE.fpSub) == sizeof(aSub)) {
+				if (dwSubSize == CD_RAW_READ_SUBCODE_SIZE) {
+					// .sub is aligned per channel (P: 12 byte, Q: 12 byte, ...)
+					AlignColumnSubcode(lpOut + dwMainSize + dwC2Size, aSub);
+				}
+				else {
+					memcpy(lpOut + dwMainSize + dwC2Size, aSub + 12, 12);
+				}
+			}
+		}
+	}
+	*byScsiStatus = SCSISTAT_GOOD;
+	return TRUE;
+}
+
+// The commands of the read queue may be read on the threads at once
+BOOL ExecReadImage(
+	PDEVICE pDevice,
+	LPBYTE lpCdb,
+	LPBYTE lpBuf,
+	DWORD dwBufLen,
+	LPBYTE byScsiStatus,
+	LPCTSTR pszFuncName,
+	LONG lLineNum
+) {
+	EnterCriticalSection(&pDevice->IMAGE.cs);
+	BOOL bRet = ExecReadImageCommand(pDevice, lpCdb, lpBuf, dwBufLen, byScsiStatus, pszFuncName, lLineNum);
+	LeaveCriticalSection(&pDevice->IMAGE.cs);
+	return bRet;
+}
+
+// All analysis which doesn't need the drive runs against the image.
+// SecuROM isn't checked because it needs the sub channel of LBA -1.
+BOOL ReadImageForAnalysis(
+	PEXEC_TYPE pExecType,
+	PEXT_ARG pExtArg,
+	LPCTSTR pszFullPath,
+	LPCTSTR pszExt
+) {
+	DEVICE device = { 0 };
+	DISC discData = { 0 };
+	PDISC pDisc = &discData;
+	BOOL bRet = TRUE;
+	try {
+		if (!OpenImage(&device, pszFullPath, pszExt)) {
+			throw FALSE;
+		}
+		if (!ReadImageForToc(pExecType, &device, pDisc, pszFullPath)) {
+			throw FALSE;
+		}
+		if (!InitProtectData(&pDisc)) {
+			throw FALSE;
+		}
+		pExtArg->byScanProtectViaFile = TRUE;
+		pExtArg->byScanProtectViaSector = device.IMAGE.dwSectorSize == CD_RAW_SECTOR_SIZE;
+		pExtArg->byScanAntiModStr = TRUE;
+		if (!ReadCDCheck(pExecType, pExtArg, &device, pDisc, CDFLAG::_READ_CD::All)) {
+			throw FALSE;
+		}
+	}
+	catch (BOOL bErr) {
+		bRet = bErr;
+	}
+	TerminateLBAPerTrack(&pDisc);
+	TerminateProtectData(&pDisc);
+	CloseImage(&device);
+	return bRet;
+}
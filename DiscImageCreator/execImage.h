@@ -0,0 +1,54 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// the transfer length which is reported for the image instead of the drive
+#define IMAGE_MAX_TRANSFER_LENGTH	(65536)
+
+BOOL OpenImage(
+	PDEVICE pDevice,
+	LPCTSTR pszFullPath,
+	LPCTSTR pszExt
+);
+
+VOID CloseImage(
+	PDEVICE pDevice
+);
+
+BOOL ReadImageForToc(
+	PEXEC_TYPE pExecType,
+	PDEVICE pDevice,
+	PDISC pDisc,
+	LPCTSTR pszFullPath
+);
+
+BOOL ExecReadImage(
+	PDEVICE pDevice,
+	LPBYTE lpCdb,
+	LPBYTE lpBuf,
+	DWORD dwBufLen,
+	LPBYTE byScsiStatus,
+	LPCTSTR pszFuncName,
+	LONG lLineNum
+);
+
+BOOL ReadImageForAnalysis(
+	PEXEC_TYPE pExecType,
+	PEXT_ARG pExtArg,
+	LPCTSTR pszFullPath,
+	LPCTSTR pszExt
+);
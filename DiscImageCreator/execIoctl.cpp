@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include "struct.h"
+#include "execImage.h"
 #include "execIoctl.h"
 #include "output.h"
 #include "outputIoctlLog.h"
@@ -99,6 +100,76 @@ BOOL ScsiGetAddress(
 	return TRUE;
 }
 
+VOID SetScsiPassThroughDirect(
+	PDEVICE pDevice,
+	PSCSI_PASS_THROUGH_DIRECT_WITH_BUFFER pSwb,
+	LPVOID lpCdb,
+	BYTE byCdbLength,
+	LPVOID pvBuffer,
+	DWORD dwBufferLength
+) {
+	ZeroMemory(pSwb, sizeof(SCSI_PASS_THROUGH_DIRECT_WITH_BUFFER));
+	pSwb->ScsiPassThroughDirect.Length = sizeof(SCSI_PASS_THROUGH_DIRECT);
+	pSwb->ScsiPassThroughDirect.PathId = pDevice->address.PathId;
+	pSwb->ScsiPassThroughDirect.TargetId = pDevice->address.TargetId;
+	pSwb->ScsiPassThroughDirect.Lun = pDevice->address.Lun;
+	pSwb->ScsiPassThroughDirect.CdbLength = byCdbLength;
+	pSwb->ScsiPassThroughDirect.SenseInfoLength = SENSE_BUFFER_SIZE;
+	pSwb->ScsiPassThroughDirect.DataIn = SCSI_IOCTL_DATA_IN;
+	pSwb->ScsiPassThroughDirect.DataTransferLength = dwBufferLength;
+	pSwb->ScsiPassThroughDirect.TimeOutValue = pDevice->dwTimeOutValue;
+	pSwb->ScsiPassThroughDirect.DataBuffer = pvBuffer;
+	pSwb->ScsiPassThroughDirect.SenseInfoOffset = 
+		offsetof(SCSI_PASS_THROUGH_DIRECT_WITH_BUFFER, SenseData);
+	memcpy(pSwb->ScsiPassThroughDirect.Cdb, lpCdb, byCdbLength);
+}
+
+// Gets the scsi status of the completed command. The check condition without
+// the sense is regarded as good
+VOID GetScsiPassThroughDirectStatus(
+	PSCSI_PASS_THROUGH_DIRECT_WITH_BUFFER pSwb,
+	LPBYTE byScsiStatus,
+	LPCTSTR pszFuncName,
+	LONG lLineNum
+) {
+	BOOL bNoSense = FALSE;
+	if (pSwb->SenseData.SenseKey == SCSI_SENSE_NO_SENSE &&
+		pSwb->SenseData.AdditionalSenseCode == SCSI_ADSENSE_NO_SENSE &&
+		pSwb->SenseData.AdditionalSenseCodeQualifier == 0x00) {
+		bNoSense = TRUE;
+	}
+	if (pSwb->ScsiPassThroughDirect.ScsiStatus >= SCSISTAT_CHECK_CONDITION &&
+		!bNoSense) {
+		INT nLBA = 0;
+		if (pSwb->ScsiPassThroughDirect.Cdb[0] == 0xa8 ||
+			pSwb->ScsiPassThroughDirect.Cdb[0] == 0xad ||
+			pSwb->ScsiPassThroughDirect.Cdb[0] == 0xbe ||
+			pSwb->ScsiPassThroughDirect.Cdb[0] == 0xd8) {
+			nLBA = (pSwb->ScsiPassThroughDirect.Cdb[2] << 24)
+				+ (pSwb->ScsiPassThroughDirect.Cdb[3] << 16)
+				+ (pSwb->ScsiPassThroughDirect.Cdb[4] << 8)
+				+ pSwb->ScsiPassThroughDirect.Cdb[5];
+		}
+		OutputLog(standardError | fileMainError
+			, _T("\rLBA[%06d, %#07x]: [F:%s][L:%ld]\n\tOpcode: %#02x\n")
+			, nLBA, nLBA, pszFuncName, lLineNum, pSwb->ScsiPassThroughDirect.Cdb[0]);
+		OutputScsiStatus(pSwb->ScsiPassThroughDirect.ScsiStatus);
+		OutputSenseData(&pSwb->SenseData);
+		if (pSwb->SenseData.SenseKey == SCSI_SENSE_UNIT_ATTENTION) {
+			DWORD milliseconds = 40000;
+			OutputErrorString(
+				_T("Please wait for %lu milliseconds until the device is returned\n"), milliseconds);
+			Sleep(milliseconds);
+		}
+	}
+	if (bNoSense) {
+		*byScsiStatus = SCSISTAT_GOOD;
+	}
+	else {
+		*byScsiStatus = pSwb->ScsiPassThroughDirect.ScsiStatus;
+	}
+}
+
 BOOL ScsiPassThroughDirect(
 	PEXT_ARG pExtArg,
 	PDEVICE pDevice,
@@ -110,25 +181,16 @@ BOOL ScsiPassThroughDirect(
 	LPCTSTR pszFuncName,
 	LONG lLineNum
 ) {
-	SCSI_PASS_THROUGH_DIRECT_WITH_BUFFER swb = { 0 };
-	swb.ScsiPassThroughDirect.Length = sizeof(SCSI_PASS_THROUGH_DIRECT);
-	swb.ScsiPassThroughDirect.PathId = pDevice->address.PathId;
-	swb.ScsiPassThroughDirect.TargetId = pDevice->address.TargetId;
-	swb.ScsiPassThroughDirect.Lun = pDevice->address.Lun;
-	swb.ScsiPassThroughDirect.CdbLength = byCdbLength;
-	swb.ScsiPassThroughDirect.SenseInfoLength = SENSE_BUFFER_SIZE;
-	swb.ScsiPassThroughDirect.DataIn = SCSI_IOCTL_DATA_IN;
-	swb.ScsiPassThroughDirect.DataTransferLength = dwBufferLength;
-	swb.ScsiPassThroughDirect.TimeOutValue = pDevice->dwTimeOutValue;
-	swb.ScsiPassThroughDirect.DataBuffer = pvBuffer;
-	swb.ScsiPassThroughDirect.SenseInfoOffset = 
-		offsetof(SCSI_PASS_THROUGH_DIRECT_WITH_BUFFER, SenseData);
-	memcpy(swb.ScsiPassThroughDirect.Cdb, lpCdb, byCdbLength);
+	if (pDevice->IMAGE.fp) {
+		return ExecReadImage(pDevice, (LPBYTE)lpCdb, (LPBYTE)pvBuffer
+			, dwBufferLength, byScsiStatus, pszFuncName, lLineNum);
+	}
+	SCSI_PASS_THROUGH_DIRECT_WITH_BUFFER swb;
+	SetScsiPassThroughDirect(pDevice, &swb, lpCdb, byCdbLength, pvBuffer, dwBufferLength);
 
 	DWORD dwLength = sizeof(SCSI_PASS_THROUGH_DIRECT_WITH_BUFFER);
 	DWORD dwReturned = 0;
 	BOOL bRet = TRUE;
-	BOOL bNoSense = FALSE;
 	SetLastError(NO_ERROR);
 	if (!DeviceIoControl(pDevice->hDevice, IOCTL_SCSI_PASS_THROUGH_DIRECT,
 		&swb, dwLength, &swb, dwLength, &dwReturned, NULL)) {
@@ -144,43 +206,10 @@ BOOL ScsiPassThroughDirect(
 			Sleep(milliseconds);
 			pDevice->FEATURE.bySetCDSpeed = FALSE;
 		}
+		*byScsiStatus = swb.ScsiPassThroughDirect.ScsiStatus;
 	}
 	else {
-		if (swb.SenseData.SenseKey == SCSI_SENSE_NO_SENSE &&
-			swb.SenseData.AdditionalSenseCode == SCSI_ADSENSE_NO_SENSE &&
-			swb.SenseData.AdditionalSenseCodeQualifier == 0x00) {
-			bNoSense = TRUE;
-		}
-		if (swb.ScsiPassThroughDirect.ScsiStatus >= SCSISTAT_CHECK_CONDITION &&
-			!bNoSense) {
-			INT nLBA = 0;
-			if (swb.ScsiPassThroughDirect.Cdb[0] == 0xa8 ||
-				swb.ScsiPassThroughDirect.Cdb[0] == 0xad ||
-				swb.ScsiPassThroughDirect.Cdb[0] == 0xbe ||
-				swb.ScsiPassThroughDirect.Cdb[0] == 0xd8) {
-				nLBA = (swb.ScsiPassThroughDirect.Cdb[2] << 24)
-					+ (swb.ScsiPassThroughDirect.Cdb[3] << 16)
-					+ (swb.ScsiPassThroughDirect.Cdb[4] << 8)
-					+ swb.ScsiPassThroughDirect.Cdb[5];
-			}
-			OutputLog(standardError | fileMainError
-				, _T("\rLBA[%06d, %#07x]: [F:%s][L:%ld]\n\tOpcode: %#02x\n")
-				, nLBA, nLBA, pszFuncName, lLineNum, swb.ScsiPassThroughDirect.Cdb[0]);
-			OutputScsiStatus(swb.ScsiPassThroughDirect.ScsiStatus);
-			OutputSenseData(&swb.SenseData);
-			if (swb.SenseData.SenseKey == SCSI_SENSE_UNIT_ATTENTION) {
-				DWORD milliseconds = 40000;
-				OutputErrorString(
-					_T("Please wait for %lu milliseconds until the device is returned\n"), milliseconds);
-				Sleep(milliseconds);
-			}
-		}
-	}
-	if (bNoSense) {
-		*byScsiStatus = SCSISTAT_GOOD;
-	}
-	else {
-		*byScsiStatus = swb.ScsiPassThroughDirect.ScsiStatus;
+		GetScsiPassThroughDirectStatus(&swb, byScsiStatus, pszFuncName, lLineNum);
 	}
 	return bRet;
 }
@@ -230,6 +259,56 @@ BOOL StorageQueryProperty(
 	return bRet;
 }
 
+BOOL StorageQuerySerialNumber(
+	PDEVICE pDevice
+) {
+	STORAGE_PROPERTY_QUERY query;
+	query.QueryType = PropertyStandardQuery;
+	query.PropertyId = StorageDeviceProperty;
+
+	STORAGE_DESCRIPTOR_HEADER header = { 0 };
+	DWORD dwReturned = 0;
+	if (!DeviceIoControl(pDevice->hDevice, IOCTL_STORAGE_QUERY_PROPERTY,
+		&query, sizeof(STORAGE_PROPERTY_QUERY), &header,
+		sizeof(STORAGE_DESCRIPTOR_HEADER), &dwReturned, FALSE)) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	PSTORAGE_DEVICE_DESCRIPTOR deviceDescriptor =
+		(PSTORAGE_DEVICE_DESCRIPTOR)calloc(header.Size, sizeof(BYTE));
+	if (!deviceDescriptor) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	BOOL bRet = DeviceIoControl(pDevice->hDevice, IOCTL_STORAGE_QUERY_PROPERTY,
+		&query, sizeof(STORAGE_PROPERTY_QUERY), deviceDescriptor, header.Size, &dwReturned, FALSE);
+	if (bRet) {
+		// some drives don't report it, then the profile is shared by the same model and firmware
+		DWORD dwOfs = deviceDescriptor->SerialNumberOffset;
+		LPCH pSerial = (LPCH)deviceDescriptor;
+		while (0 < dwOfs && dwOfs < dwReturned && pSerial[dwOfs] == ' ') {
+			dwOfs++;
+		}
+		size_t nLen = 0;
+		while (0 < dwOfs && dwOfs + nLen < dwReturned && pSerial[dwOfs + nLen] != '\0' &&
+			nLen < sizeof(pDevice->PROFILE.szSerialNumber) - 1) {
+			// the serial number is a part of the section name of driveProfile.ini
+			CHAR c = pSerial[dwOfs + nLen];
+			pDevice->PROFILE.szSerialNumber[nLen++] = isalnum((UCHAR)c) || c == '-' ? c : '_';
+		}
+		while (nLen > 0 && pDevice->PROFILE.szSerialNumber[nLen - 1] == '_') {
+			nLen--;
+		}
+		pDevice->PROFILE.szSerialNumber[nLen] = '\0';
+		OutputDriveLogA("SerialNumber: %s\n", pDevice->PROFILE.szSerialNumber);
+	}
+	else {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+	}
+	FreeAndNull(deviceDescriptor);
+	return bRet;
+}
+
 BOOL SetStreaming(
 	PDEVICE pDevice,
 	DWORD dwDiscSpeedNum
@@ -24,6 +24,22 @@ BOOL ScsiGetAddress(
 	PDEVICE pDevice
 );
 
+VOID SetScsiPassThroughDirect(
+	PDEVICE pDevice,
+	PSCSI_PASS_THROUGH_DIRECT_WITH_BUFFER pSwb,
+	LPVOID lpCdb,
+	BYTE byCdbLength,
+	LPVOID pvBuffer,
+	DWORD dwBufferLength
+);
+
+VOID GetScsiPassThroughDirectStatus(
+	PSCSI_PASS_THROUGH_DIRECT_WITH_BUFFER pSwb,
+	LPBYTE byScsiStatus,
+	LPCTSTR pszFuncName,
+	LONG lLineNum
+);
+
 BOOL ScsiPassThroughDirect(
 	PEXT_ARG pExtArg,
 	PDEVICE pDevice,
@@ -41,6 +57,10 @@ BOOL StorageQueryProperty(
 	LPBOOL lpBusTypeUSB
 );
 
+BOOL StorageQuerySerialNumber(
+	PDEVICE pDevice
+);
+
 BOOL SetStreaming(
 	PDEVICE pDevice,
 	DWORD dwDiscSpeedNum
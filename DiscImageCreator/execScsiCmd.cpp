@@ -16,6 +16,7 @@
 #include "struct.h"
 #include "check.h"
 #include "convert.h"
+#include "driveProfile.h"
 #include "execIoctl.h"
 #include "execScsiCmd.h"
 #include "execScsiCmdforCD.h"
@@ -650,6 +651,9 @@ BOOL ReadBufferCapacity(
 		}
 		else {
 			OutputReadBufferCapacity(&readBufCapaData);
+			pDevice->PROFILE.dwBufferSize = MAKELONG(
+				MAKEWORD(readBufCapaData.TotalBufferSize[3], readBufCapaData.TotalBufferSize[2]),
+				MAKEWORD(readBufCapaData.TotalBufferSize[1], readBufCapaData.TotalBufferSize[0]));
 		}
 	}
 	return TRUE;
@@ -856,6 +860,8 @@ BOOL ReadDriveInformation(
 				return FALSE;
 			}
 		}
+		// not return FALSE
+		StorageQuerySerialNumber(pDevice);
 	}
 	// 3rd: get drive vendor, product id here (because use IsValidPlextorDrive)
 	if (!Inquiry(pExecType, pExtArg, pDevice)) {
@@ -866,6 +872,9 @@ BOOL ReadDriveInformation(
 		OutputErrorString(_T("[ERROR] This drive isn't latest firmware. Please update.\n"));
 		return FALSE;
 	}
+	if (*pExecType != drivespeed) {
+		LoadDriveProfile(pDevice);
+	}
 	if ((PLXTR_DRIVE_TYPE)pDevice->byPlxtrDrive != PLXTR_DRIVE_TYPE::No) {
 		if (*pExecType != drivespeed) {
 			if (pExtArg->byPre) {
@@ -897,6 +906,8 @@ BOOL ReadDriveInformation(
 		}
 #endif
 		ReadBufferCapacity(pExtArg, pDevice);
+		pDevice->PROFILE.dwMaxTransferLength = pDevice->dwMaxTransferLength;
+		SaveDriveProfile(pDevice);
 	}
 	return TRUE;
 }
@@ -17,6 +17,7 @@
 #include "calcHash.h"
 #include "check.h"
 #include "convert.h"
+#include "errorMap.h"
 #include "execScsiCmd.h"
 #include "execScsiCmdforCD.h"
 #include "execScsiCmdforCDCheck.h"
@@ -25,12 +26,14 @@
 #include "get.h"
 #include "init.h"
 #include "output.h"
+#include "outputMds.h"
+#include "outputProgress.h"
 #include "outputScsiCmdLog.h"
 #include "outputScsiCmdLogforCD.h"
+#include "outputStream.h"
 #include "set.h"
-
-// These global variable is set at prngcd.cpp
-extern unsigned char scrambled_table[2352];
+#include "skipRegion.h"
+#include "_external/prngcd.h"
 
 BOOL ExecReadDisc(
 	PEXEC_TYPE pExecType,
@@ -442,6 +445,36 @@ BOOL ReadCDForRereadingSectorType1(
 	return bRet;
 }
 
+// Outputs the ranges of the main channel bytes which the c2 points to. Each
+// run of the suspect C2 bytes is 8 bytes of main per C2 byte, and both ends
+// are the exact error byte
+static VOID OutputC2SuspectRange(
+	PC2_ERROR_INFO pC2Info
+) {
+	INT nRunFirst = -1;
+	INT nPrev = -1;
+	for (INT i = 0; i < (INT)(sizeof(pC2Info->ullSuspectByte) / sizeof(UINT64)); i++) {
+		UINT64 x = pC2Info->ullSuspectByte[i];
+		while (x) {
+			INT nC2Pos = i * 64 + GetFirstBitFromLsb64(x);
+			x &= x - 1;
+			if (nRunFirst != -1 && nC2Pos != nPrev + 1) {
+				OutputC2ErrorLogA("(%d-%d) ", nRunFirst == pC2Info->nFirstErrorByte / CHAR_BIT ?
+					pC2Info->nFirstErrorByte : nRunFirst * CHAR_BIT, nPrev * CHAR_BIT + CHAR_BIT - 1);
+				nRunFirst = -1;
+			}
+			if (nRunFirst == -1) {
+				nRunFirst = nC2Pos;
+			}
+			nPrev = nC2Pos;
+		}
+	}
+	if (nRunFirst != -1) {
+		OutputC2ErrorLogA("(%d-%d) ", nRunFirst == pC2Info->nFirstErrorByte / CHAR_BIT ?
+			pC2Info->nFirstErrorByte : nRunFirst * CHAR_BIT, pC2Info->nLastErrorByte);
+	}
+}
+
 BOOL ReadCDForRereadingSectorType2(
 	PEXEC_TYPE pExecType,
 	PEXT_ARG pExtArg,
@@ -544,22 +577,9 @@ BOOL ReadCDForRereadingSectorType2(
 					GetCrc32(&dwTmpCrc32, lpBufMain + CD_RAW_SECTOR_WITH_C2_294_AND_SUBCODE_SIZE * k, CD_RAW_SECTOR_SIZE);
 
 					BOOL bMatch = FALSE;
-					BOOL bC2 = RETURNED_NO_C2_ERROR_1ST;
-					for (WORD wC2ErrorPos = 0; wC2ErrorPos < CD_RAW_READ_C2_294_SIZE; wC2ErrorPos++) {
-						INT nBit = 0x80;
-						DWORD dwPos = CD_RAW_SECTOR_WITH_C2_294_AND_SUBCODE_SIZE * k + pDevice->TRANSFER.dwBufC2Offset + wC2ErrorPos;
-						for (INT n = 0; n < CHAR_BIT; n++) {
-							// exist C2 error
-							if (lpBufC2[dwPos] & nBit) {
-								bC2 = RETURNED_EXIST_C2_ERROR;
-								break;
-							}
-							nBit >>= 1;
-						}
-						if (bC2 == RETURNED_EXIST_C2_ERROR) {
-							break;
-						}
-					}
+					C2_ERROR_INFO c2Info;
+					BOOL bC2 = AnalyzeC2Error(lpBufC2 + CD_RAW_SECTOR_WITH_C2_294_AND_SUBCODE_SIZE * k
+						+ pDevice->TRANSFER.dwBufC2Offset, &c2Info);
 					for (DWORD j = 0; j <= i; j++) {
 						if (dwTmpCrc32 == lpCrc32RereadSector[k][j]) {
 							OutputC2ErrorLogA("[%03ld]:0x%08lx, %d ", i, dwTmpCrc32, bC2);
@@ -581,6 +601,9 @@ BOOL ReadCDForRereadingSectorType2(
 						}
 #endif
 					}
+					if (bC2 == RETURNED_EXIST_C2_ERROR) {
+						OutputC2SuspectRange(&c2Info);
+					}
 				}
 				OutputC2ErrorLogA("\n");
 				idx++;
@@ -808,6 +831,134 @@ BOOL ProcessCreateBin(
 	return TRUE;
 }
 
+// The callback of GetFirstReadableLBA
+static BOOL ReadCDForProbing(
+	LPVOID lpContext,
+	INT nLBA
+) {
+	PSKIP_PROBE pProbe = (PSKIP_PROBE)lpContext;
+	pProbe->nProbeNum++;
+	OutputString(_T("\rProbing LBA[%06d, %#07x]"), nLBA, nLBA);
+	return ExecReadCD(pProbe->pExtArg, pProbe->pDevice, pProbe->lpCmd, nLBA
+		, pProbe->lpBuf, pProbe->dwBufSize, _T(__FUNCTION__), __LINE__);
+}
+
+// The sectors skipped by /sk are read one by one after dumping. The read
+// sector is written to .scm, .sub and .c2 again like ReadCDForRereadingSectorType1.
+// The subchannel and the C2 are written at the same positions as ReadCDAll
+// writes them, but the subchannel isn't fixed by FixSubChannel.
+static BOOL ReadCDForRetryingSkippedSector(
+	PEXEC_TYPE pExecType,
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	PDISC pDisc,
+	LPBYTE lpCmd,
+	LPBYTE lpBuf,
+	DWORD dwBufSize,
+	PERROR_MAP pMap,
+	INT nMapFirstLBA,
+	INT nFirstLBAForSub,
+	FILE* fpImg,
+	FILE* fpSub,
+	FILE* fpC2
+) {
+	INT nPos = 0;
+	INT nSectorNum = 0;
+	while (GetErrorMapRange(pMap, ERROR_MAP_BAD, &nPos, &nSectorNum)) {
+		INT nLBA = nMapFirstLBA + nPos;
+		OutputString(_T("\rRetrying the skipped sector: %6d"), nLBA);
+		if (ExecReadCD(pExtArg, pDevice, lpCmd, nLBA, lpBuf, dwBufSize, _T(__FUNCTION__), __LINE__)) {
+			LONG lSeekMain = CD_RAW_SECTOR_SIZE * (LONG)nLBA - pDisc->MAIN.nCombinedOffset;
+			fseek(fpImg, lSeekMain, SEEK_SET);
+			WriteMainChannel(pExecType, pExtArg, pDisc, lpBuf, nLBA, fpImg);
+			OutputLog(standardError | fileMainError
+				, _T("\rLBA[%06d, %#07x]: Read at the retry. Rewrote .scm[%ld-%ld(%lx-%lx)]\n")
+				, nLBA, nLBA, lSeekMain, lSeekMain + 2351, lSeekMain, lSeekMain + 2351);
+
+			// the drive having the subchannel offset returns the subchannel of nLBA + 1
+			INT nSubLBA = nLBA;
+			if (pDisc->SUB.nSubChannelOffset) {
+				nSubLBA++;
+			}
+			if (nFirstLBAForSub <= nSubLBA && nSubLBA < pDisc->SCSI.nAllLength) {
+				BYTE lpSubcode[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+				AlignRowSubcode(lpSubcode, lpBuf + pDevice->TRANSFER.dwBufSubOffset);
+				LONG lSeekSub = CD_RAW_READ_SUBCODE_SIZE * (LONG)(nSubLBA - nFirstLBAForSub);
+				fseek(fpSub, lSeekSub, SEEK_SET);
+				WriteOutputFile(fpSub, lpSubcode, CD_RAW_READ_SUBCODE_SIZE);
+				OutputLog(standardError | fileMainError
+					, _T("LBA[%06d, %#07x]: Rewrote .sub[%ld-%ld(%lx-%lx)]\n")
+					, nSubLBA, nSubLBA, lSeekSub, lSeekSub + 95, lSeekSub, lSeekSub + 95);
+			}
+
+			INT sLBA = pDisc->MAIN.nFixStartLBA;
+			if (pExtArg->byC2 && pDevice->FEATURE.byC2ErrorData &&
+				sLBA <= nLBA && nLBA < pDisc->MAIN.nFixEndLBA) {
+				// 0xd8 returns the C2 of nLBA with nLBA + 1 (see ReadCDAll)
+				LPBYTE lpC2 = lpBuf + pDevice->TRANSFER.dwBufC2Offset;
+				BOOL bC2 = TRUE;
+				if (pExtArg->byD8 || pDevice->byPlxtrDrive) {
+					if (pDevice->TRANSFER.dwBufLen * 2 <= dwBufSize) {
+						lpC2 += pDevice->TRANSFER.dwBufLen;
+					}
+					else {
+						bC2 = ExecReadCD(pExtArg, pDevice, lpCmd, nLBA + 1, lpBuf, dwBufSize, _T(__FUNCTION__), __LINE__);
+					}
+				}
+				if (bC2) {
+					// the first sector of .c2 lacks the slide like WriteC2
+					LONG lSeekC2 = 0;
+					if (sLBA < nLBA) {
+						lSeekC2 = CD_RAW_READ_C2_294_SIZE * (LONG)(nLBA - sLBA)
+							- (LONG)(pDisc->MAIN.uiMainDataSlideSize / 8);
+					}
+					fseek(fpC2, lSeekC2, SEEK_SET);
+					WriteC2(pExtArg, pDisc, lpC2, nLBA, fpC2);
+					OutputLog(standardError | fileMainError
+						, _T("LBA[%06d, %#07x]: Rewrote .c2[%ld-%ld(%lx-%lx)]\n")
+						, nLBA, nLBA, lSeekC2, lSeekC2 + 293, lSeekC2, lSeekC2 + 293);
+				}
+			}
+			if (!SetErrorMapRange(pMap, nPos, 1, ERROR_MAP_GOOD)) {
+				return FALSE;
+			}
+		}
+		nPos++;
+	}
+	OutputString(_T("\n"));
+	return TRUE;
+}
+
+// .scm (or .bin), .sub and .c2 are written by turns per sector while dumping,
+// so each of them is written through its own buffers (see outputStream.cpp).
+// They are newly created, so the blocks of zero are left as the holes.
+static BOOL AttachCDOutputStream(
+	PEXT_ARG pExtArg,
+	FILE* fpImg,
+	FILE* fpSub,
+	FILE* fpC2
+) {
+	return AttachOutputStream(fpImg, pExtArg->byDirectWrite, TRUE) &&
+		AttachOutputStream(fpSub, pExtArg->byDirectWrite, TRUE) &&
+		AttachOutputStream(fpC2, pExtArg->byDirectWrite, TRUE);
+}
+
+// Rereading the sectors seeks the files, so the streams end with the dump
+static BOOL DetachCDOutputStream(
+	FILE* fpImg,
+	FILE* fpSub,
+	FILE* fpC2
+) {
+	BOOL bRet = DetachOutputStream(fpImg, "main channel");
+	if (!DetachOutputStream(fpSub, ".sub")) {
+		bRet = FALSE;
+	}
+	if (!DetachOutputStream(fpC2, ".c2")) {
+		bRet = FALSE;
+	}
+	return bRet;
+}
+
 BOOL ReadCDAll(
 	PEXEC_TYPE pExecType,
 	PEXT_ARG pExtArg,
@@ -834,10 +985,12 @@ BOOL ReadCDAll(
 	LPBYTE pBuf = NULL;
 	LPBYTE pNextBuf = NULL;
 	LPBYTE pNextNextBuf = NULL;
+	LPBYTE pProbeBuf = NULL;
 	INT nMainDataType = scrambled;
 	if (pExtArg->byBe) {
 		nMainDataType = unscrambled;
 	}
+	ERROR_MAP map = { 0 };
 
 	try {
 		// init start
@@ -978,6 +1131,21 @@ BOOL ReadCDAll(
 			nLBA = nFirstLBA;
 			pDisc->MAIN.nOffsetStart = PREGAP_START_LBA;
 		}
+		// the map has the status of the sectors from nMapFirstLBA (the position of .scm)
+		INT nMapFirstLBA = nFirstLBA;
+		// the probe has its own buffer because ProcessReturnedContinue writes
+		// the C2 of data.current to .c2
+		SKIP_PROBE probe = { pExtArg, pDevice, lpCmd
+			, NULL, pDevice->TRANSFER.dwBufLen * byTransferLen, 0 };
+		if (pExtArg->dwSkipErrorNum) {
+			if (!InitErrorMap(&map, nLastLBA - nFirstLBA, CD_RAW_SECTOR_SIZE)) {
+				throw FALSE;
+			}
+			if (!GetAlignedCallocatedBuffer(pDevice, &pProbeBuf,
+				probe.dwBufSize, &probe.lpBuf, _T(__FUNCTION__), __LINE__)) {
+				throw FALSE;
+			}
+		}
 		// init end
 		FlushLog();
 
@@ -986,7 +1154,13 @@ BOOL ReadCDAll(
 		BOOL bReread = FALSE;
 		INT nFirstErrLBA = 0;
 		INT nSecondSessionLBA = 0;
+		INT nErrorRunNum = 0;
 
+		if (!AttachCDOutputStream(pExtArg, fpImg, fpSub, fpC2)) {
+			throw FALSE;
+		}
+		StartProgress(_T("Creating .scm"), _T("LBA"), nLBA, nLastLBA - 1, CD_RAW_SECTOR_SIZE, PROGRESS_SPEED_CD);
+		StartDpm(pDisc);
 		while (nFirstLBA < nLastLBA) {
 			if (pExtArg->byMultiSession) {
 				if (lpCmd[0] == 0xbe && pDisc->MAIN.nFixFirstLBAof2ndSession <= nLBA) {
@@ -999,6 +1173,7 @@ BOOL ReadCDAll(
 				}
 			}
 			BOOL bProcessRet = ProcessReadCD(pExecType, pExtArg, pDevice, pDisc, pDiscPerSector, lpCmd, nLBA);
+			SetDpm(pDisc, nLBA);
 			if (bProcessRet == RETURNED_EXIST_C2_ERROR) {
 				bC2Error = TRUE;
 				// C2 error points the current LBA - 1 (offset?)
@@ -1025,7 +1200,7 @@ BOOL ReadCDAll(
 							nFirstLBA++;
 						}
 						BYTE zeroByte[CD_RAW_SECTOR_SIZE] = { 0 };
-						fwrite(zeroByte, sizeof(BYTE), pDisc->MAIN.uiMainDataSlideSize, fpImg);
+						WriteOutputFile(fpImg, zeroByte, pDisc->MAIN.uiMainDataSlideSize);
 						OutputString("End of unreadable sector\n");
 
 						INT idx = pDisc->SCSI.toc.LastTrack - 1;
@@ -1050,12 +1225,42 @@ BOOL ReadCDAll(
 					else {
 						ProcessReturnedContinue(pExecType, pExtArg, pDevice, pDisc
 							, pDiscPerSector, nLBA, nMainDataType, fpImg, fpSub, fpC2, fpParse);
+						if (pExtArg->dwSkipErrorNum) {
+							if (!SetErrorMapRange(&map, nLBA - nMapFirstLBA, 1, ERROR_MAP_BAD)) {
+								throw FALSE;
+							}
+							if (++nErrorRunNum >= (INT)pExtArg->dwSkipErrorNum) {
+								probe.nProbeNum = 0;
+								INT nReadableLBA = GetFirstReadableLBA(
+									nLBA, nLBA + nLastLBA - nFirstLBA, ReadCDForProbing, &probe);
+								if (nLBA + 1 < nReadableLBA) {
+									OutputLog(standardError | fileMainError
+										, _T("\rLBA[%06d, %#07x]-[%06d, %#07x]: Skipped (probed %d times)\n")
+										, nLBA + 1, nLBA + 1, nReadableLBA - 1, nReadableLBA - 1, probe.nProbeNum);
+									if (!SetErrorMapRange(&map, nLBA + 1 - nMapFirstLBA
+										, nReadableLBA - nLBA - 1, ERROR_MAP_BAD)) {
+										throw FALSE;
+									}
+								}
+								// the skipped sectors are filled like the read error
+								while (nLBA + 1 < nReadableLBA) {
+									nLBA++;
+									nFirstLBA++;
+									ProcessReturnedContinue(pExecType, pExtArg, pDevice, pDisc
+										, pDiscPerSector, nLBA, nMainDataType, fpImg, fpSub, fpC2, fpParse);
+								}
+								nErrorRunNum = 0;
+							}
+						}
 					}
 				}
 			}
 			else if (bProcessRet == RETURNED_FALSE) {
 				throw FALSE;
 			}
+			if (bProcessRet != RETURNED_CONTINUE) {
+				nErrorRunNum = 0;
+			}
 			if (bProcessRet != RETURNED_CONTINUE &&
 				bProcessRet != RETURNED_SKIP_LBA) {
 				if (pExtArg->byC2 && pDevice->FEATURE.byC2ErrorData
@@ -1131,8 +1336,8 @@ BOOL ReadCDAll(
 					}
 					// Write track to scrambled
 					if (pExtArg->byMultiSession && nSecondSessionLBA == nLBA) {
-						fwrite(pDiscPerSector->data.current + pDisc->MAIN.uiMainDataSlideSize
-							, sizeof(BYTE), CD_RAW_SECTOR_SIZE - pDisc->MAIN.uiMainDataSlideSize, fpImg);
+						WriteOutputFile(fpImg, pDiscPerSector->data.current + pDisc->MAIN.uiMainDataSlideSize
+							, CD_RAW_SECTOR_SIZE - pDisc->MAIN.uiMainDataSlideSize);
 					}
 					else {
 						WriteMainChannel(pExecType, pExtArg, pDisc, pDiscPerSector->data.current, nLBA, fpImg);
@@ -1159,7 +1364,9 @@ BOOL ReadCDAll(
 				}
 			}
 
-			OutputString(_T("\rCreating .scm (LBA) %6d/%6d"), nLBA, nLastLBA - 1);
+			SetProgress(nLBA);
+			SetProgressZone(pDiscPerSector->byTrackNum);
+			SetProgressError(pDisc->MAIN.nC2ErrorCnt);
 			if (nFirstLBA == -76) {
 				nLBA = nFirstLBA;
 				if (!bReadOK) {
@@ -1169,11 +1376,34 @@ BOOL ReadCDAll(
 			nLBA++;
 			nFirstLBA++;
 		}
-		OutputString(_T("\n"));
+		EndProgress();
+		if (!DetachCDOutputStream(fpImg, fpSub, fpC2)) {
+			throw FALSE;
+		}
 		FcloseAndNull(fpParse);
-		FcloseAndNull(fpSub);
 		FlushLog();
 
+		// .sub is closed after the retry because it rewrites .sub
+		if (pExtArg->dwSkipErrorNum && GetErrorMapSectorNum(&map, ERROR_MAP_BAD)) {
+			if (!ReadCDForRetryingSkippedSector(pExecType, pExtArg, pDevice, pDisc, lpCmd
+				, probe.lpBuf, probe.dwBufSize, &map, nMapFirstLBA, nFirstLBAForSub, fpImg, fpSub, fpC2)) {
+				throw FALSE;
+			}
+			_TCHAR szMapPath[_MAX_PATH] = { 0 };
+			_TCHAR szDrive[_MAX_DRIVE] = { 0 };
+			_TCHAR szDir[_MAX_DIR] = { 0 };
+			_TCHAR szFname[_MAX_FNAME] = { 0 };
+			_tsplitpath(pszPath, szDrive, szDir, szFname, NULL);
+			_tmakepath(szMapPath, szDrive, szDir, szFname, _T(".map"));
+			SaveErrorMap(&map, szMapPath);
+			INT nBadNum = GetErrorMapSectorNum(&map, ERROR_MAP_BAD);
+			if (nBadNum) {
+				OutputLog(standardError | fileMainError
+					, _T("%d sectors couldn't be read. See %s\n"), nBadNum, szMapPath);
+			}
+		}
+		FcloseAndNull(fpSub);
+
 		if (pDisc->SCSI.toc.FirstTrack == pDisc->SCSI.toc.LastTrack) {
 			// [3DO] Jurassic Park Interactive (Japan)
 			if (pDisc->SUB.lpFirstLBAListOnSub[0][2] == -1 &&
@@ -1249,10 +1479,18 @@ BOOL ReadCDAll(
 		if (!ProcessCreateBin(pExtArg, pDevice, pDisc, pszPath, fpCue, fpCueForImg, fpCcd)) {
 			throw FALSE;
 		}
+		if (pExtArg->byMds) {
+			if (!WriteMdsfile(pExtArg, pDisc, pszPath)) {
+				throw FALSE;
+			}
+		}
 	}
 	catch (BOOL ret) {
 		bRet = ret;
 	}
+	EndProgress();
+	DetachCDOutputStream(fpImg, fpSub, fpC2);
+	TerminateErrorMap(&map);
 	FcloseAndNull(fpImg);
 	FcloseAndNull(fpCueForImg);
 	FcloseAndNull(fpCue);
@@ -1265,6 +1503,7 @@ BOOL ReadCDAll(
 			FreeAndNull(pNextNextBuf);
 		}
 	}
+	FreeAndNull(pProbeBuf);
 
 	return bRet;
 }
@@ -1373,6 +1612,13 @@ BOOL ReadCDForSwap(
 			pDisc->MAIN.nFixEndLBA = nLastLBA;
 			nEnd = nLastLBA;
 		}
+		_TCHAR szLabel[64] = { 0 };
+		_sntprintf(szLabel, sizeof(szLabel) / sizeof(szLabel[0]) - 1, _T("Creating .scm from %d to %d")
+			, nStart + pDisc->MAIN.nOffsetStart, nEnd + pDisc->MAIN.nOffsetEnd);
+		if (!AttachCDOutputStream(pExtArg, fpScm, fpSub, fpC2)) {
+			throw FALSE;
+		}
+		StartProgress(szLabel, _T("LBA"), nLBA, nLastLBA - 1, CD_RAW_SECTOR_SIZE, PROGRESS_SPEED_CD);
 
 		while (nFirstLBA < nLastLBA) {
 			BOOL bProcessRet = ProcessReadCD(pExecType, pExtArg, pDevice, pDisc, pDiscPerSector, lpCmd, nLBA);
@@ -1477,12 +1723,16 @@ BOOL ReadCDForSwap(
 					}
 				}
 			}
-			OutputString(_T("\rCreating .scm from %d to %d (LBA) %6d")
-				, nStart + pDisc->MAIN.nOffsetStart, nEnd + pDisc->MAIN.nOffsetEnd, nLBA);
+			SetProgress(nLBA);
+			SetProgressZone(pDiscPerSector->byTrackNum);
+			SetProgressError(pDisc->MAIN.nC2ErrorCnt);
 			nLBA++;
 			nFirstLBA++;
 		}
-		OutputString(_T("\n"));
+		EndProgress();
+		if (!DetachCDOutputStream(fpScm, fpSub, fpC2)) {
+			throw FALSE;
+		}
 		FcloseAndNull(fpParse);
 		FcloseAndNull(fpSub);
 		FlushLog();
@@ -1564,6 +1814,9 @@ BOOL ReadCDForSwap(
 		INT nLBA = 0;
 #endif
 		pDiscPerSector->byTrackNum = 1;
+		// the .sub is parsed without the drive, so /sv can't reread it
+		DWORD dwSubQVoteNum = pExtArg->dwSubQVoteNum;
+		pExtArg->dwSubQVoteNum = 0;
 		for (DWORD i = 0; i < size; i += CD_RAW_READ_SUBCODE_SIZE) {
 			fread(pDiscPerSector->subcode.current, sizeof(BYTE), CD_RAW_READ_SUBCODE_SIZE, fpSub);
 			SetTmpSubQDataFromBuffer(&pDiscPerSector->subQ.current, pDiscPerSector->subcode.current);
@@ -1582,6 +1835,7 @@ BOOL ReadCDForSwap(
 			UpdateTmpSubQData(pDiscPerSector);
 			nLBA++;
 		}
+		pExtArg->dwSubQVoteNum = dwSubQVoteNum;
 		FcloseAndNull(fpScm);
 
 		if (!ProcessDescramble(pExtArg, pDisc, pszPath, pszScmPath)) {
@@ -1635,6 +1889,8 @@ BOOL ReadCDForSwap(
 	catch (BOOL ret) {
 		bRet = ret;
 	}
+	EndProgress();
+	DetachCDOutputStream(fpScm, fpSub, fpC2);
 	FcloseAndNull(fpLeadout);
 	FcloseAndNull(fpScm);
 	FcloseAndNull(fpCueForImg);
@@ -1858,6 +2114,21 @@ BOOL ReadCDPartial(
 		INT nRetryCnt = 1;
 		BOOL bC2Error = FALSE;
 		INT bReread = FALSE;
+		if (!AttachCDOutputStream(pExtArg, fpBin, fpSub, fpC2)) {
+			throw FALSE;
+		}
+		_TCHAR szLabel[64] = { 0 };
+		if (pExtArg->byReverse) {
+			_sntprintf(szLabel, sizeof(szLabel) / sizeof(szLabel[0]) - 1, _T("Creating %s from %d to %d"), szExt
+				, nEnd + pDisc->MAIN.nOffsetEnd, nStart + pDisc->MAIN.nOffsetStart - 1);
+			// nLBA goes down from nLastLBA to nFirstLBA + 1
+			StartProgress(szLabel, _T("LBA"), nLastLBA, nFirstLBA + 1, CD_RAW_SECTOR_SIZE, PROGRESS_SPEED_CD);
+		}
+		else {
+			_sntprintf(szLabel, sizeof(szLabel) / sizeof(szLabel[0]) - 1, _T("Creating %s from %d to %d"), szExt
+				, nStart + pDisc->MAIN.nOffsetStart, nEnd + pDisc->MAIN.nOffsetEnd);
+			StartProgress(szLabel, _T("LBA"), nLBA, nLastLBA - 1, CD_RAW_SECTOR_SIZE, PROGRESS_SPEED_CD);
+		}
 
 		while (nFirstLBA < nLastLBA) {
 			BOOL bProcessRet = ProcessReadCD(pExecType, pExtArg, pDevice, pDisc, pDiscPerSector, lpCmd, nLBA);
@@ -1990,19 +2261,21 @@ BOOL ReadCDPartial(
 					memcpy(lpPrevSubcode, pDiscPerSector->subcode.next, CD_RAW_READ_SUBCODE_SIZE);
 				}
 			}
+			SetProgress(nLBA);
+			SetProgressZone(pDiscPerSector->byTrackNum);
+			SetProgressError(pDisc->MAIN.nC2ErrorCnt);
 			if (pExtArg->byReverse) {
-				OutputString(_T("\rCreating %s from %d to %d (LBA) %6d"), szExt
-					, nEnd + pDisc->MAIN.nOffsetEnd, nStart + pDisc->MAIN.nOffsetStart - 1, nLBA);
 				nLBA--;
 			}
 			else {
-				OutputString(_T("\rCreating %s from %d to %d (LBA) %6d"), szExt
-					, nStart + pDisc->MAIN.nOffsetStart, nEnd + pDisc->MAIN.nOffsetEnd, nLBA);
 				nLBA++;
 			}
 			nFirstLBA++;
 		}
-		OutputString(_T("\n"));
+		EndProgress();
+		if (!DetachCDOutputStream(fpBin, fpSub, fpC2)) {
+			throw FALSE;
+		}
 		FcloseAndNull(fpParse);
 		FcloseAndNull(fpSub);
 		FlushLog();
@@ -2127,6 +2400,8 @@ BOOL ReadCDPartial(
 	catch (BOOL ret) {
 		bRet = ret;
 	}
+	EndProgress();
+	DetachCDOutputStream(fpBin, fpSub, fpC2);
 	FcloseAndNull(fpBin);
 	FcloseAndNull(fpParse);
 	FcloseAndNull(fpSub);
@@ -17,14 +17,18 @@
 #include "calcHash.h"
 #include "check.h"
 #include "convert.h"
+#include "driveProfile.h"
 #include "execScsiCmd.h"
 #include "execScsiCmdforCD.h"
 #include "execScsiCmdforCDCheck.h"
 #include "execScsiCmdforFileSystem.h"
 #include "get.h"
 #include "output.h"
+#include "outputProgress.h"
 #include "outputScsiCmdLogforCD.h"
+#include "scanPattern.h"
 #include "set.h"
+#include "syncSearch.h"
 
 BOOL ReadCDForSubChannelOffset(
 	PEXT_ARG pExtArg,
@@ -182,17 +186,26 @@ BOOL ExecSearchingOffset(
 	}
 	else {
 		if (pDisc->SCSI.trackType != TRACK_TYPE::audioOnly || *pExecType == swap) {
-			BYTE aBuf[CD_RAW_SECTOR_SIZE * 2] = { 0 };
+			BYTE aBuf[CD_RAW_SECTOR_SIZE * SYNC_SEARCH_SECTOR_NUM] = { 0 };
 			memcpy(aBuf, lpBuf, CD_RAW_SECTOR_SIZE);
+			BOOL bOffset = FALSE;
+			INT nVotes = 0;
+			// The 2nd sector is always read. The rest is read only while the
+			// syncs don't agree on the offset, e.g. the 1st sector is damaged.
+			for (INT i = 1; i < SYNC_SEARCH_SECTOR_NUM && nVotes < 2; i++) {
+				if (!ExecReadCD(pExtArg, pDevice, lpCmd, nLBA + i
+					, lpBuf, dwBufSize, _T(__FUNCTION__), __LINE__)) {
+					if (i == 1) {
+						return FALSE;
+					}
+					break;
+				}
+				OutputCDMain(fileDisc, lpBuf, nLBA + i, CD_RAW_SECTOR_SIZE);
 
-			if (!ExecReadCD(pExtArg, pDevice, lpCmd, nLBA + 1
-				, lpBuf, dwBufSize, _T(__FUNCTION__), __LINE__)) {
-				return FALSE;
+				memcpy(aBuf + CD_RAW_SECTOR_SIZE * i, lpBuf, CD_RAW_SECTOR_SIZE);
+				bOffset = GetWriteOffset(pDisc, aBuf, CD_RAW_SECTOR_SIZE * (i + 1), &nVotes);
 			}
-			OutputCDMain(fileDisc, lpBuf, nLBA + 1, CD_RAW_SECTOR_SIZE);
-
-			memcpy(aBuf + CD_RAW_SECTOR_SIZE, lpBuf, CD_RAW_SECTOR_SIZE);
-			if (!GetWriteOffset(pDisc, aBuf)) {
+			if (!bOffset) {
 				if (pDisc->SCSI.trackType == TRACK_TYPE::dataExist) {
 					OutputLogA(standardError | fileDisc, _T("Failed to get write-offset\n"));
 					return FALSE;
@@ -215,7 +228,7 @@ BOOL ReadCDForSearchingOffset(
 ) {
 	BOOL bRet = TRUE;
 	INT nDriveSampleOffset = 0;
-	BOOL bGetDriveOffset = GetDriveOffsetAuto(pDevice->szProductId, &nDriveSampleOffset);
+	BOOL bGetDriveOffset = GetDriveOffsetAuto(pDevice, &nDriveSampleOffset);
 #ifdef _DEBUG
 	if (pDevice->byPlxtrDrive == PLXTR_DRIVE_TYPE::PX760A ||
 		pDevice->byPlxtrDrive == PLXTR_DRIVE_TYPE::PX755A ||
@@ -247,7 +260,28 @@ BOOL ReadCDForSearchingOffset(
 	}
 #endif
 	if (!bGetDriveOffset) {
-		GetDriveOffsetManually(&nDriveSampleOffset);
+		if (pDevice->PROFILE.byDriveOffset) {
+			nDriveSampleOffset = pDevice->PROFILE.nDriveSampleOffset;
+			OutputLogA(standardOut | fileDrive,
+				"Drive offset of driveProfile.ini is used: %+d\n", nDriveSampleOffset);
+		}
+		else if (!pExtArg->byNonInteractive) {
+			GetDriveOffsetManually(&nDriveSampleOffset);
+			// not asked again for this drive
+			pDevice->PROFILE.byDriveOffset = TRUE;
+			pDevice->PROFILE.nDriveSampleOffset = nDriveSampleOffset;
+			SaveDriveProfile(pDevice);
+		}
+		else if (pDisc->SCSI.trackType == TRACK_TYPE::dataExist) {
+			// the combined offset is got from the sync of the data track, so the drive offset is only shown
+			OutputLogA(standardOut | fileDrive,
+				"This drive doesn't define in driveOffset.txt. Drive offset is regarded as 0\n");
+		}
+		else {
+			OutputErrorString(
+				_T("This drive doesn't define in driveOffset.txt and the disc has no data track to get the offset\n"));
+			return FALSE;
+		}
 	}
 
 	INT nDriveOffset = nDriveSampleOffset * 4; // byte size * 4 = sample size
@@ -462,10 +496,18 @@ BOOL ReadCDForCheckingReadInOut(
 	INT nLBA = 0;
 	if (pDisc->MAIN.nCombinedOffset < 0) {
 		OutputLogA(standardOut | fileDrive, "Checking reading lead-in -> ");
+		if (pDevice->PROFILE.byLeadIn == lpCmd[0]) {
+			OutputLogA(standardOut | fileDrive, "OK (driveProfile.ini)\n");
+			return TRUE;
+		}
 		nLBA = -1;
 	}
 	else if (0 < pDisc->MAIN.nCombinedOffset && *pExecType == cd) {
 		OutputLogA(standardOut | fileDrive, "Checking reading lead-out -> ");
+		if (pDevice->PROFILE.byLeadOut == lpCmd[0]) {
+			OutputLogA(standardOut | fileDrive, "OK (driveProfile.ini)\n");
+			return TRUE;
+		}
 		nLBA = pDisc->SCSI.nAllLength;
 	}
 	// buffer is unused but buf null and size zero is semaphore error...
@@ -485,6 +527,13 @@ BOOL ReadCDForCheckingReadInOut(
 	else {
 		if (nLBA != 0) {
 			OutputLogA(standardOut | fileDrive, "OK\n");
+			if (nLBA == -1) {
+				pDevice->PROFILE.byLeadIn = lpCmd[0];
+			}
+			else {
+				pDevice->PROFILE.byLeadOut = lpCmd[0];
+			}
+			SaveDriveProfile(pDevice);
 		}
 	}
 #if 0
@@ -600,7 +649,7 @@ BOOL ReadCDForCheckingSubQAdr(
 			*byMode = GetMode(pDiscPerSector, unscrambled);
 		}
 		BOOL bCRC = FALSE;
-		WORD crc16 = (WORD)GetCrc16CCITT(10, &pDiscPerSector->subcode.current[12]);
+		WORD crc16 = GetCrc16SubQ(&pDiscPerSector->subcode.current[12]);
 		BYTE tmp1 = HIBYTE(crc16);
 		BYTE tmp2 = LOBYTE(crc16);
 		if (pDiscPerSector->subcode.current[22] == tmp1 && pDiscPerSector->subcode.current[23] == tmp2) {
@@ -1003,44 +1052,205 @@ BOOL IterateCabinet(
 	return TRUE;
 }
 #endif
-BOOL ReadCDForCheckingExe(
+int CompareExeProbeLBA(
+	const void* a,
+	const void* b
+) {
+	PEXE_PROBE pA = (PEXE_PROBE)a;
+	PEXE_PROBE pB = (PEXE_PROBE)b;
+	if (pA->nLBA != pB->nLBA) {
+		return pA->nLBA < pB->nLBA ? -1 : 1;
+	}
+	return pA->nIdx - pB->nIdx;
+}
+
+int CompareExeProbeIdx(
+	const void* a,
+	const void* b
+) {
+	return ((PEXE_PROBE)a)->nIdx - ((PEXE_PROBE)b)->nIdx;
+}
+
+BOOL ReadExeProbeRange(
 	PEXEC_TYPE pExecType,
 	PEXT_ARG pExtArg,
 	PDEVICE pDevice,
-	PDISC pDisc,
 	LPBYTE pCdb,
-	LPBYTE lpBuf
+	LPBYTE lpBuf,
+	INT nLBA,
+	INT nSectorNum,
+	INT nProbeNum,
+	LPINT lpPrevEndLBA,
+	PEXE_PROBE_STAT pStat
 ) {
-	BOOL bRet = TRUE;
 	BYTE byTransferLen = 1;
-	DWORD dwSize = DISC_RAW_READ_SIZE;
-	SetCommandForTransferLength(pExecType, pDevice, pCdb, dwSize, &byTransferLen);
-	for (INT n = 0; pDisc->PROTECT.pExtentPosForExe[n] != 0; n++) {
-#if 0
-		if (strstr(pDisc->PROTECT.pNameForExe[n], ".CAB") || strstr(pDisc->PROTECT.pNameForExe[n], ".cab")) {
-			// Get the absPath of cab file from path table
-			IterateCabinet(pDisc->PROTECT.pNameForExe[n]);
-			IterateCabinet("C:\\test\\disk1\\1.cab");
-			// Search exe, dll from extracted file
-			// Open exe, dll
-			// Read
+	SetCommandForTransferLength(pExecType, pDevice, pCdb, (DWORD)nSectorNum * DISC_RAW_READ_SIZE, &byTransferLen);
+	BOOL bSeek = *lpPrevEndLBA != nLBA;
+	LARGE_INTEGER llStart;
+	LARGE_INTEGER llEnd;
+	QueryPerformanceCounter(&llStart);
+	BOOL bRet = ExecReadCD(pExtArg, pDevice, pCdb, nLBA,
+		lpBuf, (DWORD)nSectorNum * DISC_RAW_READ_SIZE, _T(__FUNCTION__), __LINE__);
+	QueryPerformanceCounter(&llEnd);
+	double dMs = (double)(llEnd.QuadPart - llStart.QuadPart) * 1000 / pStat->llFreq.QuadPart;
+	pStat->nReadNum++;
+	if (bSeek) {
+		pStat->nSeekNum++;
+	}
+	pStat->dMs += dMs;
+	OutputMainInfoLogA("Checking EXE: nLBA %d, probe %d, byTransferLen %d, seek %s, %.2f ms%s\n"
+		, nLBA, nProbeNum, byTransferLen, bSeek ? "yes" : "no", dMs, bRet ? "" : " (failed)");
+	*lpPrevEndLBA = nLBA + nSectorNum;
+	return bRet;
+}
+
+// Reads the probes which aren't read yet in LBA order. The near probes are
+// read by one command, and the read sectors are copied to each probe.
+VOID ReadExeProbe(
+	PEXEC_TYPE pExecType,
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	LPBYTE pCdb,
+	LPBYTE lpBuf,
+	PEXE_PROBE pProbe,
+	INT nProbeNum,
+	PEXE_PROBE_STAT pStat
+) {
+	qsort(pProbe, (size_t)nProbeNum, sizeof(EXE_PROBE), CompareExeProbeLBA);
+	INT nMaxSectorNum = (INT)(pDevice->dwMaxTransferLength / DISC_RAW_READ_SIZE);
+	if (nMaxSectorNum > 0xff) {
+		nMaxSectorNum = 0xff;
+	}
+	INT nPrevEndLBA = -1;
+	for (INT j = 0; j < nProbeNum;) {
+		if (pProbe[j].lpHeader || pProbe[j].nSectorNum == 0) {
+			j++;
+			continue;
+		}
+		INT nRunLBA = pProbe[j].nLBA;
+		INT nRunEnd = nRunLBA + pProbe[j].nSectorNum;
+		INT k = j + 1;
+		for (; k < nProbeNum && pProbe[k].nLBA <= nRunEnd + EXE_PROBE_MERGE_GAP; k++) {
+			if (pProbe[k].lpHeader || pProbe[k].nSectorNum == 0) {
+				continue;
+			}
+			INT nEnd = max(nRunEnd, pProbe[k].nLBA + pProbe[k].nSectorNum);
+			if (nEnd - nRunLBA > nMaxSectorNum) {
+				break;
+			}
+			nRunEnd = nEnd;
 		}
-		else {
-#endif
-			if (!ExecReadCD(pExtArg, pDevice, pCdb, pDisc->PROTECT.pExtentPosForExe[n],
-				lpBuf, dwSize, _T(__FUNCTION__), __LINE__)) {
-				//				return FALSE;
-				// FIFA 99 (Europe) on PX-5224A
-				// LBA[000000, 0000000], [F:ReadCDForCheckingExe][L:734]
-				//		OperationCode: 0xa8
-				//		ScsiStatus: 0x02 = CHECK_CONDITION
-				//		SenseData Key-Asc-Ascq: 03-02-83 = MEDIUM_ERROR - OTHER
-				//  =>  The reason is unknown...
+		INT nNum = 0;
+		for (INT m = j; m < k; m++) {
+			if (!pProbe[m].lpHeader && pProbe[m].nSectorNum > 0) {
+				nNum++;
+			}
+		}
+		BOOL bRead = FALSE;
+		if (nNum > 1) {
+			bRead = ReadExeProbeRange(pExecType, pExtArg, pDevice, pCdb, lpBuf
+				, nRunLBA, nRunEnd - nRunLBA, nNum, &nPrevEndLBA, pStat);
+		}
+		for (INT m = j; m < k; m++) {
+			if (pProbe[m].lpHeader || pProbe[m].nSectorNum == 0) {
 				continue;
 			}
-#if 0
+			size_t size = (size_t)pProbe[m].nSectorNum * DISC_RAW_READ_SIZE;
+			LPBYTE lpSrc = lpBuf + (pProbe[m].nLBA - nRunLBA) * DISC_RAW_READ_SIZE;
+			if (!bRead) {
+				// single probe, or the merged range includes an unreadable sector
+				if (!ReadExeProbeRange(pExecType, pExtArg, pDevice, pCdb, lpBuf
+					, pProbe[m].nLBA, pProbe[m].nSectorNum, 1, &nPrevEndLBA, pStat)) {
+					//				return FALSE;
+					// FIFA 99 (Europe) on PX-5224A
+					// LBA[000000, 0000000], [F:ReadCDForCheckingExe][L:734]
+					//		OperationCode: 0xa8
+					//		ScsiStatus: 0x02 = CHECK_CONDITION
+					//		SenseData Key-Asc-Ascq: 03-02-83 = MEDIUM_ERROR - OTHER
+					//  =>  The reason is unknown...
+					pProbe[m].nSectorNum = 0;
+					continue;
+				}
+				lpSrc = lpBuf;
+			}
+			if (NULL == (pProbe[m].lpHeader = (LPBYTE)calloc(size, sizeof(BYTE)))) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				pProbe[m].nSectorNum = 0;
+				continue;
+			}
+			memcpy(pProbe[m].lpHeader, lpSrc, size);
 		}
-#endif
+		j = k;
+		SetProgress(k);
+	}
+	SetProgress(nProbeNum);
+}
+
+BOOL ReadCDForCheckingExe(
+	PEXEC_TYPE pExecType,
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	PDISC pDisc,
+	LPBYTE pCdb,
+	LPBYTE lpBuf
+) {
+	INT nProbeNum = 0;
+	while (nProbeNum < EXELBA_STORE_SIZE && pDisc->PROTECT.pExtentPosForExe[nProbeNum] != 0) {
+		nProbeNum++;
+	}
+	if (nProbeNum == 0) {
+		OutputString(_T("\n"));
+		return TRUE;
+	}
+	PEXE_PROBE pProbe = (PEXE_PROBE)calloc((size_t)nProbeNum, sizeof(EXE_PROBE));
+	if (!pProbe) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	for (INT n = 0; n < nProbeNum; n++) {
+		pProbe[n].nIdx = n;
+		pProbe[n].nLBA = pDisc->PROTECT.pExtentPosForExe[n];
+		pProbe[n].nSectorNum = 1;
+	}
+	EXE_PROBE_STAT stat = { 0 };
+	QueryPerformanceFrequency(&stat.llFreq);
+
+	// 1st: the first sector of all files
+	StartProgress(_T("Checking EXE"), _T("File"), 0, nProbeNum, 0, 0);
+	ReadExeProbe(pExecType, pExtArg, pDevice, pCdb, lpBuf, pProbe, nProbeNum, &stat);
+	// 2nd: the file whose PE header is out of the first sector
+	INT nRereadNum = 0;
+	for (INT n = 0; n < nProbeNum; n++) {
+		if (!pProbe[n].lpHeader || MAKEWORD(pProbe[n].lpHeader[0], pProbe[n].lpHeader[1]) != IMAGE_DOS_SIGNATURE) {
+			continue;
+		}
+		DWORD dwLfanew = (DWORD)((PIMAGE_DOS_HEADER)pProbe[n].lpHeader)->e_lfanew;
+		if (DISC_RAW_READ_SIZE < dwLfanew && dwLfanew <= pDevice->dwMaxTransferLength) {
+			BYTE byTransferLen = 1;
+			SetCommandForTransferLength(pExecType, pDevice, pCdb
+				, min(dwLfanew + DISC_RAW_READ_SIZE, pDevice->dwMaxTransferLength), &byTransferLen);
+			FreeAndNull(pProbe[n].lpHeader);
+			pProbe[n].nSectorNum = byTransferLen;
+			nRereadNum++;
+		}
+	}
+	if (nRereadNum > 0) {
+		StartProgress(_T("Checking EXE (PE header)"), _T("File"), 0, nProbeNum, 0, 0);
+		ReadExeProbe(pExecType, pExtArg, pDevice, pCdb, lpBuf, pProbe, nProbeNum, &stat);
+	}
+	EndProgress();
+	// the log is output in the order of the directory record
+	qsort(pProbe, (size_t)nProbeNum, sizeof(EXE_PROBE), CompareExeProbeIdx);
+
+	for (INT n = 0; n < nProbeNum; n++) {
+		if (!pProbe[n].lpHeader) {
+			continue;
+		}
+		DWORD dwSize = DWORD(DISC_RAW_READ_SIZE) * pProbe[n].nSectorNum;
+		ZeroMemory(lpBuf, pDevice->dwMaxTransferLength);
+		memcpy(lpBuf, pProbe[n].lpHeader, dwSize);
+		FreeAndNull(pProbe[n].lpHeader);
+
 		WORD wMagic = MAKEWORD(lpBuf[0], lpBuf[1]);
 		if (wMagic == IMAGE_DOS_SIGNATURE) {
 			PIMAGE_DOS_HEADER pIDh = (PIMAGE_DOS_HEADER)&lpBuf[0];
@@ -1050,9 +1260,9 @@ BOOL ReadCDForCheckingExe(
 						, pDisc->PROTECT.pNameForExe[n], pIDh->e_lfanew);
 				}
 				else {
-					SetCommandForTransferLength(pExecType, pDevice, pCdb, (DWORD)pIDh->e_lfanew, &byTransferLen);
-					dwSize = DWORD(DISC_RAW_READ_SIZE) * byTransferLen;
-					n--;
+					// the PE header isn't in the read sectors
+					OutputVolDescLogA("%s: offset (%lu) is out of the read size (%lu). read skip\n"
+						, pDisc->PROTECT.pNameForExe[n], pIDh->e_lfanew, dwSize);
 				}
 				continue;
 			}
@@ -1084,10 +1294,11 @@ BOOL ReadCDForCheckingExe(
 			OutputVolDescLogA(
 				"%s: ImageDosHeader doesn't exist\n", pDisc->PROTECT.pNameForExe[n]);
 		}
-		OutputString(_T("\rChecking EXE %4d"), n + 1);
 	}
-	OutputString(_T("\n"));
-	return bRet;
+	OutputMainInfoLogA("Checking EXE: %d files, %d reads, %d seeks, %.2f ms (%.2f ms/file)\n"
+		, nProbeNum, stat.nReadNum, stat.nSeekNum, stat.dMs, stat.dMs / nProbeNum);
+	FreeAndNull(pProbe);
+	return TRUE;
 }
 
 BOOL ReadCDForSegaDisc(
@@ -1129,45 +1340,83 @@ BOOL ReadCDForCheckingPsxRegion(
 	return FALSE;
 }
 
+// The sectors are read by the max transfer length and the both strings are
+// searched at once, so the string which spans the sectors is also found.
 VOID ReadCDForScanningPsxAntiMod(
 	PEXT_ARG pExtArg,
 	PDEVICE pDevice,
 	PDISC pDisc
 ) {
-	BOOL bRet = FALSE;
-	BYTE buf[DISC_RAW_READ_SIZE] = { 0 };
 	CONST CHAR antiModStrEn[] =
 		"     SOFTWARE TERMINATED\nCONSOLE MAY HAVE BEEN MODIFIED\n     CALL 1-888-780-7690";
 	CONST CHAR antiModStrJp[] =
 		"I܂B\n{̂Ă\nꂪ܂B";
+	CONST BYTE* lpPattern[] = { (CONST BYTE*)antiModStrEn, (CONST BYTE*)antiModStrJp };
+	DWORD dwPatternLen[] = { sizeof(antiModStrEn), sizeof(antiModStrJp) };
+	PATTERN_SCANNER scanner = {};
+	if (!InitPatternScanner(&scanner, lpPattern, dwPatternLen, 2)) {
+		return;
+	}
+	INT nMaxSectorNum = (INT)(pDevice->dwMaxTransferLength / DISC_RAW_READ_SIZE);
+	if (nMaxSectorNum > 0xff) {
+		nMaxSectorNum = 0xff;
+	}
+	else if (nMaxSectorNum < 1) {
+		nMaxSectorNum = 1;
+	}
+	LPBYTE pBuf = NULL;
+	LPBYTE lpBuf = NULL;
+	if (!GetAlignedCallocatedBuffer(pDevice, &pBuf,
+		(DWORD)nMaxSectorNum * DISC_RAW_READ_SIZE, &lpBuf, _T(__FUNCTION__), __LINE__)) {
+		TerminatePatternScanner(&scanner);
+		return;
+	}
 	CDB::_READ12 cdb = { 0 };
 	cdb.OperationCode = SCSIOP_READ12;
-	cdb.TransferLength[3] = 1;
 
-	for (INT nLBA = 18; nLBA < pDisc->SCSI.nLastLBAofDataTrack - 150; nLBA++) {
-		if (!ExecReadCD(pExtArg, pDevice, (LPBYTE)&cdb, nLBA, buf,
-			DISC_RAW_READ_SIZE, _T(__FUNCTION__), __LINE__)) {
-			return;
-		}
-		for (INT i = 0; i < DISC_RAW_READ_SIZE; i++) {
-			if (!memcmp(&buf[i], antiModStrEn, sizeof(antiModStrEn))) {
-				OutputLogA(fileDisc | standardOut, "\nDetected anti-mod string (en): LBA %d", nLBA);
-				bRet += TRUE;
-			}
-			if (!memcmp(&buf[i], antiModStrJp, sizeof(antiModStrJp))) {
-				OutputLogA(fileDisc | standardOut, "\nDetected anti-mod string (jp): LBA %d\n", nLBA);
-				bRet += TRUE;
-			}
-			if (bRet == 2) {
+	CONST INT nFirstLBA = 18;
+	CONST INT nEndLBA = pDisc->SCSI.nLastLBAofDataTrack - 150;
+	PATTERN_MATCH match[2] = {};
+	INT nMatchNum = 0;
+	// the sectors up to here are read one by one because the read by the max
+	// transfer length failed
+	INT nSingleEndLBA = nFirstLBA;
+	BOOL bReadErr = FALSE;
+
+	StartProgress(_T("Scanning sector for anti-mod string"), _T("LBA")
+		, nFirstLBA, nEndLBA - 1, DISC_RAW_READ_SIZE, PROGRESS_SPEED_CD);
+	for (INT nLBA = nFirstLBA; nLBA < nEndLBA && nMatchNum < 2;) {
+		INT nSectorNum = nLBA < nSingleEndLBA ? 1 : min(nMaxSectorNum, nEndLBA - nLBA);
+		cdb.TransferLength[3] = (BYTE)nSectorNum;
+		if (!ExecReadCD(pExtArg, pDevice, (LPBYTE)&cdb, nLBA, lpBuf,
+			(DWORD)nSectorNum * DISC_RAW_READ_SIZE, _T(__FUNCTION__), __LINE__)) {
+			if (nSectorNum == 1) {
+				bReadErr = TRUE;
 				break;
 			}
+			nSingleEndLBA = nLBA + nSectorNum;
+			continue;
 		}
-		if (bRet == 2) {
-			break;
+		INT nNum = ScanPattern(&scanner, lpBuf,
+			(DWORD)nSectorNum * DISC_RAW_READ_SIZE, &match[nMatchNum], 2 - nMatchNum);
+		for (INT i = nMatchNum; i < nMatchNum + nNum; i++) {
+			INT nMatchLBA = nFirstLBA + (INT)(match[i].ullPos / DISC_RAW_READ_SIZE);
+			if (match[i].nPatternIdx == 0) {
+				OutputLogA(fileDisc | standardOut, "\nDetected anti-mod string (en): LBA %d", nMatchLBA);
+			}
+			else {
+				OutputLogA(fileDisc | standardOut, "\nDetected anti-mod string (jp): LBA %d\n", nMatchLBA);
+			}
 		}
-		OutputString(_T("\rScanning sector for anti-mod string (LBA) %6d/%6d"), nLBA, pDisc->SCSI.nLastLBAofDataTrack - 150 - 1);
+		nMatchNum += nNum;
+		nLBA += nSectorNum;
+		SetProgress(nLBA - 1);
+		SetProgressError(nMatchNum);
 	}
-	if (!bRet) {
+	EndProgress();
+	FreeAndNull(pBuf);
+	TerminatePatternScanner(&scanner);
+	if (!bReadErr && !nMatchNum) {
 		OutputLogA(fileDisc | standardOut, "\nNo anti-mod string\n");
 	}
 	return;
@@ -1206,10 +1455,12 @@ BOOL ReadCDForScanningProtectViaSector(
 	}
 	BYTE aBuf[CD_RAW_SECTOR_WITH_C2_294_AND_SUBCODE_SIZE] = { 0 };
 	BYTE byScsiStatus = 0;
+	StartProgress(_T("Scanning sector"), _T("LBA"), 0, pDisc->SCSI.nAllLength - 1, CD_RAW_SECTOR_SIZE, PROGRESS_SPEED_CD);
 	for (INT nLBA = 0; nLBA < pDisc->SCSI.nAllLength; nLBA++) {
 		if (!ExecReadCD(pExtArg, pDevice, lpCmd, nLBA, aBuf,
 			dwBufLen, _T(__FUNCTION__), __LINE__)
 			|| byScsiStatus >= SCSISTAT_CHECK_CONDITION) {
+			EndProgress();
 			return FALSE;
 		}
 		INT nOfs = 0;
@@ -1229,9 +1480,10 @@ BOOL ReadCDForScanningProtectViaSector(
 			pExtArg->byScanProtectViaFile = pExtArg->byScanProtectViaSector;
 			break;
 		}
-		OutputString(_T("\rScanning sector (LBA) %6d/%6d"), nLBA, pDisc->SCSI.nAllLength - 1);
+		SetProgress(nLBA);
 	}
-	OutputLogA(standardOut | fileDisc, "\n");
+	EndProgress();
+	OutputDiscLogA("\n");
 
 	return TRUE;
 }
@@ -1244,7 +1496,7 @@ BOOL ReadCDForCheckingSecuROM(
 	LPBYTE lpCmd
 ) {
 #ifdef _DEBUG
-	WORD w = (WORD)GetCrc16CCITT(10, &pDiscPerSector->subcode.current[12]);
+	WORD w = GetCrc16SubQ(&pDiscPerSector->subcode.current[12]);
 	OutputSubInfoWithLBALogA(
 		"CRC-16 is original:[%02x%02x], recalc:[%04x] and XORed with 0x8001:[%02x%02x]\n"
 		, -1, 0, pDiscPerSector->subcode.current[22], pDiscPerSector->subcode.current[23]
@@ -1252,7 +1504,7 @@ BOOL ReadCDForCheckingSecuROM(
 #endif
 	if (pExtArg->byIntentionalSub && pDisc->PROTECT.byExist != securomV1 &&
 		(pDiscPerSector->subcode.current[12] == 0x41 || pDiscPerSector->subcode.current[12] == 0x61)) {
-		WORD crc16 = (WORD)GetCrc16CCITT(10, &pDiscPerSector->subcode.current[12]);
+		WORD crc16 = GetCrc16SubQ(&pDiscPerSector->subcode.current[12]);
 		WORD bufcrc = MAKEWORD(pDiscPerSector->subcode.current[23], pDiscPerSector->subcode.current[22]);
 		INT nRLBA = MSFtoLBA(BcdToDec(pDiscPerSector->subcode.current[15])
 			, BcdToDec(pDiscPerSector->subcode.current[16]), BcdToDec(pDiscPerSector->subcode.current[17]));
@@ -1323,7 +1575,7 @@ BOOL ReadCDForCheckingSecuROM(
 							pDevice->TRANSFER.dwBufLen, _T(__FUNCTION__), __LINE__)) {
 							return FALSE;
 						}
-						WORD reCalcCrc16 = (WORD)GetCrc16CCITT(10, &pDiscPerSector->subcode.current[12]);
+						WORD reCalcCrc16 = GetCrc16SubQ(&pDiscPerSector->subcode.current[12]);
 						WORD reCalcXorCrc16 = (WORD)(reCalcCrc16 ^ 0x0080);
 						if (pDiscPerSector->subcode.current[22] == HIBYTE(reCalcXorCrc16) &&
 							pDiscPerSector->subcode.current[23] == LOBYTE(reCalcXorCrc16)) {
@@ -1411,6 +1663,37 @@ BOOL ExecCheckingByteOrder(
 	return bRet;
 }
 
+// Instead of all the probes, one read confirms the result of driveProfile.ini
+static BOOL ValidateByteOrderOfProfile(
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	CDFLAG::_READ_CD::_ERROR_FLAGS* c2,
+	BYTE byOpCode
+) {
+	if (!pDevice->PROFILE.byC2Probed || pDevice->PROFILE.byC2OpCode != byOpCode) {
+		return FALSE;
+	}
+	BOOL bRet = FALSE;
+	if (pDevice->PROFILE.byC2Type == CDFLAG::_READ_CD::NoC2) {
+		// still unsupported if the first probe fails again
+		bRet = !ExecCheckingByteOrder(pExtArg, pDevice, *c2, CDFLAG::_READ_CD::Raw);
+	}
+	else {
+		*c2 = (CDFLAG::_READ_CD::_ERROR_FLAGS)pDevice->PROFILE.byC2Type;
+		bRet = ExecCheckingByteOrder(pExtArg, pDevice, *c2, CDFLAG::_READ_CD::Raw) &&
+			pDevice->driveOrder == pDevice->PROFILE.driveOrder;
+	}
+	if (bRet) {
+		OutputLogA(standardOut | fileDrive, "C2 error report of this drive is same as driveProfile.ini\n");
+	}
+	else {
+		OutputLogA(standardOut | fileDrive, "C2 error report of this drive differs from driveProfile.ini. Checking again\n");
+		*c2 = CDFLAG::_READ_CD::byte294;
+		pDevice->driveOrder = DRIVE_DATA_ORDER::MainC2Sub;
+	}
+	return bRet;
+}
+
 VOID ReadCDForCheckingByteOrder(
 	PEXT_ARG pExtArg,
 	PDEVICE pDevice,
@@ -1422,8 +1705,19 @@ VOID ReadCDForCheckingByteOrder(
 		SetBufferSizeForReadCD(pDevice, DRIVE_DATA_ORDER::MainC2Sub);
 		pDevice->driveOrder = DRIVE_DATA_ORDER::MainC2Sub;
 		CDFLAG::_READ_CD::_SUB_CHANNEL_SELECTION sub = CDFLAG::_READ_CD::Raw;
+		BYTE byOpCode = (BYTE)(((pExtArg->byD8 || pDevice->byPlxtrDrive) && !pExtArg->byBe) ? 0xd8 : 0xbe);
 
-		if (!ExecCheckingByteOrder(pExtArg, pDevice, *c2, sub)) {
+		if (ValidateByteOrderOfProfile(pExtArg, pDevice, c2, byOpCode)) {
+			if (pDevice->PROFILE.byC2Type == CDFLAG::_READ_CD::NoC2) {
+				OutputLogA(standardError | fileDrive,
+					"[WARNING] This drive doesn't support reporting C2 error. Disabled /c2\n");
+				*c2 = CDFLAG::_READ_CD::NoC2;
+				pDevice->driveOrder = DRIVE_DATA_ORDER::NoC2;
+				pDevice->FEATURE.byC2ErrorData = FALSE;
+				SetBufferSizeForReadCD(pDevice, DRIVE_DATA_ORDER::NoC2);
+			}
+		}
+		else if (!ExecCheckingByteOrder(pExtArg, pDevice, *c2, sub)) {
 			BOOL bRet = FALSE;
 			if (!pExtArg->byD8 && !pDevice->byPlxtrDrive) {
 				bRet = TRUE;
@@ -1458,6 +1752,14 @@ VOID ReadCDForCheckingByteOrder(
 				SetBufferSizeForReadCD(pDevice, DRIVE_DATA_ORDER::NoC2);
 			}
 		}
+		if (!pDevice->PROFILE.byC2Probed || pDevice->PROFILE.byC2OpCode != byOpCode ||
+			pDevice->PROFILE.byC2Type != (BYTE)*c2 || pDevice->PROFILE.driveOrder != pDevice->driveOrder) {
+			pDevice->PROFILE.byC2Probed = TRUE;
+			pDevice->PROFILE.byC2OpCode = byOpCode;
+			pDevice->PROFILE.byC2Type = (BYTE)*c2;
+			pDevice->PROFILE.driveOrder = pDevice->driveOrder;
+			SaveDriveProfile(pDevice);
+		}
 		if (pDevice->driveOrder == DRIVE_DATA_ORDER::MainSubC2) {
 			OutputDriveLogA(
 				"\tByte order of this drive is main + sub + c2\n");
@@ -15,17 +15,231 @@
  */
 #include "struct.h"
 #include "convert.h"
+#include "driveProfile.h"
+#include "dvdUnscrambler.h"
+#include "errorMap.h"
 #include "execIoctl.h"
 #include "execScsiCmd.h"
 #include "execScsiCmdforDVD.h"
 #include "execScsiCmdforFileSystem.h"
 #include "get.h"
 #include "output.h"
+#include "outputProgress.h"
+#include "outputStream.h"
 #include "outputScsiCmdLogforDVD.h"
+#include "rawCacheStrategy.h"
+#include "readQueue.h"
 
 #define GAMECUBE_SIZE	(712880)
 #define WII_SL_SIZE		(2294912)
 #define WII_DL_SIZE		(4155840)
+#define RETRY_PASS_NUM	(3)
+// frames read and written at a time by a thread
+#define UNSCRAMBLE_CHUNK_FRAME_NUM	(DVD_ECC_BLOCK_FRAME_NUM * 64)
+// frames unscrambled by a thread at least
+#define UNSCRAMBLE_THREAD_FRAME_MIN	(DVD_ECC_BLOCK_FRAME_NUM * 1024)
+
+static BOOL ReadDVDSectors(
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	CDB::_READ12* pCdb,
+	INT nLBA,
+	DWORD dwTransferLen,
+	LPBYTE lpBuf
+) {
+	CDB::_READ12 cdb = *pCdb;
+	REVERSE_BYTES(&cdb.TransferLength, &dwTransferLen);
+	REVERSE_BYTES(&cdb.LogicalBlock, &nLBA);
+	BYTE byScsiStatus = 0;
+	if (!ScsiPassThroughDirect(pExtArg, pDevice, &cdb, CDB12GENERIC_LENGTH, lpBuf,
+		DISC_RAW_READ_SIZE * dwTransferLen, &byScsiStatus, _T(__FUNCTION__), __LINE__)
+		|| byScsiStatus >= SCSISTAT_CHECK_CONDITION) {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+// The failed transfer is halved until the bad sectors are isolated, so a bad
+// sector doesn't lose the whole transfer. The bad sector is zero-filled and
+// retried after all sectors are read.
+static BOOL ReadDVDForBisecting(
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	CDB::_READ12* pCdb,
+	PERROR_MAP pMap,
+	INT nLBA,
+	DWORD dwTransferLen,
+	LPBYTE lpBuf
+) {
+	if (dwTransferLen == 1) {
+		ZeroMemory(lpBuf, DISC_RAW_READ_SIZE);
+		OutputLog(standardError | fileMainError
+			, _T("\rLBA[%06d, %#07x]: Read error. Zero-filled and retried later\n"), nLBA, nLBA);
+		return SetErrorMapRange(pMap, nLBA, 1, ERROR_MAP_BAD);
+	}
+	DWORD dwHalfLen[2] = { dwTransferLen / 2, dwTransferLen - dwTransferLen / 2 };
+	for (INT i = 0; i < 2; i++) {
+		if (ReadDVDSectors(pExtArg, pDevice, pCdb, nLBA, dwHalfLen[i], lpBuf)) {
+			if (!SetErrorMapRange(pMap, nLBA, (INT)dwHalfLen[i], ERROR_MAP_GOOD)) {
+				return FALSE;
+			}
+		}
+		else if (!ReadDVDForBisecting(pExtArg, pDevice, pCdb, pMap, nLBA, dwHalfLen[i], lpBuf)) {
+			return FALSE;
+		}
+		nLBA += (INT)dwHalfLen[i];
+		lpBuf += DISC_RAW_READ_SIZE * dwHalfLen[i];
+	}
+	return TRUE;
+}
+
+static BOOL WriteDVDSectors(
+	FILE* fp,
+	INT nLBA,
+	DWORD dwTransferLen,
+	LPBYTE lpBuf
+) {
+	if (_fseeki64(fp, (INT64)nLBA * DISC_RAW_READ_SIZE, SEEK_SET) ||
+		fwrite(lpBuf, sizeof(BYTE), DISC_RAW_READ_SIZE * dwTransferLen, fp) < DISC_RAW_READ_SIZE * dwTransferLen) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+// Reads the untried sectors of the resumed map, and then retries the bad
+// sectors one by one. A weak sector may be read at the other speed, so each
+// pass changes the speed (only the dvd supports it).
+static BOOL ReadDVDForErrorMap(
+	PEXEC_TYPE pExecType,
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	CDB::_READ12* pCdb,
+	PERROR_MAP pMap,
+	LPCTSTR pszMapPath,
+	FILE* fp,
+	LPBYTE lpBuf,
+	DWORD dwTransferLenOrg
+) {
+	INT nLBA = 0;
+	INT nSectorNum = 0;
+	while (GetErrorMapRange(pMap, ERROR_MAP_UNTRIED, &nLBA, &nSectorNum)) {
+		DWORD dwTransferLen = min(dwTransferLenOrg, (DWORD)nSectorNum);
+		OutputString(_T("\rReading untried LBA[%06d, %#07x]"), nLBA, nLBA);
+		if (ReadDVDSectors(pExtArg, pDevice, pCdb, nLBA, dwTransferLen, lpBuf)) {
+			if (!SetErrorMapRange(pMap, nLBA, (INT)dwTransferLen, ERROR_MAP_GOOD)) {
+				return FALSE;
+			}
+		}
+		else if (!ReadDVDForBisecting(pExtArg, pDevice, pCdb, pMap, nLBA, dwTransferLen, lpBuf)) {
+			return FALSE;
+		}
+		if (!WriteDVDSectors(fp, nLBA, dwTransferLen, lpBuf)) {
+			return FALSE;
+		}
+		nLBA += (INT)dwTransferLen;
+	}
+	OutputString(_T("\n"));
+	SaveErrorMap(pMap, pszMapPath);
+
+	// 0 is the max speed
+	DWORD dwRetrySpeed[RETRY_PASS_NUM] = { 1, 4, 0 };
+	for (INT i = 0; i < RETRY_PASS_NUM && GetErrorMapSectorNum(pMap, ERROR_MAP_BAD); i++) {
+		SetDiscSpeed(pExecType, pExtArg, pDevice, dwRetrySpeed[i]);
+		nLBA = 0;
+		while (GetErrorMapRange(pMap, ERROR_MAP_BAD, &nLBA, &nSectorNum)) {
+			OutputString(_T("\rRetrying LBA[%06d, %#07x] (pass %d/%d)")
+				, nLBA, nLBA, i + 1, RETRY_PASS_NUM);
+			if (ReadDVDSectors(pExtArg, pDevice, pCdb, nLBA, 1, lpBuf)) {
+				OutputLog(standardError | fileMainError
+					, _T("\rLBA[%06d, %#07x]: Read at the retry pass %d\n"), nLBA, nLBA, i + 1);
+				if (!SetErrorMapRange(pMap, nLBA, 1, ERROR_MAP_GOOD) ||
+					!WriteDVDSectors(fp, nLBA, 1, lpBuf)) {
+					return FALSE;
+				}
+			}
+			nLBA++;
+		}
+		OutputString(_T("\n"));
+		SaveErrorMap(pMap, pszMapPath);
+	}
+	INT nBadNum = GetErrorMapSectorNum(pMap, ERROR_MAP_BAD);
+	if (nBadNum) {
+		OutputErrorString(
+			_T("%d sectors couldn't be read. They are recorded in %s, and can be retried by /re\n")
+			, nBadNum, pszMapPath);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+// Completes the oldest slot of the queue and pushes it to the output stream.
+// The sectors of the failed command are read again by bisecting, so the
+// position of the iso is kept. pMap is NULL if the slots aren't in the map.
+static BOOL PushDVDSlot(
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	CDB::_READ12* pCdb,
+	PERROR_MAP pMap,
+	PREAD_QUEUE pQueue
+) {
+	LPBYTE lpSlot = NULL;
+	INT nLBA = 0;
+	DWORD dwSize = 0;
+	BOOL bRead = CompleteReadQueueSlot(pQueue, &lpSlot, &nLBA, &dwSize);
+	if (!bRead && !pMap) {
+		return FALSE;
+	}
+	if (pMap) {
+		DWORD dwTransferLen = dwSize / DISC_RAW_READ_SIZE;
+		if (!bRead) {
+			// the cdb of the caller has the transfer length of the next command
+			CDB::_READ12 cdb = *pCdb;
+			if (!ReadDVDForBisecting(pExtArg, pDevice, &cdb, pMap, nLBA, dwTransferLen, lpSlot)) {
+				return FALSE;
+			}
+		}
+		else if (!SetErrorMapRange(pMap, nLBA, (INT)dwTransferLen, ERROR_MAP_GOOD)) {
+			return FALSE;
+		}
+	}
+	if (!PushReadQueueSlot(pQueue, dwSize)) {
+		return FALSE;
+	}
+	SetProgress((INT)(pQueue->ullBytes / DISC_RAW_READ_SIZE));
+	return TRUE;
+}
+
+// Gets the slot of the next command. If the commands of the queue depth are
+// in flight, the oldest one is pushed first.
+static LPBYTE GetDVDSlot(
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	CDB::_READ12* pCdb,
+	PERROR_MAP pMap,
+	PREAD_QUEUE pQueue
+) {
+	if (pQueue->nIssuedNum >= pQueue->nDepth &&
+		!PushDVDSlot(pExtArg, pDevice, pCdb, pMap, pQueue)) {
+		return NULL;
+	}
+	return GetReadQueueSlot(pQueue);
+}
+
+static BOOL FlushDVDSlot(
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	CDB::_READ12* pCdb,
+	PERROR_MAP pMap,
+	PREAD_QUEUE pQueue
+) {
+	while (pQueue->nIssuedNum) {
+		if (!PushDVDSlot(pExtArg, pDevice, pCdb, pMap, pQueue)) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
 
 BOOL ReadDVD(
 	PEXEC_TYPE pExecType,
@@ -34,14 +248,39 @@ BOOL ReadDVD(
 	PDISC pDisc,
 	LPCTSTR pszFullPath
 ) {
+	// the map has the status of the sectors from 0 to nAllLength - 1 (the position of the iso)
+	_TCHAR szMapPath[_MAX_PATH] = { 0 };
+	_TCHAR szDrive[_MAX_DRIVE] = { 0 };
+	_TCHAR szDir[_MAX_DIR] = { 0 };
+	_TCHAR szFname[_MAX_FNAME] = { 0 };
+	_tsplitpath(pszFullPath, szDrive, szDir, szFname, NULL);
+	_tmakepath(szMapPath, szDrive, szDir, szFname, _T(".map"));
+	ERROR_MAP map = { 0 };
+	if (!InitErrorMap(&map, pDisc->SCSI.nAllLength, DISC_RAW_READ_SIZE)) {
+		return FALSE;
+	}
+	BOOL bResume = FALSE;
+	if (pExtArg->byResume && *pExecType != xbox && PathFileExists(szMapPath)) {
+		if (!LoadErrorMap(&map, szMapPath)) {
+			TerminateErrorMap(&map);
+			return FALSE;
+		}
+		OutputString(_T("Resume from %s (good: %d, bad: %d, untried: %d)\n"), szMapPath
+			, GetErrorMapSectorNum(&map, ERROR_MAP_GOOD), GetErrorMapSectorNum(&map, ERROR_MAP_BAD)
+			, GetErrorMapSectorNum(&map, ERROR_MAP_UNTRIED));
+		bResume = TRUE;
+	}
 	FILE* fp = CreateOrOpenFile(
-		pszFullPath, NULL, NULL, NULL, NULL, _T(".iso"), _T("wb"), 0, 0);
+		pszFullPath, NULL, NULL, NULL, NULL, _T(".iso"), bResume ? _T("rb+") : _T("wb"), 0, 0);
 	if (!fp) {
 		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		TerminateErrorMap(&map);
 		return FALSE;
 	}
 	BOOL bRet = TRUE;
+	BOOL bSaveMap = FALSE;
 	LPBYTE pBuf = NULL;
+	READ_QUEUE queue = { 0 };
 	try {
 		if (NULL == (pBuf = (LPBYTE)calloc(
 			pDevice->dwMaxTransferLength + pDevice->AlignmentMask, sizeof(BYTE)))) {
@@ -79,14 +318,32 @@ BOOL ReadDVD(
 				"\t                  %7u (%#x)\n", nAllLength, nAllLength);
 		}
 		FlushLog();
+		// the zero-filled security sectors, the middle zone and the padding
+		// aren't written if the file system supports sparse files
+		if (!AttachOutputStream(fp, pExtArg->byDirectWrite, !bResume)) {
+			throw FALSE;
+		}
+		if (!InitReadQueue(&queue, pDevice, fp
+			, pDevice->dwMaxTransferLength, (INT)pExtArg->dwReadQueueDepth)) {
+			throw FALSE;
+		}
 
 		DWORD dwTransferLen = pDevice->dwMaxTransferLength / DISC_RAW_READ_SIZE;
 		REVERSE_BYTES(&cdb.TransferLength, &dwTransferLen);
-		BYTE byScsiStatus = 0;
 		INT i = 0;
 		DWORD dwTransferLenOrg = dwTransferLen;
+		StartProgress(_T("Creating iso"), _T("LBA"), 0, nAllLength, DISC_RAW_READ_SIZE
+			, *pExecType == bd ? PROGRESS_SPEED_BD : PROGRESS_SPEED_DVD);
+		INT nFirstLBA = 0;
+		if (bResume) {
+			// the sectors which aren't good in the map are read by ReadDVDForErrorMap
+			nFirstLBA = pDisc->SCSI.nAllLength;
+		}
+		else {
+			bSaveMap = TRUE;
+		}
 
-		for (INT nLBA = 0; nLBA < pDisc->SCSI.nAllLength; nLBA += dwTransferLen) {
+		for (INT nLBA = nFirstLBA; nLBA < pDisc->SCSI.nAllLength; nLBA += dwTransferLen) {
 			if (*pExecType == xbox) {
 				if (pDisc->DVD.securitySectorRange[i][0] <= (DWORD)nLBA &&
 					(DWORD)nLBA <= pDisc->DVD.securitySectorRange[i][1] + 1) {
@@ -98,8 +355,14 @@ BOOL ReadDVD(
 							dwTransferLen = dwTransferLenOrg;
 							REVERSE_BYTES(&cdb.TransferLength, &dwTransferLen);
 						}
-						ZeroMemory(lpBuf, DISC_RAW_READ_SIZE * dwTransferLen);
-						fwrite(lpBuf, sizeof(BYTE), (size_t)DISC_RAW_READ_SIZE * dwTransferLen, fp);
+						LPBYTE lpSlot = GetDVDSlot(pExtArg, pDevice, &cdb, &map, &queue);
+						if (!lpSlot) {
+							throw FALSE;
+						}
+						// the security sectors are zero-filled on purpose
+						ZeroMemory(lpSlot, DISC_RAW_READ_SIZE * dwTransferLen);
+						IssueReadQueueSlot(&queue, pExtArg, pDevice
+							, NULL, 0, nLBA, DISC_RAW_READ_SIZE * dwTransferLen);
 						continue;
 					}
 				}
@@ -113,28 +376,34 @@ BOOL ReadDVD(
 				REVERSE_BYTES(&cdb.TransferLength, &dwTransferLen);
 			}
 			REVERSE_BYTES(&cdb.LogicalBlock, &nLBA);
-			if (!ScsiPassThroughDirect(pExtArg, pDevice, &cdb, CDB12GENERIC_LENGTH, lpBuf,
-				DISC_RAW_READ_SIZE * dwTransferLen, &byScsiStatus, _T(__FUNCTION__), __LINE__)
-				|| byScsiStatus >= SCSISTAT_CHECK_CONDITION) {
+			if (!GetDVDSlot(pExtArg, pDevice, &cdb, &map, &queue)) {
 				throw FALSE;
 			}
-			fwrite(lpBuf, sizeof(BYTE), (size_t)DISC_RAW_READ_SIZE * dwTransferLen, fp);
-			OutputString(_T("\rCreating iso(LBA) %8lu/%8u"), nLBA + dwTransferLen, nAllLength);
+			IssueReadQueueSlot(&queue, pExtArg, pDevice
+				, &cdb, CDB12GENERIC_LENGTH, nLBA, DISC_RAW_READ_SIZE * dwTransferLen);
+		}
+		if (!FlushDVDSlot(pExtArg, pDevice, &cdb, &map, &queue)) {
+			throw FALSE;
 		}
 		if (*pExecType == xbox) {
+			// the middle zone and L1 video are out of the map
 			if (!SetLockState(pExtArg, pDevice, 0)) {
 				throw FALSE;
 			}
 			dwTransferLen = dwTransferLenOrg;
-			ZeroMemory(lpBuf, DISC_RAW_READ_SIZE * dwTransferLen);
 			DWORD dwEndOfMiddle = pDisc->SCSI.nAllLength + dwLayer1MiddleZone;
 
 			for (DWORD j = (DWORD)pDisc->SCSI.nAllLength; j < dwEndOfMiddle; j += dwTransferLen) {
 				if (dwTransferLen > dwEndOfMiddle - j) {
 					dwTransferLen = dwEndOfMiddle - j;
 				}
-				fwrite(lpBuf, sizeof(BYTE), (size_t)DISC_RAW_READ_SIZE * dwTransferLen, fp);
-				OutputString(_T("\rCreating iso(LBA) %8lu/%8u"), j + dwTransferLen, nAllLength);
+				LPBYTE lpSlot = GetDVDSlot(pExtArg, pDevice, &cdb, NULL, &queue);
+				if (!lpSlot) {
+					throw FALSE;
+				}
+				ZeroMemory(lpSlot, DISC_RAW_READ_SIZE * dwTransferLen);
+				IssueReadQueueSlot(&queue, pExtArg, pDevice
+					, NULL, 0, (INT)j, DISC_RAW_READ_SIZE * dwTransferLen);
 			}
 
 			dwTransferLen = dwTransferLenOrg;
@@ -147,21 +416,46 @@ BOOL ReadDVD(
 					REVERSE_BYTES(&cdb.TransferLength, &dwTransferLen);
 				}
 				REVERSE_BYTES(&cdb.LogicalBlock, &k);
-				if (!ScsiPassThroughDirect(pExtArg, pDevice, &cdb, CDB12GENERIC_LENGTH, lpBuf,
-					DISC_RAW_READ_SIZE * dwTransferLen, &byScsiStatus, _T(__FUNCTION__), __LINE__)
-					|| byScsiStatus >= SCSISTAT_CHECK_CONDITION) {
+				if (!GetDVDSlot(pExtArg, pDevice, &cdb, NULL, &queue)) {
 					throw FALSE;
 				}
-				fwrite(lpBuf, sizeof(BYTE), (size_t)DISC_RAW_READ_SIZE * dwTransferLen, fp);
-				OutputString(_T("\rCreating iso(LBA) %8lu/%8u")
-					, dwEndOfMiddle + pDisc->DVD.dwLayer1SectorLength, nAllLength);
+				IssueReadQueueSlot(&queue, pExtArg, pDevice
+					, &cdb, CDB12GENERIC_LENGTH, (INT)k, DISC_RAW_READ_SIZE * dwTransferLen);
+			}
+			if (!FlushDVDSlot(pExtArg, pDevice, &cdb, NULL, &queue)) {
+				throw FALSE;
+			}
+		}
+		EndProgress();
+		// ReadDVDForErrorMap saves the map by itself
+		bSaveMap = FALSE;
+		// the retry writes the sectors at random, so the stream is flushed before it
+		TerminateReadQueue(&queue);
+		if (!DetachOutputStream(fp, ".iso")) {
+			throw FALSE;
+		}
+		if (bResume || GetErrorMapSectorNum(&map, ERROR_MAP_BAD)) {
+			if (!ReadDVDForErrorMap(pExecType, pExtArg, pDevice, &cdb
+				, &map, szMapPath, fp, lpBuf, dwTransferLenOrg)) {
+				throw FALSE;
 			}
 		}
-		OutputString(_T("\n"));
 	}
 	catch (BOOL ret) {
 		bRet = ret;
 	}
+	EndProgress();
+	// the sectors read before an error are also written
+	TerminateReadQueue(&queue);
+	if (!DetachOutputStream(fp, ".iso")) {
+		bRet = FALSE;
+		bSaveMap = FALSE;
+	}
+	if (bSaveMap) {
+		// the sectors from the error are untried, so they can be read by /re
+		SaveErrorMap(&map, szMapPath);
+	}
+	TerminateErrorMap(&map);
 	FreeAndNull(pBuf);
 	FcloseAndNull(fp);
 	return bRet;
@@ -259,6 +553,157 @@ BOOL IsSupported0xE7(
 	return FALSE;
 }
 
+static DWORD WINAPI UnscrambleDvdRawThreadProc(
+	LPVOID lpParam
+) {
+	PUNSCRAMBLE_RANGE pRange = (PUNSCRAMBLE_RANGE)lpParam;
+	PDVD_UNSCRAMBLER pUnsc = NULL;
+	LPBYTE lpRaw = NULL;
+	LPBYTE lpIso = NULL;
+	FILE* fpRaw = NULL;
+	FILE* fpIso = NULL;
+	BYTE byValidFlag[DVD_ECC_BLOCK_FRAME_NUM] = {};
+	pRange->nFirstErrorLBA = -1;
+	try {
+		if (NULL == (pUnsc = (PDVD_UNSCRAMBLER)calloc(1, sizeof(DVD_UNSCRAMBLER))) ||
+			NULL == (lpRaw = (LPBYTE)calloc((size_t)DVD_RAW_READ * UNSCRAMBLE_CHUNK_FRAME_NUM, sizeof(BYTE))) ||
+			NULL == (lpIso = (LPBYTE)calloc((size_t)DISC_RAW_READ_SIZE * UNSCRAMBLE_CHUNK_FRAME_NUM, sizeof(BYTE)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw UNSCRAMBLE_MEMORY_ERROR;
+		}
+		InitDvdUnscrambler(pUnsc, pRange->bNintendo);
+		if (NULL == (fpRaw = _tfopen(pRange->pszRawPath, _T("rb")))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw UNSCRAMBLE_OPEN_RAW_ERROR;
+		}
+		if (NULL == (fpIso = _tfopen(pRange->pszIsoPath, _T("rb+")))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw UNSCRAMBLE_OPEN_ISO_ERROR;
+		}
+		_fseeki64(fpRaw, (INT64)DVD_RAW_READ * pRange->nFirstLBA, SEEK_SET);
+		_fseeki64(fpIso, (INT64)DISC_RAW_READ_SIZE * pRange->nFirstLBA, SEEK_SET);
+
+		INT nLBA = pRange->nFirstLBA;
+		while (nLBA < pRange->nLastLBA) {
+			INT nFrameNum = min(UNSCRAMBLE_CHUNK_FRAME_NUM, pRange->nLastLBA - nLBA);
+			if (fread(lpRaw, DVD_RAW_READ, (size_t)nFrameNum, fpRaw) < (size_t)nFrameNum) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				throw UNSCRAMBLE_OPEN_RAW_ERROR;
+			}
+			for (INT i = 0; i < nFrameNum; i += DVD_ECC_BLOCK_FRAME_NUM) {
+				INT nBlockFrameNum = min(DVD_ECC_BLOCK_FRAME_NUM, nFrameNum - i);
+				if (UnscrambleDvdBlock(pUnsc, lpRaw + DVD_RAW_READ * i
+					, nBlockFrameNum, lpIso + DISC_RAW_READ_SIZE * i, byValidFlag)) {
+					continue;
+				}
+				for (INT j = 0; j < nBlockFrameNum; j++) {
+					if (!byValidFlag[j]) {
+						if (pRange->nFirstErrorLBA == -1) {
+							pRange->nFirstErrorLBA = nLBA + i + j;
+						}
+						pRange->nErrorNum++;
+					}
+				}
+			}
+			if (fwrite(lpIso, DISC_RAW_READ_SIZE, (size_t)nFrameNum, fpIso) < (size_t)nFrameNum) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				throw UNSCRAMBLE_WRITE_ISO_ERROR;
+			}
+			nLBA += nFrameNum;
+		}
+	}
+	catch (INT nRet) {
+		pRange->nRet = nRet;
+	}
+	FcloseAndNull(fpIso);
+	FcloseAndNull(fpRaw);
+	FreeAndNull(lpIso);
+	FreeAndNull(lpRaw);
+	FreeAndNull(pUnsc);
+	return 0;
+}
+
+// The ECC blocks are split among the threads, each of which has its own file
+// pointers and seeds, and the .iso is sized in advance to be written in place.
+static INT UnscrambleDvdRaw(
+	LPCTSTR pszRawPath,
+	LPCTSTR pszIsoPath,
+	BOOL bNintendo
+) {
+	FILE* fp = _tfopen(pszRawPath, _T("rb"));
+	if (!fp) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return UNSCRAMBLE_OPEN_RAW_ERROR;
+	}
+	INT nAllLBA = (INT)(GetFileSize64(0, fp) / DVD_RAW_READ);
+	FcloseAndNull(fp);
+
+	if (NULL == (fp = _tfopen(pszIsoPath, _T("wb")))) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return UNSCRAMBLE_OPEN_ISO_ERROR;
+	}
+	if (_chsize_s(_fileno(fp), (INT64)DISC_RAW_READ_SIZE * nAllLBA)) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		FcloseAndNull(fp);
+		return UNSCRAMBLE_WRITE_ISO_ERROR;
+	}
+	FcloseAndNull(fp);
+
+	SYSTEM_INFO sysInfo = { 0 };
+	GetSystemInfo(&sysInfo);
+	INT nThreadNum = (INT)min(sysInfo.dwNumberOfProcessors, (DWORD)MAXIMUM_WAIT_OBJECTS);
+	nThreadNum = max(1, min(nThreadNum, nAllLBA / UNSCRAMBLE_THREAD_FRAME_MIN));
+	INT nBlockNum = (nAllLBA + DVD_ECC_BLOCK_FRAME_NUM - 1) / DVD_ECC_BLOCK_FRAME_NUM;
+
+	UNSCRAMBLE_RANGE range[MAXIMUM_WAIT_OBJECTS] = {};
+	HANDLE hThread[MAXIMUM_WAIT_OBJECTS] = {};
+	DWORD dwThreadNum = 0;
+	for (INT i = 0; i < nThreadNum; i++) {
+		range[i].pszRawPath = pszRawPath;
+		range[i].pszIsoPath = pszIsoPath;
+		range[i].bNintendo = bNintendo;
+		range[i].nFirstLBA = min(nBlockNum * i / nThreadNum * DVD_ECC_BLOCK_FRAME_NUM, nAllLBA);
+		range[i].nLastLBA = min(nBlockNum * (i + 1) / nThreadNum * DVD_ECC_BLOCK_FRAME_NUM, nAllLBA);
+		if (NULL == (range[i].hThread = CreateThread(NULL, 0, UnscrambleDvdRawThreadProc, &range[i], 0, NULL))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			UnscrambleDvdRawThreadProc(&range[i]);
+		}
+		else {
+			hThread[dwThreadNum++] = range[i].hThread;
+		}
+	}
+	if (dwThreadNum) {
+		WaitForMultipleObjects(dwThreadNum, hThread, TRUE, INFINITE);
+		for (DWORD i = 0; i < dwThreadNum; i++) {
+			CloseHandle(hThread[i]);
+		}
+	}
+
+	INT nRet = UNSCRAMBLE_OK;
+	INT nErrorNum = 0;
+	INT nFirstErrorLBA = -1;
+	for (INT i = 0; i < nThreadNum; i++) {
+		if (range[i].nRet && nRet == UNSCRAMBLE_OK) {
+			nRet = range[i].nRet;
+		}
+		if (range[i].nErrorNum) {
+			nErrorNum += range[i].nErrorNum;
+			if (nFirstErrorLBA == -1) {
+				nFirstErrorLBA = range[i].nFirstErrorLBA;
+			}
+		}
+	}
+	if (nRet == UNSCRAMBLE_OK && nErrorNum) {
+		OutputLogA(standardError | fileMainError
+			, "EDC error: %d frames, first LBA: %d\n", nErrorNum, nFirstErrorLBA);
+		nRet = nFirstErrorLBA / DVD_ECC_BLOCK_FRAME_NUM;
+		if (nRet <= UNSCRAMBLE_WRITE_ISO_ERROR) {
+			nRet = UNSCRAMBLE_NO_SEED_ERROR;
+		}
+	}
+	return nRet;
+}
+
 BOOL ReadDVDRaw(
 	PEXT_ARG pExtArg,
 	PDEVICE pDevice,
@@ -277,96 +722,44 @@ BOOL ReadDVDRaw(
 		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
 		return FALSE;
 	}
+	BOOL bNintendo = (pDisc->SCSI.nAllLength == GAMECUBE_SIZE ||
+		pDisc->SCSI.nAllLength == WII_SL_SIZE ||
+		pDisc->SCSI.nAllLength == WII_DL_SIZE)
+		&& IsSupported0xE7(pDevice);
 	LPBYTE pBuf = NULL;
+	LPBYTE lpValid = NULL;
+	LPBYTE lpValidFlag = NULL;
+	PDVD_UNSCRAMBLER pUnsc = NULL;
 	BOOL bRet = TRUE;
 	try {
-		DWORD dwTransferLen = 16;
-		INT nMemBlkSize = 1;
-		if (NULL == (pBuf = (LPBYTE)calloc(
-			(size_t)DVD_RAW_READ * dwTransferLen * 5 + pDevice->AlignmentMask, sizeof(BYTE)))) {
-			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-			throw FALSE;
-		}
-		LPBYTE lpBuf = (LPBYTE)ConvParagraphBoundary(pDevice, pBuf);
-		INT nCmdType = 0;
-		INT nBaseAddr = 0x80000000;
-		BYTE cdblen = CDB10GENERIC_LENGTH;
 		// for dumping from memory
-		BYTE lpCmd[CDB12GENERIC_LENGTH] = { 0 };
 		INT nDriveSampleOffset = 0;
-		if (!GetDriveOffsetAuto(pDevice->szProductId, &nDriveSampleOffset)) {
+		if (!GetDriveOffsetAuto(pDevice, &nDriveSampleOffset)) {
 			GetDriveOffsetManually(&nDriveSampleOffset);
 		}
-		// Panasonic MN103S chip
-		if (nDriveSampleOffset == 102) {
-			if (IsSupported0xE7(pDevice)) {
-				if (IsSupported0xE7Type1(pDevice)) {
-					// address which disc data is cached
-					// a08000 - a0ffff (8000), a13000 - a1ffff (d000), a23000 - a2ffff (d000)
-					// a48000 - a4ffff (8000), a53000 - a5ffff (d000), a63000 - a6ffff (d000)
-					// a88000 - a8ffff (8000), a93000 - a9ffff (d000), aa3000 - aaffff (d000)
-					// ac8000 - acffff (8000), ad3000 - adffff (d000), ae3000 - aeffff (d000)
-					// b08000 - b0ffff (8000), b13000 - b1ffff (d000), b23000 - b2ffff (d000)
-					//  :
-					nBaseAddr = 0xa13000;
-				}
-				else if (IsSupported0xE7Type2(pDevice)) {
-					dwTransferLen = 8;
-					nBaseAddr -= 0x4080;
-//					dwTransferLen = 1;
-//					nBaseAddr -= 0x810;
-					nCmdType = 1;
-				}
-				else if (IsSupported0xE7Type3(pDevice) || IsSupported0xE7Type4(pDevice)) {
-					nMemBlkSize = 5;
-				}
-				lpCmd[0] = 0xE7; // vendor specific command
-				lpCmd[1] = 0x48; // H
-				lpCmd[2] = 0x49; // I
-				lpCmd[3] = 0x54; // T
-				lpCmd[4] = 0x01; // read MCU memory sub-command
-				lpCmd[10] = HIBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
-				lpCmd[11] = LOBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
-				cdblen = CDB12GENERIC_LENGTH;
-			}
-			else {
-				lpCmd[0] = SCSIOP_READ_DATA_BUFF;
-				lpCmd[1] = 0x01;
-				lpCmd[6] = LOBYTE(HIWORD(DVD_RAW_READ * dwTransferLen));
-				lpCmd[7] = HIBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
-				lpCmd[8] = LOBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
-				nCmdType = 2;
-			}
+		RAW_CACHE_STRATEGY strategy;
+		InitRawCacheStrategy(pDevice, nDriveSampleOffset, &strategy);
+		OutputLogA(standardOut | fileDrive,
+			"RawCacheStrategy: %s, TransferLength: %lu (%lu - %lu), MemoryBlock: %d, BaseAddress: %#lx, RereadMax: %d\n"
+			, strategy.szName, strategy.dwTransferLen, strategy.dwTransferLenMin
+			, strategy.dwTransferLenDefault, strategy.nMemBlkSize, strategy.dwBaseAddr, strategy.nRereadMax);
+		DWORD dwTransferLen = strategy.dwTransferLen;
+		INT nMemBlkSize = strategy.nMemBlkSize;
+		if (NULL == (pBuf = (LPBYTE)calloc(
+			(size_t)DVD_RAW_READ * strategy.dwTransferLenDefault * 5 + pDevice->AlignmentMask, sizeof(BYTE)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
 		}
-		// Renesas chip
-		else if (nDriveSampleOffset == 667) {
-			dwTransferLen = 1;
-			lpCmd[0] = SCSIOP_READ_DATA_BUFF;
-			lpCmd[1] = 0x05;
-			lpCmd[6] = LOBYTE(HIWORD(DVD_RAW_READ * dwTransferLen));
-			lpCmd[7] = HIBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
-			lpCmd[8] = LOBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
-//			lpCmd[9] = 0x44;
-			nCmdType = 3;
-		}
-		// Mediatek MT chip
-		else if (nDriveSampleOffset == 6) {
-			dwTransferLen = 1;
-			lpCmd[0] = SCSIOP_READ_DATA_BUFF;
-			lpCmd[1] = 0x01;
-			lpCmd[2] = 0x01;
-			lpCmd[6] = LOBYTE(HIWORD(DVD_RAW_READ * dwTransferLen));
-			lpCmd[7] = HIBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
-			lpCmd[8] = LOBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
-		}
-		// Plextor etc.
-		else {
-			lpCmd[0] = SCSIOP_READ_DATA_BUFF;
-			lpCmd[1] = 0x02;
-			lpCmd[6] = LOBYTE(HIWORD(DVD_RAW_READ * dwTransferLen));
-			lpCmd[7] = HIBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
-			lpCmd[8] = LOBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
+		LPBYTE lpBuf = (LPBYTE)ConvParagraphBoundary(pDevice, pBuf);
+		// the frames whose EDC matches are kept over the rereads
+		if (NULL == (pUnsc = (PDVD_UNSCRAMBLER)calloc(1, sizeof(DVD_UNSCRAMBLER))) ||
+			NULL == (lpValid = (LPBYTE)calloc(
+			(size_t)DVD_RAW_READ * strategy.dwTransferLenDefault * 5, sizeof(BYTE))) ||
+			NULL == (lpValidFlag = (LPBYTE)calloc((size_t)strategy.dwTransferLenDefault * 5, sizeof(BYTE)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
 		}
+		InitDvdUnscrambler(pUnsc, bNintendo);
 
 		INT nLBA = 0;
 		DWORD dwSectorNum = 0x30000;
@@ -381,10 +774,7 @@ BOOL ReadDVDRaw(
 		cdb.LogicalUnitNumber = pDevice->address.Lun;
 		REVERSE_BYTES(&cdb.TransferLength, &dwTransferLen);
 
-		if ((pDisc->SCSI.nAllLength == GAMECUBE_SIZE ||
-			pDisc->SCSI.nAllLength == WII_SL_SIZE ||
-			pDisc->SCSI.nAllLength == WII_DL_SIZE)
-			&& (IsSupported0xE7(pDevice))) {
+		if (bNintendo) {
 				cdb.Streaming = TRUE;
 		}
 		else {
@@ -393,13 +783,6 @@ BOOL ReadDVDRaw(
 		FlushLog();
 
 		BYTE byScsiStatus = 0;
-		DWORD dwReadAddrForHG[5] = { 
-			nBaseAddr + 0 * dwTransferLen * DVD_RAW_READ,
-			nBaseAddr + 1 * dwTransferLen * DVD_RAW_READ,
-			nBaseAddr + 2 * dwTransferLen * DVD_RAW_READ,
-			nBaseAddr + 3 * dwTransferLen * DVD_RAW_READ,
-			nBaseAddr + 4 * dwTransferLen * DVD_RAW_READ
-		};
 		DWORD dwTransferAndMemSize = dwTransferLen * nMemBlkSize;
 		DWORD dwReadSize = (DWORD)DISC_RAW_READ_SIZE * dwTransferLen;
 		DWORD dwRawReadSize = (DWORD)DVD_RAW_READ * dwTransferLen;
@@ -433,8 +816,16 @@ BOOL ReadDVDRaw(
 			return FALSE;
 #endif
 		}
+		// /f seeks the sector to fix per reading
+		if (!pExtArg->byFix && !AttachOutputStream(fp, pExtArg->byDirectWrite, !pExtArg->byResume)) {
+			throw FALSE;
+		}
+		StartProgress(_T("Creating raw"), _T("LBA"), nLBA, pDisc->SCSI.nAllLength, DVD_RAW_READ, PROGRESS_SPEED_DVD);
 
-		BOOL bRetry = FALSE;
+		DWORD dwFirstTransferLen = 0;
+		INT nRereadPeak = 0;
+		DWORD dwValidSectorNum = 0;
+		BOOL bMaxReread = FALSE;
 		for (; nLBA < pDisc->SCSI.nAllLength; nLBA += dwTransferAndMemSize) {
 			if (pExtArg->byFix) {
 				_fseeki64(fp, DVD_RAW_READ * nLBA, SEEK_SET);
@@ -457,36 +848,13 @@ BOOL ReadDVDRaw(
 			BOOL bCheckSectorNum = TRUE;
 			DWORD dwGotSectorNum = 0;
 			for (INT i = 0; i < nMemBlkSize; i++) {
-				if (nCmdType == 0) {
-					lpCmd[6] = HIBYTE(HIWORD(dwReadAddrForHG[i]));
-					lpCmd[7] = LOBYTE(HIWORD(dwReadAddrForHG[i]));
-					lpCmd[8] = HIBYTE(LOWORD(dwReadAddrForHG[i]));
-					lpCmd[9] = LOBYTE(LOWORD(dwReadAddrForHG[i]));
-				}
-				else if (nCmdType == 1) {
-					if (nRereadNum == 0) {
-						nBaseAddr += 0x810 * dwTransferLen;
-						if (nBaseAddr == 0x80008100) {
-							nBaseAddr = 0x80000000;
-						}
-					}
-					lpCmd[6] = HIBYTE(HIWORD(nBaseAddr));
-					lpCmd[7] = LOBYTE(HIWORD(nBaseAddr));
-					lpCmd[8] = HIBYTE(LOWORD(nBaseAddr));
-					lpCmd[9] = LOBYTE(LOWORD(nBaseAddr));
-				}
-				else if (nCmdType == 2 || nCmdType == 3) {
-					INT n = nLBA % 688;
-					lpCmd[3] = LOBYTE(HIWORD(n * DVD_RAW_READ));
-					lpCmd[4] = HIBYTE(LOWORD(n * DVD_RAW_READ));
-					lpCmd[5] = LOBYTE(LOWORD(n * DVD_RAW_READ));
-				}
+				SetRawCacheAddress(&strategy, nLBA, i, nRereadNum);
 				DWORD dwOfs2 = dwRawReadSize * i;
 				// read the drive cache memory
-				if (!ScsiPassThroughDirect(pExtArg, pDevice, lpCmd, cdblen, lpBuf + dwOfs2,
-					dwRawReadSize, &byScsiStatus, _T(__FUNCTION__), __LINE__)
+				if (!ScsiPassThroughDirect(pExtArg, pDevice, strategy.lpCmd, strategy.byCdbLength,
+					lpBuf + dwOfs2, dwRawReadSize, &byScsiStatus, _T(__FUNCTION__), __LINE__)
 					|| byScsiStatus >= SCSISTAT_CHECK_CONDITION) {
-					Sleep(10000);
+					Sleep(strategy.dwErrorWait);
 					throw FALSE;
 				}
 #if 1
@@ -508,93 +876,79 @@ BOOL ReadDVDRaw(
 					break;
 				}
 			}
+			BOOL bCheckEdc = TRUE;
+			LPBYTE lpWrite = lpBuf;
 			if (bCheckSectorNum) {
+				if (dwValidSectorNum != dwSectorNum) {
+					ZeroMemory(lpValidFlag, strategy.dwTransferLenDefault * 5);
+					dwValidSectorNum = dwSectorNum;
+				}
+				for (DWORD j = 0; j < dwTransferAndMemSize; j++) {
+					LPBYTE lpFrame = lpBuf + DVD_RAW_READ * j;
+					if (!lpValidFlag[j]) {
+						if (UnscrambleDvdFrame(pUnsc, lpFrame, NULL)) {
+							memcpy(lpValid + DVD_RAW_READ * j, lpFrame, DVD_RAW_READ);
+							lpValidFlag[j] = TRUE;
+						}
+						else {
+							bCheckEdc = FALSE;
+						}
+					}
+				}
+				if (!bCheckEdc && nRereadNum + 1 >= strategy.nRereadMax) {
+					// give up and write the frames of the last read
+					for (DWORD j = 0; j < dwTransferAndMemSize; j++) {
+						if (!lpValidFlag[j]) {
+							LPBYTE lpFrame = lpBuf + DVD_RAW_READ * j;
+							OutputLogA(standardError | fileMainError
+								, " EDC error. LBA: %7d, ID: %s\n", nLBA + (INT)j
+								, IsValidDvdId(lpFrame) ? "OK" : "NG");
+							memcpy(lpValid + DVD_RAW_READ * j, lpFrame, DVD_RAW_READ);
+						}
+					}
+					bCheckEdc = TRUE;
+				}
+				lpWrite = lpValid;
+			}
+			if (bCheckSectorNum && bCheckEdc) {
 				nRereadNum = 0;
-				fwrite(lpBuf, sizeof(BYTE), dwRawWriteSize, fp);
+				if (!WriteOutputFile(fp, lpWrite, dwRawWriteSize)) {
+					throw FALSE;
+				}
 				dwSectorNum += dwTransferAndMemSize;
+				if (dwFirstTransferLen == 0) {
+					dwFirstTransferLen = dwTransferLen;
+				}
 			}
 			else {
-				if (++nRereadNum == 40) {
+				nRereadNum++;
+				nRereadPeak = max(nRereadPeak, nRereadNum);
+				if (nRereadNum == strategy.nRereadMax) {
 					OutputString("Max Reread %d. LBA: %7d\n", nRereadNum, nLBA);
-					if (!bRetry && IsSupported0xE7Type2(pDevice)) {
-						dwTransferLen = 1;
+					if (SetRawCacheTransferLen(&strategy, strategy.dwTransferLenMin)) {
+						dwTransferLen = strategy.dwTransferLen;
 						dwTransferAndMemSize = dwTransferLen * nMemBlkSize;
 						dwReadSize = (DWORD)DISC_RAW_READ_SIZE * dwTransferLen;
 						dwRawReadSize = (DWORD)DVD_RAW_READ * dwTransferLen;
 						dwRawWriteSize = (DWORD)DVD_RAW_READ * dwTransferLen * nMemBlkSize;
-						nBaseAddr = 0x7FFFF7F0;
 						nLBA = (INT)dwSectorNum - 0x30000 - 2;
 						nRereadNum = 0;
-						lpCmd[10] = HIBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
-						lpCmd[11] = LOBYTE(LOWORD(DVD_RAW_READ * dwTransferLen));
 						REVERSE_BYTES(&cdb.TransferLength, &dwTransferLen);
-						bRetry = TRUE;
 						continue;
 					}
 					else {
+						bMaxReread = TRUE;
 						bRet = FALSE;
 						break;
 					}
 				}
 				OutputString("Reread %d. LBA: %7d\n", nRereadNum, nLBA);
 			}
-			if (nRereadNum || IsSupported0xE7Type1(pDevice) ||
-				IsSupported0xE7Type2(pDevice) || IsSupported0xE7Type3(pDevice)
-				) {
-				INT tmp = nLBA - (INT)dwTransferAndMemSize;
-				if (tmp < 0) {
-					if (IsSupported0xE7Type1(pDevice)) {
-						tmp = 16;
-					}
-					else if (IsSupported0xE7Type2(pDevice) || IsSupported0xE7Type3(pDevice)) {
-						tmp = 0;
-					}
-				}
+			if (nRereadNum || strategy.byFlushAlways) {
+				INT tmp = GetRawCacheFlushLBA(&strategy, nLBA, (INT)dwTransferAndMemSize);
 				if (nRereadNum) {
-					if (nCmdType == 0) {
-						nLBA = tmp;
-					}
-#if 1
-					else if (!bRetry && nCmdType == 1) {
-						if (nRereadNum == 1) {
-							nLBA = tmp;
-						}
-						else if (nRereadNum == 2) {
-							nLBA -= 16;
-						}
-						else if (nRereadNum == 4) {
-							nLBA -= 24;
-						}
-						else if (nRereadNum == 7) {
-							nLBA -= 32;
-						}
-						else if (nRereadNum == 11) {
-							nLBA -= 40;
-						}
-						else if (nRereadNum == 16) {
-							nLBA -= 48;
-						}
-						else if (nRereadNum == 22) {
-							nLBA -= 56;
-						}
-						else if (nRereadNum == 29) {
-							nLBA -= 64;
-						}
-					}
-					if (bRetry && nCmdType == 1) {
-						if ((INT)(dwGotSectorNum - dwSectorNum) > 0) {
-							nLBA -= 2;
-						}
-						else {
-							nLBA = tmp + 1;
-						}
-					}
-#endif
-					else if (nCmdType == 2) {
-						if ((INT)(dwGotSectorNum - dwSectorNum) > 0) {
-							nLBA -= 32;
-						}
-					}
+					nLBA = GetRawCacheRereadLBA(&strategy, nLBA, (INT)dwTransferAndMemSize,
+						nRereadNum, bCheckSectorNum ? 0 : (INT)(dwGotSectorNum - dwSectorNum));
 				}
 				REVERSE_BYTES(&cdb.LogicalBlock, &tmp);
 				// delete cache memory
@@ -604,39 +958,54 @@ BOOL ReadDVDRaw(
 					throw FALSE;
 				}
 			}
-			OutputString(_T("\rCreating raw(LBA) %7u/%7u")
-				, nLBA + (INT)dwTransferAndMemSize, pDisc->SCSI.nAllLength);
+			SetProgress(nLBA + (INT)dwTransferAndMemSize);
 			if (pExtArg->byFix) {
 				if (nLBA == (INT)pDisc->DVD.dwFixNum * 16 + 16) {
 					break;
 				}
 			}
 		}
-		OutputString(_T("\n"));
+		EndProgress();
+		if (!DetachOutputStream(fp, ".raw")) {
+			throw FALSE;
+		}
+		if (TuneRawCacheStrategy(pDevice, &strategy, dwFirstTransferLen, nRereadPeak, bMaxReread)) {
+			SaveDriveProfile(pDevice);
+			OutputLogA(standardOut | fileDrive,
+				"RawCacheStrategy is tuned: TransferLength: %lu, RereadMax: %d\n"
+				, pDevice->PROFILE.dwRawTransferLen, pDevice->PROFILE.nRawRereadMax);
+		}
 	}
 	catch (BOOL bErr) {
 		bRet = bErr;
 	}
+	EndProgress();
 	FreeAndNull(pBuf);
+	FreeAndNull(lpValid);
+	FreeAndNull(lpValidFlag);
+	FreeAndNull(pUnsc);
+	DetachOutputStream(fp, ".raw");
 	FcloseAndNull(fp);
 
-	if ((pDisc->SCSI.nAllLength == GAMECUBE_SIZE ||
-		pDisc->SCSI.nAllLength == WII_SL_SIZE ||
-		pDisc->SCSI.nAllLength == WII_DL_SIZE)
-		&& bRet && IsSupported0xE7(pDevice)) {
-		TCHAR str[_MAX_PATH * 3] = { 0 };
-		if (GetUnscCmd(str, pszFullPath)) {
-			bRet = _tsystem(str);
-			// unscrambler error code
-			// 0 == no error
-			// 1 == failed open .raw
-			// 2 == failed open .iso
-			// 3 == no enough cache space for this seed
-			// 4 == no seed found for recording frame xx
-			// 6 == can't write to .iso
-			// frame num == error unscrambling recording frame xx
-			OutputString("ret = %d\n", bRet);
-		}
+	if (bRet) {
+		_TCHAR szDrive[_MAX_DRIVE] = { 0 };
+		_TCHAR szDir[_MAX_DIR] = { 0 };
+		_TCHAR szFname[_MAX_FNAME] = { 0 };
+		_TCHAR szPathForRaw[_MAX_PATH] = { 0 };
+		_TCHAR szPathForIso[_MAX_PATH] = { 0 };
+		_tsplitpath(pszFullPath, szDrive, szDir, szFname, NULL);
+		_tmakepath(szPathForRaw, szDrive, szDir, szFname, _T("raw"));
+		_tmakepath(szPathForIso, szDrive, szDir, szFname, _T("iso"));
+		// same as the error code of unscrambler
+		// 0 == no error
+		// 1 == failed open .raw
+		// 2 == failed open .iso
+		// 3 == no enough memory
+		// 4 == error in the ECC block 0-6
+		// 6 == can't write to .iso
+		// ECC block num == error in the ECC block
+		bRet = UnscrambleDvdRaw(szPathForRaw, szPathForIso, bNintendo);
+		OutputString("ret = %d\n", bRet);
 	}
 	return bRet;
 }
@@ -31,6 +31,22 @@ BOOL ReadDVDForCMI(
 	PDISC pDisc
 );
 
+BOOL IsSupported0xE7Type1(
+	PDEVICE pDevice
+);
+
+BOOL IsSupported0xE7Type2(
+	PDEVICE pDevice
+);
+
+BOOL IsSupported0xE7Type3(
+	PDEVICE pDevice
+);
+
+BOOL IsSupported0xE7(
+	PDEVICE pDevice
+);
+
 BOOL ReadDVDRaw(
 	PEXT_ARG pExtArg,
 	PDEVICE pDevice,
@@ -107,25 +107,18 @@ VOID ManageEndOfDirectoryRecord(
 	}
 }
 
-BOOL ReadDirectoryRecordDetail(
+// lpBuf has byTransferLen sectors of the directory which starts at nLBA
+VOID ParseDirectoryRecord(
 	PEXEC_TYPE pExecType,
 	PEXT_ARG pExtArg,
-	PDEVICE pDevice,
 	PDISC pDisc,
-	LPBYTE pCdb,
 	INT nLBA,
 	LPBYTE lpBuf,
-	LPBYTE bufDec,
 	BYTE byTransferLen,
 	INT nDirPosNum,
 	DWORD dwLogicalBlkCoef,
-	INT nOffset,
 	PDIRECTORY_RECORD pDirRec
 ) {
-	if (!ExecReadDisc(pExecType, pExtArg, pDevice, pDisc
-		, pCdb, nLBA + nOffset, lpBuf, bufDec, byTransferLen)) {
-		return FALSE;
-	}
 	for (BYTE i = 0; i < byTransferLen; i++) {
 		OutputCDMain(fileMainInfo, lpBuf + DISC_RAW_READ_SIZE * i, nLBA + i, DISC_RAW_READ_SIZE);
 	}
@@ -231,9 +224,87 @@ BOOL ReadDirectoryRecordDetail(
 			}
 		}
 	}
+}
+
+BOOL ReadDirectoryRecordDetail(
+	PEXEC_TYPE pExecType,
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	PDISC pDisc,
+	LPBYTE pCdb,
+	INT nLBA,
+	LPBYTE lpBuf,
+	LPBYTE bufDec,
+	BYTE byTransferLen,
+	INT nDirPosNum,
+	DWORD dwLogicalBlkCoef,
+	INT nOffset,
+	PDIRECTORY_RECORD pDirRec
+) {
+	if (!ExecReadDisc(pExecType, pExtArg, pDevice, pDisc
+		, pCdb, nLBA + nOffset, lpBuf, bufDec, byTransferLen)) {
+		return FALSE;
+	}
+	ParseDirectoryRecord(pExecType, pExtArg, pDisc, nLBA
+		, lpBuf, byTransferLen, nDirPosNum, dwLogicalBlkCoef, pDirRec);
 	return TRUE;
 }
 
+BOOL ReadDirectoryRecordOverTransferLength(
+	PEXEC_TYPE pExecType,
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	PDISC pDisc,
+	LPBYTE pCdb,
+	LPBYTE lpBuf,
+	LPBYTE bufDec,
+	DWORD dwLogicalBlkCoef,
+	INT nSectorOfs,
+	PDIRECTORY_RECORD pDirRec,
+	INT nDirPosNum,
+	INT nDirRecIdx
+) {
+	// [FMT] Psychic Detective Series Vol. 4 - Orgel (Japan) (v1.0)
+	// [FMT] Psychic Detective Series Vol. 5 - Nightmare (Japan)
+	// [IBM - PC compatible] Maria 2 - Jutai Kokuchi no Nazo (Japan) (Disc 1)
+	// [IBM - PC compatible] PC Game Best Series Vol. 42 - J.B. Harold Series - Kiss of Murder - Satsui no Kuchizuke (Japan)
+	// [SS] Madou Monogatari (Japan)
+	// and more
+	INT nLBA = (INT)pDirRec[nDirRecIdx].uiPosOfDir;
+	BYTE byTransferLen = 1;
+	DWORD dwAdditionalTransferLen = pDirRec[nDirRecIdx].uiDirSize / pDevice->dwMaxTransferLength;
+	SetCommandForTransferLength(pExecType, pDevice, pCdb, pDevice->dwMaxTransferLength, &byTransferLen);
+	OutputMainInfoLogA("nLBA %d, uiDirSize: %lu, byTransferLen: %d [L:%d]\n"
+		, nLBA, pDevice->dwMaxTransferLength, byTransferLen, (INT)__LINE__);
+
+	for (DWORD n = 0; n < dwAdditionalTransferLen; n++) {
+		if (!ReadDirectoryRecordDetail(pExecType, pExtArg, pDevice, pDisc, pCdb, nLBA
+			, lpBuf, bufDec, byTransferLen, nDirPosNum, dwLogicalBlkCoef, nSectorOfs, pDirRec)) {
+			continue;
+		}
+		nLBA += byTransferLen;
+	}
+	DWORD dwLastTblSize = pDirRec[nDirRecIdx].uiDirSize % pDevice->dwMaxTransferLength;
+	SetCommandForTransferLength(pExecType, pDevice, pCdb, dwLastTblSize, &byTransferLen);
+	OutputMainInfoLogA("nLBA %d, uiDirSize: %lu, byTransferLen: %d [L:%d]\n"
+		, nLBA, dwLastTblSize, byTransferLen, (INT)__LINE__);
+
+	return ReadDirectoryRecordDetail(pExecType, pExtArg, pDevice, pDisc, pCdb, nLBA
+		, lpBuf, bufDec, byTransferLen, nDirPosNum, dwLogicalBlkCoef, nSectorOfs, pDirRec);
+}
+
+int CompareDirectoryExtent(
+	const void* a,
+	const void* b
+) {
+	PDIRECTORY_EXTENT pA = (PDIRECTORY_EXTENT)a;
+	PDIRECTORY_EXTENT pB = (PDIRECTORY_EXTENT)b;
+	if (pA->nLBA != pB->nLBA) {
+		return pA->nLBA < pB->nLBA ? -1 : 1;
+	}
+	return pA->nIdx - pB->nIdx;
+}
+
 BOOL ReadDirectoryRecord(
 	PEXEC_TYPE pExecType,
 	PEXT_ARG pExtArg,
@@ -267,55 +338,100 @@ BOOL ReadDirectoryRecord(
 	}
 	pDirRec[0].uiDirSize = dwRootDataLen;
 
-	for (INT nDirRecIdx = 0; nDirRecIdx < nDirPosNum; nDirRecIdx++) {
-		INT nLBA = (INT)pDirRec[nDirRecIdx].uiPosOfDir;
-		if (pDirRec[nDirRecIdx].uiDirSize > pDevice->dwMaxTransferLength) {
-			// [FMT] Psychic Detective Series Vol. 4 - Orgel (Japan) (v1.0)
-			// [FMT] Psychic Detective Series Vol. 5 - Nightmare (Japan)
-			// [IBM - PC compatible] Maria 2 - Jutai Kokuchi no Nazo (Japan) (Disc 1)
-			// [IBM - PC compatible] PC Game Best Series Vol. 42 - J.B. Harold Series - Kiss of Murder - Satsui no Kuchizuke (Japan)
-			// [SS] Madou Monogatari (Japan)
-			// and more
-			DWORD dwAdditionalTransferLen = pDirRec[nDirRecIdx].uiDirSize / pDevice->dwMaxTransferLength;
-			SetCommandForTransferLength(pExecType, pDevice, pCdb, pDevice->dwMaxTransferLength, &byTransferLen);
-			OutputMainInfoLogA("nLBA %d, uiDirSize: %lu, byTransferLen: %d [L:%d]\n"
-				, nLBA, pDevice->dwMaxTransferLength, byTransferLen, (INT)__LINE__);
-
-			for (DWORD n = 0; n < dwAdditionalTransferLen; n++) {
-				if (!ReadDirectoryRecordDetail(pExecType, pExtArg, pDevice, pDisc, pCdb, nLBA
-					, lpBuf, bufDec, byTransferLen, nDirPosNum, dwLogicalBlkCoef, nSectorOfs, pDirRec)) {
-					continue;
-				}
-				nLBA += byTransferLen;
+	// The path table is sorted by the level of the directory, and the size of
+	// the directory is known after the upper directory is parsed. So the
+	// directories whose upper directory is already parsed are read together
+	// in LBA order, and the near extents are read at once.
+	PDIRECTORY_EXTENT pExtent = (PDIRECTORY_EXTENT)calloc((size_t)nDirPosNum, sizeof(DIRECTORY_EXTENT));
+	if (!pExtent) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		FreeAndNull(bufDec);
+		return FALSE;
+	}
+	INT nMaxSectorNum = (INT)(pDevice->dwMaxTransferLength / DISC_RAW_READ_SIZE);
+	if (*pExecType == gd) {
+		nMaxSectorNum = (INT)(pDevice->dwMaxTransferLength / CD_RAW_SECTOR_SIZE);
+	}
+	if (nMaxSectorNum > 0xff) {
+		nMaxSectorNum = 0xff;
+	}
+	BOOL bRet = TRUE;
+	INT nDoneNum = 0;
+	for (INT nFirstIdx = 0; nFirstIdx < nDirPosNum && bRet;) {
+		INT nLastIdx = nFirstIdx + 1;
+		while (nLastIdx < nDirPosNum && (INT)pDirRec[nLastIdx].uiNumOfUpperDir - 1 < nFirstIdx) {
+			nLastIdx++;
+		}
+		INT nExtentNum = 0;
+		for (INT i = nFirstIdx; i < nLastIdx; i++) {
+			if (pDirRec[i].uiDirSize == 0) {
+				OutputMainErrorLogA("Directory Record is invalid\n");
+				bRet = FALSE;
+				break;
 			}
-			DWORD dwLastTblSize = pDirRec[nDirRecIdx].uiDirSize % pDevice->dwMaxTransferLength;
-			SetCommandForTransferLength(pExecType, pDevice, pCdb, dwLastTblSize, &byTransferLen);
-			OutputMainInfoLogA("nLBA %d, uiDirSize: %lu, byTransferLen: %d [L:%d]\n"
-				, nLBA, dwLastTblSize, byTransferLen, (INT)__LINE__);
-
-			if (!ReadDirectoryRecordDetail(pExecType, pExtArg, pDevice, pDisc, pCdb, nLBA
-				, lpBuf, bufDec, byTransferLen, nDirPosNum, dwLogicalBlkCoef, nSectorOfs, pDirRec)) {
+			if (pDirRec[i].uiDirSize > pDevice->dwMaxTransferLength) {
+				ReadDirectoryRecordOverTransferLength(pExecType, pExtArg, pDevice, pDisc, pCdb
+					, lpBuf, bufDec, dwLogicalBlkCoef, nSectorOfs, pDirRec, nDirPosNum, i);
+				OutputString(_T("\rReading DirectoryRecord %4d/%4d"), ++nDoneNum, nDirPosNum);
 				continue;
 			}
+			pExtent[nExtentNum].nIdx = i;
+			pExtent[nExtentNum].nLBA = (INT)pDirRec[i].uiPosOfDir;
+			pExtent[nExtentNum].nSectorNum =
+				(INT)((pDirRec[i].uiDirSize + DISC_RAW_READ_SIZE - 1) / DISC_RAW_READ_SIZE);
+			nExtentNum++;
 		}
-		else {
-			if (pDirRec[nDirRecIdx].uiDirSize == 0 || &byTransferLen == 0) {
-				OutputMainErrorLogA("Directory Record is invalid\n");
-				return FALSE;
-			}
-			SetCommandForTransferLength(pExecType, pDevice, pCdb, pDirRec[nDirRecIdx].uiDirSize, &byTransferLen);
-			OutputMainInfoLogA("nLBA %d, uiDirSize: %u, byTransferLen: %d [L:%d]\n"
-				, nLBA, pDirRec[nDirRecIdx].uiDirSize, byTransferLen, (INT)__LINE__);
+		if (!bRet) {
+			break;
+		}
+		qsort(pExtent, (size_t)nExtentNum, sizeof(DIRECTORY_EXTENT), CompareDirectoryExtent);
 
-			if (!ReadDirectoryRecordDetail(pExecType, pExtArg, pDevice, pDisc, pCdb, nLBA
-				, lpBuf, bufDec, byTransferLen, nDirPosNum, dwLogicalBlkCoef, nSectorOfs, pDirRec)) {
-				continue;
+		for (INT j = 0; j < nExtentNum;) {
+			// merge the adjacent, overlapping or near extents up to the max transfer length
+			INT nRunLBA = pExtent[j].nLBA;
+			INT nRunEnd = nRunLBA + pExtent[j].nSectorNum;
+			INT k = j + 1;
+			for (; k < nExtentNum && pExtent[k].nLBA <= nRunEnd + DIRECTORY_EXTENT_MERGE_GAP; k++) {
+				INT nEnd = max(nRunEnd, pExtent[k].nLBA + pExtent[k].nSectorNum);
+				if (nEnd - nRunLBA > nMaxSectorNum) {
+					break;
+				}
+				nRunEnd = nEnd;
+			}
+			BOOL bRead = FALSE;
+			if (k - j > 1) {
+				SetCommandForTransferLength(pExecType, pDevice, pCdb
+					, (DWORD)(nRunEnd - nRunLBA) * DISC_RAW_READ_SIZE, &byTransferLen);
+				OutputMainInfoLogA("nLBA %d, dirNum: %d, byTransferLen: %d [L:%d]\n"
+					, nRunLBA, k - j, byTransferLen, (INT)__LINE__);
+				bRead = ExecReadDisc(pExecType, pExtArg, pDevice, pDisc, pCdb
+					, nRunLBA + nSectorOfs, lpBuf, bufDec, byTransferLen);
+			}
+			for (INT m = j; m < k; m++) {
+				INT nIdx = pExtent[m].nIdx;
+				if (bRead) {
+					ParseDirectoryRecord(pExecType, pExtArg, pDisc, pExtent[m].nLBA
+						, lpBuf + (pExtent[m].nLBA - nRunLBA) * DISC_RAW_READ_SIZE
+						, (BYTE)pExtent[m].nSectorNum, nDirPosNum, dwLogicalBlkCoef, pDirRec);
+				}
+				else {
+					// single extent, or the merged range includes an unreadable sector
+					SetCommandForTransferLength(pExecType, pDevice, pCdb, pDirRec[nIdx].uiDirSize, &byTransferLen);
+					OutputMainInfoLogA("nLBA %d, uiDirSize: %u, byTransferLen: %d [L:%d]\n"
+						, pExtent[m].nLBA, pDirRec[nIdx].uiDirSize, byTransferLen, (INT)__LINE__);
+					ReadDirectoryRecordDetail(pExecType, pExtArg, pDevice, pDisc, pCdb, pExtent[m].nLBA
+						, lpBuf, bufDec, byTransferLen, nDirPosNum, dwLogicalBlkCoef, nSectorOfs, pDirRec);
+				}
+				OutputString(_T("\rReading DirectoryRecord %4d/%4d"), ++nDoneNum, nDirPosNum);
 			}
+			j = k;
 		}
-		OutputString(_T("\rReading DirectoryRecord %4d/%4d"), nDirRecIdx + 1, nDirPosNum);
+		nFirstIdx = nLastIdx;
 	}
 	OutputString(_T("\n"));
-	return TRUE;
+	FreeAndNull(pExtent);
+	FreeAndNull(bufDec);
+	return bRet;
 }
 
 BOOL ReadPathTableRecord(
@@ -421,7 +421,7 @@ WORD RecalcSubQCrc(
 	PDISC pDisc,
 	PDISC_PER_SECTOR pDiscPerSector
 ) {
-	WORD crc16 = (WORD)GetCrc16CCITT(10, &pDiscPerSector->subcode.current[12]);
+	WORD crc16 = GetCrc16SubQ(&pDiscPerSector->subcode.current[12]);
 	pDisc->SUB.nCorruptCrcH = pDiscPerSector->subcode.current[22] == HIBYTE(crc16) ? FALSE : TRUE;
 	pDisc->SUB.nCorruptCrcL = pDiscPerSector->subcode.current[23] == LOBYTE(crc16) ? FALSE : TRUE;
 	return crc16;
@@ -961,7 +961,7 @@ VOID FixSubQ(
 	}
 
 	// pDiscPerSector->subcode.current has already fixed ramdom errors (= original crc)
-	WORD crc16 = (WORD)GetCrc16CCITT(10, &pDiscPerSector->subcode.current[12]);
+	WORD crc16 = GetCrc16SubQ(&pDiscPerSector->subcode.current[12]);
 	if (pDiscPerSector->bLibCrypt || pDiscPerSector->bSecuRom) {
 		BOOL bExist = FALSE;
 		WORD xorCrc16 = (WORD)(crc16 ^ 0x8001);
@@ -973,7 +973,7 @@ VOID FixSubQ(
 		}
 		else {
 			// pDiscPerSector->subcode.current isn't fixed (= recalc crc)
-			WORD reCalcCrc16 = (WORD)GetCrc16CCITT(10, &SubQcodeOrg[0]);
+			WORD reCalcCrc16 = GetCrc16SubQ(&SubQcodeOrg[0]);
 			WORD reCalcXorCrc16 = (WORD)(reCalcCrc16 ^ 0x0080);
 			if (SubQcodeOrg[10] == HIBYTE(reCalcXorCrc16) &&
 				SubQcodeOrg[11] == LOBYTE(reCalcXorCrc16) &&
@@ -1208,6 +1208,175 @@ VOID FixSubRtoW(
 	return;
 }
 
+// Majority of each bit of nNum sub-Q (12 bytes each). If the bit is tie, both
+// are tried (up to 8 bits).
+// return: TRUE if the crc16 of the result is valid. lpSubQ isn't changed if FALSE
+BOOL VoteSubQ(
+	LPBYTE lpSubQ,
+	LPBYTE lpCandidate,
+	INT nNum
+) {
+	if (nNum < SUB_Q_VOTE_MIN) {
+		return FALSE;
+	}
+	BYTE subQ[12] = { 0 };
+	INT nTiePos[CHAR_BIT] = { 0 };
+	INT nTieNum = 0;
+	for (INT i = 0; i < (INT)sizeof(subQ) * CHAR_BIT; i++) {
+		INT nByte = i / CHAR_BIT;
+		BYTE byBit = (BYTE)(0x80 >> (i % CHAR_BIT));
+		INT nOn = 0;
+		for (INT j = 0; j < nNum; j++) {
+			if (lpCandidate[sizeof(subQ) * j + nByte] & byBit) {
+				nOn++;
+			}
+		}
+		if (nOn * 2 > nNum) {
+			subQ[nByte] |= byBit;
+		}
+		else if (nOn * 2 == nNum) {
+			if (nTieNum == CHAR_BIT) {
+				return FALSE;
+			}
+			nTiePos[nTieNum++] = i;
+		}
+	}
+	// all candidates of the tie bits are checked by the crc16 64 at a time
+	BYTE tmp[1 << CHAR_BIT][12] = { 0 };
+	INT nCandidateNum = 1 << nTieNum;
+	for (INT k = 0; k < nCandidateNum; k++) {
+		memcpy(tmp[k], subQ, sizeof(tmp[0]));
+		for (INT t = 0; t < nTieNum; t++) {
+			if (k & (1 << t)) {
+				tmp[k][nTiePos[t] / CHAR_BIT] |= (BYTE)(0x80 >> (nTiePos[t] % CHAR_BIT));
+			}
+		}
+	}
+	for (INT k = 0; k < nCandidateNum; k += 64) {
+		UINT64 ullValid = GetValidSubQMask(tmp[k], sizeof(tmp[0]), min(64, nCandidateNum - k));
+		if (ullValid) {
+			memcpy(lpSubQ, tmp[k + GetFirstBitFromLsb64(ullValid)], sizeof(tmp[0]));
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+// /sv: keeps the sub-Q of each reread of the same LBA, and votes them after
+// dwSubQVoteNum reads. If a reread is valid, it's used as it is (logged "OK").
+// If the vote fails, FixSubQ synthesizes it as before (logged "NG").
+// return: FALSE if it needs to reread
+BOOL VoteSubQOfRereads(
+	PEXT_ARG pExtArg,
+	PDISC pDisc,
+	PDISC_PER_SECTOR pDiscPerSector,
+	INT nLBA,
+	LPBOOL bReread
+) {
+	PSUB_Q_VOTE pVote = &pDiscPerSector->subQVote;
+	if (!*bReread || pVote->nLBA != nLBA) {
+		pVote->nLBA = nLBA;
+		pVote->nNum = 0;
+	}
+	memcpy(pVote->lpSubQ[pVote->nNum++], &pDiscPerSector->subcode.current[12], sizeof(pVote->lpSubQ[0]));
+	if (!*bReread) {
+		OutputSubErrorWithLBALogA("Q Reread [crc16 unmatch] -> ", nLBA, pDiscPerSector->byTrackNum);
+		*bReread = TRUE;
+	}
+	if ((DWORD)pVote->nNum < pExtArg->dwSubQVoteNum) {
+		return FALSE;
+	}
+	if (VoteSubQ(&pDiscPerSector->subcode.current[12], pVote->lpSubQ[0], pVote->nNum)) {
+		OutputSubErrorLogA("Voted %d reads -> ", pVote->nNum);
+		SetTmpSubQDataFromBuffer(&pDiscPerSector->subQ.current, pDiscPerSector->subcode.current);
+		pDisc->SUB.nCorruptCrcH = FALSE;
+		pDisc->SUB.nCorruptCrcL = FALSE;
+	}
+	else {
+		OutputSubErrorLogA("No valid crc16 in %d reads -> ", pVote->nNum);
+	}
+	pVote->nNum = 0;
+	return TRUE;
+}
+
+// Adds 1 to the bcd byte lpSubQ[nPos]
+VOID IncrementSubQBcd(
+	LPBYTE lpSubQ,
+	INT nPos
+) {
+	BYTE byBcd = lpSubQ[nPos];
+	UpdateCrc16SubQ(lpSubQ, nPos, (BYTE)((byBcd & 0x0f) == 9 ? byBcd + 7 : byBcd + 1));
+}
+
+// Advances the MSF from lpSubQ[nPos] by 1 frame. FALSE if the minute overflows
+BOOL IncrementSubQMSF(
+	LPBYTE lpSubQ,
+	INT nPos
+) {
+	if (lpSubQ[nPos + 2] != 0x74) {
+		IncrementSubQBcd(lpSubQ, nPos + 2);
+		return TRUE;
+	}
+	UpdateCrc16SubQ(lpSubQ, nPos + 2, 0);
+	if (lpSubQ[nPos + 1] != 0x59) {
+		IncrementSubQBcd(lpSubQ, nPos + 1);
+		return TRUE;
+	}
+	UpdateCrc16SubQ(lpSubQ, nPos + 1, 0);
+	if (lpSubQ[nPos] == 0x99) {
+		return FALSE;
+	}
+	IncrementSubQBcd(lpSubQ, nPos);
+	return TRUE;
+}
+
+// The TOC predicts the sub-Q of adr 1 & index 1 in the track, so if the sub-Q is
+// exactly same as the expected one, the heuristic checks of FixSubQ are not needed.
+// The index 0 (pregap), index 2 or later, mcn, isrc, the alternating copy bit etc.
+// aren't predicted, these go to the slow path.
+// The expected sub-Q is built once per track, and the next LBA only advances
+// the RMSF, AMSF and the crc16 of it.
+BOOL IsPredictedSubQ(
+	PDISC pDisc,
+	PDISC_PER_SECTOR pDiscPerSector,
+	INT nLBA
+) {
+	BYTE byTrackNum = pDiscPerSector->byTrackNum;
+	if (byTrackNum < pDisc->SCSI.toc.FirstTrack || pDisc->SCSI.toc.LastTrack < byTrackNum) {
+		return FALSE;
+	}
+	INT tIdx = byTrackNum - 1;
+	INT nFirstLBA = pDisc->SCSI.lpFirstLBAListOnToc[tIdx];
+	if (nLBA < nFirstLBA || pDisc->SCSI.lpLastLBAListOnToc[tIdx] < nLBA) {
+		return FALSE;
+	}
+	LPBYTE expected = pDisc->SUB.aPredictedSubQ;
+	if (pDisc->SUB.byPredictedTrackNum != byTrackNum || pDisc->SUB.nPredictedLBA != nLBA) {
+		if (pDisc->SUB.byPredictedTrackNum != byTrackNum || pDisc->SUB.nPredictedLBA + 1 != nLBA ||
+			!IncrementSubQMSF(expected, 3) || !IncrementSubQMSF(expected, 7)) {
+			ZeroMemory(expected, sizeof(pDisc->SUB.aPredictedSubQ));
+			expected[0] = (BYTE)(pDisc->SCSI.toc.TrackData[tIdx].Control << 4 | ADR_ENCODES_CURRENT_POSITION);
+			expected[1] = DecToBcd(byTrackNum);
+			expected[2] = 0x01;
+			BYTE m, s, f;
+			LBAtoMSF(nLBA - nFirstLBA, &m, &s, &f);
+			expected[3] = DecToBcd(m);
+			expected[4] = DecToBcd(s);
+			expected[5] = DecToBcd(f);
+			LBAtoMSF(nLBA + 150, &m, &s, &f);
+			expected[7] = DecToBcd(m);
+			expected[8] = DecToBcd(s);
+			expected[9] = DecToBcd(f);
+			WORD crc16 = GetCrc16SubQ(expected);
+			expected[10] = HIBYTE(crc16);
+			expected[11] = LOBYTE(crc16);
+		}
+		pDisc->SUB.byPredictedTrackNum = byTrackNum;
+		pDisc->SUB.nPredictedLBA = nLBA;
+	}
+	return !memcmp(&pDiscPerSector->subcode.current[12], expected, 12);
+}
+
 VOID FixSubChannel(
 	PEXEC_TYPE pExecType,
 	PEXT_ARG pExtArg,
@@ -1236,18 +1405,35 @@ VOID FixSubChannel(
 		}
 	}
 	if (!pExtArg->bySkipSubQ) {
-		RecalcSubQCrc(pDisc, pDiscPerSector);
-		// Red Alert (Japan) -> 208050 - 208052 is same subQ, so crc16 doesn't check this
-		// LBA[208049, 0x32cb1], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:34], AMSF[46:15:74], RtoW[0, 0, 0, 0]
-		// LBA[208050, 0x32cb2], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:35], AMSF[46:16:00], RtoW[0, 0, 0, 0]
-		// LBA[208051, 0x32cb3], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:35], AMSF[46:16:00], RtoW[0, 0, 0, 0]
-		// LBA[208052, 0x32cb4], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:35], AMSF[46:16:00], RtoW[0, 0, 0, 0]
-		// LBA[208053, 0x32cb5], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:36], AMSF[46:16:03], RtoW[0, 0, 0, 0]
-		// LBA[208054, 0x32cb6], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:37], AMSF[46:16:04], RtoW[0, 0, 0, 0]
-		BOOL bAMSF = IsValidSubQAMSF(pExecType, pExtArg->byPre, pDiscPerSector, nLBA);
-		BOOL bAFrame = IsValidSubQAFrame(pDiscPerSector->subcode.current, nLBA);
+		BOOL bAMSF = TRUE;
+		BOOL bAFrame = TRUE;
+		// /p checks the continuity of AMSF even if it's same as the LBA, so it doesn't use the model
+		if (!pExtArg->byPre && IsPredictedSubQ(pDisc, pDiscPerSector, nLBA)) {
+			pDisc->SUB.nCorruptCrcH = FALSE;
+			pDisc->SUB.nCorruptCrcL = FALSE;
+		}
+		else {
+			RecalcSubQCrc(pDisc, pDiscPerSector);
+			// Red Alert (Japan) -> 208050 - 208052 is same subQ, so crc16 doesn't check this
+			// LBA[208049, 0x32cb1], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:34], AMSF[46:15:74], RtoW[0, 0, 0, 0]
+			// LBA[208050, 0x32cb2], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:35], AMSF[46:16:00], RtoW[0, 0, 0, 0]
+			// LBA[208051, 0x32cb3], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:35], AMSF[46:16:00], RtoW[0, 0, 0, 0]
+			// LBA[208052, 0x32cb4], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:35], AMSF[46:16:00], RtoW[0, 0, 0, 0]
+			// LBA[208053, 0x32cb5], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:36], AMSF[46:16:03], RtoW[0, 0, 0, 0]
+			// LBA[208054, 0x32cb6], Audio, 2ch, Copy NG, Pre-emphasis No, Track[56], Idx[01], RMSF[03:15:37], AMSF[46:16:04], RtoW[0, 0, 0, 0]
+			bAMSF = IsValidSubQAMSF(pExecType, pExtArg->byPre, pDiscPerSector, nLBA);
+			bAFrame = IsValidSubQAFrame(pDiscPerSector->subcode.current, nLBA);
+		}
 
 		if (-76 < nLBA) {
+			if ((pDisc->SUB.nCorruptCrcH || pDisc->SUB.nCorruptCrcL || (!bAMSF && !bAFrame)) &&
+				pExtArg->dwSubQVoteNum && nLBA < MAX_LBA_OF_CD) {
+				if (!VoteSubQOfRereads(pExtArg, pDisc, pDiscPerSector, nLBA, bReread)) {
+					return;
+				}
+				bAMSF = IsValidSubQAMSF(pExecType, pExtArg->byPre, pDiscPerSector, nLBA);
+				bAFrame = IsValidSubQAFrame(pDiscPerSector->subcode.current, nLBA);
+			}
 			if (!pDisc->SUB.nCorruptCrcH && !pDisc->SUB.nCorruptCrcL && (bAMSF || bAFrame)) {
 				if (*pExecType == swap) {
 					if (pDiscPerSector->byTrackNum + 1 == pDiscPerSector->subQ.current.byTrackNum) {
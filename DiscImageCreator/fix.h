@@ -23,6 +23,12 @@ VOID FixMainHeader(
 	INT nMainDataType
 );
 
+BOOL VoteSubQ(
+	LPBYTE lpSubQ,
+	LPBYTE lpCandidate,
+	INT nNum
+);
+
 VOID FixSubChannel(
 	PEXEC_TYPE pExecType,
 	PEXT_ARG pExtArg,
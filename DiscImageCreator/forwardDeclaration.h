@@ -46,6 +46,8 @@
 #define ADR_ENCODES_CDTV_SPECIFIC	(0x06)
 
 #define DIRECTORY_RECORD_SIZE	(65535)
+// sectors between the directory extents which are read at once
+#define DIRECTORY_EXTENT_MERGE_GAP	(16)
 #define THREEDO_DIR_HEADER_SIZE	(20)
 #define THREEDO_DIR_ENTRY_SIZE	(72)
 
@@ -54,6 +56,8 @@
 #define META_CDTEXT_SIZE		(80 + 1)
 
 #define EXELBA_STORE_SIZE (4096) // TODO
+// sectors between the exe headers which are read at once
+#define EXE_PROBE_MERGE_GAP (16)
 #define EXENAME_STORE_SIZE (64) // TODO
 // ̐
 // 	1	2	3
@@ -134,6 +138,10 @@
 #define SCSIOP_PIONEER_READ_CDP				(0xE4)
 #endif
 
+#define SUB_Q_VOTE_MIN						(2)
+#define SUB_Q_VOTE_MAX						(16)
+#define READ_QUEUE_DEPTH_MAX				(16)
+
 #define RETURNED_EXIST_C2_ERROR				(FALSE)
 #define RETURNED_NO_C2_ERROR_1ST			(TRUE)
 #define RETURNED_NO_C2_ERROR_BUT_BYTE_ERROR	(2)
@@ -157,4 +165,28 @@ struct _MAIN_HEADER;
 typedef struct _MAIN_HEADER *PMAIN_HEADER;
 struct _SUB_Q;
 typedef struct _SUB_Q *PSUB_Q;
+struct _PROGRESS;
+typedef struct _PROGRESS PROGRESS;
+struct _C2_ERROR_INFO;
+typedef struct _C2_ERROR_INFO *PC2_ERROR_INFO;
+struct _PATTERN_SCANNER;
+typedef struct _PATTERN_SCANNER *PPATTERN_SCANNER;
+struct _PATTERN_MATCH;
+typedef struct _PATTERN_MATCH *PPATTERN_MATCH;
+struct _DRIVE_OFFSET_INDEX;
+typedef struct _DRIVE_OFFSET_INDEX *PDRIVE_OFFSET_INDEX;
+struct _SYNC_CANDIDATE;
+typedef struct _SYNC_CANDIDATE *PSYNC_CANDIDATE;
+struct _READ_QUEUE;
+typedef struct _READ_QUEUE *PREAD_QUEUE;
+struct _ERROR_MAP;
+typedef struct _ERROR_MAP *PERROR_MAP;
+struct _RAW_CACHE_STRATEGY;
+typedef struct _RAW_CACHE_STRATEGY *PRAW_CACHE_STRATEGY;
+struct _DVD_UNSCRAMBLER;
+typedef struct _DVD_UNSCRAMBLER *PDVD_UNSCRAMBLER;
+struct _OUTPUT_STREAM;
+typedef struct _OUTPUT_STREAM *POUTPUT_STREAM;
+struct _SCSI_PASS_THROUGH_DIRECT_WITH_BUFFER;
+typedef struct _SCSI_PASS_THROUGH_DIRECT_WITH_BUFFER *PSCSI_PASS_THROUGH_DIRECT_WITH_BUFFER;
 
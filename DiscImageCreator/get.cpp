@@ -16,8 +16,10 @@
 #include "struct.h"
 #include "check.h"
 #include "convert.h"
+#include "driveOffsetIndex.h"
 #include "get.h"
 #include "output.h"
+#include "syncSearch.h"
 
 BOOL GetAlignedCallocatedBuffer(
 	PDEVICE pDevice,
@@ -43,8 +45,9 @@ BOOL GetHandle(
 ) {
 	_sntprintf(szBuf, bufSize, _T("\\\\.\\%c:"), pDevice->byDriveLetter);
 	szBuf[7] = 0;
+	// the write is shared for the overlapped handle of GetOverlappedHandle
 	pDevice->hDevice = CreateFile(szBuf, GENERIC_READ | GENERIC_WRITE,
-		FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+		FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
 	if (pDevice->hDevice == INVALID_HANDLE_VALUE) {
 		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
 		return FALSE;
@@ -52,6 +55,25 @@ BOOL GetHandle(
 	return TRUE;
 }
 
+// The second handle of the drive for the queued reads. The commands on it
+// don't wait for the completion, so several of them are in flight at once.
+BOOL GetOverlappedHandle(
+	PDEVICE pDevice,
+	LPHANDLE lpHandle
+) {
+	_TCHAR szBuf[8] = { 0 };
+	_sntprintf(szBuf, sizeof(szBuf) / sizeof(szBuf[0]), _T("\\\\.\\%c:"), pDevice->byDriveLetter);
+	szBuf[7] = 0;
+	*lpHandle = CreateFile(szBuf, GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+	if (*lpHandle == INVALID_HANDLE_VALUE) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		*lpHandle = NULL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
 VOID GetDriveOffsetManually(
 	LPINT lpDriveOffset
 ) {
@@ -65,69 +87,16 @@ VOID GetDriveOffsetManually(
 }
 
 BOOL GetDriveOffsetAuto(
-	LPCSTR szProductId,
+	PDEVICE pDevice,
 	LPINT lpDriveOffset
 ) {
-	BOOL bGetOffset = FALSE;
-	FILE* fpDrive = OpenProgrammabledFile(_T("driveOffset.txt"), _T("r"));
-	if (!fpDrive) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+	DRIVE_OFFSET_INDEX index = { 0 };
+	if (!LoadDriveOffsetIndex(&index)) {
 		return FALSE;
 	}
-
-	CHAR szProduct[DRIVE_PRODUCT_ID_SIZE + 1] = { 0 };
-	for (INT src = 0, dst = 0; dst < sizeof(szProduct) - 1; dst++) {
-		if (szProductId[dst] == ' ' && (szProductId[dst + 1] == ' ' ||
-			szProductId[dst + 1] == '\0')) {
-			continue;
-		}
-		szProduct[src++] = szProductId[dst];
-	}
-
-	LPCH pTrimId[5] = { 0 };
-	LPCH pId = NULL;
-	pTrimId[0] = strtok(szProduct, " ");
-	// get model string (ex. PX-755A)
-	for (INT nRoop = 1; nRoop < 5; nRoop++) {
-		pTrimId[nRoop] = strtok(NULL, " ");
-		if (pTrimId[nRoop] != NULL) {
-			pId = pTrimId[nRoop];
-		}
-		else {
-			if (pTrimId[1] == NULL) {
-				pId = pTrimId[0];
-			}
-			break;
-		}
-	}
-	if (pId) {
-		LPCH pTrimBuf[10] = { 0 };
-		CHAR lpBuf[1024] = { 0 };
-
-		while ((fgets(lpBuf, sizeof(lpBuf), fpDrive))) {
-			pTrimBuf[0] = strtok(lpBuf, " 	"); // space & tab
-			for (INT nRoop = 1; nRoop < 10; nRoop++) {
-				pTrimBuf[nRoop] = strtok(NULL, " 	"); // space & tab
-			}
-			if (pTrimBuf[0] == NULL || pTrimBuf[1] == NULL || pTrimBuf[2] == NULL) {
-				continue;
-			}
-			else if (*pTrimBuf[0] == '\n' || (*pTrimBuf[1] != '-' && *pTrimBuf[2] != '-')) {
-				continue;
-			}
-			for (INT nRoop = 0; nRoop < 10 && pTrimBuf[nRoop] != NULL; nRoop++) {
-				if (strstr(pTrimBuf[nRoop], pId) != NULL) {
-					*lpDriveOffset = atoi(pTrimBuf[nRoop + 1]);
-					bGetOffset = TRUE;
-					break;
-				}
-			}
-			if (bGetOffset) {
-				break;
-			}
-		}
-	}
-	fclose(fpDrive);
+	BOOL bGetOffset = LookUpDriveOffset(&index
+		, pDevice->szVendorId, pDevice->szProductId, lpDriveOffset);
+	TerminateDriveOffsetIndex(&index);
 	return bGetOffset;
 }
 
@@ -196,25 +165,26 @@ BYTE GetMode(
 
 BOOL GetWriteOffset(
 	PDISC pDisc,
-	LPBYTE lpBuf
+	LPBYTE lpBuf,
+	INT nBufLen,
+	LPINT lpVotes
 ) {
-	BOOL bRet = FALSE;
-	for (INT i = 0; i < CD_RAW_SECTOR_SIZE * 2; i++) {
-		if (IsValidMainDataHeader(lpBuf + i)) {
-			BYTE sm = BcdToDec((BYTE)(lpBuf[i + 12] ^ 0x01));
-			BYTE ss = BcdToDec((BYTE)(lpBuf[i + 13] ^ 0x80));
-			BYTE sf = BcdToDec((BYTE)(lpBuf[i + 14]));
-			if ((sm & 0x01) == 1 && (ss & 0x50) == 80) {
-				break;
-			}
-			INT tmpLBA = MSFtoLBA(sm, ss, sf) - 150;
-			pDisc->MAIN.nCombinedOffset = 
-				CD_RAW_SECTOR_SIZE * -(tmpLBA - pDisc->SCSI.nFirstLBAofDataTrack) + i;
-			bRet = TRUE;
-			break;
+	SYNC_CANDIDATE aCandidate[SYNC_CANDIDATE_MAX] = { 0 };
+	INT nCandidateNum = GetSyncCandidates(lpBuf, nBufLen
+		, pDisc->SCSI.nFirstLBAofDataTrack, aCandidate, SYNC_CANDIDATE_MAX);
+	*lpVotes = 0;
+	if (nCandidateNum == 0) {
+		return FALSE;
+	}
+	if (nCandidateNum > 1) {
+		for (INT i = 0; i < nCandidateNum; i++) {
+			OutputDiscLogA("\tCandidate of Combined Offset: %6d (%d sync)\n"
+				, aCandidate[i].nCombinedOffset, aCandidate[i].nVotes);
 		}
 	}
-	return bRet;
+	pDisc->MAIN.nCombinedOffset = aCandidate[0].nCombinedOffset;
+	*lpVotes = aCandidate[0].nVotes;
+	return TRUE;
 }
 
 BOOL GetCmd(
@@ -261,31 +231,6 @@ BOOL GetEccEdcCmd(
 	return bRet;
 }
 
-BOOL GetUnscCmd(
-	LPTSTR pszStr,
-	LPCTSTR pszPath
-) {
-	_TCHAR szDrive[_MAX_DRIVE] = { 0 };
-	_TCHAR szDir[_MAX_DIR] = { 0 };
-	_TCHAR szFname[_MAX_FNAME] = { 0 };
-	_TCHAR szPathForIso[_MAX_PATH] = { 0 };
-	_tsplitpath(pszPath, szDrive, szDir, szFname, NULL);
-	_tmakepath(szPathForIso, szDrive, szDir, szFname, _T("iso"));
-
-	_TCHAR szPathForUnsc[_MAX_PATH] = { 0 };
-	BOOL bRet = GetCmd(szPathForUnsc, _T("unscrambler"), _T("exe"));
-	if (bRet && PathFileExists(szPathForUnsc)) {
-		size_t size = _tcslen(szPathForUnsc) + _tcslen(pszPath) + _tcslen(szPathForIso) + 9;
-		_sntprintf(pszStr, size,
-			_T("\"\"%s\" \"%s\" \"%s\"\""), szPathForUnsc, pszPath, szPathForIso);
-	}
-	else {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T(" => %s\n"), szPathForUnsc);
-	}
-	return bRet;
-}
-
 WORD  GetSizeOrWordForVolDesc(
 	LPBYTE lpBuf
 ) {
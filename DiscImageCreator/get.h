@@ -30,12 +30,17 @@ BOOL GetHandle(
 	size_t bufSize
 );
 
+BOOL GetOverlappedHandle(
+	PDEVICE pDevice,
+	LPHANDLE lpHandle
+);
+
 VOID GetDriveOffsetManually(
 	LPINT lpDriveOffset
 );
 
 BOOL GetDriveOffsetAuto(
-	LPCSTR szProductId,
+	PDEVICE pDevice,
 	LPINT lpDriveOffset
 );
 
@@ -56,7 +61,9 @@ BYTE GetMode(
 
 BOOL GetWriteOffset(
 	PDISC pDisc,
-	LPBYTE lpBuf
+	LPBYTE lpBuf,
+	INT nBufLen,
+	LPINT lpVotes
 );
 
 BOOL GetEccEdcCmd(
@@ -68,11 +75,6 @@ BOOL GetEccEdcCmd(
 	INT nEndLBA
 );
 
-BOOL GetUnscCmd(
-	LPTSTR pszStr,
-	LPCTSTR pszPath
-);
-
 WORD GetSizeOrWordForVolDesc(
 	LPBYTE lpBuf
 );
@@ -17,6 +17,7 @@
 #include "convert.h"
 #include "init.h"
 #include "output.h"
+#include "outputMds.h"
 
 // These global variable is set at DiscImageCreator.cpp
 extern BYTE g_aSyncHeader[SYNC_SIZE];
@@ -36,6 +37,19 @@ BOOL InitC2(
 	return TRUE;
 }
 
+BOOL InitDpm(
+	PDISC* pDisc
+) {
+	(*pDisc)->DPM.dwResolution = DPM_RESOLUTION;
+	(*pDisc)->DPM.dwAllocEntryNum = (DWORD)(*pDisc)->SCSI.nAllLength / DPM_RESOLUTION + 1;
+	if (NULL == ((*pDisc)->DPM.lpReadTime =
+		(LPDWORD)calloc((*pDisc)->DPM.dwAllocEntryNum, sizeof(DWORD)))) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 BOOL InitLBAPerTrack(
 	PEXEC_TYPE pExecType,
 	PDISC* pDisc
@@ -305,6 +319,17 @@ BOOL InitLogFile(
 	strncpy(szSubInfoLogtxt, "_subInfo", size);
 	strncpy(szSubErrorLogtxt, "_subError", size);
 	strncpy(szC2ErrorLogtxt, "_c2Error", size);
+	if (*pExecType == offline) {
+		// don't overwrite the logs of the dump
+		strncpy(szDiscLogtxt, "_offline_disc", size);
+		strncpy(szDriveLogtxt, "_offline_drive", size);
+		strncpy(szVolDescLogtxt, "_offline_volDesc", size);
+		strncpy(szMainInfoLogtxt, "_offline_mainInfo", size);
+		strncpy(szMainErrorLogtxt, "_offline_mainError", size);
+		strncpy(szSubInfoLogtxt, "_offline_subInfo", size);
+		strncpy(szSubErrorLogtxt, "_offline_subError", size);
+		strncpy(szC2ErrorLogtxt, "_offline_c2Error", size);
+	}
 		
 	if (NULL == (g_LogFile.fpDisc = CreateOrOpenFileA(
 		path, szDiscLogtxt, NULL, NULL, NULL, ".txt", "w", 0, 0))) {
@@ -365,6 +390,10 @@ BOOL InitLogFile(
 	catch (BOOL bErr) {
 		bRet = bErr;
 	}
+	if (bRet) {
+		// if it fails, Output*Log macros write to the logfile directly
+		InitLogWriter();
+	}
 	return bRet;
 }
 #endif
@@ -376,6 +405,14 @@ VOID TerminateC2(
 	FreeAndNull((*pDisc)->MAIN.lpAllLBAOfC2Error);
 }
 
+VOID TerminateDpm(
+	PDISC* pDisc
+) {
+	FreeAndNull((*pDisc)->DPM.lpReadTime);
+	(*pDisc)->DPM.dwEntryNum = 0;
+	(*pDisc)->DPM.dwAllocEntryNum = 0;
+}
+
 VOID TerminateLBAPerTrack(
 	PDISC* pDisc
 ) {
@@ -452,6 +489,7 @@ VOID TerminateLogFile(
 	PEXEC_TYPE pExecType,
 	PEXT_ARG pExtArg
 ) {
+	TerminateLogWriter();
 	FcloseAndNull(g_LogFile.fpDisc);
 	if (*pExecType != fd) {
 		FcloseAndNull(g_LogFile.fpDrive);
@@ -20,6 +20,10 @@ BOOL InitC2(
 	PDISC* pDisc
 );
 
+BOOL InitDpm(
+	PDISC* pDisc
+);
+
 BOOL InitLBAPerTrack(
 	PEXEC_TYPE pExecType,
 	PDISC* pDisc
@@ -63,6 +67,10 @@ VOID TerminateC2(
 	PDISC* pDisc
 );
 
+VOID TerminateDpm(
+	PDISC* pDisc
+);
+
 VOID TerminateLBAPerTrack(
 	PDISC* pDisc
 );
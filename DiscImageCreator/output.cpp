@@ -16,19 +16,20 @@
 #include "struct.h"
 #include "check.h"
 #include "convert.h"
+#include "eccRtoW.h"
 #include "get.h"
 #include "output.h"
+#include "outputProgress.h"
 #include "outputScsiCmdLog.h"
 #include "outputScsiCmdLogforCD.h"
+#include "outputStream.h"
 #include "set.h"
+#include "_external/prngcd.h"
 
 #ifdef _DEBUG
 WCHAR logBufferW[DISC_RAW_READ_SIZE];
 CHAR logBufferA[DISC_RAW_READ_SIZE];
 #endif
-// These global variable is set at prngcd.cpp
-extern unsigned char scrambled_table[2352];
-
 FILE* CreateOrOpenFile(
 	LPCTSTR pszPath,
 	LPCTSTR pszPlusFname,
@@ -658,13 +659,13 @@ VOID WriteMainChannel(
 	INT sLBA = pDisc->MAIN.nFixStartLBA;
 	INT eLBA = pDisc->MAIN.nFixEndLBA;
 	if (pExtArg->byReverse) {
-		fwrite(lpBuf, sizeof(BYTE), CD_RAW_SECTOR_SIZE, fpImg);
+		WriteOutputFile(fpImg, lpBuf, CD_RAW_SECTOR_SIZE);
 	}
 	else if (sLBA <= nLBA && nLBA < eLBA) {
 		// first sector
 		if (nLBA == sLBA) {
-			fwrite(lpBuf + pDisc->MAIN.uiMainDataSlideSize, sizeof(BYTE),
-				CD_RAW_SECTOR_SIZE - pDisc->MAIN.uiMainDataSlideSize, fpImg);
+			WriteOutputFile(fpImg, lpBuf + pDisc->MAIN.uiMainDataSlideSize,
+				CD_RAW_SECTOR_SIZE - pDisc->MAIN.uiMainDataSlideSize);
 			if (*pExecType != gd) {
 				if (pDisc->SUB.lpFirstLBAListOnSub) {
 					pDisc->SUB.lpFirstLBAListOnSub[0][0] = -150;
@@ -680,25 +681,25 @@ VOID WriteMainChannel(
 		// last sector in 1st session (when session 2 exists)
 		else if (!pExtArg->byMultiSession && pDisc->SCSI.nFirstLBAof2ndSession != -1 &&
 			nLBA == pDisc->MAIN.nFixFirstLBAofLeadout - 1) {
-			fwrite(lpBuf, sizeof(BYTE), pDisc->MAIN.uiMainDataSlideSize, fpImg);
+			WriteOutputFile(fpImg, lpBuf, pDisc->MAIN.uiMainDataSlideSize);
 		}
 		// first sector in 2nd Session
 		else if (!pExtArg->byMultiSession && pDisc->SCSI.nFirstLBAof2ndSession != -1 &&
 			nLBA == pDisc->MAIN.nFixFirstLBAof2ndSession) {
-			fwrite(lpBuf + pDisc->MAIN.uiMainDataSlideSize, sizeof(BYTE),
-				CD_RAW_SECTOR_SIZE - pDisc->MAIN.uiMainDataSlideSize, fpImg);
+			WriteOutputFile(fpImg, lpBuf + pDisc->MAIN.uiMainDataSlideSize,
+				CD_RAW_SECTOR_SIZE - pDisc->MAIN.uiMainDataSlideSize);
 		}
 		// last sector
 		else if (nLBA == eLBA - 1) {
 			if (pDisc->MAIN.uiMainDataSlideSize != 0) {
-				fwrite(lpBuf, sizeof(BYTE), pDisc->MAIN.uiMainDataSlideSize, fpImg);
+				WriteOutputFile(fpImg, lpBuf, pDisc->MAIN.uiMainDataSlideSize);
 			}
 			else {
-				fwrite(lpBuf, sizeof(BYTE), CD_RAW_SECTOR_SIZE, fpImg);
+				WriteOutputFile(fpImg, lpBuf, CD_RAW_SECTOR_SIZE);
 			}
 		}
 		else {
-			fwrite(lpBuf, sizeof(BYTE), CD_RAW_SECTOR_SIZE, fpImg);
+			WriteOutputFile(fpImg, lpBuf, CD_RAW_SECTOR_SIZE);
 		}
 	}
 }
@@ -716,31 +717,31 @@ VOID WriteC2(
 	if (sLBA <= nLBA && nLBA < eLBA) {
 		// first sector
 		if (nLBA == sLBA) {
-			fwrite(lpBuf + nC2SlideSize, sizeof(BYTE),
-				CD_RAW_READ_C2_294_SIZE - nC2SlideSize, fpC2);
+			WriteOutputFile(fpC2, lpBuf + nC2SlideSize,
+				CD_RAW_READ_C2_294_SIZE - nC2SlideSize);
 		}
 		// last sector in 1st session (when exists session 2)
 		else if (!pExtArg->byMultiSession && pDisc->SCSI.nFirstLBAof2ndSession != -1 &&
 			nLBA == pDisc->MAIN.nFixFirstLBAofLeadout - 1) {
-			fwrite(lpBuf, sizeof(BYTE), nC2SlideSize, fpC2);
+			WriteOutputFile(fpC2, lpBuf, nC2SlideSize);
 		}
 		// first sector in 2nd Session
 		else if (!pExtArg->byMultiSession && pDisc->SCSI.nFirstLBAof2ndSession != -1 &&
 			nLBA == pDisc->MAIN.nFixFirstLBAof2ndSession) {
-			fwrite(lpBuf + nC2SlideSize, sizeof(BYTE),
-				CD_RAW_READ_C2_294_SIZE - nC2SlideSize, fpC2);
+			WriteOutputFile(fpC2, lpBuf + nC2SlideSize,
+				CD_RAW_READ_C2_294_SIZE - nC2SlideSize);
 		}
 		// last sector
 		else if (nLBA == eLBA - 1) {
 			if (pDisc->MAIN.uiMainDataSlideSize != 0) {
-				fwrite(lpBuf, sizeof(BYTE), nC2SlideSize, fpC2);
+				WriteOutputFile(fpC2, lpBuf, nC2SlideSize);
 			}
 			else {
-				fwrite(lpBuf, sizeof(BYTE), CD_RAW_READ_C2_294_SIZE, fpC2);
+				WriteOutputFile(fpC2, lpBuf, CD_RAW_READ_C2_294_SIZE);
 			}
 		}
 		else {
-			fwrite(lpBuf, sizeof(BYTE), CD_RAW_READ_C2_294_SIZE, fpC2);
+			WriteOutputFile(fpC2, lpBuf, CD_RAW_READ_C2_294_SIZE);
 		}
 	}
 }
@@ -754,7 +755,7 @@ VOID WriteSubChannel(
 	FILE* fpParse
 ) {
 	if (fpSub && fpParse) {
-		fwrite(pDiscPerSector->subcode.current, sizeof(BYTE), CD_RAW_READ_SUBCODE_SIZE, fpSub);
+		WriteOutputFile(fpSub, pDiscPerSector->subcode.current, CD_RAW_READ_SUBCODE_SIZE);
 		OutputCDSubToLog(pDisc, pDiscPerSector, lpSubcodeRaw, nLBA, fpParse);
 	}
 }
@@ -765,7 +766,7 @@ VOID WriteErrorBuffer(
 	PDEVICE pDevice,
 	PDISC pDisc,
 	PDISC_PER_SECTOR pDiscPerSector,
-	LPBYTE lpScrambledBuf,
+	CONST BYTE* lpScrambledBuf,
 	INT nLBA,
 	FILE* fpImg,
 	FILE* fpSub,
@@ -779,18 +780,18 @@ VOID WriteErrorBuffer(
 #if 0
 		uiSize = CD_RAW_SECTOR_SIZE;
 		if ((pDiscPerSector->subQ.prev.byCtl & AUDIO_DATA_TRACK) == AUDIO_DATA_TRACK) {
-			fwrite(pDiscPerSector->mainHeader.current, sizeof(BYTE), MAINHEADER_MODE1_SIZE, fpImg);
+			WriteOutputFile(fpImg, pDiscPerSector->mainHeader.current, MAINHEADER_MODE1_SIZE);
 		}
 		for (UINT i = MAINHEADER_MODE1_SIZE; i < CD_RAW_SECTOR_SIZE; i++) {
 			pDiscPerSector->data.current[i] = 0x55;
 		}
 		if ((pDiscPerSector->subQ.prev.byCtl & AUDIO_DATA_TRACK) == AUDIO_DATA_TRACK) {
-			fwrite(pDiscPerSector->data.current + MAINHEADER_MODE1_SIZE,
-				sizeof(BYTE), CD_RAW_SECTOR_SIZE - MAINHEADER_MODE1_SIZE, fpImg);
+			WriteOutputFile(fpImg, pDiscPerSector->data.current + MAINHEADER_MODE1_SIZE,
+				CD_RAW_SECTOR_SIZE - MAINHEADER_MODE1_SIZE);
 		}
 		else {
 #endif
-			fwrite(zeroByte, sizeof(BYTE), CD_RAW_SECTOR_SIZE, fpImg);
+			WriteOutputFile(fpImg, zeroByte, CD_RAW_SECTOR_SIZE);
 #if 0
 		}
 #endif
@@ -815,12 +816,12 @@ VOID WriteErrorBuffer(
 			uiSize = CD_RAW_SECTOR_SIZE - pDisc->MAIN.uiMainDataSlideSize;
 #if 0
 			if ((pDiscPerSector->subQ.prev.byCtl & AUDIO_DATA_TRACK) == AUDIO_DATA_TRACK) {
-				fwrite(pDiscPerSector->data.current + pDisc->MAIN.uiMainDataSlideSize,
-					sizeof(BYTE), uiSize, fpImg);
+				WriteOutputFile(fpImg, pDiscPerSector->data.current + pDisc->MAIN.uiMainDataSlideSize,
+					uiSize);
 			}
 			else {
 #endif
-				fwrite(zeroByte, sizeof(BYTE), uiSize, fpImg);
+				WriteOutputFile(fpImg, zeroByte, uiSize);
 #if 0
 		}
 #endif
@@ -829,11 +830,11 @@ VOID WriteErrorBuffer(
 			uiSize = pDisc->MAIN.uiMainDataSlideSize;
 #if 0
 			if ((pDiscPerSector->subQ.prev.byCtl & AUDIO_DATA_TRACK) == AUDIO_DATA_TRACK) {
-				fwrite(pDiscPerSector->data.current, sizeof(BYTE), uiSize, fpImg);
+				WriteOutputFile(fpImg, pDiscPerSector->data.current, uiSize);
 			}
 			else {
 #endif
-				fwrite(zeroByte, sizeof(BYTE), uiSize, fpImg);
+				WriteOutputFile(fpImg, zeroByte, uiSize);
 #if 0
 			}
 #endif
@@ -842,11 +843,11 @@ VOID WriteErrorBuffer(
 			uiSize = CD_RAW_SECTOR_SIZE;
 #if 0
 			if ((pDiscPerSector->subQ.prev.byCtl & AUDIO_DATA_TRACK) == AUDIO_DATA_TRACK) {
-				fwrite(pDiscPerSector->data.current, sizeof(BYTE), uiSize, fpImg);
+				WriteOutputFile(fpImg, pDiscPerSector->data.current, uiSize);
 			}
 			else {
 #endif
-				fwrite(zeroByte, sizeof(BYTE), uiSize, fpImg);
+				WriteOutputFile(fpImg, zeroByte, uiSize);
 #if 0
 			}
 #endif
@@ -861,10 +862,92 @@ VOID WriteErrorBuffer(
 		WriteSubChannel(pDisc, pDiscPerSector, lpSubcodeRaw, nLBA, fpSub, fpParse);
 
 		if (pExtArg->byC2 && pDevice->FEATURE.byC2ErrorData) {
-			fwrite(pDiscPerSector->data.current + pDevice->TRANSFER.dwBufC2Offset
-				, sizeof(BYTE), CD_RAW_READ_C2_294_SIZE, fpC2);
+			WriteOutputFile(fpC2, pDiscPerSector->data.current + pDevice->TRANSFER.dwBufC2Offset
+				, CD_RAW_READ_C2_294_SIZE);
+		}
+	}
+}
+
+// The corrected R-W is written to _repaired.sub. The P-Q of it is same as the
+// original .sub
+BOOL OutputRtoWEccOfSubfile(
+	LPCTSTR pszSubfile,
+	LPBYTE lpSubcode,
+	DWORD dwFileSize,
+	FILE* fpParse
+) {
+	INT nSectorNum = (INT)(dwFileSize / CD_RAW_READ_SUBCODE_SIZE);
+	BOOL bRtoW = FALSE;
+	for (INT i = 0; i < nSectorNum && !bRtoW; i++) {
+		for (INT j = 24; j < CD_RAW_READ_SUBCODE_SIZE; j++) {
+			if (lpSubcode[CD_RAW_READ_SUBCODE_SIZE * i + j]) {
+				bRtoW = TRUE;
+				break;
+			}
+		}
+	}
+	if (!bRtoW) {
+		return TRUE;
+	}
+	BOOL bRet = TRUE;
+	LPBYTE lpSymbol = NULL;
+	LPINT lpResult = NULL;
+	FILE* fpRepaired = NULL;
+	INT nPackNum = nSectorNum * RTOW_PACK_PER_SECTOR;
+	try {
+		if (NULL == (lpSymbol = (LPBYTE)calloc((size_t)nSectorNum, CD_RAW_READ_SUBCODE_SIZE))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		if (NULL == (lpResult = (LPINT)calloc((size_t)nPackNum, sizeof(INT)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
 		}
+		for (INT i = 0; i < nSectorNum; i++) {
+			SetRtoWSymbolFromRowSubcode(lpSymbol + CD_RAW_READ_SUBCODE_SIZE * i
+				, lpSubcode + CD_RAW_READ_SUBCODE_SIZE * i);
+		}
+		INT nCorrected = 0;
+		INT nUncorrectable = 0;
+		INT nChecked = CorrectRtoWSymbol(lpSymbol, nPackNum, lpResult, &nCorrected, &nUncorrectable);
+		_ftprintf(fpParse, _T("R-W pack: checked %d, corrected %d, uncorrectable %d\n")
+			, nChecked, nCorrected, nUncorrectable);
+		OutputString(_T("R-W pack: checked %d, corrected %d, uncorrectable %d\n")
+			, nChecked, nCorrected, nUncorrectable);
+		for (INT n = 0; n < nChecked; n++) {
+			if (lpResult[n] == RTOW_UNCORRECTABLE) {
+				_ftprintf(fpParse, _T("\tSector[%06d] Pack[%d]: uncorrectable\n")
+					, n / RTOW_PACK_PER_SECTOR, n % RTOW_PACK_PER_SECTOR);
+			}
+		}
+		if (nCorrected) {
+			// the corrected packs are already interleaved to lpSymbol
+			for (INT i = 0; i < nSectorNum; i++) {
+				SetRowSubcodeFromRtoWSymbol(lpSubcode + CD_RAW_READ_SUBCODE_SIZE * i
+					, lpSymbol + CD_RAW_READ_SUBCODE_SIZE * i);
+			}
+			_TCHAR szRepaired[_MAX_PATH] = { 0 };
+			if (NULL == (fpRepaired = CreateOrOpenFile(pszSubfile, _T("_repaired")
+				, szRepaired, NULL, NULL, _T(".sub"), _T("wb"), 0, 0))) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				throw FALSE;
+			}
+			if (fwrite(lpSubcode, sizeof(BYTE), (size_t)nSectorNum * CD_RAW_READ_SUBCODE_SIZE
+				, fpRepaired) < (size_t)nSectorNum * CD_RAW_READ_SUBCODE_SIZE) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				throw FALSE;
+			}
+			_ftprintf(fpParse, _T("R-W pack: wrote the corrected packs to %s\n"), szRepaired);
+			OutputString(_T("R-W pack: wrote the corrected packs to %s\n"), szRepaired);
+		}
+	}
+	catch (BOOL bErr) {
+		bRet = bErr;
 	}
+	FcloseAndNull(fpRepaired);
+	FreeAndNull(lpResult);
+	FreeAndNull(lpSymbol);
+	return bRet;
 }
 
 BOOL WriteParsingSubfile(
@@ -919,6 +1002,7 @@ BOOL WriteParsingSubfile(
 		BYTE byPrevTrackNum = 1;
 		INT nLBA = 0;
 
+		StartProgress(_T("Parsing sub"), _T("Size"), 0, (INT)dwFileSize, 1, 0);
 		for (INT i = 0; i < (INT)dwFileSize; i += CD_RAW_READ_SUBCODE_SIZE) {
 			memcpy(discPerSector.subcode.current, data + i, CD_RAW_READ_SUBCODE_SIZE);
 			BYTE byAdr = (BYTE)(discPerSector.subcode.current[12] & 0x0f);
@@ -952,14 +1036,18 @@ BOOL WriteParsingSubfile(
 			}
 			byPrevTrackNum = byTrackNum;
 			OutputCDSubToLog(&discData, &discPerSector, lpSubcodeRtoW, nLBA, fpParse);
-			OutputString(
-				_T("\rParsing sub (Size) %8d/%8lu"), i + CD_RAW_READ_SUBCODE_SIZE, dwFileSize);
+			SetProgress((INT)(i + CD_RAW_READ_SUBCODE_SIZE));
+			SetProgressZone(byTrackNum);
+		}
+		EndProgress();
+		if (!OutputRtoWEccOfSubfile(pszSubfile, data, dwFileSize, fpParse)) {
+			throw FALSE;
 		}
-		OutputString(_T("\n"));
 	}
 	catch (BOOL bErr) {
 		bRet = bErr;
 	}
+	EndProgress();
 	FcloseAndNull(fpParse);
 	FcloseAndNull(fpSub);
 	for (DWORD i = 0; i < dwTrackAllocSize; i++) {
@@ -1251,7 +1339,7 @@ BOOL WriteParsingMdsfile(
 			_T(OUTPUT_DHYPHEN_PLUS_STR(Fname))
 			_T("          ofsToFname: %ld\n")
 			_T("            fnameFmt: %d\n")
-			_T("         fnameString: %s\n")
+			_T("         fnameString: %hs\n")
 			, fb.ofsToFname, fb.fnameFmt, fname
 		);
 		if (h.ofsToDpm > 0) {
@@ -1331,8 +1419,10 @@ BOOL WriteParsingMdsfile(
 		FreeAndNull(ib);
 		FreeAndNull(db);
 		FreeAndNull(dvd);
-		for (UINT i = 0; i < pdb->dpmBlkTotalNum; i++) {
-			FreeAndNull(pddb[i]);
+		if (pdb) {
+			for (UINT i = 0; i < pdb->dpmBlkTotalNum; i++) {
+				FreeAndNull(pddb[i]);
+			}
 		}
 		FreeAndNull(pddb);
 		FreeAndNull(pdb);
@@ -1367,6 +1457,7 @@ BOOL DescrambleMainChannelForGD(
 	DWORD dwAllSectorVal = dwFileSize / CD_RAW_SECTOR_SIZE;
 	BYTE bufScm[CD_RAW_SECTOR_SIZE] = { 0 };
 	BYTE bufImg[CD_RAW_SECTOR_SIZE] = { 0 };
+	StartProgress(_T("Descrambling img"), _T("LBA"), 0, (INT)dwAllSectorVal, CD_RAW_SECTOR_SIZE, 0);
 	for (DWORD i = 0; i < dwAllSectorVal; i++) {
 		fread(bufScm, sizeof(BYTE), CD_RAW_SECTOR_SIZE, fpScm);
 		if (IsValidMainDataHeader(bufScm)) {
@@ -1382,9 +1473,9 @@ BOOL DescrambleMainChannelForGD(
 			// copy audio data
 			fwrite(bufScm, sizeof(BYTE), CD_RAW_SECTOR_SIZE, fpImg);
 		}
-		OutputString(_T("\rDescrambling img (LBA) %6lu/%6lu"), i, dwAllSectorVal);
+		SetProgress((INT)i);
 	}
-	OutputString(_T("\n"));
+	EndProgress();
 	FcloseAndNull(fpImg);
 	FcloseAndNull(fpScm);
 	return bRet;
@@ -1617,7 +1708,7 @@ BOOL IsValidReservedByte(
 VOID DescrambleMainChannelAll(
 	PEXT_ARG pExtArg,
 	PDISC pDisc,
-	LPBYTE lpScrambledBuf,
+	CONST BYTE* lpScrambledBuf,
 	FILE* fpImg
 ) {
 	BYTE aSrcBuf[CD_RAW_SECTOR_SIZE] = { 0 };
@@ -1641,6 +1732,9 @@ VOID DescrambleMainChannelAll(
 			if (!pExtArg->byReverse) {
 				lSeekPtr = nFirstLBA;
 			}
+			StartProgress(_T("Descrambling data sector of img"), _T("LBA")
+				, nFirstLBA, nLastLBA, CD_RAW_SECTOR_SIZE, 0);
+			SetProgressZone(k + 1);
 			for (; nFirstLBA <= nLastLBA; nFirstLBA++, lSeekPtr++) {
 				// t@Cǂݏp[hŊJĂ鎞 ӂKvłB
 				// ǂݍ݂sɏ݂sꍇ₻̋tsꍇ́A 
@@ -1670,8 +1764,7 @@ VOID DescrambleMainChannelAll(
 							OutputMainErrorLogA("Reverted sector. (Not be scrambled)\n");
 							if (!IsValidReservedByte(aSrcBuf)) {
 								OutputMainErrorLogA("Invalid reserved byte. Skip descrambling\n");
-								OutputString(
-									_T("\rDescrambling data sector of img (LBA) %6d/%6d"), nFirstLBA, nLastLBA);
+								SetProgress(nFirstLBA);
 								OutputCDMain(fileMainError, aSrcBuf, nFirstLBA, CD_RAW_SECTOR_SIZE);
 								continue;
 							}
@@ -1683,8 +1776,7 @@ VOID DescrambleMainChannelAll(
 							aSrcBuf[0x817] != 0xab || aSrcBuf[0x818] != 0x56 || aSrcBuf[0x819] != 0xff ||
 							aSrcBuf[0x81a] != 0x7e || aSrcBuf[0x81b] != 0xc0) {
 							OutputMainErrorLogA("Invalid reserved byte. Skip descrambling\n");
-							OutputString(
-								_T("\rDescrambling data sector of img (LBA) %6d/%6d"), nFirstLBA, nLastLBA);
+							SetProgress(nFirstLBA);
 							OutputCDMain(fileMainError, aSrcBuf, nFirstLBA, CD_RAW_SECTOR_SIZE);
 							continue;
 						}
@@ -1705,10 +1797,9 @@ VOID DescrambleMainChannelAll(
 						OutputCDMain(fileMainError, aSrcBuf, nFirstLBA, CD_RAW_SECTOR_SIZE);
 					}
 				}
-				OutputString(
-					_T("\rDescrambling data sector of img (LBA) %6d/%6d"), nFirstLBA, nLastLBA);
+				SetProgress(nFirstLBA);
 			}
-			OutputString(_T("\n"));
+			EndProgress();
 		}
 	}
 }
@@ -1716,12 +1807,13 @@ VOID DescrambleMainChannelAll(
 VOID DescrambleMainChannelPartial(
 	INT nStartLBA,
 	INT nEndLBA,
-	LPBYTE lpScrambledBuf,
+	CONST BYTE* lpScrambledBuf,
 	FILE* fpImg
 ) {
 	BYTE aSrcBuf[CD_RAW_SECTOR_SIZE] = { 0 };
 	LONG lSeekPtr = 0;
 
+	StartProgress(_T("Descrambling data sector of img"), _T("LBA"), nStartLBA, nEndLBA, CD_RAW_SECTOR_SIZE, 0);
 	for (; nStartLBA <= nEndLBA; nStartLBA++, lSeekPtr++) {
 		// t@Cǂݏp[hŊJĂ鎞 ӂKvłB
 		// ǂݍ݂sɏ݂sꍇ₻̋tsꍇ́A 
@@ -1748,10 +1840,9 @@ VOID DescrambleMainChannelPartial(
 			OutputMainErrorWithLBALogA("Invalid sync. Skip descrambling\n", nStartLBA, 0);
 			OutputCDMain(fileMainError, aSrcBuf, nStartLBA, CD_RAW_SECTOR_SIZE);
 		}
-		OutputString(
-			_T("\rDescrambling data sector of img (LBA) %6d/%6d"), nStartLBA, nEndLBA);
+		SetProgress(nStartLBA);
 	}
-	OutputString(_T("\n"));
+	EndProgress();
 }
 
 BOOL CreateBin(
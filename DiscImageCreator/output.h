@@ -15,6 +15,8 @@
  */
 #pragma once
 #include "forwardDeclaration.h"
+#include "outputLogWriter.h"
+#include "outputProgress.h"
 
 #define BOOLEAN_TO_STRING_TRUE_FALSE_W(_b_)		((_b_) ? _T("True") : _T("False"))
 #define BOOLEAN_TO_STRING_TRUE_FALSE_A(_b_)		((_b_) ? "True" : "False")
@@ -41,8 +43,11 @@
 #define OUTPUT_DHYPHEN_PLUS_STR_WITH_TRACK			STR_DOUBLE_HYPHEN_B STR_TRACK "%s" STR_DOUBLE_HYPHEN_E
 #define OUTPUT_STR_NO_SUPPORT(str)					#str STR_NO_SUPPORT
 
-#define OutputStringW(str, ...)		_tprintf(str, __VA_ARGS__);
-#define OutputStringA(str, ...)		printf(str, __VA_ARGS__);
+// The console is shared with the progress thread (see outputProgress.cpp)
+#define OutputStringW(str, ...) \
+	(LockConsoleOutput(), _tprintf(str, __VA_ARGS__), UnlockConsoleOutput());
+#define OutputStringA(str, ...) \
+	(LockConsoleOutput(), printf(str, __VA_ARGS__), UnlockConsoleOutput());
 
 #ifdef _DEBUG
 #define FlushLog()
@@ -124,64 +129,57 @@ extern CHAR logBufferA[DISC_RAW_READ_SIZE];
 #else
 // If it uses g_LogFile, call InitLogFile()
 extern _LOG_FILE g_LogFile;
-#define FlushLog() \
-{ \
-	fflush(g_LogFile.fpDisc); \
-	fflush(g_LogFile.fpVolDesc); \
-	fflush(g_LogFile.fpDrive); \
-	fflush(g_LogFile.fpMainInfo); \
-	fflush(g_LogFile.fpMainError); \
-	fflush(g_LogFile.fpSubInfo); \
-	fflush(g_LogFile.fpSubIntention); \
-	fflush(g_LogFile.fpSubError); \
-	fflush(g_LogFile.fpC2Error); \
-}
+// Output*Log macros are queued by outputLogWriter.cpp, so FlushLog() waits
+// until the queued string is written to the logfile
+#define FlushLog()		FlushLogWriter();
 
-#define OutputErrorStringW(str, ...)	fwprintf(stderr, str, __VA_ARGS__);
-#define OutputErrorStringA(str, ...)	fprintf(stderr, str, __VA_ARGS__);
+#define OutputErrorStringW(str, ...) \
+	(LockConsoleOutput(), fwprintf(stderr, str, __VA_ARGS__), UnlockConsoleOutput());
+#define OutputErrorStringA(str, ...) \
+	(LockConsoleOutput(), fprintf(stderr, str, __VA_ARGS__), UnlockConsoleOutput());
 
-#define OutputDiscLogW(str, ...)		fwprintf(g_LogFile.fpDisc, str, __VA_ARGS__);
-#define OutputDiscLogA(str, ...)		fprintf(g_LogFile.fpDisc, str, __VA_ARGS__);
+#define OutputDiscLogW(str, ...)		OutputLogWriterW(fileDisc, str, __VA_ARGS__);
+#define OutputDiscLogA(str, ...)		OutputLogWriterA(fileDisc, str, __VA_ARGS__);
 #define OutputDiscWithLBALogA(str, nLBA, ...) \
-	fprintf(g_LogFile.fpDisc, STR_LBA str, nLBA, nLBA, __VA_ARGS__);
+	OutputLogWriterA(fileDisc, STR_LBA str, nLBA, nLBA, __VA_ARGS__);
 
-#define OutputVolDescLogW(str, ...)		fwprintf(g_LogFile.fpVolDesc, str, __VA_ARGS__);
-#define OutputVolDescLogA(str, ...)		fprintf(g_LogFile.fpVolDesc, str, __VA_ARGS__);
+#define OutputVolDescLogW(str, ...)		OutputLogWriterW(fileVolDesc, str, __VA_ARGS__);
+#define OutputVolDescLogA(str, ...)		OutputLogWriterA(fileVolDesc, str, __VA_ARGS__);
 #define OutputVolDescWithLBALogA(str1, str2, nLBA, ...) \
-	fprintf(g_LogFile.fpVolDesc, OUTPUT_DHYPHEN_PLUS_STR_WITH_LBA_F(str1) str2, nLBA, nLBA, __VA_ARGS__);
+	OutputLogWriterA(fileVolDesc, OUTPUT_DHYPHEN_PLUS_STR_WITH_LBA_F(str1) str2, nLBA, nLBA, __VA_ARGS__);
 
-#define OutputDriveLogW(str, ...)		fwprintf(g_LogFile.fpDrive, str, __VA_ARGS__);
-#define OutputDriveLogA(str, ...)		fprintf(g_LogFile.fpDrive, str, __VA_ARGS__);
+#define OutputDriveLogW(str, ...)		OutputLogWriterW(fileDrive, str, __VA_ARGS__);
+#define OutputDriveLogA(str, ...)		OutputLogWriterA(fileDrive, str, __VA_ARGS__);
 #define OutputDriveNoSupportLogA(str, ...) \
-	fprintf(g_LogFile.fpDrive, OUTPUT_STR_NO_SUPPORT(str), __VA_ARGS__);
+	OutputLogWriterA(fileDrive, OUTPUT_STR_NO_SUPPORT(str), __VA_ARGS__);
 
-#define OutputMainInfoLogW(str, ...)	fwprintf(g_LogFile.fpMainInfo, str, __VA_ARGS__);
-#define OutputMainInfoLogA(str, ...)	fprintf(g_LogFile.fpMainInfo, str, __VA_ARGS__);
+#define OutputMainInfoLogW(str, ...)	OutputLogWriterW(fileMainInfo, str, __VA_ARGS__);
+#define OutputMainInfoLogA(str, ...)	OutputLogWriterA(fileMainInfo, str, __VA_ARGS__);
 #define OutputMainInfoWithLBALogA(str, nLBA, track, ...) \
-	fprintf(g_LogFile.fpMainInfo, STR_LBA STR_TRACK str, nLBA, nLBA, track, __VA_ARGS__);
+	OutputLogWriterA(fileMainInfo, STR_LBA STR_TRACK str, nLBA, nLBA, track, __VA_ARGS__);
 
-#define OutputMainErrorLogW(str, ...)	if (g_LogFile.fpMainError) fwprintf(g_LogFile.fpMainError, str, __VA_ARGS__);
-#define OutputMainErrorLogA(str, ...)	if (g_LogFile.fpMainError) fprintf(g_LogFile.fpMainError, str, __VA_ARGS__);
+#define OutputMainErrorLogW(str, ...)	if (g_LogFile.fpMainError) OutputLogWriterW(fileMainError, str, __VA_ARGS__);
+#define OutputMainErrorLogA(str, ...)	if (g_LogFile.fpMainError) OutputLogWriterA(fileMainError, str, __VA_ARGS__);
 #define OutputMainErrorWithLBALogA(str, nLBA, track, ...) \
-	if (g_LogFile.fpMainError) fprintf(g_LogFile.fpMainError, STR_LBA STR_TRACK str, nLBA, nLBA, track, __VA_ARGS__);
+	if (g_LogFile.fpMainError) OutputLogWriterA(fileMainError, STR_LBA STR_TRACK str, nLBA, nLBA, track, __VA_ARGS__);
 
-#define OutputSubInfoLogW(str, ...)		fwprintf(g_LogFile.fpSubInfo, str, __VA_ARGS__);
-#define OutputSubInfoLogA(str, ...)		fprintf(g_LogFile.fpSubInfo, str, __VA_ARGS__);
+#define OutputSubInfoLogW(str, ...)		OutputLogWriterW(fileSubInfo, str, __VA_ARGS__);
+#define OutputSubInfoLogA(str, ...)		OutputLogWriterA(fileSubInfo, str, __VA_ARGS__);
 #define OutputSubInfoWithLBALogA(str, nLBA, track, ...) \
-	fprintf(g_LogFile.fpSubInfo, STR_LBA STR_TRACK str, nLBA, nLBA, track, __VA_ARGS__);
+	OutputLogWriterA(fileSubInfo, STR_LBA STR_TRACK str, nLBA, nLBA, track, __VA_ARGS__);
 
-#define OutputSubIntentionalLogW(str, ...)		fwprintf(g_LogFile.fpSubIntention, str, __VA_ARGS__);
-#define OutputSubIntentionalLogA(str, ...)		fprintf(g_LogFile.fpSubIntention, str, __VA_ARGS__);
+#define OutputSubIntentionalLogW(str, ...)		OutputLogWriterW(fileSubIntention, str, __VA_ARGS__);
+#define OutputSubIntentionalLogA(str, ...)		OutputLogWriterA(fileSubIntention, str, __VA_ARGS__);
 
-#define OutputSubErrorLogW(str, ...)	fwprintf(g_LogFile.fpSubError, str, __VA_ARGS__);
-#define OutputSubErrorLogA(str, ...)	fprintf(g_LogFile.fpSubError, str, __VA_ARGS__);
+#define OutputSubErrorLogW(str, ...)	OutputLogWriterW(fileSubError, str, __VA_ARGS__);
+#define OutputSubErrorLogA(str, ...)	OutputLogWriterA(fileSubError, str, __VA_ARGS__);
 #define OutputSubErrorWithLBALogA(str, nLBA, track, ...) \
-	fprintf(g_LogFile.fpSubError, STR_LBA STR_TRACK STR_SUB str, nLBA, nLBA, track, __VA_ARGS__);
+	OutputLogWriterA(fileSubError, STR_LBA STR_TRACK STR_SUB str, nLBA, nLBA, track, __VA_ARGS__);
 
-#define OutputC2ErrorLogW(str, ...)		fwprintf(g_LogFile.fpC2Error, str, __VA_ARGS__);
-#define OutputC2ErrorLogA(str, ...)		fprintf(g_LogFile.fpC2Error, str, __VA_ARGS__);
+#define OutputC2ErrorLogW(str, ...)		OutputLogWriterW(fileC2Error, str, __VA_ARGS__);
+#define OutputC2ErrorLogA(str, ...)		OutputLogWriterA(fileC2Error, str, __VA_ARGS__);
 #define OutputC2ErrorWithLBALogA(str, nLBA, ...) \
-	fprintf(g_LogFile.fpC2Error, STR_LBA str, nLBA, nLBA, __VA_ARGS__);
+	OutputLogWriterA(fileC2Error, STR_LBA str, nLBA, nLBA, __VA_ARGS__);
 
 #define OutputLogW(type, str, ...) \
 { \
@@ -428,7 +426,7 @@ VOID WriteErrorBuffer(
 	PDEVICE pDevice,
 	PDISC pDisc,
 	PDISC_PER_SECTOR pDiscPerSector,
-	LPBYTE lpScrambledBuf,
+	CONST BYTE* lpScrambledBuf,
 	INT nLBA,
 	FILE* fpImg,
 	FILE* fpSub,
@@ -457,14 +455,14 @@ BOOL CreateBinCueForGD(
 VOID DescrambleMainChannelAll(
 	PEXT_ARG pExtArg,
 	PDISC pDisc,
-	LPBYTE lpScrambledBuf,
+	CONST BYTE* lpScrambledBuf,
 	FILE* fpImg
 );
 
 VOID DescrambleMainChannelPartial(
 	INT nStartLBA,
 	INT nEndLBA,
-	LPBYTE lpScrambledBuf,
+	CONST BYTE* lpScrambledBuf,
 	FILE* fpImg
 );
 
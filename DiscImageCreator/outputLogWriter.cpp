@@ -0,0 +1,465 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "output.h"
+#include "outputLogWriter.h"
+
+#ifndef _DEBUG
+#define LOG_WRITER_FILE_NUM		9
+
+// order is same as LOG_TYPE (fileDisc - fileC2Error)
+static FILE** s_ppLogFile[LOG_WRITER_FILE_NUM] = {
+	&g_LogFile.fpDisc,
+	&g_LogFile.fpVolDesc,
+	&g_LogFile.fpDrive,
+	&g_LogFile.fpMainInfo,
+	&g_LogFile.fpMainError,
+	&g_LogFile.fpSubInfo,
+	&g_LogFile.fpSubIntention,
+	&g_LogFile.fpSubError,
+	&g_LogFile.fpC2Error
+};
+
+static LOG_RING s_ring[LOG_WRITER_MAX_THREAD];
+static volatile LONG s_lGeneration;
+// the ring is returned by the callback of this index when the thread exits
+static DWORD s_dwFlsIdx = FLS_OUT_OF_INDEXES;
+static __declspec(thread) PLOG_RING s_pRing;
+static __declspec(thread) LONG s_lRingGeneration;
+
+static LPBYTE s_lpStaging[LOG_WRITER_FILE_NUM];
+static size_t s_stStagingSize[LOG_WRITER_FILE_NUM];
+
+static HANDLE s_hThread;
+static HANDLE s_hWakeEvent;
+static HANDLE s_hFlushDoneEvent;
+static volatile LONG s_lFlushRequest;
+static volatile LONG s_lStopRequest;
+// s_csFlush: serializes the callers of FlushLogWriter
+// s_csFile: serializes fwrite between the writer thread and the direct writing
+static CRITICAL_SECTION s_csFlush;
+static CRITICAL_SECTION s_csFile;
+
+INT GetLogWriterFileIdx(
+	LOG_TYPE type
+) {
+	DWORD dwBit = 0;
+	if (!_BitScanForward(&dwBit, (DWORD)(type >> 2))) {
+		return -1;
+	}
+	if (dwBit >= LOG_WRITER_FILE_NUM) {
+		return -1;
+	}
+	return (INT)dwBit;
+}
+
+// Called when the thread exits. The records left in the ring are still
+// written by the writer thread, and the next thread continues the ring.
+VOID WINAPI ReleaseLogRing(
+	PVOID lpFlsData
+) {
+	PLOG_RING pRing = (PLOG_RING)lpFlsData;
+	if (pRing) {
+		// FlsFree calls this for the other threads too, so check the owner
+		InterlockedCompareExchange(&pRing->lOwner, 0, (LONG)GetCurrentThreadId());
+	}
+}
+
+PLOG_RING GetLogRing(
+	VOID
+) {
+	if (s_pRing && s_lRingGeneration == s_lGeneration) {
+		return s_pRing;
+	}
+	s_pRing = NULL;
+	LONG lThreadId = (LONG)GetCurrentThreadId();
+	INT nIdx = 0;
+	for (; nIdx < LOG_WRITER_MAX_THREAD; nIdx++) {
+		if (!InterlockedCompareExchange(&s_ring[nIdx].lOwner, lThreadId, 0)) {
+			break;
+		}
+	}
+	if (nIdx == LOG_WRITER_MAX_THREAD) {
+		return NULL;
+	}
+	if (!s_ring[nIdx].lpBuf) {
+		LPBYTE lpBuf = (LPBYTE)malloc(LOG_WRITER_RING_SIZE);
+		if (!lpBuf) {
+			InterlockedExchange(&s_ring[nIdx].lOwner, 0);
+			return NULL;
+		}
+		s_ring[nIdx].llHead = 0;
+		s_ring[nIdx].llTail = 0;
+		MemoryBarrier();
+		// the writer thread skips the ring until lpBuf is set
+		InterlockedExchangePointer((PVOID volatile*)&s_ring[nIdx].lpBuf, lpBuf);
+	}
+	if (!FlsSetValue(s_dwFlsIdx, &s_ring[nIdx])) {
+		InterlockedExchange(&s_ring[nIdx].lOwner, 0);
+		return NULL;
+	}
+	s_pRing = &s_ring[nIdx];
+	s_lRingGeneration = s_lGeneration;
+	return s_pRing;
+}
+
+VOID CopyToLogRing(
+	PLOG_RING pRing,
+	LONG64 llPos,
+	LPBYTE lpSrc,
+	size_t stSize
+) {
+	size_t stOfs = (size_t)(llPos % LOG_WRITER_RING_SIZE);
+	size_t stFirst = min(stSize, (size_t)LOG_WRITER_RING_SIZE - stOfs);
+	memcpy(pRing->lpBuf + stOfs, lpSrc, stFirst);
+	if (stFirst < stSize) {
+		memcpy(pRing->lpBuf, lpSrc + stFirst, stSize - stFirst);
+	}
+}
+
+VOID CopyFromLogRing(
+	PLOG_RING pRing,
+	LONG64 llPos,
+	LPBYTE lpDst,
+	size_t stSize
+) {
+	size_t stOfs = (size_t)(llPos % LOG_WRITER_RING_SIZE);
+	size_t stFirst = min(stSize, (size_t)LOG_WRITER_RING_SIZE - stOfs);
+	memcpy(lpDst, pRing->lpBuf + stOfs, stFirst);
+	if (stFirst < stSize) {
+		memcpy(lpDst + stFirst, pRing->lpBuf, stSize - stFirst);
+	}
+}
+
+VOID WriteLogStaging(
+	INT nIdx
+) {
+	if (s_stStagingSize[nIdx]) {
+		EnterCriticalSection(&s_csFile);
+		FILE* fp = *s_ppLogFile[nIdx];
+		if (fp) {
+			fwrite(s_lpStaging[nIdx], sizeof(BYTE), s_stStagingSize[nIdx], fp);
+		}
+		LeaveCriticalSection(&s_csFile);
+		s_stStagingSize[nIdx] = 0;
+	}
+}
+
+VOID WriteAllLogStaging(
+	VOID
+) {
+	for (INT i = 0; i < LOG_WRITER_FILE_NUM; i++) {
+		WriteLogStaging(i);
+	}
+}
+
+VOID FlushAllLogFile(
+	VOID
+) {
+	for (INT i = 0; i < LOG_WRITER_FILE_NUM; i++) {
+		if (*s_ppLogFile[i]) {
+			fflush(*s_ppLogFile[i]);
+		}
+	}
+}
+
+VOID DrainLogRing(
+	PLOG_RING pRing
+) {
+	LONG64 llHead = pRing->llHead;
+	MemoryBarrier();
+	LONG64 llTail = pRing->llTail;
+
+	while (llTail < llHead) {
+		LOG_RECORD rec = { 0 };
+		CopyFromLogRing(pRing, llTail, (LPBYTE)&rec, sizeof(rec));
+		llTail += sizeof(rec);
+
+		INT nIdx = (INT)rec.dwFileIdx;
+		size_t stRemain = rec.dwLen;
+		while (stRemain) {
+			size_t stCopy = min(stRemain, LOG_WRITER_STAGING_SIZE - s_stStagingSize[nIdx]);
+			CopyFromLogRing(pRing, llTail, s_lpStaging[nIdx] + s_stStagingSize[nIdx], stCopy);
+			s_stStagingSize[nIdx] += stCopy;
+			llTail += stCopy;
+			stRemain -= stCopy;
+			if (s_stStagingSize[nIdx] == LOG_WRITER_STAGING_SIZE) {
+				WriteLogStaging(nIdx);
+			}
+		}
+	}
+	MemoryBarrier();
+	pRing->llTail = llTail;
+}
+
+VOID DrainAllLogRing(
+	VOID
+) {
+	for (INT i = 0; i < LOG_WRITER_MAX_THREAD; i++) {
+		if (s_ring[i].lpBuf) {
+			DrainLogRing(&s_ring[i]);
+		}
+	}
+	WriteAllLogStaging();
+}
+
+DWORD WINAPI LogWriterThreadProc(
+	LPVOID lpParam
+) {
+	UNREFERENCED_PARAMETER(lpParam);
+	for (;;) {
+		WaitForSingleObject(s_hWakeEvent, LOG_WRITER_WAIT_MS);
+		// read the stop flag before draining, so the last records are also written
+		LONG lStop = InterlockedCompareExchange(&s_lStopRequest, 0, 0);
+		DrainAllLogRing();
+		if (InterlockedExchange(&s_lFlushRequest, 0)) {
+			// the records pushed just before the request may be missed by the above
+			DrainAllLogRing();
+			FlushAllLogFile();
+			SetEvent(s_hFlushDoneEvent);
+		}
+		if (lStop) {
+			break;
+		}
+	}
+	return 0;
+}
+
+BOOL InitLogWriter(
+	VOID
+) {
+	if (s_hThread) {
+		return TRUE;
+	}
+	BOOL bRet = TRUE;
+	try {
+		for (INT i = 0; i < LOG_WRITER_FILE_NUM; i++) {
+			if (NULL == (s_lpStaging[i] = (LPBYTE)malloc(LOG_WRITER_STAGING_SIZE))) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				throw FALSE;
+			}
+			s_stStagingSize[i] = 0;
+		}
+		if (NULL == (s_hWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		if (NULL == (s_hFlushDoneEvent = CreateEvent(NULL, TRUE, FALSE, NULL))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		if (FLS_OUT_OF_INDEXES == (s_dwFlsIdx = FlsAlloc(ReleaseLogRing))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		InitializeCriticalSection(&s_csFlush);
+		InitializeCriticalSection(&s_csFile);
+		s_lFlushRequest = 0;
+		s_lStopRequest = 0;
+		InterlockedIncrement(&s_lGeneration);
+
+		if (NULL == (s_hThread = CreateThread(NULL, 0, LogWriterThreadProc, NULL, 0, NULL))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			DeleteCriticalSection(&s_csFlush);
+			DeleteCriticalSection(&s_csFile);
+			throw FALSE;
+		}
+	}
+	catch (BOOL bErr) {
+		bRet = bErr;
+		// the macros fall back to the direct writing
+		if (s_dwFlsIdx != FLS_OUT_OF_INDEXES) {
+			FlsFree(s_dwFlsIdx);
+			s_dwFlsIdx = FLS_OUT_OF_INDEXES;
+		}
+		if (s_hFlushDoneEvent) {
+			CloseHandle(s_hFlushDoneEvent);
+			s_hFlushDoneEvent = NULL;
+		}
+		if (s_hWakeEvent) {
+			CloseHandle(s_hWakeEvent);
+			s_hWakeEvent = NULL;
+		}
+		for (INT i = 0; i < LOG_WRITER_FILE_NUM; i++) {
+			FreeAndNull(s_lpStaging[i]);
+		}
+	}
+	return bRet;
+}
+
+VOID FlushLogWriter(
+	VOID
+) {
+	if (!s_hThread) {
+		FlushAllLogFile();
+		return;
+	}
+	EnterCriticalSection(&s_csFlush);
+	ResetEvent(s_hFlushDoneEvent);
+	InterlockedExchange(&s_lFlushRequest, 1);
+	SetEvent(s_hWakeEvent);
+	WaitForSingleObject(s_hFlushDoneEvent, INFINITE);
+	LeaveCriticalSection(&s_csFlush);
+}
+
+VOID TerminateLogWriter(
+	VOID
+) {
+	if (!s_hThread) {
+		return;
+	}
+	InterlockedExchange(&s_lStopRequest, 1);
+	SetEvent(s_hWakeEvent);
+	WaitForSingleObject(s_hThread, INFINITE);
+	CloseHandle(s_hThread);
+	s_hThread = NULL;
+	FlushAllLogFile();
+
+	CloseHandle(s_hFlushDoneEvent);
+	s_hFlushDoneEvent = NULL;
+	CloseHandle(s_hWakeEvent);
+	s_hWakeEvent = NULL;
+	DeleteCriticalSection(&s_csFlush);
+	DeleteCriticalSection(&s_csFile);
+
+	FlsFree(s_dwFlsIdx);
+	s_dwFlsIdx = FLS_OUT_OF_INDEXES;
+	for (INT i = 0; i < LOG_WRITER_MAX_THREAD; i++) {
+		FreeAndNull(s_ring[i].lpBuf);
+		s_ring[i].lOwner = 0;
+	}
+	for (INT i = 0; i < LOG_WRITER_FILE_NUM; i++) {
+		FreeAndNull(s_lpStaging[i]);
+	}
+}
+
+VOID PushLogRecord(
+	INT nIdx,
+	LPCSTR lpStr,
+	size_t stLen
+) {
+	if (!s_hThread) {
+		FILE* fp = *s_ppLogFile[nIdx];
+		if (fp) {
+			fwrite(lpStr, sizeof(CHAR), stLen, fp);
+		}
+		return;
+	}
+	LOG_RECORD rec = { (DWORD)nIdx, (DWORD)stLen };
+	size_t stNeed = sizeof(rec) + stLen;
+	PLOG_RING pRing = GetLogRing();
+	if (!pRing || stNeed > LOG_WRITER_RING_SIZE / 2) {
+		// too many threads at once or too large record. The previous records of this
+		// thread must be written before this one
+		FlushLogWriter();
+		EnterCriticalSection(&s_csFile);
+		FILE* fp = *s_ppLogFile[nIdx];
+		if (fp) {
+			fwrite(lpStr, sizeof(CHAR), stLen, fp);
+		}
+		LeaveCriticalSection(&s_csFile);
+		return;
+	}
+	LONG64 llHead = pRing->llHead;
+	while (LOG_WRITER_RING_SIZE - (llHead - pRing->llTail) < (LONG64)stNeed) {
+		SetEvent(s_hWakeEvent);
+		Sleep(1);
+	}
+	CopyToLogRing(pRing, llHead, (LPBYTE)&rec, sizeof(rec));
+	CopyToLogRing(pRing, llHead + sizeof(rec), (LPBYTE)lpStr, stLen);
+	MemoryBarrier();
+	pRing->llHead = llHead + stNeed;
+
+	if (llHead + (LONG64)stNeed - pRing->llTail > LOG_WRITER_RING_SIZE / 2) {
+		SetEvent(s_hWakeEvent);
+	}
+}
+
+VOID OutputLogWriterA(
+	LOG_TYPE type,
+	LPCSTR pszFormat,
+	...
+) {
+	INT nIdx = GetLogWriterFileIdx(type);
+	if (nIdx == -1) {
+		return;
+	}
+	va_list vaList;
+	va_start(vaList, pszFormat);
+	INT nLen = _vscprintf(pszFormat, vaList);
+	va_end(vaList);
+	if (nLen <= 0) {
+		return;
+	}
+	CHAR szBuf[LOG_WRITER_FORMAT_SIZE];
+	LPSTR lpBuf = szBuf;
+	if (nLen >= LOG_WRITER_FORMAT_SIZE) {
+		if (NULL == (lpBuf = (LPSTR)malloc((size_t)nLen + 1))) {
+			return;
+		}
+	}
+	va_start(vaList, pszFormat);
+	_vsnprintf(lpBuf, (size_t)nLen + 1, pszFormat, vaList);
+	va_end(vaList);
+
+	PushLogRecord(nIdx, lpBuf, (size_t)nLen);
+	if (lpBuf != szBuf) {
+		FreeAndNull(lpBuf);
+	}
+}
+
+VOID OutputLogWriterW(
+	LOG_TYPE type,
+	LPCWSTR pszFormat,
+	...
+) {
+	INT nIdx = GetLogWriterFileIdx(type);
+	if (nIdx == -1) {
+		return;
+	}
+	va_list vaList;
+	va_start(vaList, pszFormat);
+	INT nLen = _vscwprintf(pszFormat, vaList);
+	va_end(vaList);
+	if (nLen <= 0) {
+		return;
+	}
+	WCHAR szBufW[LOG_WRITER_FORMAT_SIZE];
+	LPWSTR lpBufW = szBufW;
+	if (nLen >= LOG_WRITER_FORMAT_SIZE) {
+		if (NULL == (lpBufW = (LPWSTR)malloc(((size_t)nLen + 1) * sizeof(WCHAR)))) {
+			return;
+		}
+	}
+	va_start(vaList, pszFormat);
+	_vsnwprintf(lpBufW, (size_t)nLen + 1, pszFormat, vaList);
+	va_end(vaList);
+
+	// logfiles are opened by "w" (not ccs=UTF-8), so convert it as fwprintf does
+	INT nLenA = WideCharToMultiByte(CP_ACP, 0, lpBufW, nLen, NULL, 0, NULL, NULL);
+	if (nLenA > 0) {
+		LPSTR lpBufA = (LPSTR)malloc((size_t)nLenA);
+		if (lpBufA) {
+			WideCharToMultiByte(CP_ACP, 0, lpBufW, nLen, lpBufA, nLenA, NULL, NULL);
+			PushLogRecord(nIdx, lpBufA, (size_t)nLenA);
+			FreeAndNull(lpBufA);
+		}
+	}
+	if (lpBufW != szBufW) {
+		FreeAndNull(lpBufW);
+	}
+}
+#endif
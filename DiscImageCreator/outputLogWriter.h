@@ -0,0 +1,51 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "enum.h"
+
+#ifndef _DEBUG
+// Each thread owns a ring buffer. Output*Log macros only format the string and
+// push it to the ring, and the writer thread coalesces the records per logfile.
+#define LOG_WRITER_MAX_THREAD		16
+#define LOG_WRITER_RING_SIZE		(1024 * 1024)
+#define LOG_WRITER_STAGING_SIZE		(64 * 1024)
+#define LOG_WRITER_FORMAT_SIZE		(8 * 1024)
+#define LOG_WRITER_WAIT_MS			100
+
+BOOL InitLogWriter(
+	VOID
+);
+
+VOID FlushLogWriter(
+	VOID
+);
+
+VOID TerminateLogWriter(
+	VOID
+);
+
+VOID OutputLogWriterA(
+	LOG_TYPE type,
+	LPCSTR pszFormat,
+	...
+);
+
+VOID OutputLogWriterW(
+	LOG_TYPE type,
+	LPCWSTR pszFormat,
+	...
+);
+#endif
@@ -0,0 +1,305 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "convert.h"
+#include "get.h"
+#include "output.h"
+#include "outputMds.h"
+
+#define MDS_MEDIA_TYPE_CD_ROM	0
+#define MDS_MEDIA_TYPE_CD_R		1
+#define MDS_MEDIA_TYPE_CD_RW	2
+
+#define MDS_TRACK_MODE_AUDIO	0xa9
+#define MDS_TRACK_MODE_MODE1	0xaa
+#define MDS_TRACK_MODE_MODE2	0xab
+
+VOID StartDpm(
+	PDISC pDisc
+) {
+	pDisc->DPM.dwEntryNum = 0;
+	QueryPerformanceFrequency(&pDisc->DPM.llFreq);
+	QueryPerformanceCounter(&pDisc->DPM.llStart);
+}
+
+// Called right after the sector is read in the dump loop, so it needs no extra
+// reading. A reread of the same sector doesn't overwrite the first time.
+VOID SetDpm(
+	PDISC pDisc,
+	INT nLBA
+) {
+	if (!pDisc->DPM.lpReadTime || nLBA < 0 ||
+		(DWORD)nLBA / pDisc->DPM.dwResolution < pDisc->DPM.dwEntryNum) {
+		return;
+	}
+	LARGE_INTEGER llNow;
+	QueryPerformanceCounter(&llNow);
+	DWORD dwMs = (DWORD)((llNow.QuadPart - pDisc->DPM.llStart.QuadPart) * 1000 / pDisc->DPM.llFreq.QuadPart);
+	// the skipped entry (e.g. the gap of the multi-session) has the same time
+	while (pDisc->DPM.dwEntryNum <= (DWORD)nLBA / pDisc->DPM.dwResolution &&
+		pDisc->DPM.dwEntryNum < pDisc->DPM.dwAllocEntryNum) {
+		pDisc->DPM.lpReadTime[pDisc->DPM.dwEntryNum++] = dwMs;
+	}
+}
+
+VOID SetMdsDataBlock(
+	PMDS_DATA_BLK pDb,
+	BYTE byTrackMode,
+	BYTE byCtl,
+	BYTE byPoint,
+	BYTE byPMin,
+	BYTE byPSec,
+	BYTE byPFrame,
+	DWORD dwOfsToFname
+) {
+	pDb->trackMode = byTrackMode;
+	pDb->numOfSubch = 8;
+	pDb->adrCtl = (BYTE)(ADR_ENCODES_CURRENT_POSITION << 4 | byCtl);
+	pDb->point = byPoint;
+	pDb->m = byPMin;
+	pDb->s = byPSec;
+	pDb->f = byPFrame;
+	pDb->sectorSize = CD_RAW_SECTOR_WITH_SUBCODE_SIZE;
+	pDb->NumOfFname = 1;
+	pDb->OfsToFname = dwOfsToFname;
+}
+
+BOOL WriteMdfFile(
+	LPCTSTR pszPath
+) {
+	BOOL bRet = TRUE;
+	FILE* fpImg = NULL;
+	FILE* fpSub = NULL;
+	FILE* fpMdf = NULL;
+	LPBYTE lpBuf = NULL;
+	try {
+		if (NULL == (fpImg = CreateOrOpenFile(
+			pszPath, NULL, NULL, NULL, NULL, _T(".img"), _T("rb"), 0, 0))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		if (NULL == (fpSub = CreateOrOpenFile(
+			pszPath, NULL, NULL, NULL, NULL, _T(".sub"), _T("rb"), 0, 0))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		DWORD dwSectorNum = GetFileSize(0, fpImg) / CD_RAW_SECTOR_SIZE;
+		DWORD dwSubSectorNum = GetFileSize(0, fpSub) / CD_RAW_READ_SUBCODE_SIZE;
+		if (dwSectorNum != dwSubSectorNum) {
+			OutputErrorString(
+				_T("Sector num of .img (%lu) and .sub (%lu) are different\n"), dwSectorNum, dwSubSectorNum);
+			throw FALSE;
+		}
+		if (NULL == (fpMdf = CreateOrOpenFile(
+			pszPath, NULL, NULL, NULL, NULL, _T(".mdf"), _T("wb"), 0, 0))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		if (NULL == (lpBuf = (LPBYTE)calloc(
+			MDF_CHUNK_SECTOR_NUM * (CD_RAW_SECTOR_WITH_SUBCODE_SIZE + CD_RAW_READ_SUBCODE_SIZE), sizeof(BYTE)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		// main (2352) + raw sub (96) per sector
+		LPBYTE lpSub = lpBuf + MDF_CHUNK_SECTOR_NUM * CD_RAW_SECTOR_WITH_SUBCODE_SIZE;
+		for (DWORD i = 0; i < dwSectorNum; i += MDF_CHUNK_SECTOR_NUM) {
+			DWORD dwNum = dwSectorNum - i < MDF_CHUNK_SECTOR_NUM ? dwSectorNum - i : MDF_CHUNK_SECTOR_NUM;
+			if (fread(lpSub, CD_RAW_READ_SUBCODE_SIZE, dwNum, fpSub) != dwNum) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				throw FALSE;
+			}
+			for (DWORD j = 0; j < dwNum; j++) {
+				if (fread(lpBuf + j * CD_RAW_SECTOR_WITH_SUBCODE_SIZE, CD_RAW_SECTOR_SIZE, 1, fpImg) != 1) {
+					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+					throw FALSE;
+				}
+				memcpy(lpBuf + j * CD_RAW_SECTOR_WITH_SUBCODE_SIZE + CD_RAW_SECTOR_SIZE
+					, lpSub + j * CD_RAW_READ_SUBCODE_SIZE, CD_RAW_READ_SUBCODE_SIZE);
+			}
+			if (fwrite(lpBuf, CD_RAW_SECTOR_WITH_SUBCODE_SIZE, dwNum, fpMdf) != dwNum) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				throw FALSE;
+			}
+		}
+	}
+	catch (BOOL bErr) {
+		bRet = bErr;
+	}
+	FcloseAndNull(fpImg);
+	FcloseAndNull(fpSub);
+	FcloseAndNull(fpMdf);
+	FreeAndNull(lpBuf);
+	return bRet;
+}
+
+// The layout is the same order as WriteParsingMdsfile reads
+//  header, session blocks, data blocks (A0, A1, A2 + tracks per session),
+//  index blocks, fname block, DPM header, DPM block
+BOOL WriteMdsfile(
+	PEXT_ARG pExtArg,
+	PDISC pDisc,
+	LPCTSTR pszPath
+) {
+	if (pExtArg->byPre) {
+		OutputString(_T("[WARNING] /mds can't be used with /p. Skipped creating .mds\n"));
+		return TRUE;
+	}
+	OutputString(_T("Creating .mdf\n"));
+	if (!WriteMdfFile(pszPath)) {
+		return FALSE;
+	}
+	BYTE byFirstTrack = pDisc->SCSI.toc.FirstTrack;
+	BYTE byLastTrack = pDisc->SCSI.toc.LastTrack;
+	WORD wSessionNum = pDisc->SCSI.lpSessionNumList[byLastTrack - 1];
+	if (wSessionNum == 0) {
+		wSessionNum = 1;
+	}
+	DWORD dwTotalDataBlkNum = (DWORD)(byLastTrack - byFirstTrack + 1) + 3 * wSessionNum;
+	DWORD dwOfsToSession = sizeof(MDS_HEADER);
+	DWORD dwOfsToData = dwOfsToSession + wSessionNum * sizeof(MDS_SESSION_BLK);
+	DWORD dwOfsToIdx = dwOfsToData + dwTotalDataBlkNum * sizeof(MDS_DATA_BLK);
+	DWORD dwOfsToFname = dwOfsToIdx + dwTotalDataBlkNum * sizeof(MDS_IDX_BLK);
+	DWORD dwOfsToDpm = dwOfsToFname + sizeof(MDS_FNAME_BLK);
+	DWORD dwOfsToDpmBlk = dwOfsToDpm + sizeof(MDS_DPM_HEADER) + sizeof(DWORD);
+	DWORD dwMdsSize = dwOfsToDpm;
+	if (pDisc->DPM.dwEntryNum > 0) {
+		dwMdsSize = dwOfsToDpmBlk + sizeof(MDS_DPM_BLK) + pDisc->DPM.dwEntryNum * sizeof(DWORD);
+	}
+	LPBYTE lpMds = NULL;
+	if (NULL == (lpMds = (LPBYTE)calloc(dwMdsSize, sizeof(BYTE)))) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	PMDS_HEADER pH = (PMDS_HEADER)lpMds;
+	memcpy(pH->fileId, "MEDIA DESCRIPTOR", sizeof(pH->fileId));
+	pH->unknown1 = 0x0301;
+	pH->mediaType = MDS_MEDIA_TYPE_CD_ROM;
+	if (pDisc->SCSI.wCurrentMedia == ProfileCdRecordable) {
+		pH->mediaType = MDS_MEDIA_TYPE_CD_R;
+	}
+	else if (pDisc->SCSI.wCurrentMedia == ProfileCdRewritable) {
+		pH->mediaType = MDS_MEDIA_TYPE_CD_RW;
+	}
+	pH->sessionNum = wSessionNum;
+	pH->ofsTo1stSessionBlk = dwOfsToSession;
+	if (pDisc->DPM.dwEntryNum > 0) {
+		pH->ofsToDpm = dwOfsToDpm;
+	}
+
+	PMDS_SESSION_BLK pSb = (PMDS_SESSION_BLK)(lpMds + dwOfsToSession);
+	PMDS_DATA_BLK pDb = (PMDS_DATA_BLK)(lpMds + dwOfsToData);
+	PMDS_IDX_BLK pIb = (PMDS_IDX_BLK)(lpMds + dwOfsToIdx);
+	DWORD dwOfsToFnameString = dwOfsToFname + offsetof(MDS_FNAME_BLK, fnameString);
+	INT nBlk = 0;
+	BYTE t = (BYTE)(byFirstTrack - 1);
+	for (WORD s = 1; s <= wSessionNum; s++) {
+		BYTE byFirst = t;
+		while (t < byLastTrack && (pDisc->SCSI.lpSessionNumList[t] == s || wSessionNum == 1)) {
+			t++;
+		}
+		BYTE byLast = (BYTE)(t - 1);
+		INT nLeadout = pDisc->SCSI.lpLastLBAListOnToc[byLast] + 1;
+		pSb[s - 1].startSector = (DWORD)(pDisc->SCSI.lpFirstLBAListOnToc[byFirst] - 150);
+		pSb[s - 1].endSector = (DWORD)nLeadout;
+		pSb[s - 1].sessionNum = s;
+		pSb[s - 1].totalDataBlkNum = (UCHAR)(byLast - byFirst + 1 + 3);
+		pSb[s - 1].DataBlkNum = (UCHAR)(byLast - byFirst + 1);
+		pSb[s - 1].firstTrackNum = (WORD)(byFirst + 1);
+		pSb[s - 1].lastTrackNum = (WORD)(byLast + 1);
+		pSb[s - 1].ofsTo1stDataBlk = dwOfsToData + nBlk * sizeof(MDS_DATA_BLK);
+
+		BYTE m = 0;
+		BYTE sec = 0;
+		BYTE f = 0;
+		LBAtoMSF(nLeadout + 150, &m, &sec, &f);
+		SetMdsDataBlock(&pDb[nBlk++], 0, pDisc->SCSI.toc.TrackData[byFirst].Control
+			, 0xa0, (BYTE)(byFirst + 1), pDisc->SCSI.byFormat, 0, dwOfsToFnameString);
+		SetMdsDataBlock(&pDb[nBlk++], 0, pDisc->SCSI.toc.TrackData[byLast].Control
+			, 0xa1, (BYTE)(byLast + 1), 0, 0, dwOfsToFnameString);
+		SetMdsDataBlock(&pDb[nBlk++], 0, pDisc->SCSI.toc.TrackData[byLast].Control
+			, 0xa2, m, sec, f, dwOfsToFnameString);
+
+		for (BYTE i = byFirst; i <= byLast; i++) {
+			INT nLBA = pDisc->SCSI.lpFirstLBAListOnToc[i];
+			BYTE byMode = MDS_TRACK_MODE_AUDIO;
+			if ((pDisc->SCSI.toc.TrackData[i].Control & AUDIO_DATA_TRACK) == AUDIO_DATA_TRACK) {
+				byMode = pDisc->MAIN.lpModeList[i] == 2 ? MDS_TRACK_MODE_MODE2 : MDS_TRACK_MODE_MODE1;
+			}
+			LBAtoMSF(nLBA + 150, &m, &sec, &f);
+			SetMdsDataBlock(&pDb[nBlk], byMode, pDisc->SCSI.toc.TrackData[i].Control
+				, (BYTE)(i + 1), m, sec, f, dwOfsToFnameString);
+			pDb[nBlk].ofsToIndexBlk = dwOfsToIdx + nBlk * sizeof(MDS_IDX_BLK);
+			pDb[nBlk].trackStartSector = (DWORD)nLBA;
+			// the .mdf starts at LBA 0 and lacks the session gap as the .img does
+			INT nFileLBA = nLBA;
+			if (!pExtArg->byMultiSession) {
+				nFileLBA -= SESSION_TO_SESSION_SKIP_LBA * (s - 1);
+			}
+			UINT64 ui64Ofs = (UINT64)nFileLBA * CD_RAW_SECTOR_WITH_SUBCODE_SIZE;
+			pDb[nBlk].ofsFromHeadToIdx1 = (DWORD)ui64Ofs;
+			pDb[nBlk].unknown2 = (DWORD)(ui64Ofs >> 32);
+
+			INT nIdx0 = pDisc->SUB.lpFirstLBAListOnSub[i][0];
+			if (i > byFirst && nIdx0 != -1 && nIdx0 < nLBA) {
+				pIb[nBlk].NumOfIdx0 = (DWORD)(nLBA - nIdx0);
+			}
+			INT nNext = nLeadout;
+			if (i < byLast) {
+				nNext = pDisc->SCSI.lpFirstLBAListOnToc[i + 1];
+				INT nNextIdx0 = pDisc->SUB.lpFirstLBAListOnSub[i + 1][0];
+				if (nNextIdx0 != -1 && nNextIdx0 < nNext) {
+					nNext = nNextIdx0;
+				}
+			}
+			pIb[nBlk].NumOfIdx1 = (DWORD)(nNext - nLBA);
+			nBlk++;
+		}
+	}
+
+	PMDS_FNAME_BLK pFb = (PMDS_FNAME_BLK)(lpMds + dwOfsToFname);
+	pFb->ofsToFname = dwOfsToFnameString;
+	// 1: wide char. "*.mdf" is the same name as the .mds
+	pFb->fnameFmt = 1;
+	memcpy(pFb->fnameString, L"*.mdf", sizeof(pFb->fnameString));
+
+	if (pDisc->DPM.dwEntryNum > 0) {
+		PMDS_DPM_HEADER pDh = (PMDS_DPM_HEADER)(lpMds + dwOfsToDpm);
+		pDh->dpmBlkTotalNum = 1;
+		pDh->ofsToDpmBlk[0] = dwOfsToDpmBlk;
+		PMDS_DPM_BLK pDpm = (PMDS_DPM_BLK)(lpMds + dwOfsToDpmBlk);
+		pDpm->dpmBlkNum = 0;
+		pDpm->unknown1 = 1;
+		pDpm->resolution = pDisc->DPM.dwResolution;
+		pDpm->entry = pDisc->DPM.dwEntryNum;
+		memcpy(pDpm->readTime, pDisc->DPM.lpReadTime, pDisc->DPM.dwEntryNum * sizeof(DWORD));
+	}
+
+	BOOL bRet = TRUE;
+	FILE* fpMds = CreateOrOpenFile(pszPath, NULL, NULL, NULL, NULL, _T(".mds"), _T("wb"), 0, 0);
+	if (!fpMds) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		bRet = FALSE;
+	}
+	else {
+		if (fwrite(lpMds, sizeof(BYTE), dwMdsSize, fpMds) != dwMdsSize) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			bRet = FALSE;
+		}
+		FcloseAndNull(fpMds);
+	}
+	FreeAndNull(lpMds);
+	return bRet;
+}
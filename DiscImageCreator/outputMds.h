@@ -0,0 +1,37 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// sectors per entry of the DPM (data position measurement)
+#define DPM_RESOLUTION			50
+// sectors per fread/fwrite when the .mdf is created
+#define MDF_CHUNK_SECTOR_NUM	256
+
+VOID StartDpm(
+	PDISC pDisc
+);
+
+VOID SetDpm(
+	PDISC pDisc,
+	INT nLBA
+);
+
+BOOL WriteMdsfile(
+	PEXT_ARG pExtArg,
+	PDISC pDisc,
+	LPCTSTR pszPath
+);
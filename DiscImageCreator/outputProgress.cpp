@@ -0,0 +1,233 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "output.h"
+#include "outputProgress.h"
+
+PROGRESS g_Progress;
+static HANDLE s_hProgressThread;
+static HANDLE s_hProgressStopEvent;
+// one json per line for the external monitor (/ps)
+static FILE* s_fpProgressEvent;
+// thread id which writes to the console now. The progress thread redraws the
+// line from "\r", so the other output mustn't be mixed into it
+static LONG s_lConsoleOwner;
+static INT s_nConsoleNest;
+
+// OutputString and OutputErrorString take this lock. It is recursive because
+// the argument of them can also output the string. It spins instead of using
+// the critical section, because it is used before main() initializes anything.
+VOID LockConsoleOutput(
+	VOID
+) {
+	LONG lThreadId = (LONG)GetCurrentThreadId();
+	if (InterlockedCompareExchange(&s_lConsoleOwner, lThreadId, lThreadId) == lThreadId) {
+		s_nConsoleNest++;
+		return;
+	}
+	while (InterlockedCompareExchange(&s_lConsoleOwner, lThreadId, 0) != 0) {
+		Sleep(0);
+	}
+}
+
+VOID UnlockConsoleOutput(
+	VOID
+) {
+	if (s_nConsoleNest > 0) {
+		s_nConsoleNest--;
+		return;
+	}
+	InterlockedExchange(&s_lConsoleOwner, 0);
+}
+
+VOID OutputProgressEventString(
+	LPCTSTR pszEvent,
+	INT nCurrent,
+	double dMBps,
+	double dSpeed,
+	INT nEta
+) {
+	if (!s_fpProgressEvent) {
+		return;
+	}
+	_ftprintf(s_fpProgressEvent, _T("{\"event\":\"%s\",\"label\":\""), pszEvent);
+	for (LPCTSTR p = g_Progress.szLabel; *p; p++) {
+		if (*p == _T('"') || *p == _T('\\')) {
+			_fputtc(_T('\\'), s_fpProgressEvent);
+		}
+		_fputtc(*p, s_fpProgressEvent);
+	}
+	_ftprintf(s_fpProgressEvent,
+		_T("\",\"unit\":\"%s\",\"start\":%d,\"end\":%d,\"current\":%d,\"elapsed\":%lu")
+		_T(",\"mbps\":%.2f,\"speed\":%.2f,\"eta\":%d,\"zone\":%d,\"error\":%d}\n")
+		, g_Progress.szUnit, g_Progress.nStart, g_Progress.nEnd, nCurrent
+		, (GetTickCount() - g_Progress.dwStartTick) / 1000, dMBps, dSpeed, nEta
+		, g_Progress.nZone, g_Progress.nErrorCnt);
+	fflush(s_fpProgressEvent);
+}
+
+VOID OutputProgressString(
+	BOOL bLast
+) {
+	INT nCurrent = g_Progress.nCurrent;
+	DWORD dwTick = GetTickCount();
+	DWORD dwDiff = dwTick - g_Progress.dwPrevTick;
+
+	if (dwDiff > 0) {
+		// smoothing the rate, because the drive speed swings by the seek, reread etc.
+		double dRate = abs(nCurrent - g_Progress.nPrevCurrent) * 1000.0 / dwDiff;
+		if (g_Progress.uiTick == 0) {
+			g_Progress.dRate = dRate;
+		}
+		else {
+			g_Progress.dRate = g_Progress.dRate * 0.8 + dRate * 0.2;
+		}
+		g_Progress.dwPrevTick = dwTick;
+		g_Progress.nPrevCurrent = nCurrent;
+	}
+	double dMBps = g_Progress.dRate * g_Progress.dwUnitSize / (1024 * 1024);
+	double dSpeed = 0;
+	if (g_Progress.dwSpeedBase) {
+		dSpeed = g_Progress.dRate * g_Progress.dwUnitSize / g_Progress.dwSpeedBase;
+	}
+	INT nEta = -1;
+	INT nRemain = abs(g_Progress.nEnd - nCurrent);
+	if (g_Progress.dRate >= 1) {
+		nEta = (INT)(nRemain / g_Progress.dRate);
+	}
+
+	_TCHAR szBuf[256] = { 0 };
+	INT nLen = _sntprintf(szBuf, sizeof(szBuf) / sizeof(szBuf[0]) - 1
+		, _T("\r%s (%s) %6d/%6d"), g_Progress.szLabel, g_Progress.szUnit, nCurrent, g_Progress.nEnd);
+	if (0 < nLen && g_Progress.dwUnitSize) {
+		nLen += _sntprintf(szBuf + nLen, sizeof(szBuf) / sizeof(szBuf[0]) - 1 - nLen
+			, _T(" %6.2fMB/s"), dMBps);
+	}
+	if (0 < nLen && g_Progress.dwSpeedBase) {
+		nLen += _sntprintf(szBuf + nLen, sizeof(szBuf) / sizeof(szBuf[0]) - 1 - nLen
+			, _T(" %5.1fx"), dSpeed);
+	}
+	if (0 < nLen && !bLast && nEta >= 0) {
+		nLen += _sntprintf(szBuf + nLen, sizeof(szBuf) / sizeof(szBuf[0]) - 1 - nLen
+			, _T(" ETA %02d:%02d:%02d"), nEta / 3600, nEta / 60 % 60, nEta % 60);
+	}
+	if (0 < nLen && g_Progress.nZone) {
+		nLen += _sntprintf(szBuf + nLen, sizeof(szBuf) / sizeof(szBuf[0]) - 1 - nLen
+			, _T(" Track %02d"), g_Progress.nZone);
+	}
+	if (0 < nLen && g_Progress.nErrorCnt) {
+		nLen += _sntprintf(szBuf + nLen, sizeof(szBuf) / sizeof(szBuf[0]) - 1 - nLen
+			, _T(" Error %d"), g_Progress.nErrorCnt);
+	}
+	// overwrite the remain of the previous line
+	if (0 < nLen) {
+		_sntprintf(szBuf + nLen, sizeof(szBuf) / sizeof(szBuf[0]) - 1 - nLen, _T("%8s"), _T(""));
+	}
+	OutputString(_T("%s"), szBuf);
+
+	if (bLast) {
+		OutputProgressEventString(_T("end"), nCurrent, dMBps, dSpeed, 0);
+	}
+	else if (g_Progress.uiTick % PROGRESS_EVENT_INTERVAL == 0) {
+		OutputProgressEventString(_T("progress"), nCurrent, dMBps, dSpeed, nEta);
+	}
+	g_Progress.uiTick++;
+}
+
+DWORD WINAPI ProgressThreadProc(
+	LPVOID lpParam
+) {
+	UNREFERENCED_PARAMETER(lpParam);
+	while (WaitForSingleObject(s_hProgressStopEvent, PROGRESS_REDRAW_MS) == WAIT_TIMEOUT) {
+		OutputProgressString(FALSE);
+	}
+	return 0;
+}
+
+VOID StartProgress(
+	LPCTSTR pszLabel,
+	LPCTSTR pszUnit,
+	INT nStart,
+	INT nEnd,
+	DWORD dwUnitSize,
+	DWORD dwSpeedBase
+) {
+	EndProgress();
+	_tcsncpy(g_Progress.szLabel, pszLabel, sizeof(g_Progress.szLabel) / sizeof(g_Progress.szLabel[0]) - 1);
+	_tcsncpy(g_Progress.szUnit, pszUnit, sizeof(g_Progress.szUnit) / sizeof(g_Progress.szUnit[0]) - 1);
+	g_Progress.nCurrent = nStart;
+	g_Progress.nZone = 0;
+	g_Progress.nErrorCnt = 0;
+	g_Progress.nStart = nStart;
+	g_Progress.nEnd = nEnd;
+	g_Progress.dwUnitSize = dwUnitSize;
+	g_Progress.dwSpeedBase = dwSpeedBase;
+	g_Progress.dwStartTick = GetTickCount();
+	g_Progress.dwPrevTick = g_Progress.dwStartTick;
+	g_Progress.nPrevCurrent = nStart;
+	g_Progress.dRate = 0;
+	g_Progress.uiTick = 0;
+	g_Progress.bActive = TRUE;
+	OutputProgressEventString(_T("start"), nStart, 0, 0, -1);
+
+	if (NULL == (s_hProgressStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL))) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return;
+	}
+	// if it fails, the progress is output only when EndProgress is called
+	if (NULL == (s_hProgressThread = CreateThread(NULL, 0, ProgressThreadProc, NULL, 0, NULL))) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		CloseHandle(s_hProgressStopEvent);
+		s_hProgressStopEvent = NULL;
+	}
+}
+
+VOID EndProgress(
+	VOID
+) {
+	if (!g_Progress.bActive) {
+		return;
+	}
+	if (s_hProgressThread) {
+		SetEvent(s_hProgressStopEvent);
+		WaitForSingleObject(s_hProgressThread, INFINITE);
+		CloseHandle(s_hProgressThread);
+		s_hProgressThread = NULL;
+		CloseHandle(s_hProgressStopEvent);
+		s_hProgressStopEvent = NULL;
+	}
+	OutputProgressString(TRUE);
+	OutputString(_T("\n"));
+	g_Progress.bActive = FALSE;
+}
+
+BOOL InitProgressEvent(
+	LPCTSTR pszFullPath
+) {
+	if (NULL == (s_fpProgressEvent = CreateOrOpenFile(
+		pszFullPath, _T("_progress"), NULL, NULL, NULL, _T(".jsonl"), _T(WFLAG), 0, 0))) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+VOID TerminateProgressEvent(
+	VOID
+) {
+	EndProgress();
+	FcloseAndNull(s_fpProgressEvent);
+}
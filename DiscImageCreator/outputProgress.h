@@ -0,0 +1,61 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// The loop only stores the counter, and the progress thread redraws the console
+#define PROGRESS_REDRAW_MS			100
+#define PROGRESS_EVENT_INTERVAL		10
+// bytes per second of 1x
+#define PROGRESS_SPEED_CD			(75 * CD_RAW_SECTOR_SIZE)
+#define PROGRESS_SPEED_DVD			1385000
+#define PROGRESS_SPEED_BD			4495500
+
+// These global variable is set at outputProgress.cpp
+extern PROGRESS g_Progress;
+
+#define SetProgress(n)			(g_Progress.nCurrent = (n))
+#define SetProgressZone(n)		(g_Progress.nZone = (n))
+#define SetProgressError(n)		(g_Progress.nErrorCnt = (n))
+
+VOID LockConsoleOutput(
+	VOID
+);
+
+VOID UnlockConsoleOutput(
+	VOID
+);
+
+VOID StartProgress(
+	LPCTSTR pszLabel,
+	LPCTSTR pszUnit,
+	INT nStart,
+	INT nEnd,
+	DWORD dwUnitSize,
+	DWORD dwSpeedBase
+);
+
+VOID EndProgress(
+	VOID
+);
+
+BOOL InitProgressEvent(
+	LPCTSTR pszFullPath
+);
+
+VOID TerminateProgressEvent(
+	VOID
+);
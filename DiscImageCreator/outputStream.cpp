@@ -0,0 +1,332 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "output.h"
+#include "outputStream.h"
+#include "sparseFile.h"
+
+// The dump writes .scm, .sub and .c2 by turns per sector. Each attached file
+// has its own large buffers instead, and they are written by the thread of the
+// file, so the disk gets a few large writes per file while the drive reads.
+// The files which aren't attached are written by fwrite as before.
+static POUTPUT_STREAM s_pOutputStream[OUTPUT_STREAM_MAX];
+
+static POUTPUT_STREAM GetOutputStream(
+	FILE* fp
+) {
+	if (fp) {
+		for (INT i = 0; i < OUTPUT_STREAM_MAX; i++) {
+			if (s_pOutputStream[i] && s_pOutputStream[i]->fp == fp) {
+				return s_pOutputStream[i];
+			}
+		}
+	}
+	return NULL;
+}
+
+// The position is given by OVERLAPPED, so the handle is shared with the stdio
+static BOOL WriteOutputStreamBuffer(
+	HANDLE hFile,
+	LPBYTE lpBuf,
+	DWORD dwSize,
+	INT64 llPos
+) {
+	OVERLAPPED ov = { 0 };
+	ov.Offset = (DWORD)llPos;
+	ov.OffsetHigh = (DWORD)(llPos >> 32);
+	DWORD dwWritten = 0;
+	return WriteFile(hFile, lpBuf, dwSize, &dwWritten, &ov) && dwWritten == dwSize;
+}
+
+// If bySparse, the zero up to each boundary of SPARSE_BLOCK_SIZE in the file is
+// skipped as WriteSparseFile does, and the rest is written by the runs between
+// them. The runs start and end at the boundary or at the end of the buffer, so
+// they keep the alignment of FILE_FLAG_NO_BUFFERING.
+static BOOL WriteOutputStreamRange(
+	POUTPUT_STREAM pStream,
+	HANDLE hFile,
+	LPBYTE lpBuf,
+	DWORD dwSize,
+	INT64 llPos
+) {
+	if (!pStream->bySparse) {
+		return WriteOutputStreamBuffer(hFile, lpBuf, dwSize, llPos);
+	}
+	DWORD dwOfs = 0;
+	DWORD dwRun = 0;
+	while (dwOfs < dwSize) {
+		DWORD dwLen = SPARSE_BLOCK_SIZE - (DWORD)((llPos + dwOfs) % SPARSE_BLOCK_SIZE);
+		if (dwLen > dwSize - dwOfs) {
+			dwLen = dwSize - dwOfs;
+		}
+		if (IsZeroBlock(lpBuf + dwOfs, dwLen)) {
+			if (dwRun && !WriteOutputStreamBuffer(hFile
+				, lpBuf + dwOfs - dwRun, dwRun, llPos + dwOfs - dwRun)) {
+				return FALSE;
+			}
+			dwRun = 0;
+			pStream->ullSparseBytes += dwLen;
+		}
+		else {
+			dwRun += dwLen;
+		}
+		dwOfs += dwLen;
+	}
+	return !dwRun ||
+		WriteOutputStreamBuffer(hFile, lpBuf + dwSize - dwRun, dwRun, llPos + dwSize - dwRun);
+}
+
+DWORD WINAPI OutputStreamThreadProc(
+	LPVOID lpParam
+) {
+	POUTPUT_STREAM pStream = (POUTPUT_STREAM)lpParam;
+	for (;;) {
+		WaitForSingleObject(pStream->hRequest, INFINITE);
+		if (pStream->byTerminate) {
+			break;
+		}
+		LARGE_INTEGER llStart = { 0 };
+		LARGE_INTEGER llEnd = { 0 };
+		QueryPerformanceCounter(&llStart);
+		if (!pStream->lError && !WriteOutputStreamRange(pStream, pStream->hWrite
+			, pStream->lpBuf[pStream->nFlush], pStream->dwFlushSize, pStream->llFlushPos)) {
+			InterlockedExchange(&pStream->lError, TRUE);
+		}
+		QueryPerformanceCounter(&llEnd);
+		pStream->dWriteMs += (double)(llEnd.QuadPart - llStart.QuadPart) * 1000 / pStream->llFreq.QuadPart;
+		SetEvent(pStream->hDone);
+	}
+	return 0;
+}
+
+static VOID TerminateOutputStream(
+	POUTPUT_STREAM pStream
+) {
+	if (pStream->hThread) {
+		pStream->byTerminate = TRUE;
+		SetEvent(pStream->hRequest);
+		WaitForSingleObject(pStream->hThread, INFINITE);
+		CloseHandle(pStream->hThread);
+	}
+	if (pStream->hDone) {
+		CloseHandle(pStream->hDone);
+	}
+	if (pStream->hRequest) {
+		CloseHandle(pStream->hRequest);
+	}
+	if (pStream->hWrite != pStream->hFile) {
+		CloseHandle(pStream->hWrite);
+	}
+	if (pStream->lpBuf[0]) {
+		VirtualFree(pStream->lpBuf[0], 0, MEM_RELEASE);
+	}
+	FreeAndNull(pStream);
+}
+
+// Writes the data of fp buffered by the stdio, and the stream continues from
+// the position. If bNoBuffering, the buffers are written without the cache of
+// the system (FILE_FLAG_NO_BUFFERING) if the position is aligned. If bSparse,
+// the blocks of zero are left as the holes if the file system supports sparse
+// files, so fp must have nothing after the position (see WriteSparseFile).
+BOOL AttachOutputStream(
+	FILE* fp,
+	BOOL bNoBuffering,
+	BOOL bSparse
+) {
+	if (!fp || GetOutputStream(fp)) {
+		return TRUE;
+	}
+	INT nIdx = 0;
+	for (; nIdx < OUTPUT_STREAM_MAX && s_pOutputStream[nIdx]; nIdx++);
+	if (nIdx == OUTPUT_STREAM_MAX) {
+		OutputErrorString(_T("Too many output streams\n"));
+		return FALSE;
+	}
+	POUTPUT_STREAM pStream = NULL;
+	try {
+		INT64 llPos = 0;
+		if (fflush(fp) || (llPos = _ftelli64(fp)) < 0) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		if (NULL == (pStream = (POUTPUT_STREAM)calloc(1, sizeof(OUTPUT_STREAM)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		pStream->fp = fp;
+		pStream->hFile = (HANDLE)_get_osfhandle(_fileno(fp));
+		pStream->hWrite = pStream->hFile;
+		pStream->dwBufSize = OUTPUT_STREAM_BUF_SIZE;
+		pStream->llPos = llPos;
+		pStream->bySparse = (BYTE)(bSparse && SetSparseFile(fp));
+		// the page is aligned to any sector size
+		if (NULL == (pStream->lpBuf[0] = (LPBYTE)VirtualAlloc(NULL
+			, (SIZE_T)OUTPUT_STREAM_BUF_SIZE * 2, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		pStream->lpBuf[1] = pStream->lpBuf[0] + OUTPUT_STREAM_BUF_SIZE;
+		if (bNoBuffering) {
+			HANDLE hWrite = INVALID_HANDLE_VALUE;
+			if (llPos % OUTPUT_STREAM_ALIGNMENT == 0) {
+				hWrite = ReOpenFile(pStream->hFile, GENERIC_WRITE
+					, FILE_SHARE_READ | FILE_SHARE_WRITE, FILE_FLAG_NO_BUFFERING);
+			}
+			if (hWrite == INVALID_HANDLE_VALUE) {
+				OutputString(_T("The file can't be written without the cache. Written as usual\n"));
+			}
+			else {
+				pStream->hWrite = hWrite;
+			}
+		}
+		// hDone is set because no buffer is being written yet
+		if (NULL == (pStream->hRequest = CreateEvent(NULL, FALSE, FALSE, NULL)) ||
+			NULL == (pStream->hDone = CreateEvent(NULL, FALSE, TRUE, NULL))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		QueryPerformanceFrequency(&pStream->llFreq);
+		QueryPerformanceCounter(&pStream->llStart);
+		if (NULL == (pStream->hThread = CreateThread(NULL, 0, OutputStreamThreadProc, pStream, 0, NULL))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+	}
+	catch (BOOL ret) {
+		if (pStream) {
+			TerminateOutputStream(pStream);
+		}
+		return ret;
+	}
+	s_pOutputStream[nIdx] = pStream;
+	return TRUE;
+}
+
+// Hands the filled buffer to the thread, and waits until the thread writes
+// the former one. The time of waiting is the time that the output stalled.
+static BOOL FlushOutputStream(
+	POUTPUT_STREAM pStream
+) {
+	LARGE_INTEGER llStart = { 0 };
+	LARGE_INTEGER llEnd = { 0 };
+	QueryPerformanceCounter(&llStart);
+	WaitForSingleObject(pStream->hDone, INFINITE);
+	QueryPerformanceCounter(&llEnd);
+	pStream->dStallMs += (double)(llEnd.QuadPart - llStart.QuadPart) * 1000 / pStream->llFreq.QuadPart;
+	if (pStream->lError) {
+		// no buffer is handed, so the thread is still idle
+		SetEvent(pStream->hDone);
+		return FALSE;
+	}
+	pStream->nFlush = pStream->nCur;
+	pStream->dwFlushSize = pStream->dwFilled;
+	pStream->llFlushPos = pStream->llPos;
+	pStream->llPos += pStream->dwFilled;
+	pStream->ullBytes += pStream->dwFilled;
+	pStream->nCur ^= 1;
+	pStream->dwFilled = 0;
+	SetEvent(pStream->hRequest);
+	return TRUE;
+}
+
+// All the writers of the dump use this instead of fwrite. It's the same as
+// fwrite if fp isn't attached.
+BOOL WriteOutputFile(
+	FILE* fp,
+	LPCVOID lpBuf,
+	size_t size
+) {
+	POUTPUT_STREAM pStream = GetOutputStream(fp);
+	if (!pStream) {
+		return fwrite(lpBuf, sizeof(BYTE), size, fp) == size;
+	}
+	LPBYTE lpSrc = (LPBYTE)lpBuf;
+	while (size) {
+		DWORD dwLen = pStream->dwBufSize - pStream->dwFilled;
+		if (dwLen > size) {
+			dwLen = (DWORD)size;
+		}
+		memcpy(pStream->lpBuf[pStream->nCur] + pStream->dwFilled, lpSrc, dwLen);
+		pStream->dwFilled += dwLen;
+		lpSrc += dwLen;
+		size -= dwLen;
+		if (pStream->dwFilled == pStream->dwBufSize && !FlushOutputStream(pStream)) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+// Writes the rest of the buffers, flushes the file to the disk and reports
+// the throughput. The stdio of fp continues from the end of the stream.
+BOOL DetachOutputStream(
+	FILE* fp,
+	LPCSTR pszName
+) {
+	POUTPUT_STREAM pStream = GetOutputStream(fp);
+	if (!pStream) {
+		return TRUE;
+	}
+	for (INT i = 0; i < OUTPUT_STREAM_MAX; i++) {
+		if (s_pOutputStream[i] == pStream) {
+			s_pOutputStream[i] = NULL;
+		}
+	}
+	WaitForSingleObject(pStream->hDone, INFINITE);
+	BOOL bRet = !pStream->lError;
+	// the last buffer isn't a multiple of the sector, so it's written with the cache
+	if (bRet && pStream->dwFilled) {
+		LARGE_INTEGER llStart = { 0 };
+		LARGE_INTEGER llEnd = { 0 };
+		QueryPerformanceCounter(&llStart);
+		bRet = WriteOutputStreamRange(pStream, pStream->hFile
+			, pStream->lpBuf[pStream->nCur], pStream->dwFilled, pStream->llPos);
+		QueryPerformanceCounter(&llEnd);
+		pStream->dWriteMs += (double)(llEnd.QuadPart - llStart.QuadPart) * 1000 / pStream->llFreq.QuadPart;
+		pStream->llPos += pStream->dwFilled;
+		pStream->ullBytes += pStream->dwFilled;
+	}
+	if (bRet && _fseeki64(fp, pStream->llPos, SEEK_SET)) {
+		bRet = FALSE;
+	}
+	// the skipped blocks at the end aren't in the file yet
+	if (bRet && pStream->bySparse && !TerminateSparseFile(fp)) {
+		bRet = FALSE;
+	}
+	if (bRet && !FlushFileBuffers(pStream->hFile)) {
+		bRet = FALSE;
+	}
+	if (bRet) {
+		LARGE_INTEGER llEnd = { 0 };
+		QueryPerformanceCounter(&llEnd);
+		double dMs = (double)(llEnd.QuadPart - pStream->llStart.QuadPart) * 1000 / pStream->llFreq.QuadPart;
+		OutputDiscLogA(
+			"\t%s: Wrote %llu bytes in %.0f ms (%.2f MB/s%s), waited for the output %.0f ms\n"
+			, pszName, pStream->ullBytes, dMs
+			, pStream->dWriteMs > 0 ? pStream->ullBytes / 1048576.0 * 1000 / pStream->dWriteMs : 0
+			, pStream->hWrite != pStream->hFile ? ", no buffering" : "", pStream->dStallMs);
+		if (pStream->bySparse) {
+			OutputDiscLogA("\t%s: %llu bytes of zero are left as the holes\n"
+				, pszName, pStream->ullSparseBytes);
+		}
+	}
+	else {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		OutputErrorStringA("Failed to write %s\n", pszName);
+	}
+	TerminateOutputStream(pStream);
+	return bRet;
+}
@@ -0,0 +1,41 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// the size of each of the two buffers of a stream
+#define OUTPUT_STREAM_BUF_SIZE		(2 * 1024 * 1024)
+// FILE_FLAG_NO_BUFFERING needs the position aligned to the sector of the disk
+#define OUTPUT_STREAM_ALIGNMENT		(4096)
+// the files which are attached at once
+#define OUTPUT_STREAM_MAX			(8)
+
+BOOL AttachOutputStream(
+	FILE* fp,
+	BOOL bNoBuffering,
+	BOOL bSparse
+);
+
+BOOL WriteOutputFile(
+	FILE* fp,
+	LPCVOID lpBuf,
+	size_t size
+);
+
+BOOL DetachOutputStream(
+	FILE* fp,
+	LPCSTR pszName
+);
@@ -0,0 +1,287 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "execScsiCmdforDVD.h"
+#include "rawCacheStrategy.h"
+
+// the reread of the ring backs off further at the 2nd, 4th, 7th, 11th ... 29th
+#define RAW_CACHE_REWIND_STEP_NUM	(7)
+
+static VOID SetRawCacheCmdLength(
+	PRAW_CACHE_STRATEGY pStrategy
+) {
+	DWORD dwSize = DVD_RAW_READ * pStrategy->dwTransferLen;
+	if (pStrategy->lpCmd[0] == 0xE7) {
+		pStrategy->lpCmd[10] = HIBYTE(LOWORD(dwSize));
+		pStrategy->lpCmd[11] = LOBYTE(LOWORD(dwSize));
+	}
+	else {
+		pStrategy->lpCmd[6] = LOBYTE(HIWORD(dwSize));
+		pStrategy->lpCmd[7] = HIBYTE(LOWORD(dwSize));
+		pStrategy->lpCmd[8] = LOBYTE(LOWORD(dwSize));
+	}
+	if (pStrategy->nCmdType == RAW_CACHE_CMD_RING) {
+		// the first block advances the address to the start of the ring
+		pStrategy->dwBaseAddr = RAW_CACHE_RING_START_ADDR - DVD_RAW_READ * pStrategy->dwTransferLen;
+	}
+}
+
+// Each chipset dumps the disc data from its cache in its own way. The strategy
+// holds the geometry of the cache (the command, the address, the sectors
+// stored at a time and the blocks dumped at a time) and the retry policy, and
+// the values measured by TuneRawCacheStrategy on the former dump of this drive
+// override the defaults. This doesn't issue any command, so the strategies can
+// be checked against the simulated chipset of DiscImageCreatorTest.
+VOID InitRawCacheStrategy(
+	PDEVICE pDevice,
+	INT nDriveSampleOffset,
+	PRAW_CACHE_STRATEGY pStrategy
+) {
+	ZeroMemory(pStrategy, sizeof(RAW_CACHE_STRATEGY));
+	pStrategy->nCmdType = RAW_CACHE_CMD_FIXED;
+	pStrategy->dwBaseAddr = RAW_CACHE_RING_START_ADDR;
+	pStrategy->dwTransferLenDefault = 16;
+	pStrategy->nMemBlkSize = 1;
+	pStrategy->nRereadMax = RAW_CACHE_REREAD_MAX;
+	pStrategy->dwErrorWait = RAW_CACHE_ERROR_WAIT;
+	pStrategy->byCdbLength = CDB10GENERIC_LENGTH;
+	LPBYTE lpCmd = pStrategy->lpCmd;
+	// Panasonic MN103S chip
+	if (nDriveSampleOffset == 102) {
+		if (IsSupported0xE7(pDevice)) {
+			if (IsSupported0xE7Type1(pDevice)) {
+				// address which disc data is cached
+				// a08000 - a0ffff (8000), a13000 - a1ffff (d000), a23000 - a2ffff (d000)
+				// a48000 - a4ffff (8000), a53000 - a5ffff (d000), a63000 - a6ffff (d000)
+				// a88000 - a8ffff (8000), a93000 - a9ffff (d000), aa3000 - aaffff (d000)
+				// ac8000 - acffff (8000), ad3000 - adffff (d000), ae3000 - aeffff (d000)
+				// b08000 - b0ffff (8000), b13000 - b1ffff (d000), b23000 - b2ffff (d000)
+				//  :
+				pStrategy->szName = "MN103S 0xE7 Type1";
+				pStrategy->dwBaseAddr = 0xa13000;
+				pStrategy->nFlushLBAMin = 16;
+				pStrategy->byFlushAlways = TRUE;
+			}
+			else if (IsSupported0xE7Type2(pDevice)) {
+				pStrategy->szName = "MN103S 0xE7 Type2";
+				pStrategy->dwTransferLenDefault = 8;
+				pStrategy->dwTransferLenMin = 1;
+				pStrategy->nCmdType = RAW_CACHE_CMD_RING;
+				pStrategy->byFlushAlways = TRUE;
+			}
+			else if (IsSupported0xE7Type3(pDevice)) {
+				pStrategy->szName = "MN103S 0xE7 Type3";
+				pStrategy->nMemBlkSize = 5;
+				pStrategy->byFlushAlways = TRUE;
+			}
+			else {
+				pStrategy->szName = "MN103S 0xE7 Type4";
+				pStrategy->nMemBlkSize = 5;
+			}
+			lpCmd[0] = 0xE7; // vendor specific command
+			lpCmd[1] = 0x48; // H
+			lpCmd[2] = 0x49; // I
+			lpCmd[3] = 0x54; // T
+			lpCmd[4] = 0x01; // read MCU memory sub-command
+			pStrategy->byCdbLength = CDB12GENERIC_LENGTH;
+		}
+		else {
+			pStrategy->szName = "MN103S READ DATA BUFFER";
+			lpCmd[0] = SCSIOP_READ_DATA_BUFF;
+			lpCmd[1] = 0x01;
+			pStrategy->nCmdType = RAW_CACHE_CMD_OFFSET;
+		}
+	}
+	// Renesas chip
+	else if (nDriveSampleOffset == 667) {
+		pStrategy->szName = "Renesas READ DATA BUFFER";
+		pStrategy->dwTransferLenDefault = 1;
+		lpCmd[0] = SCSIOP_READ_DATA_BUFF;
+		lpCmd[1] = 0x05;
+//		lpCmd[9] = 0x44;
+		pStrategy->nCmdType = RAW_CACHE_CMD_OFFSET_NO_REWIND;
+	}
+	// Mediatek MT chip
+	else if (nDriveSampleOffset == 6) {
+		pStrategy->szName = "MediaTek READ DATA BUFFER";
+		pStrategy->dwTransferLenDefault = 1;
+		lpCmd[0] = SCSIOP_READ_DATA_BUFF;
+		lpCmd[1] = 0x01;
+		lpCmd[2] = 0x01;
+	}
+	// Plextor etc.
+	else {
+		pStrategy->szName = "READ DATA BUFFER";
+		lpCmd[0] = SCSIOP_READ_DATA_BUFF;
+		lpCmd[1] = 0x02;
+	}
+	if (pStrategy->dwTransferLenMin == 0) {
+		pStrategy->dwTransferLenMin = pStrategy->dwTransferLenDefault;
+	}
+	pStrategy->dwTransferLen = pStrategy->dwTransferLenDefault;
+	SetRawCacheCmdLength(pStrategy);
+
+	_DEVICE::_PROFILE* pProfile = &pDevice->PROFILE;
+	if (pProfile->dwRawTransferLen != 0) {
+		SetRawCacheTransferLen(pStrategy, pProfile->dwRawTransferLen);
+	}
+	if (RAW_CACHE_REREAD_MAX < pProfile->nRawRereadMax &&
+		pProfile->nRawRereadMax <= RAW_CACHE_REREAD_LIMIT) {
+		pStrategy->nRereadMax = pProfile->nRawRereadMax;
+	}
+}
+
+// Returns FALSE if dwTransferLen isn't supported by the chipset or is already set
+BOOL SetRawCacheTransferLen(
+	PRAW_CACHE_STRATEGY pStrategy,
+	DWORD dwTransferLen
+) {
+	if (dwTransferLen < pStrategy->dwTransferLenMin ||
+		pStrategy->dwTransferLenDefault < dwTransferLen ||
+		dwTransferLen == pStrategy->dwTransferLen) {
+		return FALSE;
+	}
+	pStrategy->dwTransferLen = dwTransferLen;
+	SetRawCacheCmdLength(pStrategy);
+	return TRUE;
+}
+
+VOID SetRawCacheAddress(
+	PRAW_CACHE_STRATEGY pStrategy,
+	INT nLBA,
+	INT nBlk,
+	INT nRereadNum
+) {
+	LPBYTE lpCmd = pStrategy->lpCmd;
+	if (pStrategy->nCmdType == RAW_CACHE_CMD_FIXED) {
+		DWORD dwAddr = pStrategy->dwBaseAddr + (DWORD)nBlk * pStrategy->dwTransferLen * DVD_RAW_READ;
+		lpCmd[6] = HIBYTE(HIWORD(dwAddr));
+		lpCmd[7] = LOBYTE(HIWORD(dwAddr));
+		lpCmd[8] = HIBYTE(LOWORD(dwAddr));
+		lpCmd[9] = LOBYTE(LOWORD(dwAddr));
+	}
+	else if (pStrategy->nCmdType == RAW_CACHE_CMD_RING) {
+		if (nRereadNum == 0) {
+			pStrategy->dwBaseAddr += DVD_RAW_READ * pStrategy->dwTransferLen;
+			if (pStrategy->dwBaseAddr == RAW_CACHE_RING_END_ADDR) {
+				pStrategy->dwBaseAddr = RAW_CACHE_RING_START_ADDR;
+			}
+		}
+		lpCmd[6] = HIBYTE(HIWORD(pStrategy->dwBaseAddr));
+		lpCmd[7] = LOBYTE(HIWORD(pStrategy->dwBaseAddr));
+		lpCmd[8] = HIBYTE(LOWORD(pStrategy->dwBaseAddr));
+		lpCmd[9] = LOBYTE(LOWORD(pStrategy->dwBaseAddr));
+	}
+	else {
+		INT n = nLBA % RAW_CACHE_SECTOR_NUM;
+		lpCmd[3] = LOBYTE(HIWORD(n * DVD_RAW_READ));
+		lpCmd[4] = HIBYTE(LOWORD(n * DVD_RAW_READ));
+		lpCmd[5] = LOBYTE(LOWORD(n * DVD_RAW_READ));
+	}
+}
+
+// The LBA read before the reread to push the sectors out of the cache
+INT GetRawCacheFlushLBA(
+	PRAW_CACHE_STRATEGY pStrategy,
+	INT nLBA,
+	INT nTransferAndMemSize
+) {
+	INT nFlushLBA = nLBA - nTransferAndMemSize;
+	if (nFlushLBA < 0) {
+		nFlushLBA = pStrategy->nFlushLBAMin;
+	}
+	return nFlushLBA;
+}
+
+// Returns the LBA before the next block to reread. nSectorDiff is the got
+// sector num minus the expected one, positive if the drive read ahead.
+INT GetRawCacheRereadLBA(
+	PRAW_CACHE_STRATEGY pStrategy,
+	INT nLBA,
+	INT nTransferAndMemSize,
+	INT nRereadNum,
+	INT nSectorDiff
+) {
+	// not clamped unlike the flush, otherwise the first block is skipped
+	INT nPrevLBA = nLBA - nTransferAndMemSize;
+	if (pStrategy->nCmdType == RAW_CACHE_CMD_FIXED) {
+		return nPrevLBA;
+	}
+	else if (pStrategy->nCmdType == RAW_CACHE_CMD_RING) {
+		if (pStrategy->dwTransferLen < pStrategy->dwTransferLenDefault) {
+			return nSectorDiff > 0 ? nLBA - 2 : nPrevLBA + 1;
+		}
+		if (nRereadNum == 1) {
+			return nPrevLBA;
+		}
+		for (INT k = 1; k <= RAW_CACHE_REWIND_STEP_NUM; k++) {
+			if (nRereadNum == 1 + k * (k + 1) / 2) {
+				return nLBA - (INT)pStrategy->dwTransferLen * (k + 1);
+			}
+		}
+	}
+	else if (pStrategy->nCmdType == RAW_CACHE_CMD_OFFSET) {
+		if (nSectorDiff > 0) {
+			return nLBA - 32;
+		}
+	}
+	return nLBA;
+}
+
+// dwFirstTransferLen is the transfer length which dumped the first block of
+// this dump (0 if none), and nRereadPeak is the most rereads of a block in
+// this dump. The transfer length is learned from the first block only. If the
+// larger block didn't dump even the first one, this drive can't use it, so the
+// next dump starts at the smaller one instead of falling back after the max of
+// the reread. A fallback on the way means the disc is bad there, so it isn't
+// learned. If the learned smaller one dumped without any reread, the next dump
+// tries the larger one again. The max of the reread is doubled if the dump
+// gave up, and halved back to RAW_CACHE_REREAD_MAX while the dump needs less
+// than half of it. Returns TRUE if the profile is changed, then the caller
+// saves it. Delete the keys of driveProfile.ini to measure them again.
+BOOL TuneRawCacheStrategy(
+	PDEVICE pDevice,
+	PRAW_CACHE_STRATEGY pStrategy,
+	DWORD dwFirstTransferLen,
+	INT nRereadPeak,
+	BOOL bMaxReread
+) {
+	_DEVICE::_PROFILE* pProfile = &pDevice->PROFILE;
+	DWORD dwTransferLen = pProfile->dwRawTransferLen;
+	if (dwFirstTransferLen != 0) {
+		dwTransferLen = dwFirstTransferLen;
+		if (dwFirstTransferLen == pProfile->dwRawTransferLen &&
+			dwFirstTransferLen < pStrategy->dwTransferLenDefault &&
+			!bMaxReread && nRereadPeak == 0) {
+			dwTransferLen = pStrategy->dwTransferLenDefault;
+		}
+	}
+	INT nRereadMax = pProfile->nRawRereadMax;
+	if (bMaxReread) {
+		nRereadMax = min(pStrategy->nRereadMax * 2, RAW_CACHE_REREAD_LIMIT);
+	}
+	else if (RAW_CACHE_REREAD_MAX < pStrategy->nRereadMax &&
+		nRereadPeak < pStrategy->nRereadMax / 2) {
+		nRereadMax = max(pStrategy->nRereadMax / 2, RAW_CACHE_REREAD_MAX);
+	}
+	if (pProfile->dwRawTransferLen == dwTransferLen &&
+		pProfile->nRawRereadMax == nRereadMax) {
+		return FALSE;
+	}
+	pProfile->dwRawTransferLen = dwTransferLen;
+	pProfile->nRawRereadMax = nRereadMax;
+	return TRUE;
+}
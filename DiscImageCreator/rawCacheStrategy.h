@@ -0,0 +1,73 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// how the address of the cache memory is set to the command
+#define RAW_CACHE_CMD_FIXED				(0) // each block is cached at the fixed address
+#define RAW_CACHE_CMD_RING				(1) // the blocks are cached in turn in the ring
+#define RAW_CACHE_CMD_OFFSET			(2) // the offset of the LBA in the cache, rewinds if the drive read ahead
+#define RAW_CACHE_CMD_OFFSET_NO_REWIND	(3)
+
+#define RAW_CACHE_RING_START_ADDR	(0x80000000)
+#define RAW_CACHE_RING_END_ADDR		(0x80008100)
+// the sectors which the cache of READ DATA BUFFER holds
+#define RAW_CACHE_SECTOR_NUM		(688)
+
+#define RAW_CACHE_REREAD_MAX		(40)
+// the tuner doesn't raise the max beyond this
+#define RAW_CACHE_REREAD_LIMIT		(160)
+#define RAW_CACHE_ERROR_WAIT		(10000)
+
+VOID InitRawCacheStrategy(
+	PDEVICE pDevice,
+	INT nDriveSampleOffset,
+	PRAW_CACHE_STRATEGY pStrategy
+);
+
+BOOL SetRawCacheTransferLen(
+	PRAW_CACHE_STRATEGY pStrategy,
+	DWORD dwTransferLen
+);
+
+VOID SetRawCacheAddress(
+	PRAW_CACHE_STRATEGY pStrategy,
+	INT nLBA,
+	INT nBlk,
+	INT nRereadNum
+);
+
+INT GetRawCacheFlushLBA(
+	PRAW_CACHE_STRATEGY pStrategy,
+	INT nLBA,
+	INT nTransferAndMemSize
+);
+
+INT GetRawCacheRereadLBA(
+	PRAW_CACHE_STRATEGY pStrategy,
+	INT nLBA,
+	INT nTransferAndMemSize,
+	INT nRereadNum,
+	INT nSectorDiff
+);
+
+BOOL TuneRawCacheStrategy(
+	PDEVICE pDevice,
+	PRAW_CACHE_STRATEGY pStrategy,
+	DWORD dwFirstTransferLen,
+	INT nRereadPeak,
+	BOOL bMaxReread
+);
@@ -0,0 +1,288 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "convert.h"
+#include "execImage.h"
+#include "execIoctl.h"
+#include "get.h"
+#include "output.h"
+#include "outputStream.h"
+#include "readQueue.h"
+
+// The reader issues the read commands to the slots in order, and up to nDepth
+// of them are in flight on the overlapped handle at once. The drive may
+// complete them in any order, but the reader completes the oldest one first,
+// so the slots act as the reorder buffer. The completed slots are written in
+// the same order by WriteOutputFile, so the image goes through the output
+// stream of fp like the other images (/dw and the sparse file). The stream
+// writes its buffer on its own thread, so nDepth slots are enough.
+static VOID TerminateReadQueueCommand(
+	PREAD_QUEUE pQueue
+) {
+	pQueue->pImage = NULL;
+	if (pQueue->lpCmd) {
+		for (INT i = 0; i < pQueue->nDepth; i++) {
+			if (pQueue->lpCmd[i].ov.hEvent) {
+				CloseHandle(pQueue->lpCmd[i].ov.hEvent);
+			}
+		}
+		FreeAndNull(pQueue->lpCmd);
+	}
+	if (pQueue->hDevice) {
+		CloseHandle(pQueue->hDevice);
+		pQueue->hDevice = NULL;
+	}
+}
+
+BOOL InitReadQueue(
+	PREAD_QUEUE pQueue,
+	PDEVICE pDevice,
+	FILE* fp,
+	DWORD dwSlotSize,
+	INT nDepth
+) {
+	ZeroMemory(pQueue, sizeof(READ_QUEUE));
+	pQueue->fp = fp;
+	pQueue->dwSlotSize = dwSlotSize;
+	pQueue->nDepth = nDepth;
+	BOOL bRet = TRUE;
+	try {
+		// dwSlotSize is a multiple of the sector size, so every slot keeps the alignment
+		if (NULL == (pQueue->lpBufOrg = (LPBYTE)calloc(
+			(size_t)dwSlotSize * nDepth + pDevice->AlignmentMask, sizeof(BYTE)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		pQueue->lpBuf = (LPBYTE)ConvParagraphBoundary(pDevice, pQueue->lpBufOrg);
+		if (NULL == (pQueue->lpCmd = (PREAD_QUEUE_COMMAND)calloc(
+			(size_t)nDepth, sizeof(READ_QUEUE_COMMAND)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		for (INT i = 0; i < nDepth; i++) {
+			if (NULL == (pQueue->lpCmd[i].ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL))) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				throw FALSE;
+			}
+		}
+		// the image is read by ScsiPassThroughDirect, and the drive which
+		// can't be opened twice reads the slots one by one as before
+		if (nDepth > 1 && !pDevice->IMAGE.fp && !GetOverlappedHandle(pDevice, &pQueue->hDevice)) {
+			OutputDiscLogA("\tThe drive can't be opened for the overlapped reads. Read one by one\n");
+		}
+		// the image with the latency is read on the threads, so the commands
+		// are completed out of order like the drive
+		if (pDevice->IMAGE.fp && pDevice->IMAGE.dwLatencyMs) {
+			pQueue->pImage = pDevice;
+		}
+	}
+	catch (BOOL ret) {
+		bRet = ret;
+		TerminateReadQueueCommand(pQueue);
+		FreeAndNull(pQueue->lpBufOrg);
+		return bRet;
+	}
+	QueryPerformanceFrequency(&pQueue->llFreq);
+	QueryPerformanceCounter(&pQueue->llStart);
+	return bRet;
+}
+
+// Simulates the drive. The command of the image is completed after its delay.
+static DWORD WINAPI ExecReadImageForQueue(
+	LPVOID lpParam
+) {
+	PREAD_QUEUE_COMMAND pCmd = (PREAD_QUEUE_COMMAND)lpParam;
+	Sleep(pCmd->dwLatencyMs);
+	pCmd->bRet = ExecReadImage(pCmd->pQueue->pImage, pCmd->swb.ScsiPassThroughDirect.Cdb
+		, (LPBYTE)pCmd->swb.ScsiPassThroughDirect.DataBuffer
+		, pCmd->swb.ScsiPassThroughDirect.DataTransferLength, &pCmd->byScsiStatus, _T(__FUNCTION__), __LINE__);
+	SetEvent(pCmd->ov.hEvent);
+	return 0;
+}
+
+// Waits for the command of the image or the drive
+static VOID WaitForReadQueueCommand(
+	PREAD_QUEUE pQueue,
+	PREAD_QUEUE_COMMAND pCmd
+) {
+	if (pCmd->hThread) {
+		WaitForSingleObject(pCmd->hThread, INFINITE);
+		CloseHandle(pCmd->hThread);
+		pCmd->hThread = NULL;
+	}
+	else {
+		DWORD dwReturned = 0;
+		if (GetOverlappedResult(pQueue->hDevice, &pCmd->ov, &dwReturned, TRUE)) {
+			GetScsiPassThroughDirectStatus(&pCmd->swb, &pCmd->byScsiStatus, _T(__FUNCTION__), __LINE__);
+		}
+		else {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			pCmd->bRet = FALSE;
+		}
+	}
+	pCmd->byPending = FALSE;
+}
+
+// The caller must complete a command first if nDepth commands are in flight
+LPBYTE GetReadQueueSlot(
+	PREAD_QUEUE pQueue
+) {
+	return pQueue->lpBuf + (size_t)pQueue->dwSlotSize * pQueue->nHead;
+}
+
+// Issues the read command to the slot of GetReadQueueSlot without waiting for
+// the completion. If lpCdb is NULL, the slot was filled by the reader.
+// The result is got by CompleteReadQueueSlot.
+VOID IssueReadQueueSlot(
+	PREAD_QUEUE pQueue,
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	LPVOID lpCdb,
+	BYTE byCdbLength,
+	INT nLBA,
+	DWORD dwSize
+) {
+	PREAD_QUEUE_COMMAND pCmd = &pQueue->lpCmd[pQueue->nHead];
+	LPBYTE lpSlot = pQueue->lpBuf + (size_t)pQueue->dwSlotSize * pQueue->nHead;
+	pCmd->nLBA = nLBA;
+	pCmd->dwSize = dwSize;
+	pCmd->bRet = TRUE;
+	pCmd->byPending = FALSE;
+	pCmd->byScsiStatus = SCSISTAT_GOOD;
+	if (lpCdb) {
+		if (pQueue->pImage) {
+			// the delay differs by the LBA, so the newer command can be completed first
+			pCmd->dwLatencyMs = ((DWORD)nLBA * 2654435761U >> 16) % (pDevice->IMAGE.dwLatencyMs + 1);
+			pCmd->pQueue = pQueue;
+			SetScsiPassThroughDirect(pDevice, &pCmd->swb, lpCdb, byCdbLength, lpSlot, dwSize);
+			ResetEvent(pCmd->ov.hEvent);
+			if (NULL != (pCmd->hThread = CreateThread(NULL, 0, ExecReadImageForQueue, pCmd, 0, NULL))) {
+				pCmd->byPending = TRUE;
+			}
+			else {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				pCmd->bRet = FALSE;
+			}
+		}
+		else if (pQueue->hDevice) {
+			SetScsiPassThroughDirect(pDevice, &pCmd->swb, lpCdb, byCdbLength, lpSlot, dwSize);
+			HANDLE hEvent = pCmd->ov.hEvent;
+			ZeroMemory(&pCmd->ov, sizeof(OVERLAPPED));
+			pCmd->ov.hEvent = hEvent;
+			ResetEvent(hEvent);
+
+			DWORD dwLength = sizeof(SCSI_PASS_THROUGH_DIRECT_WITH_BUFFER);
+			if (DeviceIoControl(pQueue->hDevice, IOCTL_SCSI_PASS_THROUGH_DIRECT,
+				&pCmd->swb, dwLength, &pCmd->swb, dwLength, NULL, &pCmd->ov) ||
+				GetLastError() == ERROR_IO_PENDING) {
+				pCmd->byPending = TRUE;
+			}
+			else {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				pCmd->bRet = FALSE;
+			}
+		}
+		else {
+			pCmd->bRet = ScsiPassThroughDirect(pExtArg, pDevice, lpCdb, byCdbLength, lpSlot,
+				dwSize, &pCmd->byScsiStatus, _T(__FUNCTION__), __LINE__);
+		}
+	}
+	pQueue->nHead = (pQueue->nHead + 1) % pQueue->nDepth;
+	pQueue->nIssuedNum++;
+}
+
+// Waits for the command of the oldest issued slot. The slots issued after it
+// may be completed already, but they wait for their turn, so the output stays
+// in order. Returns FALSE if the command failed.
+BOOL CompleteReadQueueSlot(
+	PREAD_QUEUE pQueue,
+	LPBYTE* lpSlot,
+	LPINT lpLBA,
+	LPDWORD lpSize
+) {
+	PREAD_QUEUE_COMMAND pCmd = &pQueue->lpCmd[pQueue->nDone];
+	if (pCmd->byPending) {
+		if (WaitForSingleObject(pCmd->ov.hEvent, 0) != WAIT_OBJECT_0) {
+			INT nSlot = pQueue->nDone;
+			for (INT i = 1; i < pQueue->nIssuedNum; i++) {
+				nSlot = (nSlot + 1) % pQueue->nDepth;
+				if (pQueue->lpCmd[nSlot].byPending &&
+					WaitForSingleObject(pQueue->lpCmd[nSlot].ov.hEvent, 0) == WAIT_OBJECT_0) {
+					pQueue->nOutOfOrderNum++;
+					break;
+				}
+			}
+		}
+		LARGE_INTEGER llStart = { 0 };
+		LARGE_INTEGER llEnd = { 0 };
+		QueryPerformanceCounter(&llStart);
+		WaitForReadQueueCommand(pQueue, pCmd);
+		QueryPerformanceCounter(&llEnd);
+		pQueue->dCmdWaitMs += (double)(llEnd.QuadPart - llStart.QuadPart) * 1000 / pQueue->llFreq.QuadPart;
+	}
+	*lpSlot = pQueue->lpBuf + (size_t)pQueue->dwSlotSize * pQueue->nDone;
+	*lpLBA = pCmd->nLBA;
+	*lpSize = pCmd->dwSize;
+	return pCmd->bRet && pCmd->byScsiStatus < SCSISTAT_CHECK_CONDITION;
+}
+
+// Writes the slot of CompleteReadQueueSlot to fp
+BOOL PushReadQueueSlot(
+	PREAD_QUEUE pQueue,
+	DWORD dwSize
+) {
+	LPBYTE lpSlot = pQueue->lpBuf + (size_t)pQueue->dwSlotSize * pQueue->nDone;
+	pQueue->nDone = (pQueue->nDone + 1) % pQueue->nDepth;
+	pQueue->nIssuedNum--;
+	pQueue->ullBytes += dwSize;
+	if (!WriteOutputFile(pQueue->fp, lpSlot, dwSize)) {
+		OutputErrorString(_T("Failed to write the image\n"));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+// The commands in flight use the slots, so they are completed before the
+// slots are freed, but their sectors aren't written.
+VOID TerminateReadQueue(
+	PREAD_QUEUE pQueue
+) {
+	if (!pQueue->lpBufOrg) {
+		return;
+	}
+	INT nSlot = pQueue->nDone;
+	for (INT i = 0; i < pQueue->nIssuedNum; i++) {
+		PREAD_QUEUE_COMMAND pCmd = &pQueue->lpCmd[nSlot];
+		if (pCmd->byPending) {
+			WaitForReadQueueCommand(pQueue, pCmd);
+		}
+		nSlot = (nSlot + 1) % pQueue->nDepth;
+	}
+	if (pQueue->ullBytes) {
+		LARGE_INTEGER llEnd = { 0 };
+		QueryPerformanceCounter(&llEnd);
+		double dMs = (double)(llEnd.QuadPart - pQueue->llStart.QuadPart) * 1000 / pQueue->llFreq.QuadPart;
+		OutputDiscLogA(
+			"\tRead %llu bytes in %.0f ms (%.2f MB/s), %d commands in flight (%s)\n"
+			"\tWaited for the drive %.0f ms, %d times completed out of order\n"
+			, pQueue->ullBytes, dMs, dMs > 0 ? pQueue->ullBytes / 1048576.0 * 1000 / dMs : 0
+			, pQueue->nDepth, pQueue->hDevice || pQueue->pImage ? "overlapped" : "one by one"
+			, pQueue->dCmdWaitMs, pQueue->nOutOfOrderNum);
+	}
+	pQueue->nIssuedNum = 0;
+	TerminateReadQueueCommand(pQueue);
+	FreeAndNull(pQueue->lpBufOrg);
+}
@@ -0,0 +1,55 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+BOOL InitReadQueue(
+	PREAD_QUEUE pQueue,
+	PDEVICE pDevice,
+	FILE* fp,
+	DWORD dwSlotSize,
+	INT nDepth
+);
+
+LPBYTE GetReadQueueSlot(
+	PREAD_QUEUE pQueue
+);
+
+VOID IssueReadQueueSlot(
+	PREAD_QUEUE pQueue,
+	PEXT_ARG pExtArg,
+	PDEVICE pDevice,
+	LPVOID lpCdb,
+	BYTE byCdbLength,
+	INT nLBA,
+	DWORD dwSize
+);
+
+BOOL CompleteReadQueueSlot(
+	PREAD_QUEUE pQueue,
+	LPBYTE* lpSlot,
+	LPINT lpLBA,
+	LPDWORD lpSize
+);
+
+BOOL PushReadQueueSlot(
+	PREAD_QUEUE pQueue,
+	DWORD dwSize
+);
+
+VOID TerminateReadQueue(
+	PREAD_QUEUE pQueue
+);
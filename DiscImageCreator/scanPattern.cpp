@@ -0,0 +1,166 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "output.h"
+#include "scanPattern.h"
+
+// All patterns are compiled into one Aho-Corasick automaton. The missing
+// transitions are resolved while building, so the scan is one table lookup
+// per byte regardless of the number of the patterns.
+BOOL InitPatternScanner(
+	PPATTERN_SCANNER pScanner,
+	CONST BYTE** lpPattern,
+	LPDWORD lpPatternLen,
+	INT nPatternNum
+) {
+	if (nPatternNum <= 0 || PATTERN_SCANNER_MAX_PATTERN_NUM < nPatternNum) {
+		OutputErrorString(_T("Illegal pattern num: %d\n"), nPatternNum);
+		return FALSE;
+	}
+	INT nMaxStateNum = 1;
+	for (INT i = 0; i < nPatternNum; i++) {
+		if (lpPatternLen[i] == 0) {
+			OutputErrorString(_T("Empty pattern: %d\n"), i);
+			return FALSE;
+		}
+		nMaxStateNum += (INT)lpPatternLen[i];
+	}
+	BOOL bRet = TRUE;
+	LPINT lpFail = NULL;
+	LPINT lpQueue = NULL;
+	try {
+		if (NULL == (pScanner->lpGoto = (LPINT)calloc((size_t)nMaxStateNum * 256, sizeof(INT)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		if (NULL == (pScanner->lpOutMask = (LPDWORD)calloc((size_t)nMaxStateNum, sizeof(DWORD)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		if (NULL == (pScanner->lpPatternLen = (LPDWORD)calloc((size_t)nPatternNum, sizeof(DWORD)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		if (NULL == (lpFail = (LPINT)calloc((size_t)nMaxStateNum, sizeof(INT)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		if (NULL == (lpQueue = (LPINT)calloc((size_t)nMaxStateNum, sizeof(INT)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		LPINT lpGoto = pScanner->lpGoto;
+		for (INT i = 0; i < nMaxStateNum * 256; i++) {
+			lpGoto[i] = -1;
+		}
+		// trie
+		INT nStateNum = 1;
+		for (INT i = 0; i < nPatternNum; i++) {
+			INT nState = 0;
+			for (DWORD j = 0; j < lpPatternLen[i]; j++) {
+				LPINT pNext = &lpGoto[nState * 256 + lpPattern[i][j]];
+				if (*pNext == -1) {
+					*pNext = nStateNum++;
+				}
+				nState = *pNext;
+			}
+			pScanner->lpOutMask[nState] |= 1UL << i;
+			pScanner->lpPatternLen[i] = lpPatternLen[i];
+		}
+		// failure links in breadth-first order, folded into the goto table
+		INT nHead = 0;
+		INT nTail = 0;
+		for (INT c = 0; c < 256; c++) {
+			INT nNext = lpGoto[c];
+			if (nNext == -1) {
+				lpGoto[c] = 0;
+			}
+			else {
+				lpFail[nNext] = 0;
+				lpQueue[nTail++] = nNext;
+			}
+		}
+		while (nHead < nTail) {
+			INT nState = lpQueue[nHead++];
+			pScanner->lpOutMask[nState] |= pScanner->lpOutMask[lpFail[nState]];
+			for (INT c = 0; c < 256; c++) {
+				INT nNext = lpGoto[nState * 256 + c];
+				if (nNext == -1) {
+					lpGoto[nState * 256 + c] = lpGoto[lpFail[nState] * 256 + c];
+				}
+				else {
+					lpFail[nNext] = lpGoto[lpFail[nState] * 256 + c];
+					lpQueue[nTail++] = nNext;
+				}
+			}
+		}
+		pScanner->nStateNum = nStateNum;
+		pScanner->nPatternNum = nPatternNum;
+		pScanner->nState = 0;
+		pScanner->ullPos = 0;
+	}
+	catch (BOOL bErr) {
+		bRet = bErr;
+		TerminatePatternScanner(pScanner);
+	}
+	FreeAndNull(lpFail);
+	FreeAndNull(lpQueue);
+	return bRet;
+}
+
+VOID TerminatePatternScanner(
+	PPATTERN_SCANNER pScanner
+) {
+	FreeAndNull(pScanner->lpGoto);
+	FreeAndNull(pScanner->lpOutMask);
+	FreeAndNull(pScanner->lpPatternLen);
+}
+
+// The state is carried over the calls, so the pattern which spans the buffers
+// (e.g. the sector boundary) is also found. ullPos of the match is the offset
+// of the first byte of the pattern from the first byte given to the scanner.
+// Returns the number of the matches stored in pMatch; the scan stops when
+// pMatch is full.
+INT ScanPattern(
+	PPATTERN_SCANNER pScanner,
+	LPBYTE lpBuf,
+	DWORD dwBufLen,
+	PPATTERN_MATCH pMatch,
+	INT nMatchMax
+) {
+	CONST INT* lpGoto = pScanner->lpGoto;
+	CONST DWORD* lpOutMask = pScanner->lpOutMask;
+	INT nState = pScanner->nState;
+	INT nMatchNum = 0;
+	DWORD i = 0;
+	while (i < dwBufLen && nMatchNum < nMatchMax) {
+		nState = lpGoto[nState * 256 + lpBuf[i++]];
+		DWORD dwMask = lpOutMask[nState];
+		if (dwMask) {
+			UINT64 ullEnd = pScanner->ullPos + i;
+			for (INT j = 0; j < pScanner->nPatternNum && nMatchNum < nMatchMax; j++) {
+				if (dwMask & (1UL << j)) {
+					pMatch[nMatchNum].nPatternIdx = j;
+					pMatch[nMatchNum].ullPos = ullEnd - pScanner->lpPatternLen[j];
+					nMatchNum++;
+				}
+			}
+		}
+	}
+	pScanner->nState = nState;
+	pScanner->ullPos += i;
+	return nMatchNum;
+}
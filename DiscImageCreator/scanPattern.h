@@ -0,0 +1,39 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// the max number of the patterns which one scanner finds at once
+#define PATTERN_SCANNER_MAX_PATTERN_NUM	(32)
+
+BOOL InitPatternScanner(
+	PPATTERN_SCANNER pScanner,
+	CONST BYTE** lpPattern,
+	LPDWORD lpPatternLen,
+	INT nPatternNum
+);
+
+VOID TerminatePatternScanner(
+	PPATTERN_SCANNER pScanner
+);
+
+INT ScanPattern(
+	PPATTERN_SCANNER pScanner,
+	LPBYTE lpBuf,
+	DWORD dwBufLen,
+	PPATTERN_MATCH pMatch,
+	INT nMatchMax
+);
@@ -1227,7 +1227,7 @@ VOID SetBufferFromTmpSubQData(
 	lpSubcode[19] = DecToBcd(m);
 	lpSubcode[20] = DecToBcd(s);
 	lpSubcode[21] = DecToBcd(f);
-	WORD crc16 = (WORD)GetCrc16CCITT(10, &lpSubcode[12]);
+	WORD crc16 = GetCrc16SubQ(&lpSubcode[12]);
 	lpSubcode[22] = HIBYTE(crc16);
 	lpSubcode[23] = LOBYTE(crc16);
 }
@@ -0,0 +1,55 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "skipRegion.h"
+
+// Skips an unreadable region instead of reading all sectors of it. From
+// nBadLBA, the probe goes ahead by 2, 4, 8 ... sectors until a readable sector
+// is found, and then the boundary between the last unreadable probe and it is
+// bisected. Returns the first readable LBA of the boundary, or nEndLBA if
+// the rest of the disc can't be read. The sectors from nBadLBA + 1 to the
+// returned LBA - 1 aren't read one by one, so the caller retries them later.
+INT GetFirstReadableLBA(
+	INT nBadLBA,
+	INT nEndLBA,
+	LPFN_PROBE_SECTOR lpfnProbe,
+	LPVOID lpContext
+) {
+	INT nLo = nBadLBA;
+	INT nHi = nEndLBA;
+	for (INT nStep = 2; nLo + 1 < nEndLBA; nStep = min(nStep * 2, SKIP_REGION_STEP_MAX)) {
+		INT nProbe = min(nLo + nStep, nEndLBA - 1);
+		if (lpfnProbe(lpContext, nProbe)) {
+			nHi = nProbe;
+			break;
+		}
+		nLo = nProbe;
+	}
+	if (nHi == nEndLBA) {
+		return nEndLBA;
+	}
+	// nLo is unreadable, nHi is readable
+	while (nLo + 1 < nHi) {
+		INT nMid = nLo + (nHi - nLo) / 2;
+		if (lpfnProbe(lpContext, nMid)) {
+			nHi = nMid;
+		}
+		else {
+			nLo = nMid;
+		}
+	}
+	return nHi;
+}
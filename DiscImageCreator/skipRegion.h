@@ -0,0 +1,31 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// the max sectors skipped at a time. The readable sectors between the probes
+// aren't found, so the skip doesn't grow beyond this.
+#define SKIP_REGION_STEP_MAX	(1024)
+
+// returns TRUE if nLBA can be read
+typedef BOOL (*LPFN_PROBE_SECTOR)(LPVOID lpContext, INT nLBA);
+
+INT GetFirstReadableLBA(
+	INT nBadLBA,
+	INT nEndLBA,
+	LPFN_PROBE_SECTOR lpfnProbe,
+	LPVOID lpContext
+);
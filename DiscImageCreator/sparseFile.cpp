@@ -0,0 +1,172 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "get.h"
+#include "output.h"
+#include "outputProgress.h"
+#include "sparseFile.h"
+
+// the size read at a time by CopySparseFile
+#define SPARSE_COPY_SIZE	(SPARSE_BLOCK_SIZE * 64)
+
+BOOL IsZeroBlock(
+	LPBYTE lpBuf,
+	DWORD dwSize
+) {
+	return lpBuf[0] == 0 && !memcmp(lpBuf, lpBuf + 1, dwSize - 1);
+}
+
+// Returns FALSE if the file system doesn't support sparse files (e.g. FAT32)
+BOOL SetSparseFile(
+	FILE* fp
+) {
+	HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(fp));
+	DWORD dwReturned = 0;
+	if (hFile == INVALID_HANDLE_VALUE ||
+		!DeviceIoControl(hFile, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &dwReturned, NULL)) {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+// Writes lpBuf to the current position of the file, and seeks over the zero
+// in it. It's checked up to each boundary of SPARSE_BLOCK_SIZE in the file, so
+// a block of zero which spans two calls is also left as a hole. The file must
+// be newly created and written in order, because the skipped area has to be a
+// hole or the end.
+BOOL WriteSparseFile(
+	FILE* fp,
+	LPBYTE lpBuf,
+	DWORD dwSize,
+	PUINT64 pullSkipped
+) {
+	INT64 llPos = _ftelli64(fp);
+	if (llPos < 0) {
+		return FALSE;
+	}
+	DWORD dwOfs = 0;
+	while (dwOfs < dwSize) {
+		// up to the next boundary of the block in the file
+		DWORD dwLen = SPARSE_BLOCK_SIZE - (DWORD)((llPos + dwOfs) % SPARSE_BLOCK_SIZE);
+		if (dwLen > dwSize - dwOfs) {
+			dwLen = dwSize - dwOfs;
+		}
+		if (IsZeroBlock(lpBuf + dwOfs, dwLen)) {
+			if (_fseeki64(fp, dwLen, SEEK_CUR)) {
+				return FALSE;
+			}
+			*pullSkipped += dwLen;
+		}
+		else if (fwrite(lpBuf + dwOfs, sizeof(BYTE), dwLen, fp) < dwLen) {
+			return FALSE;
+		}
+		dwOfs += dwLen;
+	}
+	return TRUE;
+}
+
+// If the file ends with the skipped blocks, the size is set to the current
+// position. SetEndOfFile extends the sparse file without writing unlike _chsize_s
+BOOL TerminateSparseFile(
+	FILE* fp
+) {
+	INT64 llPos = _ftelli64(fp);
+	if (llPos < 0 || fflush(fp)) {
+		return FALSE;
+	}
+	if ((INT64)GetFileSize64(0, fp) < llPos) {
+		HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(fp));
+		LARGE_INTEGER llSize = { 0 };
+		llSize.QuadPart = llPos;
+		if (hFile == INVALID_HANDLE_VALUE ||
+			!SetFilePointerEx(hFile, llSize, NULL, FILE_BEGIN) || !SetEndOfFile(hFile)) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+// Copies the image for the archive leaving the blocks of zero as the holes.
+// The hash of the copy is the same because the hole is read as zero.
+BOOL CopySparseFile(
+	LPCTSTR pszSrcPath,
+	LPCTSTR pszDstPath
+) {
+	FILE* fpSrc = NULL;
+	FILE* fpDst = NULL;
+	LPBYTE lpBuf = NULL;
+	BOOL bRet = TRUE;
+	try {
+		if (NULL == (fpSrc = _tfopen(pszSrcPath, _T("rb")))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			OutputErrorString(_T(" => %s\n"), pszSrcPath);
+			throw FALSE;
+		}
+		if (NULL == (fpDst = _tfopen(pszDstPath, _T("wb")))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			OutputErrorString(_T(" => %s\n"), pszDstPath);
+			throw FALSE;
+		}
+		if (NULL == (lpBuf = (LPBYTE)calloc(SPARSE_COPY_SIZE, sizeof(BYTE)))) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		BOOL bSparse = SetSparseFile(fpDst);
+		if (!bSparse) {
+			OutputString(_T("The file system doesn't support sparse files. Copied as usual\n"));
+		}
+		UINT64 ullSize = GetFileSize64(0, fpSrc);
+		UINT64 ullCopied = 0;
+		UINT64 ullSkipped = 0;
+		size_t size = 0;
+		StartProgress(_T("Copying"), _T("Block"), 0
+			, (INT)((ullSize + SPARSE_BLOCK_SIZE - 1) / SPARSE_BLOCK_SIZE), SPARSE_BLOCK_SIZE, 0);
+		while ((size = fread(lpBuf, sizeof(BYTE), SPARSE_COPY_SIZE, fpSrc)) > 0) {
+			if (bSparse) {
+				if (!WriteSparseFile(fpDst, lpBuf, (DWORD)size, &ullSkipped)) {
+					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+					throw FALSE;
+				}
+			}
+			else if (fwrite(lpBuf, sizeof(BYTE), size, fpDst) < size) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				throw FALSE;
+			}
+			ullCopied += size;
+			SetProgress((INT)((ullCopied + SPARSE_BLOCK_SIZE - 1) / SPARSE_BLOCK_SIZE));
+		}
+		EndProgress();
+		if (ferror(fpSrc)) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			throw FALSE;
+		}
+		if (bSparse) {
+			if (!TerminateSparseFile(fpDst)) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+				throw FALSE;
+			}
+			OutputString(_T("%llu bytes of zero are left as the holes\n"), ullSkipped);
+		}
+	}
+	catch (BOOL ret) {
+		bRet = ret;
+	}
+	EndProgress();
+	FreeAndNull(lpBuf);
+	FcloseAndNull(fpDst);
+	FcloseAndNull(fpSrc);
+	return bRet;
+}
@@ -0,0 +1,46 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// the unit which NTFS allocates to a sparse file. The zero is checked in
+// this size, and an aligned block of zero becomes a hole
+#define SPARSE_BLOCK_SIZE	(65536)
+
+BOOL IsZeroBlock(
+	LPBYTE lpBuf,
+	DWORD dwSize
+);
+
+BOOL SetSparseFile(
+	FILE* fp
+);
+
+BOOL WriteSparseFile(
+	FILE* fp,
+	LPBYTE lpBuf,
+	DWORD dwSize,
+	PUINT64 pullSkipped
+);
+
+BOOL TerminateSparseFile(
+	FILE* fp
+);
+
+BOOL CopySparseFile(
+	LPCTSTR pszSrcPath,
+	LPCTSTR pszDstPath
+);
@@ -21,6 +21,8 @@
 #pragma comment(lib, "imagehlp.lib")
 #include <tchar.h>
 #include <time.h>
+// popcnt, cpuid
+#include <intrin.h>
 #if 0
 #include <TlHelp32.h>
 #endif
@@ -35,12 +37,6 @@
 #include <setupapi.h>
 #pragma comment (lib, "setupapi.lib")
 #endif
-// XML
-#define _ATL_CSTRING_EXPLICIT_CONSTRUCTORS
-#include <atlbase.h>
-#include <atlstr.h>
-#include <xmllite.h>
-#pragma comment(lib, "xmllite.lib")
 
 // SPTI(needs Windows Driver Kit(wdk))
 #include <ntddcdrm.h> // inc\api
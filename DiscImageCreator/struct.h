@@ -171,6 +171,44 @@ typedef struct _LOG_FILE {
 	FILE* fpC2Error;
 } LOG_FILE, *PLOG_FILE;
 
+typedef struct _LOG_RING {
+	LPBYTE lpBuf;
+	volatile LONG64 llHead;
+	volatile LONG64 llTail;
+	volatile LONG lOwner; // the thread id using the ring, 0 if it's free
+	BYTE padding[4];
+} LOG_RING, *PLOG_RING;
+
+typedef struct _LOG_RECORD {
+	DWORD dwFileIdx;
+	DWORD dwLen;
+} LOG_RECORD, *PLOG_RECORD;
+
+typedef struct _PROGRESS {
+	volatile INT nCurrent;
+	volatile INT nZone;
+	volatile INT nErrorCnt;
+	INT nStart;
+	INT nEnd;
+	DWORD dwUnitSize;
+	DWORD dwSpeedBase;
+	DWORD dwStartTick;
+	DWORD dwPrevTick;
+	INT nPrevCurrent;
+	double dRate;
+	UINT uiTick;
+	BOOL bActive;
+	_TCHAR szLabel[128];
+	_TCHAR szUnit[16];
+} PROGRESS, *PPROGRESS;
+
+typedef struct _C2_ERROR_INFO {
+	DWORD dwErrorBitNum;
+	INT nFirstErrorByte;	// position of main channel. -1 if no error
+	INT nLastErrorByte;
+	UINT64 ullSuspectByte[(CD_RAW_READ_C2_294_SIZE + 63) / 64];	// bit n is on if C2 byte n isn't 0
+} C2_ERROR_INFO, *PC2_ERROR_INFO;
+
 typedef struct _EXT_ARG {
 	BYTE byQuiet;
 	BYTE byAdd;
@@ -197,7 +235,10 @@ typedef struct _EXT_ARG {
 	BYTE byLibCrypt;
 	BYTE byIntentionalSub;
 	BYTE by74Min;
-	BYTE padding[3];
+	BYTE byProgressEvent;
+	BYTE byMds;
+	BYTE byNonInteractive;
+	BYTE byDirectWrite;
 	INT nAudioCDOffsetNum;
 	DWORD dwMaxRereadNum;
 	INT nC2RereadingType;
@@ -206,6 +247,9 @@ typedef struct _EXT_ARG {
 	DWORD dwCacheDelNum;
 	DWORD dwTimeoutNum;
 	DWORD dwSubAddionalNum;
+	DWORD dwSubQVoteNum;
+	DWORD dwReadQueueDepth;
+	DWORD dwSkipErrorNum;
 } EXT_ARG, *PEXT_ARG;
 
 typedef struct _DEVICE {
@@ -238,6 +282,32 @@ typedef struct _DEVICE {
 		BYTE byReadBufCapa;
 		BYTE reserved[3];
 	} FEATURE, *PFEATURE;
+	struct _IMAGE {
+		FILE* fp;	// not NULL if the image is read instead of the drive
+		FILE* fpSub;
+		DWORD dwSectorSize;	// CD_RAW_SECTOR_SIZE (.img, .bin) or DISC_RAW_READ_SIZE (.iso)
+		INT nSectorNum;
+		LPBYTE lpErrorNum;	// per sector, the times the read fails (0xff: always). NULL if no error is injected
+		DWORD dwLatencyMs;	// the max delay of the command of the read queue. 0 if it completes at once
+		CRITICAL_SECTION cs;	// the read queue reads the image on the threads
+	} IMAGE, *PIMAGE;
+	struct _PROFILE {
+		CHAR szSerialNumber[32];	// get at IOCTL_STORAGE_QUERY_PROPERTY
+		BYTE byExist;				// the drive is in driveProfile.ini
+		BYTE byC2Probed;
+		BYTE byC2OpCode;			// 0xbe or 0xd8
+		BYTE byC2Type;				// CDFLAG::_READ_CD::_ERROR_FLAGS, NoC2 if unsupported
+		DRIVE_DATA_ORDER driveOrder;
+		BYTE byLeadIn;				// opcode which read the lead-in, 0 if unknown
+		BYTE byLeadOut;				// opcode which read the lead-out, 0 if unknown
+		BYTE byDriveOffset;			// TRUE if nDriveSampleOffset is valid
+		BYTE padding;
+		INT nDriveSampleOffset;
+		DWORD dwMaxTransferLength;
+		DWORD dwBufferSize;			// get at SCSIOP_READ_BUFFER_CAPACITY
+		DWORD dwRawTransferLen;		// sectors which dumped the first block of ReadDVDRaw, 0 if not tuned
+		INT nRawRereadMax;			// 0 if not tuned
+	} PROFILE, *PPROFILE;
 } DEVICE, *PDEVICE;
 
 // Don't define value of BYTE(1byte) or SHOUT(2byte) before CDROM_TOC structure
@@ -317,6 +387,11 @@ typedef struct _DISC {
 		LPBYTE lpRtoWList;
 		INT nCorruptCrcH;
 		INT nCorruptCrcL;
+		// the sub-Q of nPredictedLBA expected from the TOC (see IsPredictedSubQ)
+		BYTE aPredictedSubQ[12];
+		BYTE byPredictedTrackNum; // 0 if aPredictedSubQ isn't built
+		BYTE padding[3];
+		INT nPredictedLBA;
 	} SUB;
 	struct _PROTECT {
 		BYTE byExist;
@@ -350,6 +425,15 @@ typedef struct _DISC {
 		DWORD dwLayer1SectorLength;
 		DWORD securitySectorRange[23][2];
 	} DVD;
+	struct _DPM {
+		LARGE_INTEGER llFreq;
+		LARGE_INTEGER llStart;
+		// ms from the start of the dump per dwResolution sectors
+		LPDWORD lpReadTime;
+		DWORD dwResolution;
+		DWORD dwEntryNum;
+		DWORD dwAllocEntryNum;
+	} DPM;
 } DISC, *PDISC;
 
 typedef struct _VOLUME_DESCRIPTOR {
@@ -375,6 +459,198 @@ typedef struct _DIRECTORY_RECORD {
 	UINT uiDirSize;
 } DIRECTORY_RECORD, *PDIRECTORY_RECORD;
 
+typedef struct _DIRECTORY_EXTENT {
+	INT nIdx; // index of DIRECTORY_RECORD
+	INT nLBA;
+	INT nSectorNum;
+} DIRECTORY_EXTENT, *PDIRECTORY_EXTENT;
+
+typedef struct _EXE_PROBE {
+	INT nIdx; // index of PROTECT.pExtentPosForExe
+	INT nLBA;
+	INT nSectorNum;
+	LPBYTE lpHeader;
+} EXE_PROBE, *PEXE_PROBE;
+
+typedef struct _EXE_PROBE_STAT {
+	LARGE_INTEGER llFreq;
+	INT nReadNum;
+	INT nSeekNum;
+	double dMs;
+} EXE_PROBE_STAT, *PEXE_PROBE_STAT;
+
+typedef struct _PATTERN_SCANNER {
+	LPINT lpGoto; // next state; [state * 256 + byte]
+	LPDWORD lpOutMask; // bit n is on if pattern n ends at the state
+	LPDWORD lpPatternLen;
+	INT nStateNum;
+	INT nPatternNum;
+	INT nState; // carried over the buffers
+	UINT64 ullPos; // bytes scanned so far
+} PATTERN_SCANNER, *PPATTERN_SCANNER;
+
+typedef struct _PATTERN_MATCH {
+	INT nPatternIdx;
+	UINT64 ullPos; // offset of the first byte of the pattern
+} PATTERN_MATCH, *PPATTERN_MATCH;
+
+typedef struct _SYNC_CANDIDATE {
+	INT nCombinedOffset;
+	INT nVotes; // the number of the syncs which agree on the offset
+	INT nFirstPos; // position of the first sync in the buffer
+} SYNC_CANDIDATE, *PSYNC_CANDIDATE;
+
+typedef struct _READ_QUEUE_COMMAND {
+	SCSI_PASS_THROUGH_DIRECT_WITH_BUFFER swb;
+	OVERLAPPED ov; // hEvent is kept while the queue lives
+	INT nLBA;
+	DWORD dwSize;
+	BOOL bRet; // FALSE if the command couldn't be issued or failed
+	BYTE byPending; // in flight on hDevice or hThread
+	BYTE byScsiStatus;
+	BYTE padding[2];
+	HANDLE hThread; // runs the command of the image with IMAGE.dwLatencyMs
+	DWORD dwLatencyMs;
+	PREAD_QUEUE pQueue;
+} READ_QUEUE_COMMAND, *PREAD_QUEUE_COMMAND;
+
+typedef struct _READ_QUEUE {
+	LPBYTE lpBufOrg;
+	LPBYTE lpBuf; // aligned, nDepth slots of dwSlotSize
+	PREAD_QUEUE_COMMAND lpCmd; // the read command of each slot
+	HANDLE hDevice; // opened with FILE_FLAG_OVERLAPPED, NULL if the commands wait for the completion
+	DWORD dwSlotSize;
+	INT nDepth; // the commands in flight at most
+	INT nHead; // next slot filled by the reader
+	INT nDone; // oldest slot whose command isn't completed by the reader
+	INT nIssuedNum; // the slots from nDone to nHead
+	FILE* fp; // written by WriteOutputFile
+	UINT64 ullBytes;
+	LARGE_INTEGER llFreq;
+	LARGE_INTEGER llStart;
+	double dCmdWaitMs; // the reader waited for the completion of the commands
+	INT nOutOfOrderNum; // the oldest command was in flight while a newer one was completed
+	PDEVICE pImage; // not NULL if the commands of the image run on the threads
+} READ_QUEUE, *PREAD_QUEUE;
+
+typedef struct _OUTPUT_STREAM {
+	FILE* fp; // the key of the stream
+	HANDLE hFile; // the handle of fp
+	HANDLE hWrite; // reopened with FILE_FLAG_NO_BUFFERING, or hFile
+	LPBYTE lpBuf[2]; // aligned to the page, filled by turns
+	DWORD dwBufSize;
+	DWORD dwFilled; // bytes in lpBuf[nCur]
+	INT nCur; // filled by the caller
+	INT nFlush; // written by the thread
+	DWORD dwFlushSize;
+	BYTE byTerminate;
+	BYTE bySparse; // the blocks of zero are skipped instead of written
+	BYTE padding[2];
+	INT64 llPos; // the file position of lpBuf[nCur]
+	INT64 llFlushPos;
+	HANDLE hRequest; // set when lpBuf[nFlush] is handed to the thread
+	HANDLE hDone; // set when the thread wrote it
+	HANDLE hThread;
+	volatile LONG lError;
+	UINT64 ullBytes;
+	UINT64 ullSparseBytes; // skipped by bySparse
+	LARGE_INTEGER llFreq;
+	LARGE_INTEGER llStart;
+	double dWriteMs; // the time of the thread writing
+	double dStallMs; // the time of the caller waiting for the thread
+} OUTPUT_STREAM, *POUTPUT_STREAM;
+
+typedef struct _ERROR_MAP_RANGE {
+	INT nLBA;
+	INT nSectorNum;
+	CHAR cStatus; // ERROR_MAP_UNTRIED, ERROR_MAP_BAD or ERROR_MAP_GOOD
+	BYTE padding[3];
+} ERROR_MAP_RANGE, *PERROR_MAP_RANGE;
+
+typedef struct _ERROR_MAP {
+	PERROR_MAP_RANGE pRange;
+	INT nRangeNum;
+	INT nRangeMax; // allocated num of pRange
+	INT nSectorNum;
+	DWORD dwSectorSize; // the unit of the position in the mapfile
+} ERROR_MAP, *PERROR_MAP;
+
+typedef struct _SKIP_PROBE {
+	PEXT_ARG pExtArg;
+	PDEVICE pDevice;
+	LPBYTE lpCmd;
+	LPBYTE lpBuf;
+	DWORD dwBufSize;
+	INT nProbeNum;
+} SKIP_PROBE, *PSKIP_PROBE;
+
+typedef struct _RAW_CACHE_STRATEGY {
+	LPCSTR szName;
+	INT nCmdType; // RAW_CACHE_CMD_FIXED, RAW_CACHE_CMD_RING, RAW_CACHE_CMD_OFFSET...
+	DWORD dwBaseAddr; // address which the first block is cached
+	DWORD dwTransferLen; // sectors stored to the cache at a time
+	DWORD dwTransferLenDefault;
+	DWORD dwTransferLenMin; // fallback if the sector num doesn't match at the max of the reread
+	INT nMemBlkSize; // blocks of dwTransferLen dumped from the cache at a time
+	INT nFlushLBAMin;
+	INT nRereadMax;
+	DWORD dwErrorWait; // msec to wait for the drive if the cache can't be read
+	BYTE byFlushAlways; // flush the cache after every block, otherwise before the reread only
+	BYTE byCdbLength;
+	BYTE lpCmd[CDB12GENERIC_LENGTH];
+	BYTE padding[2];
+} RAW_CACHE_STRATEGY, *PRAW_CACHE_STRATEGY;
+
+typedef struct _DVD_UNSCRAMBLER {
+	DWORD dwEdcBasis[32]; // the EDC of the scramble stream, reduced by the highest bit
+	WORD wBasisSeed[32]; // the bits of the seed which make dwEdcBasis
+	WORD wSeed[16]; // ECMA-267 seeds by the bits 7-4 of the sector num
+	BYTE byNintendo; // the seed is solved per ECC block instead of ECMA-267
+	BYTE padding;
+	WORD wBlockSeed; // the seed of dwBlock of the Nintendo disc, 0 if not known yet
+	DWORD dwBlock; // the ECC block (the sector num / 16) of wBlockSeed
+	BYTE lpStream[16][DISC_RAW_READ_SIZE]; // the scramble stream of wSeed
+	BYTE lpBlockStream[DISC_RAW_READ_SIZE]; // the scramble stream of wBlockSeed
+} DVD_UNSCRAMBLER, *PDVD_UNSCRAMBLER;
+
+typedef struct _UNSCRAMBLE_RANGE {
+	LPCTSTR pszRawPath;
+	LPCTSTR pszIsoPath;
+	BOOL bNintendo;
+	INT nFirstLBA;
+	INT nLastLBA; // not included
+	INT nRet; // UNSCRAMBLE_OK, UNSCRAMBLE_OPEN_RAW_ERROR...
+	INT nErrorNum;
+	INT nFirstErrorLBA; // -1 if no error
+	HANDLE hThread;
+} UNSCRAMBLE_RANGE, *PUNSCRAMBLE_RANGE;
+
+typedef struct _DRIVE_OFFSET_ENTRY {
+	CHAR szModel[32]; // last word of the product (ex. PX-755A), the key of the index
+	CHAR szProduct[32];
+	CHAR szVendor[32];
+	INT nOffset; // samples
+	BYTE byPurged;
+	BYTE padding[3];
+	DWORD dwLine; // line of driveOffset.txt
+} DRIVE_OFFSET_ENTRY, *PDRIVE_OFFSET_ENTRY;
+
+typedef struct _DRIVE_OFFSET_INDEX_HEADER {
+	CHAR szMagic[4];
+	DWORD dwVersion;
+	DWORD dwEntrySize;
+	DWORD padding;
+	INT64 llTxtSize;
+	INT64 llTxtTime;
+	DWORD dwEntryNum;
+	DWORD padding2;
+} DRIVE_OFFSET_INDEX_HEADER, *PDRIVE_OFFSET_INDEX_HEADER;
+
+typedef struct _DRIVE_OFFSET_INDEX {
+	PDRIVE_OFFSET_ENTRY pEntry; // sorted by szModel, then dwLine
+	DWORD dwEntryNum;
+} DRIVE_OFFSET_INDEX, *PDRIVE_OFFSET_INDEX;
+
 // This buffer stores all CD data (main + c2 + sub) obtained from SCSI read command
 // Depending on the situation, this may store main, main + sub.
 typedef struct _DATA_IN_CD {
@@ -416,11 +692,19 @@ typedef struct _SUB_Q {
 	SUB_Q_PER_SECTOR nextNext;
 } SUB_Q, *PSUB_Q;
 
+// raw sub-Q of each reread of the same LBA (/sv)
+typedef struct _SUB_Q_VOTE {
+	INT nLBA;
+	INT nNum;
+	BYTE lpSubQ[SUB_Q_VOTE_MAX][12];
+} SUB_Q_VOTE, *PSUB_Q_VOTE;
+
 typedef struct _DISC_PER_SECTOR {
 	DATA_IN_CD data;
 	MAIN_HEADER mainHeader;
 	SUBCODE subcode;
 	SUB_Q subQ;
+	SUB_Q_VOTE subQVote;
 	DWORD dwC2errorNum;
 	BYTE byTrackNum;
 	BYTE padding[3];
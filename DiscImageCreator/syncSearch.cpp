@@ -0,0 +1,110 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "struct.h"
+#include "convert.h"
+#include "syncSearch.h"
+
+extern BYTE g_aSyncHeader[SYNC_SIZE];
+
+// Returns the position of the first sync at or after nPos, -1 if not found.
+// The sync is 00 ff*10 00. Its bytes 0, 1, 5, 10 and 11 are compared at 16
+// positions at once, and only the positions left are compared entirely.
+INT FindSyncHeader(
+	LPBYTE lpBuf,
+	INT nBufLen,
+	INT nPos
+) {
+	INT nLast = nBufLen - SYNC_SIZE;
+#if defined(_M_IX86) || defined(_M_X64)
+	CONST __m128i zero = _mm_setzero_si128();
+	CONST __m128i ff = _mm_set1_epi8((CHAR)0xff);
+	for (; nPos + 15 <= nLast; nPos += 16) {
+		LPBYTE p = lpBuf + nPos;
+		__m128i m = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)p), zero);
+		m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(p + 1)), ff));
+		m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(p + 5)), ff));
+		m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(p + 10)), ff));
+		m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(p + 11)), zero));
+		DWORD dwMask = (DWORD)_mm_movemask_epi8(m);
+		while (dwMask) {
+			DWORD dwBit = 0;
+			_BitScanForward(&dwBit, dwMask);
+			if (!memcmp(p + dwBit, g_aSyncHeader, SYNC_SIZE)) {
+				return nPos + (INT)dwBit;
+			}
+			dwMask &= dwMask - 1;
+		}
+	}
+#endif
+	for (; nPos <= nLast; nPos++) {
+		if (!memcmp(lpBuf + nPos, g_aSyncHeader, SYNC_SIZE)) {
+			return nPos;
+		}
+	}
+	return -1;
+}
+
+// Every sync in the buffer votes for the write offset that its scrambled
+// header implies. nLBA is the LBA of the sector read at the top of lpBuf.
+// The candidates are returned in the descending order of the votes, the
+// first found wins a tie.
+INT GetSyncCandidates(
+	LPBYTE lpBuf,
+	INT nBufLen,
+	INT nLBA,
+	PSYNC_CANDIDATE pCandidate,
+	INT nCandidateMax
+) {
+	INT nCandidateNum = 0;
+	INT nPos = FindSyncHeader(lpBuf, nBufLen, 0);
+	while (nPos != -1 && nPos + 16 <= nBufLen) {
+		// 0x01, 0x80, 0x00, 0x60 are the 12th - 15th byte of the scramble table
+		BYTE m = (BYTE)(lpBuf[nPos + 12] ^ 0x01);
+		BYTE s = (BYTE)(lpBuf[nPos + 13] ^ 0x80);
+		BYTE f = lpBuf[nPos + 14];
+		BYTE byMode = (BYTE)(lpBuf[nPos + 15] ^ 0x60);
+		// an unscrambled or broken header isn't BCD or its mode is illegal
+		if ((m & 0x0f) <= 9 && m <= 0x99 && (s & 0x0f) <= 9 && s <= 0x59 &&
+			(f & 0x0f) <= 9 && f <= 0x74 && byMode <= DATA_BLOCK_MODE2) {
+			INT nSectorLBA = MSFtoLBA(BcdToDec(m), BcdToDec(s), BcdToDec(f)) - 150;
+			INT nOffset = CD_RAW_SECTOR_SIZE * -(nSectorLBA - nLBA) + nPos;
+			INT i = 0;
+			for (; i < nCandidateNum; i++) {
+				if (pCandidate[i].nCombinedOffset == nOffset) {
+					pCandidate[i].nVotes++;
+					break;
+				}
+			}
+			if (i == nCandidateNum && nCandidateNum < nCandidateMax) {
+				pCandidate[i].nCombinedOffset = nOffset;
+				pCandidate[i].nVotes = 1;
+				pCandidate[i].nFirstPos = nPos;
+				nCandidateNum++;
+			}
+		}
+		nPos = FindSyncHeader(lpBuf, nBufLen, nPos + SYNC_SIZE);
+	}
+	for (INT i = 1; i < nCandidateNum; i++) {
+		SYNC_CANDIDATE tmp = pCandidate[i];
+		INT j = i - 1;
+		for (; j >= 0 && (pCandidate[j].nVotes < tmp.nVotes ||
+			(pCandidate[j].nVotes == tmp.nVotes && pCandidate[j].nFirstPos > tmp.nFirstPos)); j--) {
+			pCandidate[j + 1] = pCandidate[j];
+		}
+		pCandidate[j + 1] = tmp;
+	}
+	return nCandidateNum;
+}
@@ -0,0 +1,36 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "forwardDeclaration.h"
+
+// the max number of the sectors read to agree on the write offset
+#define SYNC_SEARCH_SECTOR_NUM	(4)
+// the max number of the different offsets kept while searching
+#define SYNC_CANDIDATE_MAX		(16)
+
+INT FindSyncHeader(
+	LPBYTE lpBuf,
+	INT nBufLen,
+	INT nPos
+);
+
+INT GetSyncCandidates(
+	LPBYTE lpBuf,
+	INT nBufLen,
+	INT nLBA,
+	PSYNC_CANDIDATE pCandidate,
+	INT nCandidateMax
+);
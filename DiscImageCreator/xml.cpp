@@ -23,348 +23,220 @@
 #include "get.h"
 #include "init.h"
 #include "output.h"
+#include "outputProgress.h"
 #include "xml.h"
 #include "_external/prngcd.h"
 
-BOOL ReadWriteDat(
-	PEXEC_TYPE pExecType,
-	PEXT_ARG pExtArg,
-	PDISC pDisc,
-	_TCHAR* pszFullPath,
-	_TCHAR* szDrive,
-	_TCHAR* szDir,
-	_TCHAR* szFname,
-	BOOL bDesync
+static BOOL ConvertToUtf8(
+	LPCTSTR pszSrc,
+	LPSTR pszDst,
+	INT nDstSize
 ) {
-	WCHAR wszDefaultDat[_MAX_PATH] = { 0 };
-	if (!GetModuleFileNameW(NULL, wszDefaultDat, sizeof(wszDefaultDat) / sizeof(wszDefaultDat[0]))) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		return FALSE;
-	}
-	if (!PathRemoveFileSpecW(wszDefaultDat)) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		return FALSE;
-	}
-	if (!PathAppendW(wszDefaultDat, L"default.dat")) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		return FALSE;
-	}
-
-	HRESULT hr = S_OK;
-	CComPtr<IXmlReader> pReader;
-	CComPtr<IStream> pReadStream;
-	if (FAILED(hr = SHCreateStreamOnFileW(wszDefaultDat, STGM_READ, &pReadStream))) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-		return FALSE;
-	}
-	if (FAILED(hr = CreateXmlReader(__uuidof(IXmlReader), reinterpret_cast<void**>(&pReader), 0))) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-		return FALSE;
-	}
-	if (FAILED(hr = pReader->SetInput(pReadStream))) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-		return FALSE;
-	}
-	if (FAILED(hr = pReader->SetProperty(XmlReaderProperty_DtdProcessing, DtdProcessing_Parse))) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-		return FALSE;
-	}
-
-	WCHAR wszPathForDat[_MAX_PATH] = { 0 };
-	_TCHAR szPath[_MAX_PATH] = { 0 };
-	if (bDesync) {
-		_sntprintf(szPath, _MAX_PATH, _T("%s\\%s\\%s (Subs indexes).dat"), szDrive, szDir, szFname);
-	}
-	else {
-		_sntprintf(szPath, _MAX_PATH, _T("%s\\%s\\%s.dat"), szDrive, szDir, szFname);
-	}
-	szPath[_MAX_FNAME - 1] = 0;
 #ifndef UNICODE
-	if (!MultiByteToWideChar(CP_ACP, 0
-		, szPath, sizeof(szPath) / sizeof(szPath[0])
-		, wszPathForDat, sizeof(wszPathForDat) / sizeof(wszPathForDat[0]))) {
+	WCHAR wszSrc[_MAX_PATH] = { 0 };
+	if (!MultiByteToWideChar(CP_ACP, 0, pszSrc, -1, wszSrc, sizeof(wszSrc) / sizeof(wszSrc[0]))) {
 		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
 		return FALSE;
 	}
+	LPCWSTR pwszSrc = wszSrc;
 #else
-	size = sizeof(wszPathForDat) / sizeof(wszPathForDat[0]);
-	wcsncpy(wszPathForDat, szPath, size);
-	wszPathForDat[size - 1] = 0;
+	LPCWSTR pwszSrc = pszSrc;
 #endif
-
-	CComPtr<IXmlWriter> pWriter;
-	CComPtr<IStream> pWriteStream;
-	if (FAILED(hr = SHCreateStreamOnFileW(wszPathForDat, STGM_CREATE | STGM_WRITE, &pWriteStream))) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-		return FALSE;
-	}
-	if (FAILED(hr = CreateXmlWriter(__uuidof(IXmlWriter), reinterpret_cast<void**>(&pWriter), 0))) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-		return FALSE;
-	}
-	if (FAILED(hr = pWriter->SetOutput(pWriteStream))) {
+	if (!WideCharToMultiByte(CP_UTF8, 0, pwszSrc, -1, pszDst, nDstSize, NULL, NULL)) {
 		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-		return FALSE;
-	}
-	if (FAILED(hr = pWriter->SetProperty(XmlWriterProperty_Indent, TRUE))) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
 		return FALSE;
 	}
+	return TRUE;
+}
 
-	if (FAILED(hr = pWriter->WriteStartDocument(XmlStandalone_Omit))) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-		return FALSE;
-	}
-	if (FAILED(hr = pWriter->WriteDocType(L"datafile"
-		, L"-//Logiqx//DTD ROM Management Datafile//EN", L"http://www.logiqx.com/Dats/datafile.dtd", NULL))) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-		return FALSE;
-	}
+typedef struct _DAT_GAME_END_CONTEXT {
+	PEXEC_TYPE pExecType;
+	PEXT_ARG pExtArg;
+	PDISC pDisc;
+	_TCHAR* pszFullPath;
+	BOOL bDesync;
+} DAT_GAME_END_CONTEXT, *PDAT_GAME_END_CONTEXT;
 
-	WCHAR wszDir[_MAX_DIR] = { 0 };
-#ifndef UNICODE
-	if (!MultiByteToWideChar(CP_ACP, 0, szDir, _MAX_DIR, wszDir, sizeof(wszDir) / sizeof(wszDir[0]))) {
-		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		return FALSE;
+// Adds the roms of the dumped image to <game>
+static INT OutputDatGameEnd(
+	PXML_STREAM_WRITER pWriter,
+	LPVOID lpContext
+) {
+	PDAT_GAME_END_CONTEXT pContext = (PDAT_GAME_END_CONTEXT)lpContext;
+	PEXEC_TYPE pExecType = pContext->pExecType;
+	_TCHAR* pszFullPath = pContext->pszFullPath;
+	if (*pExecType == fd) {
+		if (!OutputHash(pWriter, pszFullPath, _T(".bin"), 1, 1, FALSE)) {
+			return FALSE;
+		}
 	}
-#else
-	size_t size = sizeof(wszDir) / sizeof(wszDir[0]);
-	wcsncpy(wszDir, szDir, size);
-	wszDir[size - 1] = 0;
-#endif
-	LPWCH p = wcsrchr(wszDir, L'\\');
-	*p = NULL;
-	p = wcsrchr(wszDir, L'\\');
-	LPWCH pCurrentDir = p + 1;
-
-	XmlNodeType nodeType;
-	LPCWSTR pwszLocalName = NULL;
-	LPCWSTR pwszValue = NULL;
-	while (S_OK == pReader->Read(&nodeType)) {
-		switch (nodeType) {
-		case XmlNodeType_Element:
-			if (FAILED(hr = pReader->GetLocalName(&pwszLocalName, NULL))) {
-				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-				OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-				return FALSE;
-			}
-			else if (!pwszLocalName) {
-				OutputErrorString(_T("[L:%d] LocalName is NULL\n"), (INT)__LINE__);
+	else if (*pExecType == dvd || *pExecType == xbox || *pExecType == bd) {
+		if (!OutputHash(pWriter, pszFullPath, _T(".iso"), 1, 1, FALSE)) {
+			return FALSE;
+		}
+		if (pContext->pExtArg->byRawDump) {
+			if (!OutputHash(pWriter, pszFullPath, _T(".raw"), 1, 1, FALSE)) {
 				return FALSE;
 			}
-			if (!wcsncmp(pwszLocalName, L"game", 4)) {
-				if (S_FALSE == pReader->MoveToFirstAttribute()) {
-					break;
-				}
-				do {
-					LPCWSTR pwszAttributeName = NULL;
-					if (FAILED(hr = pReader->GetLocalName(&pwszAttributeName, NULL))) {
-						OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-						OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-						return FALSE;
-					}
-					else if (!pwszAttributeName) {
-						OutputErrorString(_T("[L:%d] AttributeName is NULL\n"), (INT)__LINE__);
-						return FALSE;
-					}
-					if (!wcsncmp(pwszAttributeName, L"name", 4)) {
-						if (FAILED(hr = pWriter->WriteStartElement(NULL, pwszLocalName, NULL))) {
-							OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-							OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-							return FALSE;
-						}
-						if (FAILED(hr = pWriter->WriteAttributeString(NULL, pwszAttributeName, NULL, pCurrentDir))) {
-							OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-							OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-							return FALSE;
-						}
-					}
-				} while (S_OK == pReader->MoveToNextAttribute());
-			}
-			else {
-				if (FAILED(hr = pWriter->WriteStartElement(NULL, pwszLocalName, NULL))) {
+		}
+		if (*pExecType == dvd || *pExecType == xbox) {
+			_TCHAR szPath[_MAX_PATH] = { 0 };
+			_tcsncpy(szPath, pszFullPath, _MAX_PATH);
+			szPath[_MAX_PATH - 1] = 0;
+			if (*pExecType == xbox) {
+				if (!PathRemoveFileSpec(szPath)) {
 					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-					OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
 					return FALSE;
 				}
-			}
-			break;
-		case XmlNodeType_Text:
-			if (FAILED(hr = pReader->GetValue(&pwszValue, NULL))) {
-				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-				OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-				return FALSE;
-			}
-			else if (!pwszValue) {
-				OutputErrorString(_T("Error GetValue, NULL, L:%d\n"), (INT)__LINE__);
-				return FALSE;
-			}
-			if (!wcsncmp(pwszLocalName, L"description", 11) && !wcsncmp(pwszValue, L"foo", 3)) {
-				if (FAILED(hr = pWriter->WriteString(pCurrentDir))) {
+				if (!PathAppend(szPath, _T("SS.bin"))) {
 					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-					OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
 					return FALSE;
 				}
-			}
-			else {
-				if (FAILED(hr = pWriter->WriteString(pwszValue))) {
-					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-					OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
+				if (!OutputHash(pWriter, szPath, _T(".bin"), 1, 1, FALSE)) {
 					return FALSE;
 				}
 			}
-			break;
-		case XmlNodeType_EndElement:
-			if (FAILED(hr = pReader->GetLocalName(&pwszLocalName, NULL))) {
+
+			if (!PathRemoveFileSpec(szPath)) {
 				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-				OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
 				return FALSE;
 			}
-			else if (!pwszLocalName) {
-				OutputErrorString(_T("[L:%d] LocalName is NULL\n"), (INT)__LINE__);
+			if (!PathAppend(szPath, _T("PFI.bin"))) {
+				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
 				return FALSE;
 			}
-			if (!wcsncmp(pwszLocalName, L"game", 4)) {
-				if (*pExecType == fd) {
-					if (!OutputHash(pWriter, pszFullPath, _T(".bin"), 1, 1, FALSE)) {
-						return FALSE;
-					}
-				}
-				else if (*pExecType == dvd || *pExecType == xbox || *pExecType == bd) {
-					if (*pExecType == dvd || *pExecType == bd || *pExecType == xbox) {
-						if (!OutputHash(pWriter, pszFullPath, _T(".iso"), 1, 1, FALSE)) {
-							return FALSE;
-						}
-					}
-					if (pExtArg->byRawDump) {
-						if (!OutputHash(pWriter, pszFullPath, _T(".raw"), 1, 1, FALSE)) {
-							return FALSE;
-						}
-					}
-					if (*pExecType == dvd || *pExecType == xbox) {
-						_tcsncpy(szPath, pszFullPath, _MAX_PATH);
-						if (*pExecType == xbox) {
-							if (!PathRemoveFileSpec(szPath)) {
-								OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-								return FALSE;
-							}
-							if (!PathAppend(szPath, _T("SS.bin"))) {
-								OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-								return FALSE;
-							}
-							if (!OutputHash(pWriter, szPath, _T(".bin"), 1, 1, FALSE)) {
-								return FALSE;
-							}
-						}
-
-						if (!PathRemoveFileSpec(szPath)) {
-							OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-							return FALSE;
-						}
-						if (!PathAppend(szPath, _T("PFI.bin"))) {
-							OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-							return FALSE;
-						}
-						if (!OutputHash(pWriter, szPath, _T(".bin"), 1, 1, FALSE)) {
-							return FALSE;
-						}
-
-						if (!PathRemoveFileSpec(szPath)) {
-							OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-							return FALSE;
-						}
-						if (!PathAppend(szPath, _T("DMI.bin"))) {
-							OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-							return FALSE;
-						}
-						if (!OutputHash(pWriter, szPath, _T(".bin"), 1, 1, FALSE)) {
-							return FALSE;
-						}
-					}
-				}
-				else {
-					if (!pDisc->SUB.byDesync || !bDesync) {
-						OutputDiscLogA(OUTPUT_DHYPHEN_PLUS_STR(Hash(Whole image)));
-						if (pDisc->SCSI.trackType == TRACK_TYPE::dataExist) {
-							if (!OutputHash(pWriter, pszFullPath, _T(".scm"), 1, 1, FALSE)) {
-								return FALSE;
-							}
-						}
-						if (!OutputHash(pWriter, pszFullPath, _T(".img"), 1, 1, FALSE)) {
-							return FALSE;
-						}
-					}
-					for (UCHAR i = pDisc->SCSI.toc.FirstTrack; i <= pDisc->SCSI.toc.LastTrack; i++) {
-						if (!OutputHash(pWriter, pszFullPath, _T(".bin"), i, pDisc->SCSI.toc.LastTrack, bDesync)) {
-							return FALSE;
-						}
-					}
-				}
-
+			if (!OutputHash(pWriter, szPath, _T(".bin"), 1, 1, FALSE)) {
+				return FALSE;
 			}
-			if (FAILED(hr = pWriter->WriteEndElement())) {
+
+			if (!PathRemoveFileSpec(szPath)) {
 				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-				OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
 				return FALSE;
 			}
-			break;
-		case XmlNodeType_None:
-			break;
-		case XmlNodeType_Attribute:
-			break;
-		case XmlNodeType_CDATA:
-			break;
-		case XmlNodeType_ProcessingInstruction:
-			break;
-		case XmlNodeType_Comment:
-			break;
-		case XmlNodeType_DocumentType:
-			break;
-		case XmlNodeType_Whitespace:
-#if 0
-			if (FAILED(hr = pWriter->WriteWhitespace(L"\n"))) {
+			if (!PathAppend(szPath, _T("DMI.bin"))) {
 				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-				OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
 				return FALSE;
 			}
-			if (FAILED(hr = pWriter->WriteWhitespace(L"\t"))) {
-				OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-				OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
+			if (!OutputHash(pWriter, szPath, _T(".bin"), 1, 1, FALSE)) {
+				return FALSE;
+			}
+		}
+	}
+	else {
+		PDISC pDisc = pContext->pDisc;
+		if (!pDisc->SUB.byDesync || !pContext->bDesync) {
+			OutputDiscLogA(OUTPUT_DHYPHEN_PLUS_STR(Hash(Whole image)));
+			if (pDisc->SCSI.trackType == TRACK_TYPE::dataExist) {
+				if (!OutputHash(pWriter, pszFullPath, _T(".scm"), 1, 1, FALSE)) {
+					return FALSE;
+				}
+			}
+			if (!OutputHash(pWriter, pszFullPath, _T(".img"), 1, 1, FALSE)) {
+				return FALSE;
+			}
+		}
+		for (UCHAR i = pDisc->SCSI.toc.FirstTrack; i <= pDisc->SCSI.toc.LastTrack; i++) {
+			if (!OutputHash(pWriter, pszFullPath, _T(".bin"), i, pDisc->SCSI.toc.LastTrack, pContext->bDesync)) {
 				return FALSE;
 			}
-#endif
-			break;
-		case XmlNodeType_XmlDeclaration:
-			break;
-		default:
-			break;
 		}
 	}
-	if (FAILED(hr = pWriter->WriteEndDocument())) {
+	return TRUE;
+}
+
+BOOL ReadWriteDat(
+	PEXEC_TYPE pExecType,
+	PEXT_ARG pExtArg,
+	PDISC pDisc,
+	_TCHAR* pszFullPath,
+	_TCHAR* szDrive,
+	_TCHAR* szDir,
+	_TCHAR* szFname,
+	BOOL bDesync
+) {
+	_TCHAR szDefaultDat[_MAX_PATH] = { 0 };
+	if (!GetModuleFileName(NULL, szDefaultDat, sizeof(szDefaultDat) / sizeof(szDefaultDat[0]))) {
 		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
 		return FALSE;
 	}
-	if (FAILED(hr = pWriter->Flush())) {
+	if (!PathRemoveFileSpec(szDefaultDat)) {
 		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-		OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
 		return FALSE;
 	}
-	return TRUE;
+	if (!PathAppend(szDefaultDat, _T("default.dat"))) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		return FALSE;
+	}
+	_TCHAR szPath[_MAX_PATH] = { 0 };
+	if (bDesync) {
+		_sntprintf(szPath, _MAX_PATH, _T("%s\\%s\\%s (Subs indexes).dat"), szDrive, szDir, szFname);
+	}
+	else {
+		_sntprintf(szPath, _MAX_PATH, _T("%s\\%s\\%s.dat"), szDrive, szDir, szFname);
+	}
+	szPath[_MAX_FNAME - 1] = 0;
+
+	_TCHAR szCurrentDir[_MAX_DIR] = { 0 };
+	_tcsncpy(szCurrentDir, szDir, _MAX_DIR);
+	szCurrentDir[_MAX_DIR - 1] = 0;
+	_TCHAR* p = _tcsrchr(szCurrentDir, _T('\\'));
+	if (p) {
+		*p = 0;
+		p = _tcsrchr(szCurrentDir, _T('\\'));
+	}
+	// the dat is UTF-8, so the names are converted once here
+	CHAR szCurrentDirUtf8[_MAX_DIR * 3] = { 0 };
+	if (!ConvertToUtf8(p ? p + 1 : szCurrentDir, szCurrentDirUtf8, sizeof(szCurrentDirUtf8))) {
+		return FALSE;
+	}
+
+	FILE* fpIn = _tfopen(szDefaultDat, _T("rb"));
+	if (!fpIn) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		OutputErrorString(_T(" => %s\n"), szDefaultDat);
+		return FALSE;
+	}
+	XML_STREAM_READER reader;
+	BOOL bRet = InitXmlStreamReader(&reader, fpIn);
+	FcloseAndNull(fpIn);
+	if (!bRet) {
+		OutputErrorString(_T("Dat error: failed to read %s\n"), szDefaultDat);
+		return FALSE;
+	}
+	FILE* fpOut = _tfopen(szPath, _T("wb"));
+	if (!fpOut) {
+		OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+		OutputErrorString(_T(" => %s\n"), szPath);
+		TerminateXmlStreamReader(&reader);
+		return FALSE;
+	}
+	XML_STREAM_WRITER writer;
+	InitXmlStreamWriter(&writer, fpOut);
+	DAT_GAME_END_CONTEXT context = { pExecType, pExtArg, pDisc, pszFullPath, bDesync };
+	try {
+		INT nRet = CopyXmlStreamDat(&reader, &writer, szCurrentDirUtf8, OutputDatGameEnd, &context);
+		if (nRet == -1) {
+			OutputErrorString(_T("Dat error: %s is malformed\n"), szDefaultDat);
+			throw FALSE;
+		}
+		else if (!nRet) {
+			throw FALSE;
+		}
+	}
+	catch (BOOL bErr) {
+		if (writer.bErr) {
+			OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
+			OutputErrorString(_T("Dat error: failed to write %s\n"), szPath);
+		}
+		bRet = bErr;
+	}
+	FcloseAndNull(fpOut);
+	TerminateXmlStreamReader(&reader);
+	return bRet;
 }
 
 BOOL OutputHash(
-	CComPtr<IXmlWriter> pWriter,
+	PXML_STREAM_WRITER pWriter,
 	_TCHAR* pszFullPath,
 	LPCTSTR szExt,
 	UCHAR uiTrack,
@@ -406,6 +278,9 @@ BOOL OutputHash(
 		BYTE data[CD_RAW_SECTOR_SIZE] = { 0 };
 		DWORD crc32 = 0;
 		int nRet = TRUE;
+		_TCHAR szLabel[_MAX_FNAME + 32] = { 0 };
+		_sntprintf(szLabel, sizeof(szLabel) / sizeof(szLabel[0]) - 1, _T("Calculating hash: %s"), pszFnameAndExt);
+		StartProgress(szLabel, _T("Sector"), 0, (INT)ui64SectorSizeAll, dwSectorSizeOne, 0);
 		// TODO: This code can more speed up! if reduce calling fread()
 		for (UINT64 i = 1; i <= ui64SectorSizeAll; i++) {
 			fread(data, sizeof(BYTE), dwSectorSizeOne, fp);
@@ -413,10 +288,9 @@ BOOL OutputHash(
 			if (!nRet) {
 				break;
 			}
-			OutputString(_T("\rCalculating hash: %s [%lld/%lld]")
-				, pszFnameAndExt, i * dwSectorSizeOne, ui64FileSize);
+			SetProgress((INT)i);
 		}
-		OutputString("\n");
+		EndProgress();
 		FcloseAndNull(fp);
 		if (!nRet) {
 			return nRet;
@@ -432,75 +306,18 @@ BOOL OutputHash(
 				!_tcsncmp(pszFnameAndExt, _T("DMI.bin"), 7)
 				) {
 #ifndef _DEBUG
+				// g_LogFile.fpDisc is also written by the log writer thread
+				FlushLog();
 				OutputHashData(g_LogFile.fpDisc, pszFnameAndExt,
 					ui64FileSize, crc32, digest, Message_Digest);
 #endif
 			}
 			else {
-				HRESULT hr = S_OK;
-				if (FAILED(hr = pWriter->WriteStartElement(NULL, L"rom", NULL))) {
-					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-					OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
+				CHAR szFnameAndExtUtf8[_MAX_PATH * 3] = { 0 };
+				if (!ConvertToUtf8(pszFnameAndExt, szFnameAndExtUtf8, sizeof(szFnameAndExtUtf8))) {
 					return FALSE;
 				}
-				WCHAR wszFnameAndExt[_MAX_PATH] = { 0 };
-#ifndef UNICODE
-				if (!MultiByteToWideChar(CP_ACP, 0
-					, pszFnameAndExt, sizeof(pszFnameAndExt) / sizeof(pszFnameAndExt[0])
-					, wszFnameAndExt, sizeof(wszFnameAndExt) / sizeof(wszFnameAndExt[0]))) {
-					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-					return FALSE;
-				}
-#else
-				size_t size = sizeof(wszFnameAndExt) / sizeof(wszFnameAndExt[0]);
-				wcsncpy(wszFnameAndExt, pszFnameAndExt, size);
-				wszFnameAndExt[size - 1] = 0;
-#endif
-				if (FAILED(hr = pWriter->WriteAttributeString(NULL, L"name", NULL, wszFnameAndExt))) {
-					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-					OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-					return FALSE;
-				}
-				WCHAR buf[128] = { 0 };
-				_snwprintf(buf, sizeof(buf) / sizeof(buf[0]), L"%llu", ui64FileSize);
-				buf[127] = 0;
-				if (FAILED(hr = pWriter->WriteAttributeString(NULL, L"size", NULL, buf))) {
-					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-					OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-					return FALSE;
-				}
-				_snwprintf(buf, sizeof(buf) / sizeof(buf[0]), L"%08lx", crc32);
-				buf[127] = 0;
-				if (FAILED(hr = pWriter->WriteAttributeString(NULL, L"crc", NULL, buf))) {
-					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-					OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-					return FALSE;
-				}
-				_snwprintf(buf, sizeof(buf) / sizeof(buf[0])
-					, L"%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x"
-					, digest[0], digest[1], digest[2], digest[3], digest[4], digest[5], digest[6], digest[7]
-					, digest[8], digest[9], digest[10], digest[11], digest[12], digest[13], digest[14], digest[15]);
-				buf[127] = 0;
-				if (FAILED(hr = pWriter->WriteAttributeString(NULL, L"md5", NULL, buf))) {
-					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-					OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-					return FALSE;
-				}
-				_snwprintf(buf, sizeof(buf) / sizeof(buf[0])
-					, L"%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x"
-					, Message_Digest[0], Message_Digest[1], Message_Digest[2], Message_Digest[3], Message_Digest[4]
-					, Message_Digest[5], Message_Digest[6], Message_Digest[7], Message_Digest[8], Message_Digest[9]
-					, Message_Digest[10], Message_Digest[11], Message_Digest[12], Message_Digest[13], Message_Digest[14]
-					, Message_Digest[15], Message_Digest[16], Message_Digest[17], Message_Digest[18], Message_Digest[19]);
-				buf[127] = 0;
-				if (FAILED(hr = pWriter->WriteAttributeString(NULL, L"sha1", NULL, buf))) {
-					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-					OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
-					return FALSE;
-				}
-				if (FAILED(hr = pWriter->WriteEndElement())) {
-					OutputLastErrorNumAndString(_T(__FUNCTION__), __LINE__);
-					OutputErrorString(_T("Dat error: %08.8lx\n"), hr);
+				if (!WriteXmlStreamRom(pWriter, szFnameAndExtUtf8, ui64FileSize, crc32, digest, Message_Digest)) {
 					return FALSE;
 				}
 			}
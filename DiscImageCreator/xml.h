@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #pragma once
+#include "xmlStream.h"
 
 BOOL ReadWriteDat(
 	PEXEC_TYPE pExecType,
@@ -27,7 +28,7 @@ BOOL ReadWriteDat(
 );
 
 BOOL OutputHash(
-	CComPtr<IXmlWriter> pWriter,
+	PXML_STREAM_WRITER pWriter,
 	_TCHAR* pszFullPath,
 	LPCTSTR szExt,
 	UCHAR uiTrack,
@@ -0,0 +1,661 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "xmlStream.h"
+
+static int IsXmlSpace(
+	char c
+) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int IsXmlNameEnd(
+	char c
+) {
+	return IsXmlSpace(c) || c == '/' || c == '>' || c == '=' || c == '\0';
+}
+
+static int SkipXmlUntil(
+	PXML_STREAM_READER pReader,
+	const char* pszEnd
+) {
+	size_t nEndLen = strlen(pszEnd);
+	while (pReader->nPos + nEndLen <= pReader->nLen) {
+		if (!memcmp(&pReader->lpBuf[pReader->nPos], pszEnd, nEndLen)) {
+			pReader->nPos += nEndLen;
+			return 1;
+		}
+		pReader->nPos++;
+	}
+	return 0;
+}
+
+static void SkipXmlSpace(
+	PXML_STREAM_READER pReader
+) {
+	while (pReader->nPos < pReader->nLen && IsXmlSpace(pReader->lpBuf[pReader->nPos])) {
+		pReader->nPos++;
+	}
+}
+
+static void PutXmlScratchUtf8(
+	PXML_STREAM_READER pReader,
+	unsigned long ulCode
+) {
+	// a character reference is never shorter than its UTF-8 form,
+	// so the scratch buffer (as large as the input) cannot overflow
+	char* p = &pReader->lpScratch[pReader->nScratchPos];
+	if (ulCode < 0x80) {
+		p[0] = (char)ulCode;
+		pReader->nScratchPos += 1;
+	}
+	else if (ulCode < 0x800) {
+		p[0] = (char)(0xc0 | (ulCode >> 6));
+		p[1] = (char)(0x80 | (ulCode & 0x3f));
+		pReader->nScratchPos += 2;
+	}
+	else if (ulCode < 0x10000) {
+		p[0] = (char)(0xe0 | (ulCode >> 12));
+		p[1] = (char)(0x80 | ((ulCode >> 6) & 0x3f));
+		p[2] = (char)(0x80 | (ulCode & 0x3f));
+		pReader->nScratchPos += 3;
+	}
+	else {
+		p[0] = (char)(0xf0 | (ulCode >> 18));
+		p[1] = (char)(0x80 | ((ulCode >> 12) & 0x3f));
+		p[2] = (char)(0x80 | ((ulCode >> 6) & 0x3f));
+		p[3] = (char)(0x80 | (ulCode & 0x3f));
+		pReader->nScratchPos += 4;
+	}
+}
+
+// Copies [nBegin, nEnd) of the input to the scratch buffer, decoding the
+// predefined entities and character references and normalizing the line ends
+static const char* CopyXmlValue(
+	PXML_STREAM_READER pReader,
+	size_t nBegin,
+	size_t nEnd,
+	int bAttribute
+) {
+	static const struct {
+		const char* pszName;
+		size_t nLen;
+		char c;
+	} entity[] = {
+		{ "&lt;", 4, '<' }, { "&gt;", 4, '>' }, { "&amp;", 5, '&' },
+		{ "&quot;", 6, '"' }, { "&apos;", 6, '\'' }
+	};
+	const char* pszValue = &pReader->lpScratch[pReader->nScratchPos];
+	const char* lpBuf = pReader->lpBuf;
+	size_t i = nBegin;
+	while (i < nEnd) {
+		if (lpBuf[i] == '&') {
+			if (i + 2 < nEnd && lpBuf[i + 1] == '#') {
+				char* pEnd = NULL;
+				unsigned long ulCode = lpBuf[i + 2] == 'x'
+					? strtoul(&lpBuf[i + 3], &pEnd, 16) : strtoul(&lpBuf[i + 2], &pEnd, 10);
+				if (!pEnd || *pEnd != ';' || (size_t)(pEnd - lpBuf) >= nEnd || ulCode > 0x10ffff) {
+					return NULL;
+				}
+				PutXmlScratchUtf8(pReader, ulCode);
+				i = (size_t)(pEnd - lpBuf) + 1;
+				continue;
+			}
+			size_t j = 0;
+			for (; j < sizeof(entity) / sizeof(entity[0]); j++) {
+				if (i + entity[j].nLen <= nEnd &&
+					!memcmp(&lpBuf[i], entity[j].pszName, entity[j].nLen)) {
+					break;
+				}
+			}
+			if (j == sizeof(entity) / sizeof(entity[0])) {
+				return NULL;
+			}
+			pReader->lpScratch[pReader->nScratchPos++] = entity[j].c;
+			i += entity[j].nLen;
+		}
+		else if (lpBuf[i] == '\r') {
+			if (i + 1 < nEnd && lpBuf[i + 1] == '\n') {
+				i++;
+			}
+			else {
+				pReader->lpScratch[pReader->nScratchPos++] = bAttribute ? ' ' : '\n';
+				i++;
+			}
+		}
+		else if (bAttribute && IsXmlSpace(lpBuf[i])) {
+			pReader->lpScratch[pReader->nScratchPos++] = ' ';
+			i++;
+		}
+		else {
+			pReader->lpScratch[pReader->nScratchPos++] = lpBuf[i++];
+		}
+	}
+	pReader->lpScratch[pReader->nScratchPos++] = '\0';
+	return pszValue;
+}
+
+static const char* CopyXmlName(
+	PXML_STREAM_READER pReader
+) {
+	size_t nBegin = pReader->nPos;
+	while (pReader->nPos < pReader->nLen && !IsXmlNameEnd(pReader->lpBuf[pReader->nPos])) {
+		pReader->nPos++;
+	}
+	if (nBegin == pReader->nPos) {
+		return NULL;
+	}
+	const char* pszName = &pReader->lpScratch[pReader->nScratchPos];
+	size_t nLen = pReader->nPos - nBegin;
+	memcpy(&pReader->lpScratch[pReader->nScratchPos], &pReader->lpBuf[nBegin], nLen);
+	pReader->nScratchPos += nLen;
+	pReader->lpScratch[pReader->nScratchPos++] = '\0';
+	return pszName;
+}
+
+int InitXmlStreamReader(
+	PXML_STREAM_READER pReader,
+	FILE* fp
+) {
+	memset(pReader, 0, sizeof(XML_STREAM_READER));
+	if (fseek(fp, 0, SEEK_END)) {
+		return 0;
+	}
+	long lSize = ftell(fp);
+	if (lSize < 0 || fseek(fp, 0, SEEK_SET)) {
+		return 0;
+	}
+	pReader->nLen = (size_t)lSize;
+	// the scratch holds the names and decoded values of one node, and these
+	// are never longer than the markup they come from
+	pReader->lpBuf = (char*)calloc(pReader->nLen + 1, sizeof(char));
+	pReader->lpScratch = (char*)calloc(pReader->nLen + 1, sizeof(char));
+	if (!pReader->lpBuf || !pReader->lpScratch ||
+		fread(pReader->lpBuf, sizeof(char), pReader->nLen, fp) != pReader->nLen) {
+		TerminateXmlStreamReader(pReader);
+		return 0;
+	}
+	if (pReader->nLen >= 3 && !memcmp(pReader->lpBuf, "\xef\xbb\xbf", 3)) {
+		pReader->nPos = 3;
+	}
+	return 1;
+}
+
+// Returns the next element, text or end element, skipping the xml declaration,
+// processing instructions, comments, the DOCTYPE and whitespace-only text.
+// An empty element <a/> is returned as an element followed by its end element.
+XML_STREAM_NODE ReadXmlStreamNode(
+	PXML_STREAM_READER pReader
+) {
+	if (pReader->bPendingEnd) {
+		pReader->bPendingEnd = 0;
+		pReader->nAttributeNum = 0;
+		return XmlStreamEndElement;
+	}
+	for (;;) {
+		pReader->nScratchPos = 0;
+		pReader->nAttributeNum = 0;
+		pReader->pszName = NULL;
+		pReader->pszValue = NULL;
+		if (pReader->nPos >= pReader->nLen) {
+			return XmlStreamNone;
+		}
+		const char* p = &pReader->lpBuf[pReader->nPos];
+		size_t nRemain = pReader->nLen - pReader->nPos;
+
+		if (*p != '<') {
+			size_t nBegin = pReader->nPos;
+			int bSpaceOnly = 1;
+			while (pReader->nPos < pReader->nLen && pReader->lpBuf[pReader->nPos] != '<') {
+				if (!IsXmlSpace(pReader->lpBuf[pReader->nPos])) {
+					bSpaceOnly = 0;
+				}
+				pReader->nPos++;
+			}
+			if (bSpaceOnly) {
+				continue;
+			}
+			if (!(pReader->pszValue = CopyXmlValue(pReader, nBegin, pReader->nPos, 0))) {
+				return XmlStreamError;
+			}
+			return XmlStreamText;
+		}
+		else if (nRemain >= 4 && !memcmp(p, "<!--", 4)) {
+			if (!SkipXmlUntil(pReader, "-->")) {
+				return XmlStreamError;
+			}
+		}
+		else if (nRemain >= 9 && !memcmp(p, "<![CDATA[", 9)) {
+			size_t nBegin = pReader->nPos + 9;
+			pReader->nPos = nBegin;
+			if (!SkipXmlUntil(pReader, "]]>")) {
+				return XmlStreamError;
+			}
+			size_t nLen = pReader->nPos - 3 - nBegin;
+			memcpy(pReader->lpScratch, &pReader->lpBuf[nBegin], nLen);
+			pReader->lpScratch[nLen] = '\0';
+			pReader->pszValue = pReader->lpScratch;
+			return XmlStreamText;
+		}
+		else if (nRemain >= 2 && p[1] == '?') {
+			if (!SkipXmlUntil(pReader, "?>")) {
+				return XmlStreamError;
+			}
+		}
+		else if (nRemain >= 2 && p[1] == '!') {
+			// DOCTYPE, with or without an internal subset
+			int bSubset = 0;
+			for (; pReader->nPos < pReader->nLen; pReader->nPos++) {
+				char c = pReader->lpBuf[pReader->nPos];
+				if (c == '[') {
+					bSubset = 1;
+				}
+				else if (c == ']') {
+					bSubset = 0;
+				}
+				else if (c == '>' && !bSubset) {
+					break;
+				}
+			}
+			if (pReader->nPos++ >= pReader->nLen) {
+				return XmlStreamError;
+			}
+		}
+		else if (nRemain >= 2 && p[1] == '/') {
+			pReader->nPos += 2;
+			if (!(pReader->pszName = CopyXmlName(pReader))) {
+				return XmlStreamError;
+			}
+			SkipXmlSpace(pReader);
+			if (pReader->nPos >= pReader->nLen || pReader->lpBuf[pReader->nPos] != '>') {
+				return XmlStreamError;
+			}
+			pReader->nPos++;
+			return XmlStreamEndElement;
+		}
+		else {
+			pReader->nPos++;
+			if (!(pReader->pszName = CopyXmlName(pReader))) {
+				return XmlStreamError;
+			}
+			for (;;) {
+				SkipXmlSpace(pReader);
+				if (pReader->nPos >= pReader->nLen) {
+					return XmlStreamError;
+				}
+				char c = pReader->lpBuf[pReader->nPos];
+				if (c == '>') {
+					pReader->nPos++;
+					break;
+				}
+				else if (c == '/') {
+					if (pReader->nPos + 1 >= pReader->nLen || pReader->lpBuf[pReader->nPos + 1] != '>') {
+						return XmlStreamError;
+					}
+					pReader->nPos += 2;
+					pReader->bPendingEnd = 1;
+					break;
+				}
+				if (pReader->nAttributeNum >= XML_STREAM_MAX_ATTRIBUTE) {
+					return XmlStreamError;
+				}
+				const char* pszAttributeName = CopyXmlName(pReader);
+				if (!pszAttributeName) {
+					return XmlStreamError;
+				}
+				SkipXmlSpace(pReader);
+				if (pReader->nPos >= pReader->nLen || pReader->lpBuf[pReader->nPos] != '=') {
+					return XmlStreamError;
+				}
+				pReader->nPos++;
+				SkipXmlSpace(pReader);
+				if (pReader->nPos >= pReader->nLen) {
+					return XmlStreamError;
+				}
+				char cQuote = pReader->lpBuf[pReader->nPos];
+				if (cQuote != '"' && cQuote != '\'') {
+					return XmlStreamError;
+				}
+				size_t nBegin = ++pReader->nPos;
+				while (pReader->nPos < pReader->nLen && pReader->lpBuf[pReader->nPos] != cQuote) {
+					pReader->nPos++;
+				}
+				if (pReader->nPos >= pReader->nLen) {
+					return XmlStreamError;
+				}
+				const char* pszAttributeValue = CopyXmlValue(pReader, nBegin, pReader->nPos, 1);
+				if (!pszAttributeValue) {
+					return XmlStreamError;
+				}
+				pReader->nPos++;
+				pReader->pszAttributeName[pReader->nAttributeNum] = pszAttributeName;
+				pReader->pszAttributeValue[pReader->nAttributeNum] = pszAttributeValue;
+				pReader->nAttributeNum++;
+			}
+			return XmlStreamElement;
+		}
+	}
+}
+
+void TerminateXmlStreamReader(
+	PXML_STREAM_READER pReader
+) {
+	free(pReader->lpBuf);
+	free(pReader->lpScratch);
+	pReader->lpBuf = NULL;
+	pReader->lpScratch = NULL;
+}
+
+static void PutXml(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszStr,
+	size_t nLen
+) {
+	if (nLen && fwrite(pszStr, sizeof(char), nLen, pWriter->fp) != nLen) {
+		pWriter->bErr = 1;
+	}
+}
+
+static void PutXmlString(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszStr
+) {
+	PutXml(pWriter, pszStr, strlen(pszStr));
+}
+
+// XmlLite escapes these in both text and attributes;
+// the quote and the whitespace other than the space only in attributes
+static void PutXmlEscaped(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszStr,
+	int bAttribute
+) {
+	const char* pBegin = pszStr;
+	for (const char* p = pszStr; *p; p++) {
+		const char* pszEntity = NULL;
+		switch (*p) {
+		case '&':
+			pszEntity = "&amp;";
+			break;
+		case '<':
+			pszEntity = "&lt;";
+			break;
+		case '>':
+			pszEntity = "&gt;";
+			break;
+		case '\r':
+			pszEntity = "&#xD;";
+			break;
+		case '"':
+			pszEntity = bAttribute ? "&quot;" : NULL;
+			break;
+		case '\t':
+			pszEntity = bAttribute ? "&#x9;" : NULL;
+			break;
+		case '\n':
+			pszEntity = bAttribute ? "&#xA;" : NULL;
+			break;
+		default:
+			break;
+		}
+		if (pszEntity) {
+			PutXml(pWriter, pBegin, (size_t)(p - pBegin));
+			PutXmlString(pWriter, pszEntity);
+			pBegin = p + 1;
+		}
+	}
+	PutXmlString(pWriter, pBegin);
+}
+
+static void PutXmlIndent(
+	PXML_STREAM_WRITER pWriter
+) {
+	if (pWriter->bWritten) {
+		PutXml(pWriter, "\r\n", 2);
+		for (int i = 0; i < pWriter->nDepth; i++) {
+			PutXml(pWriter, "  ", 2);
+		}
+	}
+	pWriter->bWritten = 1;
+}
+
+static void CloseXmlStartTag(
+	PXML_STREAM_WRITER pWriter
+) {
+	if (pWriter->bStartTagOpen) {
+		PutXml(pWriter, ">", 1);
+		pWriter->bStartTagOpen = 0;
+	}
+}
+
+void InitXmlStreamWriter(
+	PXML_STREAM_WRITER pWriter,
+	FILE* fp
+) {
+	memset(pWriter, 0, sizeof(XML_STREAM_WRITER));
+	pWriter->fp = fp;
+}
+
+int WriteXmlStreamStartDocument(
+	PXML_STREAM_WRITER pWriter
+) {
+	// the BOM and the declaration of XmlLite's default UTF-8 output
+	PutXmlString(pWriter, "\xef\xbb\xbf<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+	pWriter->bWritten = 1;
+	return !pWriter->bErr;
+}
+
+int WriteXmlStreamDocType(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszName,
+	const char* pszPubId,
+	const char* pszSysId
+) {
+	PutXmlIndent(pWriter);
+	PutXmlString(pWriter, "<!DOCTYPE ");
+	PutXmlString(pWriter, pszName);
+	if (pszPubId) {
+		PutXmlString(pWriter, " PUBLIC \"");
+		PutXmlString(pWriter, pszPubId);
+		PutXmlString(pWriter, "\" \"");
+		PutXmlString(pWriter, pszSysId ? pszSysId : "");
+		PutXml(pWriter, "\"", 1);
+	}
+	else if (pszSysId) {
+		PutXmlString(pWriter, " SYSTEM \"");
+		PutXmlString(pWriter, pszSysId);
+		PutXml(pWriter, "\"", 1);
+	}
+	PutXml(pWriter, ">", 1);
+	return !pWriter->bErr;
+}
+
+int WriteXmlStreamStartElement(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszName
+) {
+	size_t nLen = strlen(pszName);
+	if (pWriter->nDepth >= XML_STREAM_MAX_DEPTH || nLen >= sizeof(pWriter->szName[0])) {
+		pWriter->bErr = 1;
+		return 0;
+	}
+	CloseXmlStartTag(pWriter);
+	if (pWriter->nDepth > 0) {
+		pWriter->bHasChild[pWriter->nDepth - 1] = 1;
+	}
+	PutXmlIndent(pWriter);
+	PutXml(pWriter, "<", 1);
+	PutXml(pWriter, pszName, nLen);
+	memcpy(pWriter->szName[pWriter->nDepth], pszName, nLen + 1);
+	pWriter->bHasChild[pWriter->nDepth] = 0;
+	pWriter->nDepth++;
+	pWriter->bStartTagOpen = 1;
+	return !pWriter->bErr;
+}
+
+int WriteXmlStreamAttribute(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszName,
+	const char* pszValue
+) {
+	if (!pWriter->bStartTagOpen) {
+		pWriter->bErr = 1;
+		return 0;
+	}
+	PutXml(pWriter, " ", 1);
+	PutXmlString(pWriter, pszName);
+	PutXml(pWriter, "=\"", 2);
+	PutXmlEscaped(pWriter, pszValue, 1);
+	PutXml(pWriter, "\"", 1);
+	return !pWriter->bErr;
+}
+
+int WriteXmlStreamString(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszText
+) {
+	CloseXmlStartTag(pWriter);
+	PutXmlEscaped(pWriter, pszText, 0);
+	return !pWriter->bErr;
+}
+
+int WriteXmlStreamEndElement(
+	PXML_STREAM_WRITER pWriter
+) {
+	if (pWriter->nDepth == 0) {
+		pWriter->bErr = 1;
+		return 0;
+	}
+	pWriter->nDepth--;
+	if (pWriter->bStartTagOpen) {
+		PutXml(pWriter, " />", 3);
+		pWriter->bStartTagOpen = 0;
+	}
+	else {
+		if (pWriter->bHasChild[pWriter->nDepth]) {
+			PutXmlIndent(pWriter);
+		}
+		PutXml(pWriter, "</", 2);
+		PutXmlString(pWriter, pWriter->szName[pWriter->nDepth]);
+		PutXml(pWriter, ">", 1);
+	}
+	return !pWriter->bErr;
+}
+
+int WriteXmlStreamEndDocument(
+	PXML_STREAM_WRITER pWriter
+) {
+	while (pWriter->nDepth > 0) {
+		WriteXmlStreamEndElement(pWriter);
+	}
+	if (fflush(pWriter->fp)) {
+		pWriter->bErr = 1;
+	}
+	return !pWriter->bErr;
+}
+
+int WriteXmlStreamRom(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszName,
+	unsigned long long ullSize,
+	unsigned long ulCrc32,
+	const unsigned char* lpMd5,
+	const unsigned char* lpSha1
+) {
+	char buf[64] = { 0 };
+	WriteXmlStreamStartElement(pWriter, "rom");
+	WriteXmlStreamAttribute(pWriter, "name", pszName);
+	snprintf(buf, sizeof(buf), "%llu", ullSize);
+	WriteXmlStreamAttribute(pWriter, "size", buf);
+	snprintf(buf, sizeof(buf), "%08lx", ulCrc32);
+	WriteXmlStreamAttribute(pWriter, "crc", buf);
+	for (int i = 0; i < 16; i++) {
+		snprintf(&buf[i * 2], 3, "%02x", lpMd5[i]);
+	}
+	WriteXmlStreamAttribute(pWriter, "md5", buf);
+	for (int i = 0; i < 20; i++) {
+		snprintf(&buf[i * 2], 3, "%02x", lpSha1[i]);
+	}
+	WriteXmlStreamAttribute(pWriter, "sha1", buf);
+	return WriteXmlStreamEndElement(pWriter);
+}
+
+// Writes the dat from the default.dat template. The name attribute of <game>
+// and the text "foo" of <description> are replaced with pszGameName, and
+// lpGameEnd adds the roms to <game>.
+// return: 1 if OK, 0 if the write or lpGameEnd failed, -1 if the template is malformed
+int CopyXmlStreamDat(
+	PXML_STREAM_READER pReader,
+	PXML_STREAM_WRITER pWriter,
+	const char* pszGameName,
+	LPXML_STREAM_GAME_END lpGameEnd,
+	void* lpContext
+) {
+	if (!WriteXmlStreamStartDocument(pWriter) ||
+		!WriteXmlStreamDocType(pWriter, "datafile"
+		, "-//Logiqx//DTD ROM Management Datafile//EN", "http://www.logiqx.com/Dats/datafile.dtd")) {
+		return 0;
+	}
+	char szLocalName[64] = { 0 };
+	XML_STREAM_NODE nodeType = XmlStreamNone;
+	while ((nodeType = ReadXmlStreamNode(pReader)) != XmlStreamNone) {
+		switch (nodeType) {
+		case XmlStreamElement:
+			strncpy(szLocalName, pReader->pszName, sizeof(szLocalName) - 1);
+			if (!WriteXmlStreamStartElement(pWriter, pReader->pszName)) {
+				return 0;
+			}
+			if (!strcmp(pReader->pszName, "game")) {
+				for (int i = 0; i < pReader->nAttributeNum; i++) {
+					if (!strcmp(pReader->pszAttributeName[i], "name")) {
+						if (!WriteXmlStreamAttribute(pWriter, "name", pszGameName)) {
+							return 0;
+						}
+					}
+				}
+			}
+			break;
+		case XmlStreamText:
+			if (!strcmp(szLocalName, "description") && !strcmp(pReader->pszValue, "foo")) {
+				if (!WriteXmlStreamString(pWriter, pszGameName)) {
+					return 0;
+				}
+			}
+			else {
+				if (!WriteXmlStreamString(pWriter, pReader->pszValue)) {
+					return 0;
+				}
+			}
+			break;
+		case XmlStreamEndElement:
+			if (!strcmp(pReader->pszName, "game") && lpGameEnd) {
+				if (!lpGameEnd(pWriter, lpContext)) {
+					return 0;
+				}
+			}
+			if (!WriteXmlStreamEndElement(pWriter)) {
+				return 0;
+			}
+			break;
+		case XmlStreamError:
+			return -1;
+		default:
+			break;
+		}
+	}
+	return WriteXmlStreamEndDocument(pWriter);
+}
@@ -0,0 +1,132 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+// Portable streaming dat writer and the minimal template reader.
+// Uses the C runtime only, so it builds with any compiler and the output
+// is byte-identical to what XmlLite wrote with XmlWriterProperty_Indent.
+#include <stdio.h>
+
+#define XML_STREAM_MAX_DEPTH		16
+#define XML_STREAM_MAX_ATTRIBUTE	16
+
+typedef enum _XML_STREAM_NODE {
+	XmlStreamNone,
+	XmlStreamElement,
+	XmlStreamText,
+	XmlStreamEndElement,
+	XmlStreamError
+} XML_STREAM_NODE;
+
+typedef struct _XML_STREAM_READER {
+	char* lpBuf;
+	char* lpScratch;
+	size_t nLen;
+	size_t nPos;
+	size_t nScratchPos;
+	int bPendingEnd;
+	const char* pszName;
+	const char* pszValue;
+	int nAttributeNum;
+	const char* pszAttributeName[XML_STREAM_MAX_ATTRIBUTE];
+	const char* pszAttributeValue[XML_STREAM_MAX_ATTRIBUTE];
+} XML_STREAM_READER, *PXML_STREAM_READER;
+
+typedef struct _XML_STREAM_WRITER {
+	FILE* fp;
+	int bErr;
+	int bWritten;
+	int bStartTagOpen;
+	int nDepth;
+	int bHasChild[XML_STREAM_MAX_DEPTH];
+	char szName[XML_STREAM_MAX_DEPTH][64];
+} XML_STREAM_WRITER, *PXML_STREAM_WRITER;
+
+int InitXmlStreamReader(
+	PXML_STREAM_READER pReader,
+	FILE* fp
+);
+
+XML_STREAM_NODE ReadXmlStreamNode(
+	PXML_STREAM_READER pReader
+);
+
+void TerminateXmlStreamReader(
+	PXML_STREAM_READER pReader
+);
+
+void InitXmlStreamWriter(
+	PXML_STREAM_WRITER pWriter,
+	FILE* fp
+);
+
+int WriteXmlStreamStartDocument(
+	PXML_STREAM_WRITER pWriter
+);
+
+int WriteXmlStreamDocType(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszName,
+	const char* pszPubId,
+	const char* pszSysId
+);
+
+int WriteXmlStreamStartElement(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszName
+);
+
+int WriteXmlStreamAttribute(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszName,
+	const char* pszValue
+);
+
+int WriteXmlStreamString(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszText
+);
+
+int WriteXmlStreamEndElement(
+	PXML_STREAM_WRITER pWriter
+);
+
+int WriteXmlStreamEndDocument(
+	PXML_STREAM_WRITER pWriter
+);
+
+int WriteXmlStreamRom(
+	PXML_STREAM_WRITER pWriter,
+	const char* pszName,
+	unsigned long long ullSize,
+	unsigned long ulCrc32,
+	const unsigned char* lpMd5,
+	const unsigned char* lpSha1
+);
+
+// Called at the end of <game> of the template, before </game> is written.
+// Returns 0 to stop the copy
+typedef int (*LPXML_STREAM_GAME_END)(
+	PXML_STREAM_WRITER pWriter,
+	void* lpContext
+);
+
+int CopyXmlStreamDat(
+	PXML_STREAM_READER pReader,
+	PXML_STREAM_WRITER pWriter,
+	const char* pszGameName,
+	LPXML_STREAM_GAME_END lpGameEnd,
+	void* lpContext
+);
@@ -0,0 +1,83 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "test.h"
+
+INT g_nTestFailNum = 0;
+
+// The modules are linked except DiscImageCreator.cpp, so the global of it is
+// defined here
+BYTE g_aSyncHeader[SYNC_SIZE] = {
+	0x00, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0x00
+};
+
+typedef struct _TEST_CASE {
+	LPCSTR szName;
+	VOID(*lpFunc)(VOID);
+} TEST_CASE, *PTEST_CASE;
+
+static CONST TEST_CASE s_testCase[] = {
+	{ "calcHash", TestCalcHash },
+	{ "check", TestCheck },
+	{ "convert", TestConvert },
+	{ "dvdUnscrambler", TestDvdUnscrambler },
+	{ "eccRtoW", TestEccRtoW },
+	{ "errorMap", TestErrorMap },
+	{ "fileSystem", TestFileSystem },
+	{ "outputMds", TestOutputMds },
+	{ "rawCacheStrategy", TestRawCacheStrategy },
+	{ "readQueue", TestReadQueue },
+	{ "scanPattern", TestScanPattern },
+	{ "skipRegion", TestSkipRegion },
+	{ "syncSearch", TestSyncSearch },
+	{ "voter", TestVoter },
+	{ "xmlStream", TestXmlStream },
+};
+
+// The files which the tests write are in the temp directory
+VOID GetTestTempPath(
+	LPTSTR pszPath,
+	LPCTSTR pszFname
+) {
+	if (!GetTempPath(_MAX_PATH, pszPath)) {
+		_tcscpy(pszPath, _T(".\\"));
+	}
+	_tcscat(pszPath, pszFname);
+}
+
+// Runs all tests, or only the test of argv[1]. The test data is read from
+// the "data" directory of the current directory (= this project directory
+// when it runs as the post-build event).
+int main(int argc, char* argv[])
+{
+	INT nRunNum = 0;
+	for (size_t i = 0; i < sizeof(s_testCase) / sizeof(s_testCase[0]); i++) {
+		if (argc >= 2 && strcmp(argv[1], s_testCase[i].szName)) {
+			continue;
+		}
+		INT nFailNum = g_nTestFailNum;
+		s_testCase[i].lpFunc();
+		printf("[%s] %s\n", s_testCase[i].szName, nFailNum == g_nTestFailNum ? "OK" : "NG");
+		nRunNum++;
+	}
+	if (nRunNum == 0) {
+		fprintf(stderr, "No test: %s\n", argc >= 2 ? argv[1] : "");
+		return EXIT_FAILURE;
+	}
+	printf("%d test(s), %d failure(s)\n", nRunNum, g_nTestFailNum);
+	return g_nTestFailNum ? EXIT_FAILURE : EXIT_SUCCESS;
+}
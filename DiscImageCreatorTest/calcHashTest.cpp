@@ -0,0 +1,187 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/calcHash.h"
+#include "test.h"
+
+// The scalar reference of the sub-Q check is update_crc16 of 10 bytes
+static BOOL IsValidSubQByScalar(
+	LPBYTE lpSubQ
+) {
+	WORD crc16 = GetCrc16CCITT(SUBQ_CRC_DATA_SIZE, lpSubQ);
+	return lpSubQ[10] == HIBYTE(crc16) && lpSubQ[11] == LOBYTE(crc16);
+}
+
+static VOID SetSubQCrcByScalar(
+	LPBYTE lpSubQ
+) {
+	WORD crc16 = GetCrc16CCITT(SUBQ_CRC_DATA_SIZE, lpSubQ);
+	lpSubQ[10] = HIBYTE(crc16);
+	lpSubQ[11] = LOBYTE(crc16);
+}
+
+// track 1, index 1, 00:00:00, AMSF 00:02:00 and track 2, index 0 of a data disc
+static CONST BYTE s_aSubQ[][12] = {
+	{ 0x41, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00 },
+	{ 0x01, 0x02, 0x00, 0x00, 0x01, 0x74, 0x00, 0x12, 0x34, 0x56, 0x00, 0x00 },
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+	{ 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00 },
+};
+
+// every value of every byte, and every value of every pair of 2 bytes
+static VOID TestCrc16SubQ(
+	VOID
+) {
+	for (size_t n = 0; n < sizeof(s_aSubQ) / sizeof(s_aSubQ[0]); n++) {
+		for (INT i = 0; i < SUBQ_CRC_DATA_SIZE; i++) {
+			for (INT j = i; j < SUBQ_CRC_DATA_SIZE; j++) {
+				BYTE subQ[12] = { 0 };
+				memcpy(subQ, s_aSubQ[n], sizeof(subQ));
+				INT nFail = 0;
+				for (INT v = 0; v <= USHRT_MAX; v++) {
+					subQ[i] = HIBYTE(v);
+					subQ[j] = LOBYTE(v);
+					if (GetCrc16SubQ(subQ) != GetCrc16CCITT(SUBQ_CRC_DATA_SIZE, subQ)) {
+						nFail++;
+					}
+				}
+				TEST_CHECK(nFail == 0);
+			}
+		}
+	}
+}
+
+// 65536 values of the crc16 field of each message are checked 64 frames at a
+// time, so only 1 bit of 1024 masks is on
+static VOID TestValidSubQMaskOfAllCrc(
+	VOID
+) {
+	BYTE buf[64][12] = { 0 };
+	for (size_t n = 0; n < sizeof(s_aSubQ) / sizeof(s_aSubQ[0]); n++) {
+		INT nValidNum = 0;
+		INT nFail = 0;
+		for (INT v = 0; v <= USHRT_MAX; v += 64) {
+			UINT64 ullScalar = 0;
+			for (INT k = 0; k < 64; k++) {
+				memcpy(buf[k], s_aSubQ[n], sizeof(buf[0]));
+				buf[k][10] = HIBYTE(v + k);
+				buf[k][11] = LOBYTE(v + k);
+				if (IsValidSubQByScalar(buf[k])) {
+					ullScalar |= 1ULL << k;
+					nValidNum++;
+				}
+			}
+			if (GetValidSubQMask(buf[0], sizeof(buf[0]), 64) != ullScalar) {
+				nFail++;
+			}
+		}
+		TEST_CHECK(nFail == 0);
+		TEST_CHECK(nValidNum == 1);
+	}
+}
+
+// every value of every pair of 2 bytes of the message. The even frames have
+// the valid crc16, and 1 bit of the crc16 of the odd frames is flipped
+static VOID TestValidSubQMaskOfAllMessage(
+	VOID
+) {
+	BYTE buf[64][12] = { 0 };
+	for (INT i = 0; i < SUBQ_CRC_DATA_SIZE; i++) {
+		for (INT j = i + 1; j < SUBQ_CRC_DATA_SIZE; j++) {
+			INT nFail = 0;
+			for (INT v = 0; v <= USHRT_MAX; v += 64) {
+				UINT64 ullScalar = 0;
+				for (INT k = 0; k < 64; k++) {
+					memcpy(buf[k], s_aSubQ[0], sizeof(buf[0]));
+					buf[k][i] = HIBYTE(v + k);
+					buf[k][j] = LOBYTE(v + k);
+					SetSubQCrcByScalar(buf[k]);
+					if (k % 2) {
+						buf[k][10 + k / 2 % 2] ^= (BYTE)(1 << (k / 4 % CHAR_BIT));
+					}
+					if (IsValidSubQByScalar(buf[k])) {
+						ullScalar |= 1ULL << k;
+					}
+				}
+				if (ullScalar != 0x5555555555555555ULL ||
+					GetValidSubQMask(buf[0], sizeof(buf[0]), 64) != ullScalar) {
+					nFail++;
+				}
+			}
+			TEST_CHECK(nFail == 0);
+		}
+	}
+}
+
+// the sub-Q of the 96 bytes subcode, and the number of the frames
+static VOID TestValidSubQMaskOfStride(
+	VOID
+) {
+	CONST INT nFrameNum = 100;
+	LPBYTE lpBuf = (LPBYTE)calloc(nFrameNum, CD_RAW_READ_SUBCODE_SIZE);
+	TEST_CHECK(lpBuf != NULL);
+	if (!lpBuf) {
+		return;
+	}
+	for (INT k = 0; k < nFrameNum; k++) {
+		LPBYTE lpSubQ = lpBuf + CD_RAW_READ_SUBCODE_SIZE * k + 12;
+		memcpy(lpSubQ, s_aSubQ[1], 12);
+		lpSubQ[9] = (BYTE)k;
+		SetSubQCrcByScalar(lpSubQ);
+		// the P channel and the R-W channel aren't checked
+		memset(lpSubQ - 12, 0xff, 12);
+		memset(lpSubQ + 12, 0xff, CD_RAW_READ_SUBCODE_SIZE - 24);
+	}
+	lpBuf[CD_RAW_READ_SUBCODE_SIZE * 3 + 12 + 11] ^= 0x80;
+	lpBuf[CD_RAW_READ_SUBCODE_SIZE * 70 + 12 + 0] ^= 0x01;
+	TEST_CHECK(GetValidSubQMask(lpBuf + 12, CD_RAW_READ_SUBCODE_SIZE, 64) == ~(1ULL << 3));
+	TEST_CHECK(GetValidSubQMask(lpBuf + 12, CD_RAW_READ_SUBCODE_SIZE, 5) == 0x17);
+	TEST_CHECK(GetValidSubQMask(lpBuf + 12, CD_RAW_READ_SUBCODE_SIZE, 0) == 0);
+	// up to 64 frames
+	TEST_CHECK(GetValidSubQMask(lpBuf + CD_RAW_READ_SUBCODE_SIZE * 30 + 12
+		, CD_RAW_READ_SUBCODE_SIZE, nFrameNum - 30) == ~(1ULL << (70 - 30)));
+	free(lpBuf);
+}
+
+// the crc16 is updated by the difference of the byte
+static VOID TestUpdateCrc16SubQ(
+	VOID
+) {
+	for (size_t n = 0; n < sizeof(s_aSubQ) / sizeof(s_aSubQ[0]); n++) {
+		BYTE subQ[12] = { 0 };
+		memcpy(subQ, s_aSubQ[n], sizeof(subQ));
+		SetSubQCrcByScalar(subQ);
+		INT nFail = 0;
+		for (INT i = 0; i < SUBQ_CRC_DATA_SIZE; i++) {
+			for (INT v = 0; v <= UCHAR_MAX; v++) {
+				UpdateCrc16SubQ(subQ, i, (BYTE)v);
+				if (subQ[i] != v || !IsValidSubQByScalar(subQ)) {
+					nFail++;
+				}
+			}
+		}
+		TEST_CHECK(nFail == 0);
+	}
+}
+
+VOID TestCalcHash(
+	VOID
+) {
+	TestCrc16SubQ();
+	TestValidSubQMaskOfAllCrc();
+	TestValidSubQMaskOfAllMessage();
+	TestValidSubQMaskOfStride();
+	TestUpdateCrc16SubQ();
+}
@@ -0,0 +1,159 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/check.h"
+#include "test.h"
+
+static UINT64 Rand64(
+	VOID
+) {
+	UINT64 x = 0;
+	for (INT i = 0; i < 4; i++) {
+		x = (x << 16) | (UINT64)(rand() & 0xffff);
+	}
+	return x;
+}
+
+// The bit scans and the popcount must be same as the scan bit by bit
+static BOOL IsSameAsBitScan(
+	UINT64 x
+) {
+	INT nNum = 0;
+	INT nFirstFromMsb = -1;
+	INT nLastFromMsb = -1;
+	INT nFirstFromLsb = -1;
+	for (INT n = 0; n < 64; n++) {
+		if (x & (0x8000000000000000ULL >> n)) {
+			nNum++;
+			if (nFirstFromMsb == -1) {
+				nFirstFromMsb = n;
+			}
+			nLastFromMsb = n;
+		}
+		if (nFirstFromLsb == -1 && (x & (1ULL << n))) {
+			nFirstFromLsb = n;
+		}
+	}
+	if (PopCount64(x) != nNum) {
+		return FALSE;
+	}
+	// the scans are undefined if x is 0
+	if (x == 0) {
+		return TRUE;
+	}
+	return GetFirstBitFromMsb64(x) == nFirstFromMsb &&
+		GetLastBitFromMsb64(x) == nLastFromMsb &&
+		GetFirstBitFromLsb64(x) == nFirstFromLsb;
+}
+
+static VOID TestBitScan(
+	VOID
+) {
+	TEST_CHECK(IsSameAsBitScan(0));
+	TEST_CHECK(IsSameAsBitScan(~0ULL));
+	INT nFail = 0;
+	for (INT n = 0; n < 64; n++) {
+		// single bit, all bits but one, and both 32-bit halves of the Win32 path
+		if (!IsSameAsBitScan(1ULL << n) ||
+			!IsSameAsBitScan(~(1ULL << n)) ||
+			!IsSameAsBitScan((1ULL << n) | 1ULL) ||
+			!IsSameAsBitScan((1ULL << n) | 0x8000000000000000ULL)) {
+			nFail++;
+		}
+	}
+	srand(4);
+	for (INT n = 0; n < 100000; n++) {
+		UINT64 x = Rand64();
+		// sparse words
+		if (n & 1) {
+			x &= Rand64() & Rand64();
+		}
+		if (!IsSameAsBitScan(x)) {
+			nFail++;
+		}
+	}
+	TEST_CHECK(nFail == 0);
+}
+
+// AnalyzeC2Error must be same as the loop bit by bit which it replaced
+static BOOL IsSameAsC2Loop(
+	LPBYTE lpC2
+) {
+	DWORD dwErrorBitNum = 0;
+	INT nFirstErrorByte = -1;
+	INT nLastErrorByte = -1;
+	UINT64 ullSuspectByte[(CD_RAW_READ_C2_294_SIZE + 63) / 64] = { 0 };
+	for (INT i = 0; i < CD_RAW_READ_C2_294_SIZE; i++) {
+		if (lpC2[i] != 0) {
+			ullSuspectByte[i / 64] |= 1ULL << (i % 64);
+		}
+		for (INT n = 0; n < CHAR_BIT; n++) {
+			if (lpC2[i] & (0x80 >> n)) {
+				dwErrorBitNum++;
+				if (nFirstErrorByte == -1) {
+					nFirstErrorByte = i * CHAR_BIT + n;
+				}
+				nLastErrorByte = i * CHAR_BIT + n;
+			}
+		}
+	}
+	C2_ERROR_INFO c2Info;
+	FillMemory(&c2Info, sizeof(c2Info), 0xff);
+	BOOL bRet = AnalyzeC2Error(lpC2, &c2Info);
+	return bRet == (dwErrorBitNum ? RETURNED_EXIST_C2_ERROR : RETURNED_NO_C2_ERROR_1ST) &&
+		c2Info.dwErrorBitNum == dwErrorBitNum &&
+		c2Info.nFirstErrorByte == nFirstErrorByte &&
+		c2Info.nLastErrorByte == nLastErrorByte &&
+		!memcmp(c2Info.ullSuspectByte, ullSuspectByte, sizeof(ullSuspectByte));
+}
+
+static VOID TestAnalyzeC2Error(
+	VOID
+) {
+	BYTE c2[CD_RAW_READ_C2_294_SIZE] = { 0 };
+	TEST_CHECK(IsSameAsC2Loop(c2));
+	FillMemory(c2, sizeof(c2), 0xff);
+	TEST_CHECK(IsSameAsC2Loop(c2));
+
+	INT nFail = 0;
+	for (INT i = 0; i < CD_RAW_READ_C2_294_SIZE * CHAR_BIT; i++) {
+		ZeroMemory(c2, sizeof(c2));
+		c2[i / CHAR_BIT] = (BYTE)(0x80 >> (i % CHAR_BIT));
+		if (!IsSameAsC2Loop(c2)) {
+			nFail++;
+		}
+	}
+	srand(5);
+	for (INT n = 0; n < 10000; n++) {
+		ZeroMemory(c2, sizeof(c2));
+		// a few bytes, as a scratch on the disc
+		INT nNum = rand() % 16;
+		for (INT k = 0; k < nNum; k++) {
+			c2[rand() % CD_RAW_READ_C2_294_SIZE] = (BYTE)rand();
+		}
+		if (!IsSameAsC2Loop(c2)) {
+			nFail++;
+		}
+	}
+	TEST_CHECK(nFail == 0);
+}
+
+VOID TestCheck(
+	VOID
+) {
+	TestBitScan();
+	TestAnalyzeC2Error();
+}
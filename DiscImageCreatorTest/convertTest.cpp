@@ -0,0 +1,105 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/convert.h"
+#include "test.h"
+
+// Both directions of the 8x8 transpose must be same as the *Scalar. The
+// dst is preset by byPreset: AlignRowSubcode* overwrite it, and
+// AlignColumnSubcode* OR into it.
+static BOOL IsSameAsScalar(
+	LPBYTE lpSrc,
+	BYTE byPreset
+) {
+	BYTE row[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+	BYTE rowScalar[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+	FillMemory(row, sizeof(row), byPreset);
+	FillMemory(rowScalar, sizeof(rowScalar), byPreset);
+	AlignRowSubcode(row, lpSrc);
+	AlignRowSubcodeScalar(rowScalar, lpSrc);
+	if (memcmp(row, rowScalar, sizeof(row))) {
+		return FALSE;
+	}
+
+	BYTE column[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+	BYTE columnScalar[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+	FillMemory(column, sizeof(column), byPreset);
+	FillMemory(columnScalar, sizeof(columnScalar), byPreset);
+	AlignColumnSubcode(column, lpSrc);
+	AlignColumnSubcodeScalar(columnScalar, lpSrc);
+	if (memcmp(column, columnScalar, sizeof(column))) {
+		return FALSE;
+	}
+
+	// column -> row -> column is the original
+	ZeroMemory(column, sizeof(column));
+	AlignColumnSubcode(column, row);
+	return !memcmp(column, lpSrc, sizeof(column));
+}
+
+// 0x00, 0xff and every single bit, with the dst of 0x00, 0xff and 0x5a
+static VOID TestAlignSubcodeEdge(
+	VOID
+) {
+	CONST BYTE aPreset[] = { 0x00, 0xff, 0x5a };
+	for (size_t p = 0; p < sizeof(aPreset); p++) {
+		BYTE src[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+		TEST_CHECK(IsSameAsScalar(src, aPreset[p]));
+		FillMemory(src, sizeof(src), 0xff);
+		TEST_CHECK(IsSameAsScalar(src, aPreset[p]));
+
+		INT nFail = 0;
+		for (INT i = 0; i < CD_RAW_READ_SUBCODE_SIZE * CHAR_BIT; i++) {
+			ZeroMemory(src, sizeof(src));
+			src[i / CHAR_BIT] = (BYTE)(0x80 >> (i % CHAR_BIT));
+			if (!IsSameAsScalar(src, aPreset[p])) {
+				nFail++;
+			}
+			// all bits but one
+			for (INT j = 0; j < CD_RAW_READ_SUBCODE_SIZE; j++) {
+				src[j] = (BYTE)~src[j];
+			}
+			if (!IsSameAsScalar(src, aPreset[p])) {
+				nFail++;
+			}
+		}
+		TEST_CHECK(nFail == 0);
+	}
+}
+
+static VOID TestAlignSubcodeRandom(
+	VOID
+) {
+	srand(3);
+	INT nFail = 0;
+	for (INT n = 0; n < 1000; n++) {
+		BYTE src[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+		for (INT i = 0; i < CD_RAW_READ_SUBCODE_SIZE; i++) {
+			src[i] = (BYTE)rand();
+		}
+		if (!IsSameAsScalar(src, (BYTE)rand())) {
+			nFail++;
+		}
+	}
+	TEST_CHECK(nFail == 0);
+}
+
+VOID TestConvert(
+	VOID
+) {
+	TestAlignSubcodeEdge();
+	TestAlignSubcodeRandom();
+}
@@ -0,0 +1,210 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/calcHash.h"
+#include "../DiscImageCreator/dvdUnscrambler.h"
+#include "../DiscImageCreator/execScsiCmdforDVD.h"
+#include "test.h"
+
+// The frames of the vector are laid out as the GameCube disc: the ECC block 0
+// (sector num 0x30000 - 0x3000f) is scrambled by the ECMA-267 seed and has the
+// disc header, the others are scrambled by the seed of the disc key, which is
+// another seed of the same table here. The block 0x3010 is the 16th block,
+// whose bits 7-4 of the sector num are the same as the block 0.
+#define VECTOR_BLOCK_NUM	(3)
+#define VECTOR_FRAME_NUM	(VECTOR_BLOCK_NUM * DVD_ECC_BLOCK_FRAME_NUM)
+#define VECTOR_DISC_KEY		(0x05)
+
+static CONST DWORD s_dwVectorBlock[VECTOR_BLOCK_NUM] = { 0x3000, 0x3001, 0x3010 };
+
+static CONST WORD s_wVectorSeed[DVD_ECC_BLOCK_FRAME_NUM] = {
+	0x0001, 0x5500, 0x0002, 0x2a00, 0x0004, 0x5400, 0x0008, 0x2800,
+	0x0010, 0x5000, 0x0020, 0x2001, 0x0040, 0x4002, 0x0080, 0x0005
+};
+
+static WORD GetVectorSeed(
+	DWORD dwBlock
+) {
+	INT nIdx = (INT)(dwBlock & 0x0f);
+	if (dwBlock == 0x3000) {
+		return s_wVectorSeed[nIdx];
+	}
+	return s_wVectorSeed[nIdx ^ VECTOR_DISC_KEY];
+}
+
+static VOID ScrambleVectorFrame(
+	LPBYTE lpFrame,
+	DWORD dwSectorNum,
+	LPBYTE lpMainData,
+	WORD wSeed
+) {
+	ZeroMemory(lpFrame, DVD_RAW_READ);
+	lpFrame[1] = (BYTE)(dwSectorNum >> 16);
+	lpFrame[2] = (BYTE)(dwSectorNum >> 8);
+	lpFrame[3] = (BYTE)dwSectorNum;
+	for (INT i = 0; i < 0x10000; i++) {
+		lpFrame[DVD_FRAME_IED_OFFSET] = (BYTE)(i >> 8);
+		lpFrame[DVD_FRAME_IED_OFFSET + 1] = (BYTE)i;
+		if (IsValidDvdId(lpFrame)) {
+			break;
+		}
+	}
+	// the EDC is of the frame before the main data is scrambled
+	memcpy(lpFrame + DVD_FRAME_DATA_OFFSET, lpMainData, DISC_RAW_READ_SIZE);
+	DWORD dwEdc = 0;
+	GetCrc32Ecma267(&dwEdc, lpFrame, DVD_FRAME_EDC_OFFSET);
+	LPBYTE lpEdc = lpFrame + DVD_FRAME_EDC_OFFSET;
+	lpEdc[0] = HIBYTE(HIWORD(dwEdc));
+	lpEdc[1] = LOBYTE(HIWORD(dwEdc));
+	lpEdc[2] = HIBYTE(LOWORD(dwEdc));
+	lpEdc[3] = LOBYTE(LOWORD(dwEdc));
+	// ECMA-267 16.3
+	UINT r = wSeed;
+	for (INT i = 0; i < DISC_RAW_READ_SIZE; i++) {
+		lpFrame[DVD_FRAME_DATA_OFFSET + i] ^= (BYTE)r;
+		for (INT j = 0; j < CHAR_BIT; j++) {
+			r = ((r << 1) | ((r >> 14 ^ r >> 10) & 0x01)) & 0x7fff;
+		}
+	}
+}
+
+static VOID MakeVector(
+	LPBYTE lpRaw,
+	LPBYTE lpIso
+) {
+	for (INT i = 0; i < VECTOR_FRAME_NUM; i++) {
+		DWORD dwBlock = s_dwVectorBlock[i / DVD_ECC_BLOCK_FRAME_NUM];
+		DWORD dwSectorNum = dwBlock * DVD_ECC_BLOCK_FRAME_NUM + i % DVD_ECC_BLOCK_FRAME_NUM;
+		LPBYTE lpMainData = lpIso + DISC_RAW_READ_SIZE * i;
+		for (INT j = 0; j < DISC_RAW_READ_SIZE; j++) {
+			lpMainData[j] = (BYTE)(dwSectorNum * 31 + j * 7);
+		}
+		if (i == 0) {
+			// the disc header: the game code, the maker code and the magic word
+			memcpy(lpMainData, "GALE01", 6);
+			lpMainData[0x1c] = 0xc2;
+			lpMainData[0x1d] = 0x33;
+			lpMainData[0x1e] = 0x9f;
+			lpMainData[0x1f] = 0x3d;
+		}
+		ScrambleVectorFrame(lpRaw + DVD_RAW_READ * i, dwSectorNum, lpMainData, GetVectorSeed(dwBlock));
+	}
+}
+
+// The frames are unscrambled one by one as ReadDVDRaw does. The seed of the
+// block 0 mustn't be carried to the block 0x3010, and the ECMA-267 seeds match
+// only the block 0.
+static VOID TestUnscrambleNintendoFrame(
+	PDVD_UNSCRAMBLER pUnsc,
+	LPBYTE lpRaw,
+	LPBYTE lpIso
+) {
+	BYTE lpMainData[DISC_RAW_READ_SIZE] = {};
+	InitDvdUnscrambler(pUnsc, TRUE);
+	for (INT i = 0; i < VECTOR_FRAME_NUM; i++) {
+		BOOL bRet = UnscrambleDvdFrame(pUnsc, lpRaw + DVD_RAW_READ * i, lpMainData);
+		TEST_CHECK(bRet);
+		TEST_CHECK(!memcmp(lpMainData, lpIso + DISC_RAW_READ_SIZE * i, DISC_RAW_READ_SIZE));
+	}
+	TEST_CHECK(UnscrambleDvdFrame(pUnsc, lpRaw, lpMainData));
+	TEST_CHECK(!memcmp(lpMainData, "GALE01", 6));
+
+	InitDvdUnscrambler(pUnsc, FALSE);
+	for (INT i = 0; i < VECTOR_FRAME_NUM; i++) {
+		BOOL bRet = UnscrambleDvdFrame(pUnsc, lpRaw + DVD_RAW_READ * i, lpMainData);
+		TEST_CHECK(bRet == (i < DVD_ECC_BLOCK_FRAME_NUM));
+	}
+}
+
+// A frame whose EDC doesn't match is an error, and the other frames of the
+// block aren't affected by it.
+static VOID TestUnscrambleBrokenFrame(
+	PDVD_UNSCRAMBLER pUnsc,
+	LPBYTE lpRaw,
+	LPBYTE lpIso
+) {
+	BYTE lpMainData[DISC_RAW_READ_SIZE * DVD_ECC_BLOCK_FRAME_NUM] = {};
+	BYTE byValidFlag[DVD_ECC_BLOCK_FRAME_NUM] = {};
+	LPBYTE lpBlockRaw = lpRaw + DVD_RAW_READ * DVD_ECC_BLOCK_FRAME_NUM;
+	LPBYTE lpBlockIso = lpIso + DISC_RAW_READ_SIZE * DVD_ECC_BLOCK_FRAME_NUM;
+	lpBlockRaw[DVD_RAW_READ * 5 + DVD_FRAME_DATA_OFFSET + 100] ^= 0x10;
+
+	InitDvdUnscrambler(pUnsc, TRUE);
+	for (INT i = 0; i < DVD_ECC_BLOCK_FRAME_NUM; i++) {
+		BOOL bRet = UnscrambleDvdFrame(pUnsc, lpBlockRaw + DVD_RAW_READ * i, lpMainData);
+		TEST_CHECK(bRet == (i != 5));
+	}
+	InitDvdUnscrambler(pUnsc, TRUE);
+	TEST_CHECK(!UnscrambleDvdBlock(pUnsc, lpBlockRaw, DVD_ECC_BLOCK_FRAME_NUM, lpMainData, byValidFlag));
+	for (INT i = 0; i < DVD_ECC_BLOCK_FRAME_NUM; i++) {
+		TEST_CHECK(byValidFlag[i] == (i != 5));
+		if (i != 5) {
+			TEST_CHECK(!memcmp(lpMainData + DISC_RAW_READ_SIZE * i
+				, lpBlockIso + DISC_RAW_READ_SIZE * i, DISC_RAW_READ_SIZE));
+		}
+	}
+	lpBlockRaw[DVD_RAW_READ * 5 + DVD_FRAME_DATA_OFFSET + 100] ^= 0x10;
+}
+
+// The first frame of the block is scrambled by another seed with a valid EDC.
+// The seed of the block is decided by all the frames, so only the first one
+// is an error.
+static VOID TestUnscrambleDisagreeingFrame(
+	PDVD_UNSCRAMBLER pUnsc,
+	LPBYTE lpRaw,
+	LPBYTE lpIso
+) {
+	BYTE lpMainData[DISC_RAW_READ_SIZE * DVD_ECC_BLOCK_FRAME_NUM] = {};
+	BYTE byValidFlag[DVD_ECC_BLOCK_FRAME_NUM] = {};
+	BYTE lpFrame[DVD_RAW_READ] = {};
+	LPBYTE lpBlockRaw = lpRaw + DVD_RAW_READ * DVD_ECC_BLOCK_FRAME_NUM * 2;
+	LPBYTE lpBlockIso = lpIso + DISC_RAW_READ_SIZE * DVD_ECC_BLOCK_FRAME_NUM * 2;
+	memcpy(lpFrame, lpBlockRaw, DVD_RAW_READ);
+	ScrambleVectorFrame(lpBlockRaw, 0x30100, lpBlockIso, 0x1234);
+
+	InitDvdUnscrambler(pUnsc, TRUE);
+	TEST_CHECK(!UnscrambleDvdBlock(pUnsc, lpBlockRaw, DVD_ECC_BLOCK_FRAME_NUM, lpMainData, byValidFlag));
+	for (INT i = 0; i < DVD_ECC_BLOCK_FRAME_NUM; i++) {
+		TEST_CHECK(byValidFlag[i] == (i != 0));
+		TEST_CHECK(!memcmp(lpMainData + DISC_RAW_READ_SIZE * i
+			, lpBlockIso + DISC_RAW_READ_SIZE * i, DISC_RAW_READ_SIZE) == (i != 0));
+	}
+	memcpy(lpBlockRaw, lpFrame, DVD_RAW_READ);
+
+	TEST_CHECK(UnscrambleDvdBlock(pUnsc, lpBlockRaw, DVD_ECC_BLOCK_FRAME_NUM, lpMainData, byValidFlag));
+	TEST_CHECK(!memcmp(lpMainData, lpBlockIso, DISC_RAW_READ_SIZE * DVD_ECC_BLOCK_FRAME_NUM));
+}
+
+VOID TestDvdUnscrambler(
+	VOID
+) {
+	PDVD_UNSCRAMBLER pUnsc = (PDVD_UNSCRAMBLER)calloc(1, sizeof(DVD_UNSCRAMBLER));
+	LPBYTE lpRaw = (LPBYTE)calloc((size_t)DVD_RAW_READ * VECTOR_FRAME_NUM, sizeof(BYTE));
+	LPBYTE lpIso = (LPBYTE)calloc((size_t)DISC_RAW_READ_SIZE * VECTOR_FRAME_NUM, sizeof(BYTE));
+	TEST_CHECK(pUnsc && lpRaw && lpIso);
+	if (pUnsc && lpRaw && lpIso) {
+		MakeVector(lpRaw, lpIso);
+		for (INT i = 0; i < VECTOR_FRAME_NUM; i++) {
+			TEST_CHECK(IsValidDvdId(lpRaw + DVD_RAW_READ * i));
+		}
+		TestUnscrambleNintendoFrame(pUnsc, lpRaw, lpIso);
+		TestUnscrambleBrokenFrame(pUnsc, lpRaw, lpIso);
+		TestUnscrambleDisagreeingFrame(pUnsc, lpRaw, lpIso);
+	}
+	free(lpIso);
+	free(lpRaw);
+	free(pUnsc);
+}
@@ -0,0 +1,220 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/convert.h"
+#include "../DiscImageCreator/eccRtoW.h"
+#include "test.h"
+
+BYTE GfMul(
+	BYTE a,
+	BYTE b
+);
+
+BYTE GfDiv(
+	BYTE a,
+	BYTE b
+);
+
+// Sets the parity symbols lpPos[0..nParity-1] of lpCode so that S(j) = c(a^j)
+// is 0 for j = 0..nParity-1, by the gaussian elimination over GF(2^6)
+static VOID EncodeRtoWCode(
+	LPBYTE lpCode,
+	INT nLen,
+	CONST INT* lpPos,
+	INT nParity
+) {
+	BYTE m[4][5] = { 0 };
+	for (INT i = 0; i < nLen; i++) {
+		BOOL bParity = FALSE;
+		for (INT k = 0; k < nParity; k++) {
+			if (lpPos[k] == i) {
+				bParity = TRUE;
+			}
+		}
+		if (bParity) {
+			lpCode[i] = 0;
+		}
+	}
+	for (INT j = 0; j < nParity; j++) {
+		// a^j
+		BYTE x = 1;
+		for (INT t = 0; t < j; t++) {
+			x = GfMul(x, 2);
+		}
+		// x^(nLen - 1 - i) of each parity, and the syndrome of the others
+		BYTE s = 0;
+		for (INT i = 0; i < nLen; i++) {
+			s = (BYTE)(GfMul(s, x) ^ lpCode[i]);
+		}
+		for (INT k = 0; k < nParity; k++) {
+			BYTE p = 1;
+			for (INT t = 0; t < nLen - 1 - lpPos[k]; t++) {
+				p = GfMul(p, x);
+			}
+			m[j][k] = p;
+		}
+		m[j][nParity] = s;
+	}
+	for (INT c = 0; c < nParity; c++) {
+		INT r = c;
+		while (m[r][c] == 0) {
+			r++;
+		}
+		for (INT k = 0; k <= nParity; k++) {
+			BYTE t = m[c][k];
+			m[c][k] = m[r][k];
+			m[r][k] = t;
+		}
+		BYTE d = m[c][c];
+		for (INT k = 0; k <= nParity; k++) {
+			m[c][k] = GfDiv(m[c][k], d);
+		}
+		for (INT r2 = 0; r2 < nParity; r2++) {
+			if (r2 != c && m[r2][c]) {
+				BYTE f = m[r2][c];
+				for (INT k = 0; k <= nParity; k++) {
+					m[r2][k] ^= GfMul(f, m[c][k]);
+				}
+			}
+		}
+	}
+	for (INT k = 0; k < nParity; k++) {
+		lpCode[lpPos[k]] = m[k][nParity];
+	}
+}
+
+// Q parity is the symbol 2-3, P parity is the symbol 20-23
+static VOID EncodeRtoWPack(
+	LPBYTE lpPack
+) {
+	CONST INT aQ[] = { 2, 3 };
+	CONST INT aP[] = { 20, 21, 22, 23 };
+	EncodeRtoWCode(lpPack, 4, aQ, 2);
+	EncodeRtoWCode(lpPack, RTOW_PACK_SIZE, aP, 4);
+}
+
+// .sub (P-W in the row) <-> symbols of R-W
+static VOID TestRtoWSymbolOfRowSubcode(
+	VOID
+) {
+	srand(1);
+	INT nFail = 0;
+	for (INT n = 0; n < 1000; n++) {
+		BYTE row[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+		BYTE org[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+		BYTE symbol[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+		for (INT i = 0; i < CD_RAW_READ_SUBCODE_SIZE; i++) {
+			row[i] = (BYTE)rand();
+		}
+		memcpy(org, row, sizeof(org));
+		SetRtoWSymbolFromRowSubcode(symbol, row);
+		SetRowSubcodeFromRtoWSymbol(row, symbol);
+		if (memcmp(row, org, sizeof(row))) {
+			nFail++;
+		}
+		// the P-Q isn't changed by the R-W
+		for (INT i = 0; i < CD_RAW_READ_SUBCODE_SIZE; i++) {
+			symbol[i] ^= 0x3f;
+		}
+		SetRowSubcodeFromRtoWSymbol(row, symbol);
+		for (INT i = 0; i < CD_RAW_READ_SUBCODE_SIZE; i++) {
+			if ((i < 24 && row[i] != org[i]) || (i >= 24 && row[i] != (BYTE)~org[i])) {
+				nFail++;
+			}
+		}
+	}
+	TEST_CHECK(nFail == 0);
+}
+
+// The packs of the sectors are encoded and interleaved as the disc, and 2
+// symbols of some packs are broken in the .sub. The repaired .sub must be
+// same as the original
+static VOID TestRepairRtoW(
+	VOID
+) {
+	CONST INT nSectorNum = 40;
+	CONST INT nPackNum = nSectorNum * RTOW_PACK_PER_SECTOR;
+	LPBYTE lpSymbol = (LPBYTE)calloc(nSectorNum, CD_RAW_READ_SUBCODE_SIZE);
+	LPBYTE lpSub = (LPBYTE)calloc(nSectorNum, CD_RAW_READ_SUBCODE_SIZE);
+	LPBYTE lpOrg = (LPBYTE)calloc(nSectorNum, CD_RAW_READ_SUBCODE_SIZE);
+	LPINT lpResult = (LPINT)calloc(nPackNum, sizeof(INT));
+	TEST_CHECK(lpSymbol && lpSub && lpOrg && lpResult);
+	if (lpSymbol && lpSub && lpOrg && lpResult) {
+		srand(2);
+		// the last packs aren't complete, so they're zero
+		for (INT n = 0; n < nPackNum - (RTOW_INTERLEAVE_DELAY - 1); n++) {
+			BYTE pack[RTOW_PACK_SIZE] = { 0 };
+			for (INT i = 0; i < RTOW_PACK_SIZE; i++) {
+				pack[i] = (BYTE)(rand() & 0x3f);
+			}
+			EncodeRtoWPack(pack);
+			BYTE tmp[RTOW_PACK_SIZE] = { 0 };
+			memcpy(tmp, pack, sizeof(tmp));
+			TEST_CHECK(CorrectRtoWPack(tmp) == 0);
+			InterleaveRtoW(lpSymbol, pack, n);
+		}
+		for (INT i = 0; i < nSectorNum * CD_RAW_READ_SUBCODE_SIZE; i++) {
+			// P-Q of the .sub
+			lpSymbol[i] |= (BYTE)(rand() & 0xc0);
+		}
+		for (INT i = 0; i < nSectorNum; i++) {
+			AlignRowSubcode(lpSub + CD_RAW_READ_SUBCODE_SIZE * i, lpSymbol + CD_RAW_READ_SUBCODE_SIZE * i);
+		}
+		memcpy(lpOrg, lpSub, (size_t)nSectorNum * CD_RAW_READ_SUBCODE_SIZE);
+
+		// 2 symbols of every 3rd pack
+		INT nBrokenNum = 0;
+		for (INT n = 0; n < nPackNum - (RTOW_INTERLEAVE_DELAY - 1); n += 3) {
+			for (INT k = 0; k < 2; k++) {
+				INT i = (n * 5 + k * 11) % RTOW_PACK_SIZE;
+				INT nPos = (n + i % RTOW_INTERLEAVE_DELAY) * RTOW_PACK_SIZE + i;
+				// bit of R-W in the row: byte 24 + 12 * channel + (column / 8)
+				INT nSector = nPos / CD_RAW_READ_SUBCODE_SIZE;
+				INT nColumn = nPos % CD_RAW_READ_SUBCODE_SIZE;
+				lpSub[CD_RAW_READ_SUBCODE_SIZE * nSector + 24 + 12 * (k * 3) + nColumn / CHAR_BIT] ^=
+					(BYTE)(0x80 >> (nColumn % CHAR_BIT));
+			}
+			nBrokenNum++;
+		}
+		TEST_CHECK(memcmp(lpSub, lpOrg, (size_t)nSectorNum * CD_RAW_READ_SUBCODE_SIZE) != 0);
+
+		for (INT i = 0; i < nSectorNum; i++) {
+			SetRtoWSymbolFromRowSubcode(lpSymbol + CD_RAW_READ_SUBCODE_SIZE * i
+				, lpSub + CD_RAW_READ_SUBCODE_SIZE * i);
+		}
+		INT nCorrected = 0;
+		INT nUncorrectable = 0;
+		CorrectRtoWSymbol(lpSymbol, nPackNum, lpResult, &nCorrected, &nUncorrectable);
+		TEST_CHECK(nCorrected == nBrokenNum);
+		TEST_CHECK(nUncorrectable == 0);
+		for (INT i = 0; i < nSectorNum; i++) {
+			SetRowSubcodeFromRtoWSymbol(lpSub + CD_RAW_READ_SUBCODE_SIZE * i
+				, lpSymbol + CD_RAW_READ_SUBCODE_SIZE * i);
+		}
+		TEST_CHECK(memcmp(lpSub, lpOrg, (size_t)nSectorNum * CD_RAW_READ_SUBCODE_SIZE) == 0);
+	}
+	free(lpResult);
+	free(lpOrg);
+	free(lpSub);
+	free(lpSymbol);
+}
+
+VOID TestEccRtoW(
+	VOID
+) {
+	TestRtoWSymbolOfRowSubcode();
+	TestRepairRtoW();
+}
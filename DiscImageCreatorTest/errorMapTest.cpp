@@ -0,0 +1,332 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/errorMap.h"
+#include "../DiscImageCreator/execImage.h"
+#include "../DiscImageCreator/execScsiCmdforDVD.h"
+#include "test.h"
+
+#define ERROR_MAP_TEST_SECTOR_NUM	(405)
+#define ERROR_MAP_TEST_TRANSFER_LEN	(16)
+// A sector which fails the whole command is read 5 times until it's isolated
+// (16, 8, 4, 2 and 1 sector), and once in each retry pass
+#define ERROR_MAP_TEST_BISECT_NUM	(5)
+
+// The ranges must be sorted, cover the map without a gap, and the adjacent
+// ranges must have the different status. Each sector must be lpStatus[LBA].
+static BOOL IsErrorMap(
+	PERROR_MAP pMap,
+	LPCH lpStatus
+) {
+	INT nEnd = 0;
+	for (INT i = 0; i < pMap->nRangeNum; i++) {
+		PERROR_MAP_RANGE pRange = &pMap->pRange[i];
+		if (pRange->nLBA != nEnd || pRange->nSectorNum <= 0 ||
+			(i > 0 && pMap->pRange[i - 1].cStatus == pRange->cStatus)) {
+			return FALSE;
+		}
+		for (INT j = pRange->nLBA; j < pRange->nLBA + pRange->nSectorNum; j++) {
+			if (lpStatus[j] != pRange->cStatus) {
+				return FALSE;
+			}
+		}
+		nEnd += pRange->nSectorNum;
+	}
+	return nEnd == pMap->nSectorNum;
+}
+
+static VOID TestErrorMapSplitAndMerge(
+	VOID
+) {
+	ERROR_MAP map = { 0 };
+	TEST_CHECK(InitErrorMap(&map, 100, DISC_RAW_READ_SIZE));
+	TEST_CHECK(map.nRangeNum == 1);
+
+	// the middle of a range is split into 3
+	TEST_CHECK(SetErrorMapRange(&map, 10, 10, ERROR_MAP_BAD));
+	TEST_CHECK(map.nRangeNum == 3);
+	TEST_CHECK(map.pRange[1].nLBA == 10 && map.pRange[1].nSectorNum == 10);
+	// the next range of the same status is merged
+	TEST_CHECK(SetErrorMapRange(&map, 20, 10, ERROR_MAP_BAD));
+	TEST_CHECK(map.nRangeNum == 3);
+	TEST_CHECK(map.pRange[1].nLBA == 10 && map.pRange[1].nSectorNum == 20);
+	// the head and the tail
+	TEST_CHECK(SetErrorMapRange(&map, 0, 10, ERROR_MAP_GOOD));
+	TEST_CHECK(SetErrorMapRange(&map, 30, 70, ERROR_MAP_GOOD));
+	TEST_CHECK(map.nRangeNum == 3);
+	TEST_CHECK(GetErrorMapSectorNum(&map, ERROR_MAP_UNTRIED) == 0);
+	// the range between the same status is merged with both
+	TEST_CHECK(SetErrorMapRange(&map, 10, 20, ERROR_MAP_GOOD));
+	TEST_CHECK(map.nRangeNum == 1);
+	TEST_CHECK(GetErrorMapSectorNum(&map, ERROR_MAP_GOOD) == 100);
+	// out of the map is clipped
+	TEST_CHECK(SetErrorMapRange(&map, -5, 10, ERROR_MAP_BAD));
+	TEST_CHECK(SetErrorMapRange(&map, 95, 10, ERROR_MAP_BAD));
+	TEST_CHECK(GetErrorMapSectorNum(&map, ERROR_MAP_BAD) == 10);
+	TEST_CHECK(map.nRangeNum == 3);
+
+	INT nLBA = 0;
+	INT nSectorNum = 0;
+	TEST_CHECK(GetErrorMapRange(&map, ERROR_MAP_BAD, &nLBA, &nSectorNum));
+	TEST_CHECK(nLBA == 0 && nSectorNum == 5);
+	nLBA += nSectorNum;
+	TEST_CHECK(GetErrorMapRange(&map, ERROR_MAP_BAD, &nLBA, &nSectorNum));
+	TEST_CHECK(nLBA == 95 && nSectorNum == 5);
+	nLBA += nSectorNum;
+	TEST_CHECK(!GetErrorMapRange(&map, ERROR_MAP_BAD, &nLBA, &nSectorNum));
+	TerminateErrorMap(&map);
+
+	// many ranges split, overwritten and merged at random
+	CONST CHAR cStatus[] = { ERROR_MAP_UNTRIED, ERROR_MAP_BAD, ERROR_MAP_GOOD };
+	CONST INT nMapSize = 1000;
+	CHAR aStatus[nMapSize];
+	FillMemory(aStatus, sizeof(aStatus), ERROR_MAP_UNTRIED);
+	TEST_CHECK(InitErrorMap(&map, nMapSize, DISC_RAW_READ_SIZE));
+	srand(12);
+	BOOL bMap = TRUE;
+	for (INT i = 0; i < 5000; i++) {
+		INT nFirst = rand() % nMapSize;
+		INT nNum = rand() % 3 ? rand() % 4 + 1 : rand() % 200 + 1;
+		CHAR c = cStatus[rand() % 3];
+		TEST_CHECK(SetErrorMapRange(&map, nFirst, nNum, c));
+		for (INT j = nFirst; j < min(nFirst + nNum, nMapSize); j++) {
+			aStatus[j] = c;
+		}
+		bMap &= IsErrorMap(&map, aStatus);
+	}
+	TEST_CHECK(bMap);
+	TerminateErrorMap(&map);
+}
+
+static VOID TestErrorMapFile(
+	VOID
+) {
+	_TCHAR szPath[_MAX_PATH] = { 0 };
+	GetTestTempPath(szPath, _T("DiscImageCreatorTest_errorMap.map"));
+
+	CONST INT nMapSize = 300;
+	CHAR aStatus[nMapSize];
+	FillMemory(aStatus, sizeof(aStatus), ERROR_MAP_UNTRIED);
+	ERROR_MAP map = { 0 };
+	TEST_CHECK(InitErrorMap(&map, nMapSize, DISC_RAW_READ_SIZE));
+	srand(13);
+	for (INT i = 0; i < 50; i++) {
+		INT nFirst = rand() % nMapSize;
+		INT nNum = rand() % 20 + 1;
+		CHAR c = rand() % 2 ? ERROR_MAP_BAD : ERROR_MAP_GOOD;
+		SetErrorMapRange(&map, nFirst, nNum, c);
+		for (INT j = nFirst; j < min(nFirst + nNum, nMapSize); j++) {
+			aStatus[j] = c;
+		}
+	}
+	TEST_CHECK(SaveErrorMap(&map, szPath));
+	ERROR_MAP mapLoad = { 0 };
+	TEST_CHECK(InitErrorMap(&mapLoad, nMapSize, DISC_RAW_READ_SIZE));
+	TEST_CHECK(LoadErrorMap(&mapLoad, szPath));
+	TEST_CHECK(mapLoad.nRangeNum == map.nRangeNum);
+	TEST_CHECK(IsErrorMap(&mapLoad, aStatus));
+	TerminateErrorMap(&mapLoad);
+
+	// the map of another disc doesn't fit
+	TEST_CHECK(InitErrorMap(&mapLoad, nMapSize + 1, DISC_RAW_READ_SIZE));
+	TEST_CHECK(!LoadErrorMap(&mapLoad, szPath));
+	TerminateErrorMap(&mapLoad);
+	TerminateErrorMap(&map);
+
+	// '*' (non-trimmed) and '/' (non-scraped) of ddrescue are read back as
+	// untried, and merged with the untried neighbor
+	FILE* fp = _tfopen(szPath, _T("w"));
+	TEST_CHECK(fp != NULL);
+	if (fp) {
+		fprintf(fp, "# Mapfile. Created by GNU ddrescue\n"
+			"# current_pos  current_status  current_pass\n"
+			"0x00001000     *               1\n"
+			"#      pos        size  status\n"
+			"0x00000000  0x00001000  +\n"
+			"0x00001000  0x00000800  *\n"
+			"0x00001800  0x00001000  /\n"
+			"0x00002800  0x00000800  ?\n"
+			"0x00003000  0x00000800  -\n"
+			"0x00003800  0x00000800  +\n");
+		fclose(fp);
+	}
+	CHAR aStatusDdrescue[] = {
+		ERROR_MAP_GOOD, ERROR_MAP_GOOD, ERROR_MAP_UNTRIED, ERROR_MAP_UNTRIED,
+		ERROR_MAP_UNTRIED, ERROR_MAP_UNTRIED, ERROR_MAP_BAD, ERROR_MAP_GOOD
+	};
+	TEST_CHECK(InitErrorMap(&mapLoad, sizeof(aStatusDdrescue), DISC_RAW_READ_SIZE));
+	TEST_CHECK(LoadErrorMap(&mapLoad, szPath));
+	TEST_CHECK(mapLoad.nRangeNum == 4);
+	TEST_CHECK(IsErrorMap(&mapLoad, aStatusDdrescue));
+	TerminateErrorMap(&mapLoad);
+	_tremove(szPath);
+}
+
+static BOOL DumpErrorMapTestImage(
+	PDEVICE pDevice,
+	PDISC pDisc,
+	LPCTSTR pszPath,
+	BOOL bResume
+) {
+	EXEC_TYPE execType = dvd;
+	EXT_ARG extArg = { 0 };
+	extArg.byResume = (BYTE)bResume;
+	extArg.dwReadQueueDepth = 4;
+	return ReadDVD(&execType, &extArg, pDevice, pDisc, pszPath);
+}
+
+// The good sector of the .iso must be the same as the image, and the bad
+// sector must be zero-filled. The .map must be lpStatus.
+static BOOL IsErrorMapTestDump(
+	LPCTSTR pszPath,
+	LPBYTE lpImage,
+	LPCH lpStatus
+) {
+	_TCHAR szPath[_MAX_PATH] = { 0 };
+	_tcscpy(szPath, pszPath);
+	PathRenameExtension(szPath, _T(".map"));
+	ERROR_MAP map = { 0 };
+	if (!InitErrorMap(&map, ERROR_MAP_TEST_SECTOR_NUM, DISC_RAW_READ_SIZE)) {
+		return FALSE;
+	}
+	BOOL bRet = LoadErrorMap(&map, szPath) && IsErrorMap(&map, lpStatus);
+	TerminateErrorMap(&map);
+
+	FILE* fp = _tfopen(pszPath, _T("rb"));
+	if (!fp) {
+		return FALSE;
+	}
+	BYTE aBuf[DISC_RAW_READ_SIZE] = { 0 };
+	BYTE aZero[DISC_RAW_READ_SIZE] = { 0 };
+	for (INT i = 0; i < ERROR_MAP_TEST_SECTOR_NUM; i++) {
+		if (fread(aBuf, sizeof(aBuf), 1, fp) != 1) {
+			bRet = FALSE;
+			break;
+		}
+		LPBYTE lpExpected = lpStatus[i] == ERROR_MAP_GOOD ? lpImage + DISC_RAW_READ_SIZE * i : aZero;
+		if (memcmp(aBuf, lpExpected, DISC_RAW_READ_SIZE)) {
+			bRet = FALSE;
+		}
+	}
+	if (fread(aBuf, 1, 1, fp) != 0) {
+		bRet = FALSE;
+	}
+	fclose(fp);
+	return bRet;
+}
+
+// The image device fails the injected sectors. The dump isolates them,
+// retries them in the passes, and /re reads the rest into the same .iso.
+static VOID TestErrorMapDump(
+	VOID
+) {
+	_TCHAR szImage[_MAX_PATH] = { 0 };
+	_TCHAR szPath[_MAX_PATH] = { 0 };
+	_TCHAR szMap[_MAX_PATH] = { 0 };
+	GetTestTempPath(szImage, _T("DiscImageCreatorTest_errorMapImage.iso"));
+	GetTestTempPath(szPath, _T("DiscImageCreatorTest_errorMap.iso"));
+	GetTestTempPath(szMap, _T("DiscImageCreatorTest_errorMap.map"));
+
+	LPBYTE lpImage = (LPBYTE)calloc(ERROR_MAP_TEST_SECTOR_NUM, DISC_RAW_READ_SIZE);
+	BYTE aErrorNum[ERROR_MAP_TEST_SECTOR_NUM] = { 0 };
+	CHAR aStatus[ERROR_MAP_TEST_SECTOR_NUM];
+	PDISC pDisc = (PDISC)calloc(1, sizeof(DISC));
+	DEVICE device = { 0 };
+	srand(14);
+	for (INT i = 0; i < ERROR_MAP_TEST_SECTOR_NUM * DISC_RAW_READ_SIZE; i++) {
+		lpImage[i] = (BYTE)rand();
+	}
+	FILE* fp = _tfopen(szImage, _T("wb"));
+	TEST_CHECK(fp != NULL);
+	if (fp) {
+		fwrite(lpImage, DISC_RAW_READ_SIZE, ERROR_MAP_TEST_SECTOR_NUM, fp);
+		fclose(fp);
+	}
+	TEST_CHECK(OpenImage(&device, szImage, _T(".iso")));
+	if (device.IMAGE.fp) {
+		// the file system is read at 16 to 47 and 256 to 271, so no error is there
+		device.dwMaxTransferLength = DISC_RAW_READ_SIZE * ERROR_MAP_TEST_TRANSFER_LEN;
+		device.IMAGE.lpErrorNum = aErrorNum;
+		pDisc->SCSI.nAllLength = ERROR_MAP_TEST_SECTOR_NUM;
+		// bad sectors next to each other and at the end of the shorter last command
+		aErrorNum[100] = 0xff;
+		aErrorNum[101] = 0xff;
+		aErrorNum[350] = 0xff;
+		aErrorNum[404] = 0xff;
+		// weak sectors read at the retry pass 1 and 3, and the one which
+		// still fails after the last pass
+		aErrorNum[200] = ERROR_MAP_TEST_BISECT_NUM;
+		aErrorNum[250] = ERROR_MAP_TEST_BISECT_NUM + 2;
+		aErrorNum[280] = ERROR_MAP_TEST_BISECT_NUM + 3;
+
+		FillMemory(aStatus, sizeof(aStatus), ERROR_MAP_GOOD);
+		aStatus[100] = ERROR_MAP_BAD;
+		aStatus[101] = ERROR_MAP_BAD;
+		aStatus[280] = ERROR_MAP_BAD;
+		aStatus[350] = ERROR_MAP_BAD;
+		aStatus[404] = ERROR_MAP_BAD;
+		TEST_CHECK(!DumpErrorMapTestImage(&device, pDisc, szPath, FALSE));
+		TEST_CHECK(aErrorNum[200] == 0 && aErrorNum[250] == 0 && aErrorNum[280] == 0);
+		TEST_CHECK(IsErrorMapTestDump(szPath, lpImage, aStatus));
+
+		// /re retries only the bad sectors. 280 is read at the first pass
+		aErrorNum[100] = 0;
+		aErrorNum[101] = 0;
+		aErrorNum[350] = 0;
+		aStatus[100] = ERROR_MAP_GOOD;
+		aStatus[101] = ERROR_MAP_GOOD;
+		aStatus[280] = ERROR_MAP_GOOD;
+		aStatus[350] = ERROR_MAP_GOOD;
+		TEST_CHECK(!DumpErrorMapTestImage(&device, pDisc, szPath, TRUE));
+		TEST_CHECK(IsErrorMapTestDump(szPath, lpImage, aStatus));
+
+		// the dump which stopped at 150 leaves the untried sectors, and /re
+		// reads them by the commands of the transfer length
+		ERROR_MAP map = { 0 };
+		TEST_CHECK(InitErrorMap(&map, ERROR_MAP_TEST_SECTOR_NUM, DISC_RAW_READ_SIZE));
+		TEST_CHECK(SetErrorMapRange(&map, 0, 150, ERROR_MAP_GOOD));
+		TEST_CHECK(SaveErrorMap(&map, szMap));
+		TerminateErrorMap(&map);
+		if (NULL != (fp = _tfopen(szPath, _T("rb+")))) {
+			BYTE aZero[DISC_RAW_READ_SIZE] = { 0 };
+			fseek(fp, DISC_RAW_READ_SIZE * 150, SEEK_SET);
+			for (INT i = 150; i < ERROR_MAP_TEST_SECTOR_NUM; i++) {
+				fwrite(aZero, sizeof(aZero), 1, fp);
+			}
+			fclose(fp);
+		}
+		aErrorNum[160] = 1;
+		aErrorNum[404] = 0;
+		FillMemory(aStatus, sizeof(aStatus), ERROR_MAP_GOOD);
+		TEST_CHECK(DumpErrorMapTestImage(&device, pDisc, szPath, TRUE));
+		TEST_CHECK(aErrorNum[160] == 0);
+		TEST_CHECK(IsErrorMapTestDump(szPath, lpImage, aStatus));
+		CloseImage(&device);
+	}
+	free(pDisc);
+	free(lpImage);
+	_tremove(szImage);
+	_tremove(szPath);
+	_tremove(szMap);
+}
+
+VOID TestErrorMap(
+	VOID
+) {
+	TestErrorMapSplitAndMerge();
+	TestErrorMapFile();
+	TestErrorMapDump();
+}
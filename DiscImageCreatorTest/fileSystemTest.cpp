@@ -0,0 +1,350 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/execImage.h"
+#include "../DiscImageCreator/execScsiCmdforFileSystem.h"
+#include "../DiscImageCreator/init.h"
+#include "test.h"
+
+#define FS_TEST_SECTOR_NUM		(320)
+#define FS_TEST_PATH_TABLE_LBA	(19)
+#define FS_TEST_FILE_NUM_MAX	(256)
+
+// The extents of the directories. A and B are read at once over the gap of
+// 73, C is far from them. A1 and A2 are read at once, B1 is over the max
+// transfer length (32 sectors).
+#define FS_TEST_ROOT_LBA	(70)
+#define FS_TEST_A_LBA		(72)
+#define FS_TEST_B_LBA		(74)
+#define FS_TEST_C_LBA		(200)
+#define FS_TEST_A1_LBA		(80)
+#define FS_TEST_A1_SIZE		(3)
+#define FS_TEST_A2_LBA		(84)
+#define FS_TEST_A1X_LBA		(90)
+#define FS_TEST_B1_LBA		(100)
+#define FS_TEST_B1_SIZE		(40)
+#define FS_TEST_BIG_LBA		(310)
+
+typedef struct _FS_TEST_IMAGE {
+	LPBYTE lpImage;
+	INT nFileLBA;
+	INT nFileNum;
+	CHAR szName[FS_TEST_FILE_NUM_MAX][MAX_FNAME_FOR_VOLUME];
+	INT nExtent[FS_TEST_FILE_NUM_MAX];
+} FS_TEST_IMAGE, *PFS_TEST_IMAGE;
+
+static VOID SetBothEndianDword(
+	LPBYTE lpBuf,
+	DWORD dwVal
+) {
+	lpBuf[0] = (BYTE)dwVal;
+	lpBuf[1] = (BYTE)(dwVal >> 8);
+	lpBuf[2] = (BYTE)(dwVal >> 16);
+	lpBuf[3] = (BYTE)(dwVal >> 24);
+	lpBuf[4] = (BYTE)(dwVal >> 24);
+	lpBuf[5] = (BYTE)(dwVal >> 16);
+	lpBuf[6] = (BYTE)(dwVal >> 8);
+	lpBuf[7] = (BYTE)dwVal;
+}
+
+// Appends the directory record to the directory at nLBA. The record doesn't
+// cross the sector, so the rest of the sector is zero-padded.
+static VOID AddFsTestDirectoryRecord(
+	PFS_TEST_IMAGE pFs,
+	INT nLBA,
+	LPUINT lpOfs,
+	DWORD dwExtent,
+	DWORD dwDataLen,
+	BYTE byFlag,
+	LPCSTR pszName,
+	BYTE byNameLen
+) {
+	BYTE byLen = (BYTE)(MIN_LEN_DR - 1 + byNameLen + (byNameLen % 2 == 0 ? 1 : 0));
+	if (*lpOfs % DISC_RAW_READ_SIZE + byLen > DISC_RAW_READ_SIZE) {
+		*lpOfs += DISC_RAW_READ_SIZE - *lpOfs % DISC_RAW_READ_SIZE;
+	}
+	LPBYTE lpRec = pFs->lpImage + DISC_RAW_READ_SIZE * nLBA + *lpOfs;
+	lpRec[0] = byLen;
+	SetBothEndianDword(lpRec + 2, dwExtent);
+	SetBothEndianDword(lpRec + 10, dwDataLen);
+	lpRec[25] = byFlag;
+	lpRec[28] = 1;
+	lpRec[31] = 1;
+	lpRec[32] = byNameLen;
+	memcpy(lpRec + 33, pszName, byNameLen);
+	*lpOfs += byLen;
+}
+
+static VOID AddFsTestSelfAndParent(
+	PFS_TEST_IMAGE pFs,
+	INT nLBA,
+	LPUINT lpOfs,
+	INT nSectorNum,
+	INT nParentLBA
+) {
+	AddFsTestDirectoryRecord(pFs, nLBA, lpOfs, (DWORD)nLBA
+		, (DWORD)(DISC_RAW_READ_SIZE * nSectorNum), 0x02, "\0", 1);
+	AddFsTestDirectoryRecord(pFs, nLBA, lpOfs, (DWORD)nParentLBA
+		, DISC_RAW_READ_SIZE, 0x02, "\1", 1);
+}
+
+static VOID AddFsTestFile(
+	PFS_TEST_IMAGE pFs,
+	INT nLBA,
+	LPUINT lpOfs,
+	BYTE byFlag,
+	LPCSTR pszName
+) {
+	CHAR szName[MAX_FNAME_FOR_VOLUME] = { 0 };
+	_snprintf(szName, sizeof(szName), "%s;1", pszName);
+	AddFsTestDirectoryRecord(pFs, nLBA, lpOfs, (DWORD)pFs->nFileLBA
+		, DISC_RAW_READ_SIZE, byFlag, szName, (BYTE)strlen(szName));
+	strncpy(pFs->szName[pFs->nFileNum], pszName, MAX_FNAME_FOR_VOLUME - 1);
+	pFs->nExtent[pFs->nFileNum++] = pFs->nFileLBA++;
+}
+
+static VOID AddFsTestPathTableRecord(
+	LPBYTE lpTbl,
+	LPUINT lpOfs,
+	DWORD dwExtent,
+	WORD wUpperDir,
+	LPCSTR pszName,
+	BYTE byNameLen
+) {
+	LPBYTE lpRec = lpTbl + *lpOfs;
+	lpRec[0] = byNameLen;
+	lpRec[2] = (BYTE)dwExtent;
+	lpRec[3] = (BYTE)(dwExtent >> 8);
+	lpRec[4] = (BYTE)(dwExtent >> 16);
+	lpRec[5] = (BYTE)(dwExtent >> 24);
+	lpRec[6] = (BYTE)wUpperDir;
+	lpRec[7] = (BYTE)(wUpperDir >> 8);
+	memcpy(lpRec + 8, pszName, byNameLen);
+	*lpOfs += 8 + byNameLen + byNameLen % 2;
+}
+
+// root
+// +- ROOT.EXE
+// +- A
+// |  +- A.EXE
+// |  +- A1 (3 sectors)
+// |  |  +- A1X
+// |  |  |  +- A1X.EXE
+// |  |  +- A1_000.EXE - A1_109.EXE
+// |  +- A2
+// |     +- BIG.EXE (2 extents)
+// +- B
+// |  +- B.EXE
+// |  +- B1 (40 sectors)
+// |     +- B1_000.EXE - B1_039.EXE (1 file per sector)
+// +- C
+//    +- C.EXE
+static VOID MakeFsTestImage(
+	PFS_TEST_IMAGE pFs
+) {
+	LPBYTE lpPvd = pFs->lpImage + DISC_RAW_READ_SIZE * 16;
+	lpPvd[0] = 1;
+	memcpy(lpPvd + 1, "CD001", 5);
+	lpPvd[6] = 1;
+	SetBothEndianDword(lpPvd + 80, FS_TEST_SECTOR_NUM);
+	lpPvd[120] = 1;
+	lpPvd[123] = 1;
+	lpPvd[124] = 1;
+	lpPvd[127] = 1;
+	lpPvd[129] = DISC_RAW_READ_SIZE >> 8;
+	lpPvd[130] = DISC_RAW_READ_SIZE >> 8;
+	lpPvd[140] = FS_TEST_PATH_TABLE_LBA;
+	UINT uiOfs = 156;
+	AddFsTestDirectoryRecord(pFs, 16, &uiOfs, FS_TEST_ROOT_LBA, DISC_RAW_READ_SIZE, 0x02, "\0", 1);
+
+	LPBYTE lpTerm = pFs->lpImage + DISC_RAW_READ_SIZE * 17;
+	lpTerm[0] = 0xff;
+	memcpy(lpTerm + 1, "CD001", 5);
+	lpTerm[6] = 1;
+
+	LPBYTE lpTbl = pFs->lpImage + DISC_RAW_READ_SIZE * FS_TEST_PATH_TABLE_LBA;
+	UINT uiTblOfs = 0;
+	AddFsTestPathTableRecord(lpTbl, &uiTblOfs, FS_TEST_ROOT_LBA, 1, "\0", 1);
+	AddFsTestPathTableRecord(lpTbl, &uiTblOfs, FS_TEST_A_LBA, 1, "A", 1);
+	AddFsTestPathTableRecord(lpTbl, &uiTblOfs, FS_TEST_B_LBA, 1, "B", 1);
+	AddFsTestPathTableRecord(lpTbl, &uiTblOfs, FS_TEST_C_LBA, 1, "C", 1);
+	AddFsTestPathTableRecord(lpTbl, &uiTblOfs, FS_TEST_A1_LBA, 2, "A1", 2);
+	AddFsTestPathTableRecord(lpTbl, &uiTblOfs, FS_TEST_A2_LBA, 2, "A2", 2);
+	AddFsTestPathTableRecord(lpTbl, &uiTblOfs, FS_TEST_B1_LBA, 3, "B1", 2);
+	AddFsTestPathTableRecord(lpTbl, &uiTblOfs, FS_TEST_A1X_LBA, 5, "A1X", 3);
+	SetBothEndianDword(lpPvd + 132, uiTblOfs);
+
+	pFs->nFileLBA = 140;
+	uiOfs = 0;
+	AddFsTestSelfAndParent(pFs, FS_TEST_ROOT_LBA, &uiOfs, 1, FS_TEST_ROOT_LBA);
+	AddFsTestDirectoryRecord(pFs, FS_TEST_ROOT_LBA, &uiOfs, FS_TEST_A_LBA, DISC_RAW_READ_SIZE, 0x02, "A", 1);
+	AddFsTestDirectoryRecord(pFs, FS_TEST_ROOT_LBA, &uiOfs, FS_TEST_B_LBA, DISC_RAW_READ_SIZE, 0x02, "B", 1);
+	AddFsTestDirectoryRecord(pFs, FS_TEST_ROOT_LBA, &uiOfs, FS_TEST_C_LBA, DISC_RAW_READ_SIZE, 0x02, "C", 1);
+	AddFsTestFile(pFs, FS_TEST_ROOT_LBA, &uiOfs, 0, "ROOT.EXE");
+
+	uiOfs = 0;
+	AddFsTestSelfAndParent(pFs, FS_TEST_A_LBA, &uiOfs, 1, FS_TEST_ROOT_LBA);
+	AddFsTestFile(pFs, FS_TEST_A_LBA, &uiOfs, 0, "A.EXE");
+	AddFsTestDirectoryRecord(pFs, FS_TEST_A_LBA, &uiOfs, FS_TEST_A1_LBA
+		, DISC_RAW_READ_SIZE * FS_TEST_A1_SIZE, 0x02, "A1", 2);
+	AddFsTestDirectoryRecord(pFs, FS_TEST_A_LBA, &uiOfs, FS_TEST_A2_LBA, DISC_RAW_READ_SIZE, 0x02, "A2", 2);
+
+	uiOfs = 0;
+	AddFsTestSelfAndParent(pFs, FS_TEST_B_LBA, &uiOfs, 1, FS_TEST_ROOT_LBA);
+	AddFsTestFile(pFs, FS_TEST_B_LBA, &uiOfs, 0, "B.EXE");
+	AddFsTestDirectoryRecord(pFs, FS_TEST_B_LBA, &uiOfs, FS_TEST_B1_LBA
+		, DISC_RAW_READ_SIZE * FS_TEST_B1_SIZE, 0x02, "B1", 2);
+
+	uiOfs = 0;
+	AddFsTestSelfAndParent(pFs, FS_TEST_C_LBA, &uiOfs, 1, FS_TEST_ROOT_LBA);
+	AddFsTestFile(pFs, FS_TEST_C_LBA, &uiOfs, 0, "C.EXE");
+
+	uiOfs = 0;
+	AddFsTestSelfAndParent(pFs, FS_TEST_A1_LBA, &uiOfs, FS_TEST_A1_SIZE, FS_TEST_A_LBA);
+	AddFsTestDirectoryRecord(pFs, FS_TEST_A1_LBA, &uiOfs, FS_TEST_A1X_LBA, DISC_RAW_READ_SIZE, 0x02, "A1X", 3);
+	for (INT i = 0; i < 110; i++) {
+		CHAR szName[MAX_FNAME_FOR_VOLUME] = { 0 };
+		_snprintf(szName, sizeof(szName), "A1_%03d.EXE", i);
+		AddFsTestFile(pFs, FS_TEST_A1_LBA, &uiOfs, 0, szName);
+	}
+
+	uiOfs = 0;
+	AddFsTestSelfAndParent(pFs, FS_TEST_A1X_LBA, &uiOfs, 1, FS_TEST_A1_LBA);
+	AddFsTestFile(pFs, FS_TEST_A1X_LBA, &uiOfs, 0, "A1X.EXE");
+
+	// the multi-extent file is recorded per extent
+	uiOfs = 0;
+	AddFsTestSelfAndParent(pFs, FS_TEST_A2_LBA, &uiOfs, 1, FS_TEST_A_LBA);
+	INT nFileLBA = pFs->nFileLBA;
+	pFs->nFileLBA = FS_TEST_BIG_LBA;
+	AddFsTestFile(pFs, FS_TEST_A2_LBA, &uiOfs, 0x80, "BIG.EXE");
+	AddFsTestFile(pFs, FS_TEST_A2_LBA, &uiOfs, 0, "BIG.EXE");
+	pFs->nFileLBA = nFileLBA;
+
+	uiOfs = 0;
+	AddFsTestSelfAndParent(pFs, FS_TEST_B1_LBA, &uiOfs, FS_TEST_B1_SIZE, FS_TEST_B_LBA);
+	for (INT i = 0; i < FS_TEST_B1_SIZE; i++) {
+		CHAR szName[MAX_FNAME_FOR_VOLUME] = { 0 };
+		_snprintf(szName, sizeof(szName), "B1_%03d.EXE", i);
+		uiOfs = (UINT)(DISC_RAW_READ_SIZE * i + (i == 0 ? uiOfs : 0));
+		AddFsTestFile(pFs, FS_TEST_B1_LBA, &uiOfs, 0, szName);
+	}
+}
+
+// Every .EXE of the image must be found once at its extent
+static BOOL IsFsTestExeFound(
+	PFS_TEST_IMAGE pFs,
+	PDISC pDisc
+) {
+	if (pDisc->PROTECT.nCntForExe != pFs->nFileNum) {
+		return FALSE;
+	}
+	for (INT i = 0; i < pFs->nFileNum; i++) {
+		INT nFoundNum = 0;
+		for (INT j = 0; j < pDisc->PROTECT.nCntForExe; j++) {
+			if (pDisc->PROTECT.pExtentPosForExe[j] == pFs->nExtent[i] &&
+				!strncmp(pDisc->PROTECT.pNameForExe[j], pFs->szName[i], MAX_FNAME_FOR_VOLUME)) {
+				nFoundNum++;
+			}
+		}
+		if (nFoundNum != 1) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static BOOL ReadFsTestImage(
+	PDEVICE pDevice,
+	PDISC pDisc
+) {
+	EXEC_TYPE execType = dvd;
+	EXT_ARG extArg = { 0 };
+	extArg.byScanProtectViaFile = TRUE;
+	pDisc->PROTECT.nCntForExe = 0;
+	pDisc->PROTECT.byExist = no;
+	for (INT i = 0; i < EXELBA_STORE_SIZE; i++) {
+		ZeroMemory(pDisc->PROTECT.pNameForExe[i], MAX_FNAME_FOR_VOLUME);
+	}
+	LPBYTE lpBuf = (LPBYTE)calloc(pDevice->dwMaxTransferLength, sizeof(BYTE));
+	if (!lpBuf) {
+		return FALSE;
+	}
+	CDB::_READ12 cdb = { 0 };
+	cdb.OperationCode = SCSIOP_READ12;
+	BOOL bRet = ReadDVDForFileSystem(&execType, &extArg, pDevice, pDisc, &cdb, lpBuf);
+	free(lpBuf);
+	return bRet;
+}
+
+// The directories are read per level in LBA order, and the near extents are
+// read at once. Every file of the nested directories must be found even if
+// the merged read fails.
+VOID TestFileSystem(
+	VOID
+) {
+	_TCHAR szImage[_MAX_PATH] = { 0 };
+	GetTestTempPath(szImage, _T("DiscImageCreatorTest_fileSystem.iso"));
+
+	PFS_TEST_IMAGE pFs = (PFS_TEST_IMAGE)calloc(1, sizeof(FS_TEST_IMAGE));
+	PDISC pDisc = (PDISC)calloc(1, sizeof(DISC));
+	TEST_CHECK(pFs != NULL && pDisc != NULL);
+	if (!pFs || !pDisc) {
+		free(pFs);
+		free(pDisc);
+		return;
+	}
+	pFs->lpImage = (LPBYTE)calloc(FS_TEST_SECTOR_NUM, DISC_RAW_READ_SIZE);
+	MakeFsTestImage(pFs);
+	FILE* fp = _tfopen(szImage, _T("wb"));
+	TEST_CHECK(fp != NULL);
+	if (fp) {
+		fwrite(pFs->lpImage, DISC_RAW_READ_SIZE, FS_TEST_SECTOR_NUM, fp);
+		fclose(fp);
+	}
+	pDisc->SCSI.nAllLength = FS_TEST_SECTOR_NUM;
+	TEST_CHECK(InitProtectData(&pDisc));
+
+	DEVICE device = { 0 };
+	TEST_CHECK(OpenImage(&device, szImage, _T(".iso")));
+	if (device.IMAGE.fp && pDisc->PROTECT.pNameForExe) {
+		TEST_CHECK(pFs->nFileNum == 157);
+		TEST_CHECK(ReadFsTestImage(&device, pDisc));
+		TEST_CHECK(IsFsTestExeFound(pFs, pDisc));
+
+		// the merged read of A and B fails once, and they are read one by one
+		BYTE aErrorNum[FS_TEST_SECTOR_NUM] = { 0 };
+		aErrorNum[FS_TEST_B_LBA - 1] = 1;
+		aErrorNum[FS_TEST_C_LBA - 1] = 1;
+		device.IMAGE.lpErrorNum = aErrorNum;
+		TEST_CHECK(ReadFsTestImage(&device, pDisc));
+		TEST_CHECK(IsFsTestExeFound(pFs, pDisc));
+		TEST_CHECK(aErrorNum[FS_TEST_B_LBA - 1] == 0);
+		TEST_CHECK(aErrorNum[FS_TEST_C_LBA - 1] == 1);
+
+		// the directory which can't be read is skipped
+		aErrorNum[FS_TEST_A2_LBA] = 0xff;
+		TEST_CHECK(ReadFsTestImage(&device, pDisc));
+		TEST_CHECK(pDisc->PROTECT.nCntForExe == pFs->nFileNum - 2);
+		device.IMAGE.lpErrorNum = NULL;
+		CloseImage(&device);
+	}
+	TerminateProtectData(&pDisc);
+	free(pFs->lpImage);
+	free(pFs);
+	free(pDisc);
+	_tremove(szImage);
+}
@@ -0,0 +1,317 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/convert.h"
+#include "../DiscImageCreator/output.h"
+#include "../DiscImageCreator/outputMds.h"
+#include "test.h"
+
+#define MDS_TEST_TRACK_NUM		(3)
+#define MDS_TEST_SECTOR_NUM		(600)
+#define MDS_TEST_DPM_ENTRY_NUM	(MDS_TEST_SECTOR_NUM / DPM_RESOLUTION)
+
+// A track of the simulated disc and the values which the .mds must have
+typedef struct _MDS_TEST_TRACK {
+	BYTE byCtl;
+	BYTE byMode;
+	BYTE bySession;
+	INT nFirstLBA;
+	INT nLastLBA;
+	INT nIdx0LBA; // -1 if no index 0
+	BYTE byTrackMode; // expected
+	DWORD dwNumOfIdx0; // expected
+	DWORD dwNumOfIdx1; // expected
+	INT nFileLBA; // expected LBA in the .mdf
+} MDS_TEST_TRACK, *PMDS_TEST_TRACK;
+
+// data track + 2 audio tracks with the pregap
+static CONST MDS_TEST_TRACK s_singleSession[MDS_TEST_TRACK_NUM] = {
+	{ AUDIO_DATA_TRACK, 1, 1, 0, 289, -1, 0xaa, 0, 290, 0 },
+	{ 0, 0, 1, 300, 479, 290, 0xa9, 10, 180, 300 },
+	{ 0, 0, 1, 500, 599, 480, 0xa9, 20, 100, 500 },
+};
+
+// 2 audio tracks + data track of the 2nd session (CD-Extra). The .mdf lacks
+// the gap between the sessions
+static CONST MDS_TEST_TRACK s_multiSession[MDS_TEST_TRACK_NUM] = {
+	{ 0, 0, 1, 0, 299, -1, 0xa9, 0, 300, 0 },
+	{ 0, 0, 1, 300, 499, -1, 0xa9, 0, 200, 300 },
+	{ AUDIO_DATA_TRACK, 2, 2, 11900, 11999, -1, 0xab, 0, 100, 500 },
+};
+
+// The simulated dump: .img and .sub of MDS_TEST_SECTOR_NUM sectors
+static BOOL WriteMdsTestImage(
+	LPCTSTR pszPath
+) {
+	BOOL bRet = TRUE;
+	_TCHAR szPath[_MAX_PATH] = { 0 };
+	_tcscpy(szPath, pszPath);
+	FILE* fpImg = _tfopen(szPath, _T("wb"));
+	PathRenameExtension(szPath, _T(".sub"));
+	FILE* fpSub = _tfopen(szPath, _T("wb"));
+	if (!fpImg || !fpSub) {
+		bRet = FALSE;
+	}
+	else {
+		for (INT i = 0; i < MDS_TEST_SECTOR_NUM; i++) {
+			BYTE main[CD_RAW_SECTOR_SIZE] = { 0 };
+			BYTE sub[CD_RAW_READ_SUBCODE_SIZE] = { 0 };
+			FillMemory(main, sizeof(main), (BYTE)i);
+			FillMemory(sub, sizeof(sub), (BYTE)~i);
+			fwrite(main, sizeof(main), 1, fpImg);
+			fwrite(sub, sizeof(sub), 1, fpSub);
+		}
+	}
+	if (fpImg) {
+		fclose(fpImg);
+	}
+	if (fpSub) {
+		fclose(fpSub);
+	}
+	return bRet;
+}
+
+// Returns the value of "szKey: value" in the nIdx-th "========== szSection"
+// of the _mdsReadable.txt, NULL if not found
+static LPCSTR GetMdsReadableValue(
+	LPCSTR lpText,
+	LPCSTR szSection,
+	INT nIdx,
+	LPCSTR szKey
+) {
+	CHAR szHeader[64] = { 0 };
+	_snprintf(szHeader, sizeof(szHeader), "%s%s ", STR_DOUBLE_HYPHEN_B, szSection);
+	LPCSTR p = lpText;
+	for (INT i = 0; i <= nIdx; i++) {
+		if (NULL == (p = strstr(p, szHeader))) {
+			return NULL;
+		}
+		p += strlen(szHeader);
+	}
+	LPCSTR pEnd = strstr(p, STR_DOUBLE_HYPHEN_B);
+	CHAR szLabel[64] = { 0 };
+	_snprintf(szLabel, sizeof(szLabel), " %s: ", szKey);
+	LPCSTR pKey = strstr(p, szLabel);
+	if (!pKey || (pEnd && pKey > pEnd)) {
+		return NULL;
+	}
+	return pKey + strlen(szLabel);
+}
+
+// The value is printed by %ld, so a DWORD over LONG_MAX may be negative
+static BOOL IsMdsReadableValue(
+	LPCSTR lpText,
+	LPCSTR szSection,
+	INT nIdx,
+	LPCSTR szKey,
+	DWORD dwExpected
+) {
+	LPCSTR p = GetMdsReadableValue(lpText, szSection, nIdx, szKey);
+	return p && (DWORD)strtoll(p, NULL, 10) == dwExpected;
+}
+
+static BOOL IsMdsReadableString(
+	LPCSTR lpText,
+	LPCSTR szSection,
+	INT nIdx,
+	LPCSTR szKey,
+	LPCSTR szExpected
+) {
+	LPCSTR p = GetMdsReadableValue(lpText, szSection, nIdx, szKey);
+	return p && !strncmp(p, szExpected, strlen(szExpected));
+}
+
+static LPSTR ReadMdsTestText(
+	LPCTSTR pszPath
+) {
+	FILE* fp = _tfopen(pszPath, _T("rb"));
+	if (!fp) {
+		return NULL;
+	}
+	fseek(fp, 0, SEEK_END);
+	LONG lSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	LPSTR lpText = (LPSTR)calloc((size_t)lSize + 1, sizeof(CHAR));
+	if (lpText) {
+		fread(lpText, sizeof(CHAR), (size_t)lSize, fp);
+	}
+	fclose(fp);
+	return lpText;
+}
+
+// Each sector of the .mdf is the main of the .img and the sub of the .sub
+static BOOL IsMdfOfTestImage(
+	LPCTSTR pszPath
+) {
+	FILE* fp = _tfopen(pszPath, _T("rb"));
+	if (!fp) {
+		return FALSE;
+	}
+	BOOL bRet = TRUE;
+	for (INT i = 0; i < MDS_TEST_SECTOR_NUM && bRet; i++) {
+		BYTE sector[CD_RAW_SECTOR_WITH_SUBCODE_SIZE] = { 0 };
+		if (fread(sector, sizeof(sector), 1, fp) != 1 ||
+			sector[0] != (BYTE)i || sector[CD_RAW_SECTOR_SIZE - 1] != (BYTE)i ||
+			sector[CD_RAW_SECTOR_SIZE] != (BYTE)~i || sector[sizeof(sector) - 1] != (BYTE)~i) {
+			bRet = FALSE;
+		}
+	}
+	BYTE byExtra = 0;
+	if (fread(&byExtra, sizeof(byExtra), 1, fp) != 0) {
+		bRet = FALSE;
+	}
+	fclose(fp);
+	return bRet;
+}
+
+// WriteMdsfile writes the .mds of the simulated disc, and WriteParsingMdsfile
+// reads it back. Every field of the _mdsReadable.txt must be the disc
+static VOID TestMdsRoundTrip(
+	CONST MDS_TEST_TRACK* pTrack,
+	WORD wSessionNum
+) {
+	_TCHAR szPath[_MAX_PATH] = { 0 };
+	GetTestTempPath(szPath, _T("DiscImageCreatorTest_mds.img"));
+	TEST_CHECK(WriteMdsTestImage(szPath));
+
+	PDISC pDisc = (PDISC)calloc(1, sizeof(DISC));
+	EXT_ARG extArg = { 0 };
+	INT aFirstLBA[MDS_TEST_TRACK_NUM] = { 0 };
+	INT aLastLBA[MDS_TEST_TRACK_NUM] = { 0 };
+	BYTE aSessionNum[MDS_TEST_TRACK_NUM] = { 0 };
+	BYTE aMode[MDS_TEST_TRACK_NUM] = { 0 };
+	INT aIdx[MDS_TEST_TRACK_NUM][2] = { 0 };
+	LPINT lpIdx[MDS_TEST_TRACK_NUM] = { 0 };
+	DWORD aReadTime[MDS_TEST_DPM_ENTRY_NUM] = { 0 };
+	TEST_CHECK(pDisc != NULL);
+	if (!pDisc) {
+		return;
+	}
+	pDisc->SCSI.toc.FirstTrack = 1;
+	pDisc->SCSI.toc.LastTrack = MDS_TEST_TRACK_NUM;
+	for (INT i = 0; i < MDS_TEST_TRACK_NUM; i++) {
+		pDisc->SCSI.toc.TrackData[i].Control = pTrack[i].byCtl;
+		aFirstLBA[i] = pTrack[i].nFirstLBA;
+		aLastLBA[i] = pTrack[i].nLastLBA;
+		aSessionNum[i] = pTrack[i].bySession;
+		aMode[i] = pTrack[i].byMode;
+		aIdx[i][0] = pTrack[i].nIdx0LBA;
+		aIdx[i][1] = pTrack[i].nFirstLBA;
+		lpIdx[i] = aIdx[i];
+	}
+	pDisc->SCSI.lpFirstLBAListOnToc = aFirstLBA;
+	pDisc->SCSI.lpLastLBAListOnToc = aLastLBA;
+	pDisc->SCSI.lpSessionNumList = aSessionNum;
+	pDisc->SCSI.byFormat = wSessionNum > 1 ? DISK_TYPE_XA : DISK_TYPE_CDDA;
+	pDisc->SCSI.wCurrentMedia = ProfileCdRecordable;
+	pDisc->MAIN.lpModeList = aMode;
+	pDisc->SUB.lpFirstLBAListOnSub = lpIdx;
+	for (INT i = 0; i < MDS_TEST_DPM_ENTRY_NUM; i++) {
+		aReadTime[i] = (DWORD)(i * 120 + i * i);
+	}
+	pDisc->DPM.lpReadTime = aReadTime;
+	pDisc->DPM.dwResolution = DPM_RESOLUTION;
+	pDisc->DPM.dwEntryNum = MDS_TEST_DPM_ENTRY_NUM;
+	pDisc->DPM.dwAllocEntryNum = MDS_TEST_DPM_ENTRY_NUM;
+
+	TEST_CHECK(WriteMdsfile(&extArg, pDisc, szPath));
+	_TCHAR szMds[_MAX_PATH] = { 0 };
+	_tcscpy(szMds, szPath);
+	PathRenameExtension(szMds, _T(".mds"));
+	TEST_CHECK(WriteParsingMdsfile(szMds));
+
+	_TCHAR szMdf[_MAX_PATH] = { 0 };
+	_tcscpy(szMdf, szPath);
+	PathRenameExtension(szMdf, _T(".mdf"));
+	TEST_CHECK(IsMdfOfTestImage(szMdf));
+
+	_TCHAR szTxt[_MAX_PATH] = { 0 };
+	GetTestTempPath(szTxt, _T("DiscImageCreatorTest_mds_mdsReadable.txt"));
+	LPSTR lpText = ReadMdsTestText(szTxt);
+	TEST_CHECK(lpText != NULL);
+	if (lpText) {
+		TEST_CHECK(IsMdsReadableString(lpText, "Header", 0, "id", "MEDIA DESCRIPTOR"));
+		TEST_CHECK(IsMdsReadableValue(lpText, "Header", 0, "mediaType", 1));
+		TEST_CHECK(IsMdsReadableValue(lpText, "Header", 0, "sessionNum", wSessionNum));
+		TEST_CHECK(IsMdsReadableValue(lpText, "Header", 0, "ofsTo1stSessionBlk", sizeof(MDS_HEADER)));
+
+		// A0, A1, A2 and the tracks of each session
+		INT nBlk = 0;
+		INT t = 0;
+		for (WORD s = 1; s <= wSessionNum; s++) {
+			INT nFirst = t;
+			while (t < MDS_TEST_TRACK_NUM && pTrack[t].bySession == s) {
+				t++;
+			}
+			INT nLast = t - 1;
+			INT nSession = s - 1;
+			TEST_CHECK(IsMdsReadableValue(lpText, "SessionBlock", nSession, "startSector", (DWORD)(pTrack[nFirst].nFirstLBA - 150)));
+			TEST_CHECK(IsMdsReadableValue(lpText, "SessionBlock", nSession, "endSector", (DWORD)(pTrack[nLast].nLastLBA + 1)));
+			TEST_CHECK(IsMdsReadableValue(lpText, "SessionBlock", nSession, "sessionNum", s));
+			TEST_CHECK(IsMdsReadableValue(lpText, "SessionBlock", nSession, "totalDataBlkNum", (DWORD)(nLast - nFirst + 4)));
+			TEST_CHECK(IsMdsReadableValue(lpText, "SessionBlock", nSession, "DataBlkNum", (DWORD)(nLast - nFirst + 1)));
+			TEST_CHECK(IsMdsReadableValue(lpText, "SessionBlock", nSession, "firstTrackNum", (DWORD)(nFirst + 1)));
+			TEST_CHECK(IsMdsReadableValue(lpText, "SessionBlock", nSession, "lastTrackNum", (DWORD)(nLast + 1)));
+
+			TEST_CHECK(IsMdsReadableValue(lpText, "DataBlock", nBlk++, "point", 0xa0));
+			TEST_CHECK(IsMdsReadableValue(lpText, "DataBlock", nBlk++, "point", 0xa1));
+			TEST_CHECK(IsMdsReadableValue(lpText, "DataBlock", nBlk, "point", 0xa2));
+			BYTE m = 0;
+			BYTE sec = 0;
+			BYTE f = 0;
+			CHAR szMsf[16] = { 0 };
+			LBAtoMSF(pTrack[nLast].nLastLBA + 1 + 150, &m, &sec, &f);
+			_snprintf(szMsf, sizeof(szMsf), "%02d:%02d:%02d", m, sec, f);
+			TEST_CHECK(IsMdsReadableString(lpText, "DataBlock", nBlk++, "msf", szMsf));
+
+			for (INT i = nFirst; i <= nLast; i++, nBlk++) {
+				LBAtoMSF(pTrack[i].nFirstLBA + 150, &m, &sec, &f);
+				_snprintf(szMsf, sizeof(szMsf), "%02d:%02d:%02d", m, sec, f);
+				TEST_CHECK(IsMdsReadableValue(lpText, "DataBlock", nBlk, "trackMode", pTrack[i].byTrackMode));
+				TEST_CHECK(IsMdsReadableValue(lpText, "DataBlock", nBlk, "adrCtl", (DWORD)(0x10 | pTrack[i].byCtl)));
+				TEST_CHECK(IsMdsReadableValue(lpText, "DataBlock", nBlk, "point", (DWORD)(i + 1)));
+				TEST_CHECK(IsMdsReadableString(lpText, "DataBlock", nBlk, "msf", szMsf));
+				TEST_CHECK(IsMdsReadableValue(lpText, "DataBlock", nBlk, "sectorSize", CD_RAW_SECTOR_WITH_SUBCODE_SIZE));
+				TEST_CHECK(IsMdsReadableValue(lpText, "DataBlock", nBlk, "trackStartSector", (DWORD)pTrack[i].nFirstLBA));
+				TEST_CHECK(IsMdsReadableValue(lpText, "DataBlock", nBlk, "ofsFromHeadToIdx1"
+					, (DWORD)pTrack[i].nFileLBA * CD_RAW_SECTOR_WITH_SUBCODE_SIZE));
+				TEST_CHECK(IsMdsReadableValue(lpText, "IndexBlock", nBlk, "NumOfIdx0", pTrack[i].dwNumOfIdx0));
+				TEST_CHECK(IsMdsReadableValue(lpText, "IndexBlock", nBlk, "NumOfIdx1", pTrack[i].dwNumOfIdx1));
+			}
+		}
+		TEST_CHECK(IsMdsReadableValue(lpText, "Fname", 0, "fnameFmt", 1));
+		TEST_CHECK(IsMdsReadableString(lpText, "Fname", 0, "fnameString", "*.mdf"));
+		TEST_CHECK(IsMdsReadableValue(lpText, "DPM", 0, "dpmBlkTotalNum", 1));
+		TEST_CHECK(IsMdsReadableValue(lpText, "DPM", 0, "resolution", DPM_RESOLUTION));
+		TEST_CHECK(IsMdsReadableValue(lpText, "DPM", 0, "entry", MDS_TEST_DPM_ENTRY_NUM));
+		TEST_CHECK(IsMdsReadableValue(lpText, "DPM", 0, "readTime", aReadTime[0]));
+		free(lpText);
+	}
+	free(pDisc);
+	_tremove(szTxt);
+	_tremove(szMds);
+	_tremove(szMdf);
+	_tremove(szPath);
+	PathRenameExtension(szPath, _T(".sub"));
+	_tremove(szPath);
+}
+
+VOID TestOutputMds(
+	VOID
+) {
+	TestMdsRoundTrip(s_singleSession, 1);
+	TestMdsRoundTrip(s_multiSession, 2);
+}
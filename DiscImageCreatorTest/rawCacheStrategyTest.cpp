@@ -0,0 +1,407 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/execScsiCmdforDVD.h"
+#include "../DiscImageCreator/rawCacheStrategy.h"
+#include "test.h"
+
+#define SIMULATED_DISC_SIZE		(8000)
+#define SIMULATED_FIRST_SECTOR	(0x30000)
+
+// The simulated chipsets. The product id selects the 0xE7 type of
+// execScsiCmdforDVD.cpp like the real drive
+typedef struct _SIMULATED_DRIVE {
+	LPCSTR szProductId;
+	INT nDriveSampleOffset;
+	DWORD dwCacheAddr; // the address which the chipset caches the first block, 0 if it doesn't use 0xE7
+	BOOL bRing;
+} SIMULATED_DRIVE, *PSIMULATED_DRIVE;
+
+static CONST SIMULATED_DRIVE s_drive[] = {
+	{ "RW/DVD GCC-4160N", 102, 0xa13000, FALSE },
+	{ "RW/DVD GCC-4242N", 102, RAW_CACHE_RING_START_ADDR, TRUE },
+	{ "RW/DVD GCC-4243N", 102, RAW_CACHE_RING_START_ADDR, FALSE },
+	{ "DVD-ROM GDR8082N", 102, RAW_CACHE_RING_START_ADDR, FALSE },
+	{ "DVD-ROM SIM0102 ", 102, 0, FALSE },
+	{ "DVD-ROM SIM0667 ", 667, 0, FALSE },
+};
+
+// The cache of the chipset holds the sectors of the last READ(12). The sector
+// num of the fault range is wrong if the transfer length is dwFaultTransferLen
+// or more, nFaultReadNum times per LBA read (-1: always).
+typedef struct _SIMULATED_CHIPSET {
+	CONST SIMULATED_DRIVE* pDrive;
+	INT nReadLBA;
+	DWORD dwReadLen;
+	INT nFaultFirstLBA;
+	INT nFaultLastLBA; // not included
+	INT nFaultReadNum;
+	DWORD dwFaultTransferLen;
+	INT anFaultCount[SIMULATED_DISC_SIZE];
+} SIMULATED_CHIPSET, *PSIMULATED_CHIPSET;
+
+static VOID ReadSimulatedDisc(
+	PSIMULATED_CHIPSET pChip,
+	INT nLBA,
+	DWORD dwTransferLen
+) {
+	pChip->nReadLBA = nLBA;
+	pChip->dwReadLen = dwTransferLen;
+}
+
+// Returns FALSE if the chipset doesn't accept the command
+static BOOL DumpSimulatedCache(
+	PSIMULATED_CHIPSET pChip,
+	LPBYTE lpCmd,
+	LPBYTE lpBuf
+) {
+	DWORD dwSize = 0;
+	INT nFirstLBA = pChip->nReadLBA;
+	if (lpCmd[0] == 0xE7) {
+		if (pChip->pDrive->dwCacheAddr == 0) {
+			return FALSE;
+		}
+		DWORD dwAddr = MAKEDWORD(MAKEWORD(lpCmd[9], lpCmd[8]), MAKEWORD(lpCmd[7], lpCmd[6]));
+		dwSize = MAKEWORD(lpCmd[11], lpCmd[10]);
+		if (dwSize == 0 || dwAddr < pChip->pDrive->dwCacheAddr ||
+			(dwAddr - pChip->pDrive->dwCacheAddr) % dwSize) {
+			return FALSE;
+		}
+		DWORD dwBlk = (dwAddr - pChip->pDrive->dwCacheAddr) / dwSize;
+		if (pChip->pDrive->bRing) {
+			if (RAW_CACHE_RING_END_ADDR <= dwAddr) {
+				return FALSE;
+			}
+		}
+		else {
+			if (5 <= dwBlk) {
+				return FALSE;
+			}
+			nFirstLBA += (INT)(dwBlk * dwSize / DVD_RAW_READ);
+		}
+	}
+	else if (lpCmd[0] == SCSIOP_READ_DATA_BUFF) {
+		if (pChip->pDrive->dwCacheAddr != 0) {
+			return FALSE;
+		}
+		DWORD dwOfs = MAKEDWORD(MAKEWORD(lpCmd[5], lpCmd[4]), MAKEWORD(lpCmd[3], 0));
+		dwSize = MAKEDWORD(MAKEWORD(lpCmd[8], lpCmd[7]), MAKEWORD(lpCmd[6], 0));
+		if (dwOfs != (DWORD)(pChip->nReadLBA % RAW_CACHE_SECTOR_NUM) * DVD_RAW_READ) {
+			return FALSE;
+		}
+	}
+	else {
+		return FALSE;
+	}
+	INT nErr = 0;
+	if (pChip->nFaultFirstLBA <= pChip->nReadLBA && pChip->nReadLBA < pChip->nFaultLastLBA &&
+		pChip->dwFaultTransferLen <= pChip->dwReadLen) {
+		if (pChip->nFaultReadNum < 0 ||
+			pChip->anFaultCount[pChip->nReadLBA] < pChip->nFaultReadNum) {
+			nErr = 1;
+		}
+		pChip->anFaultCount[pChip->nReadLBA]++;
+	}
+	for (DWORD i = 0; i < dwSize / DVD_RAW_READ; i++) {
+		DWORD dwSectorNum = (DWORD)(SIMULATED_FIRST_SECTOR + nFirstLBA + (INT)i + nErr);
+		lpBuf[DVD_RAW_READ * i + 1] = LOBYTE(HIWORD(dwSectorNum));
+		lpBuf[DVD_RAW_READ * i + 2] = HIBYTE(LOWORD(dwSectorNum));
+		lpBuf[DVD_RAW_READ * i + 3] = LOBYTE(LOWORD(dwSectorNum));
+	}
+	return TRUE;
+}
+
+typedef struct _SIMULATED_DUMP {
+	BOOL bRet;
+	BOOL bTuned;
+	BOOL bSectorOK; // all sectors are dumped in order
+	INT nRereadPeak;
+} SIMULATED_DUMP, *PSIMULATED_DUMP;
+
+// The loop of ReadDVDRaw without the EDC check
+static VOID DumpSimulatedDisc(
+	PDEVICE pDevice,
+	PSIMULATED_CHIPSET pChip,
+	PSIMULATED_DUMP pDump
+) {
+	ZeroMemory(pDump, sizeof(SIMULATED_DUMP));
+	pDump->bRet = TRUE;
+	ZeroMemory(pChip->anFaultCount, sizeof(pChip->anFaultCount));
+	RAW_CACHE_STRATEGY strategy;
+	InitRawCacheStrategy(pDevice, pChip->pDrive->nDriveSampleOffset, &strategy);
+	LPBYTE lpBuf = (LPBYTE)calloc((size_t)DVD_RAW_READ * strategy.dwTransferLenDefault, 5);
+	LPDWORD lpDumped = (LPDWORD)calloc(SIMULATED_DISC_SIZE, sizeof(DWORD));
+	if (!lpBuf || !lpDumped) {
+		pDump->bRet = FALSE;
+		free(lpBuf);
+		free(lpDumped);
+		return;
+	}
+	DWORD dwTransferLen = strategy.dwTransferLen;
+	INT nMemBlkSize = strategy.nMemBlkSize;
+	DWORD dwTransferAndMemSize = dwTransferLen * nMemBlkSize;
+	DWORD dwSectorNum = SIMULATED_FIRST_SECTOR;
+	DWORD dwFirstTransferLen = 0;
+	BOOL bMaxReread = FALSE;
+	INT nRereadNum = 0;
+	for (INT nLBA = 0; nLBA < SIMULATED_DISC_SIZE; nLBA += dwTransferAndMemSize) {
+		if (dwSectorNum == SIMULATED_FIRST_SECTOR + SIMULATED_DISC_SIZE) {
+			break;
+		}
+		if ((INT)dwTransferAndMemSize > SIMULATED_DISC_SIZE - nLBA) {
+			nMemBlkSize = (SIMULATED_DISC_SIZE - nLBA) / (INT)dwTransferLen;
+			dwTransferAndMemSize = dwTransferLen * nMemBlkSize;
+		}
+		ReadSimulatedDisc(pChip, nLBA, dwTransferLen);
+		BOOL bCheckSectorNum = TRUE;
+		DWORD dwGotSectorNum = 0;
+		for (INT i = 0; i < nMemBlkSize && bCheckSectorNum; i++) {
+			SetRawCacheAddress(&strategy, nLBA, i, nRereadNum);
+			LPBYTE lpBlk = lpBuf + DVD_RAW_READ * dwTransferLen * i;
+			if (!DumpSimulatedCache(pChip, strategy.lpCmd, lpBlk)) {
+				pDump->bRet = FALSE;
+				break;
+			}
+			for (DWORD j = 0; j < dwTransferLen; j++) {
+				LPBYTE lpFrame = lpBlk + DVD_RAW_READ * j;
+				dwGotSectorNum = MAKEDWORD(MAKEWORD(lpFrame[3], lpFrame[2]), MAKEWORD(lpFrame[1], 0));
+				if (dwSectorNum != dwGotSectorNum - j - i * dwTransferLen) {
+					bCheckSectorNum = FALSE;
+					break;
+				}
+			}
+		}
+		if (!pDump->bRet) {
+			break;
+		}
+		if (bCheckSectorNum) {
+			nRereadNum = 0;
+			for (DWORD j = 0; j < dwTransferAndMemSize; j++) {
+				LPBYTE lpFrame = lpBuf + DVD_RAW_READ * j;
+				lpDumped[dwSectorNum - SIMULATED_FIRST_SECTOR + j] =
+					MAKEDWORD(MAKEWORD(lpFrame[3], lpFrame[2]), MAKEWORD(lpFrame[1], 0));
+			}
+			dwSectorNum += dwTransferAndMemSize;
+			if (dwFirstTransferLen == 0) {
+				dwFirstTransferLen = dwTransferLen;
+			}
+		}
+		else {
+			nRereadNum++;
+			pDump->nRereadPeak = max(pDump->nRereadPeak, nRereadNum);
+			if (nRereadNum == strategy.nRereadMax) {
+				if (SetRawCacheTransferLen(&strategy, strategy.dwTransferLenMin)) {
+					dwTransferLen = strategy.dwTransferLen;
+					dwTransferAndMemSize = dwTransferLen * nMemBlkSize;
+					nLBA = (INT)dwSectorNum - SIMULATED_FIRST_SECTOR - 2;
+					nRereadNum = 0;
+					continue;
+				}
+				else {
+					bMaxReread = TRUE;
+					pDump->bRet = FALSE;
+					break;
+				}
+			}
+		}
+		if (nRereadNum || strategy.byFlushAlways) {
+			INT nFlushLBA = GetRawCacheFlushLBA(&strategy, nLBA, (INT)dwTransferAndMemSize);
+			if (nRereadNum) {
+				nLBA = GetRawCacheRereadLBA(&strategy, nLBA, (INT)dwTransferAndMemSize,
+					nRereadNum, bCheckSectorNum ? 0 : (INT)(dwGotSectorNum - dwSectorNum));
+			}
+			ReadSimulatedDisc(pChip, nFlushLBA, dwTransferLen);
+		}
+	}
+	pDump->bSectorOK = dwSectorNum == SIMULATED_FIRST_SECTOR + SIMULATED_DISC_SIZE;
+	for (INT i = 0; i < SIMULATED_DISC_SIZE && pDump->bSectorOK; i++) {
+		if (lpDumped[i] != (DWORD)(SIMULATED_FIRST_SECTOR + i)) {
+			pDump->bSectorOK = FALSE;
+		}
+	}
+	// the dump which threw an error isn't tuned
+	if (pDump->bRet || bMaxReread) {
+		pDump->bTuned = TuneRawCacheStrategy(pDevice, &strategy, dwFirstTransferLen,
+			pDump->nRereadPeak, bMaxReread);
+	}
+	free(lpBuf);
+	free(lpDumped);
+}
+
+static VOID InitSimulatedChipset(
+	PDEVICE pDevice,
+	PSIMULATED_CHIPSET pChip,
+	CONST SIMULATED_DRIVE* pDrive
+) {
+	ZeroMemory(pDevice, sizeof(DEVICE));
+	strncpy(pDevice->szProductId, pDrive->szProductId, DRIVE_PRODUCT_ID_SIZE);
+	ZeroMemory(pChip, sizeof(SIMULATED_CHIPSET));
+	pChip->pDrive = pDrive;
+	pChip->nFaultFirstLBA = -1;
+	pChip->nFaultLastLBA = -1;
+}
+
+// Every chipset dumps the disc from its cache, and rereads the block of the
+// wrong sector num
+static VOID TestDumpEachChipset(
+	PDEVICE pDevice
+) {
+	SIMULATED_CHIPSET chip;
+	SIMULATED_DUMP dump;
+	for (size_t i = 0; i < sizeof(s_drive) / sizeof(s_drive[0]); i++) {
+		InitSimulatedChipset(pDevice, &chip, &s_drive[i]);
+		DumpSimulatedDisc(pDevice, &chip, &dump);
+		TEST_CHECK(dump.bRet && dump.bSectorOK && dump.nRereadPeak == 0);
+		TEST_CHECK(pDevice->PROFILE.nRawRereadMax == 0);
+
+		// the Renesas chip doesn't rewind at the reread
+		if (s_drive[i].nDriveSampleOffset != 667) {
+			InitSimulatedChipset(pDevice, &chip, &s_drive[i]);
+			chip.nFaultFirstLBA = 3000;
+			chip.nFaultLastLBA = 3200;
+			chip.nFaultReadNum = 1;
+			DumpSimulatedDisc(pDevice, &chip, &dump);
+			TEST_CHECK(dump.bRet && dump.bSectorOK && 0 < dump.nRereadPeak);
+			if (!dump.bRet || !dump.bSectorOK) {
+				fprintf(stderr, "\t%s\n", s_drive[i].szProductId);
+			}
+		}
+	}
+}
+
+// A give-up doubles the max of the reread for the next dump, and the clean
+// dumps halve it back
+static VOID TestRereadMax(
+	PDEVICE pDevice
+) {
+	SIMULATED_CHIPSET chip;
+	SIMULATED_DUMP dump;
+	InitSimulatedChipset(pDevice, &chip, &s_drive[0]);
+	chip.nFaultFirstLBA = 4000;
+	chip.nFaultLastLBA = 4016;
+	chip.nFaultReadNum = -1;
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	TEST_CHECK(!dump.bRet && dump.bTuned);
+	TEST_CHECK(pDevice->PROFILE.nRawRereadMax == RAW_CACHE_REREAD_MAX * 2);
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	TEST_CHECK(pDevice->PROFILE.nRawRereadMax == RAW_CACHE_REREAD_LIMIT);
+
+	// the dump needs the half or more
+	chip.nFaultReadNum = RAW_CACHE_REREAD_LIMIT / 2;
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	TEST_CHECK(dump.bRet && dump.bSectorOK && !dump.bTuned);
+	TEST_CHECK(pDevice->PROFILE.nRawRereadMax == RAW_CACHE_REREAD_LIMIT);
+
+	chip.nFaultReadNum = 0;
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	TEST_CHECK(dump.bRet && dump.bSectorOK && dump.bTuned);
+	TEST_CHECK(pDevice->PROFILE.nRawRereadMax == RAW_CACHE_REREAD_LIMIT / 2);
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	TEST_CHECK(pDevice->PROFILE.nRawRereadMax == RAW_CACHE_REREAD_MAX);
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	TEST_CHECK(!dump.bTuned);
+}
+
+// The transfer length is learned from the first block only, and the learned
+// smaller one is dropped after a clean dump
+static VOID TestTransferLength(
+	PDEVICE pDevice
+) {
+	SIMULATED_CHIPSET chip;
+	SIMULATED_DUMP dump;
+	// this drive can't dump the larger block at all
+	InitSimulatedChipset(pDevice, &chip, &s_drive[1]);
+	chip.nFaultFirstLBA = 0;
+	chip.nFaultLastLBA = SIMULATED_DISC_SIZE;
+	chip.nFaultReadNum = -1;
+	chip.dwFaultTransferLen = 2;
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	TEST_CHECK(dump.bRet && dump.bSectorOK);
+	TEST_CHECK(pDevice->PROFILE.dwRawTransferLen == 1);
+	// the fallback isn't a reason to raise the max of the reread
+	TEST_CHECK(pDevice->PROFILE.nRawRereadMax == 0);
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	TEST_CHECK(dump.bRet && dump.bSectorOK && dump.nRereadPeak == 0);
+	TEST_CHECK(pDevice->PROFILE.dwRawTransferLen == 8);
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	TEST_CHECK(pDevice->PROFILE.dwRawTransferLen == 1);
+
+	// the smaller one needed the reread, so it's kept
+	chip.nFaultFirstLBA = 5000;
+	chip.nFaultLastLBA = 5008;
+	chip.nFaultReadNum = 1;
+	chip.dwFaultTransferLen = 1;
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	TEST_CHECK(dump.bRet && dump.bSectorOK && 0 < dump.nRereadPeak);
+	TEST_CHECK(pDevice->PROFILE.dwRawTransferLen == 1);
+
+	// the bad area of the disc falls back on the way, but it isn't learned
+	InitSimulatedChipset(pDevice, &chip, &s_drive[1]);
+	chip.nFaultFirstLBA = 2000;
+	chip.nFaultLastLBA = 2100;
+	chip.nFaultReadNum = -1;
+	chip.dwFaultTransferLen = 2;
+	DumpSimulatedDisc(pDevice, &chip, &dump);
+	TEST_CHECK(dump.bRet && dump.bSectorOK);
+	TEST_CHECK(pDevice->PROFILE.dwRawTransferLen == 8);
+}
+
+// The geometry of every chipset is in the range of the transfer length
+static VOID TestStrategyGeometry(
+	PDEVICE pDevice
+) {
+	CONST INT anOffset[] = { 102, 667, 6, 0 };
+	RAW_CACHE_STRATEGY strategy;
+	for (size_t i = 0; i < sizeof(s_drive) / sizeof(s_drive[0]) + sizeof(anOffset) / sizeof(anOffset[0]); i++) {
+		ZeroMemory(pDevice, sizeof(DEVICE));
+		INT nOffset = 0;
+		if (i < sizeof(s_drive) / sizeof(s_drive[0])) {
+			strncpy(pDevice->szProductId, s_drive[i].szProductId, DRIVE_PRODUCT_ID_SIZE);
+			nOffset = s_drive[i].nDriveSampleOffset;
+		}
+		else {
+			nOffset = anOffset[i - sizeof(s_drive) / sizeof(s_drive[0])];
+		}
+		InitRawCacheStrategy(pDevice, nOffset, &strategy);
+		TEST_CHECK(strategy.szName != NULL);
+		TEST_CHECK(1 <= strategy.dwTransferLenMin && strategy.dwTransferLenMin <= strategy.dwTransferLen);
+		TEST_CHECK(strategy.dwTransferLen == strategy.dwTransferLenDefault && strategy.dwTransferLen <= 16);
+		TEST_CHECK(1 <= strategy.nMemBlkSize && strategy.nMemBlkSize <= 5);
+		TEST_CHECK(strategy.nRereadMax == RAW_CACHE_REREAD_MAX);
+	}
+	// the profile out of the range isn't used
+	pDevice->PROFILE.dwRawTransferLen = 17;
+	pDevice->PROFILE.nRawRereadMax = RAW_CACHE_REREAD_LIMIT + 1;
+	InitRawCacheStrategy(pDevice, 102, &strategy);
+	TEST_CHECK(strategy.dwTransferLen == strategy.dwTransferLenDefault);
+	TEST_CHECK(strategy.nRereadMax == RAW_CACHE_REREAD_MAX);
+}
+
+VOID TestRawCacheStrategy(
+	VOID
+) {
+	PDEVICE pDevice = (PDEVICE)calloc(1, sizeof(DEVICE));
+	TEST_CHECK(pDevice != NULL);
+	if (pDevice) {
+		TestStrategyGeometry(pDevice);
+		TestDumpEachChipset(pDevice);
+		TestRereadMax(pDevice);
+		TestTransferLength(pDevice);
+	}
+	free(pDevice);
+}
@@ -0,0 +1,171 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/execImage.h"
+#include "../DiscImageCreator/outputStream.h"
+#include "../DiscImageCreator/readQueue.h"
+#include "test.h"
+
+#define READ_QUEUE_TEST_SECTOR_NUM	(512)
+#define READ_QUEUE_TEST_TRANSFER_LEN	(8)
+#define READ_QUEUE_TEST_SLOT_SIZE	(DISC_RAW_READ_SIZE * READ_QUEUE_TEST_TRANSFER_LEN)
+#define READ_QUEUE_TEST_LATENCY_MS	(6)
+
+// Reads the image to pszPath like ReadDVD. The slots must be completed in the
+// order of the issue. The failed slot is zero-filled, and its LBA is set to
+// lpFailedLBA. Returns the time of the dump in ms, or -1 if it failed.
+static double DumpReadQueueTestImage(
+	PDEVICE pDevice,
+	LPCTSTR pszPath,
+	INT nDepth,
+	PREAD_QUEUE pQueue,
+	LPINT lpFailedLBA
+) {
+	FILE* fp = _tfopen(pszPath, _T("wb"));
+	if (!fp) {
+		return -1;
+	}
+	EXT_ARG extArg = { 0 };
+	BOOL bRet = AttachOutputStream(fp, FALSE, FALSE) &&
+		InitReadQueue(pQueue, pDevice, fp, READ_QUEUE_TEST_SLOT_SIZE, nDepth);
+	LARGE_INTEGER llStart = { 0 };
+	LARGE_INTEGER llEnd = { 0 };
+	QueryPerformanceCounter(&llStart);
+
+	CDB::_READ12 cdb = { 0 };
+	cdb.OperationCode = SCSIOP_READ12;
+	DWORD dwTransferLen = READ_QUEUE_TEST_TRANSFER_LEN;
+	REVERSE_BYTES(&cdb.TransferLength, &dwTransferLen);
+	INT nIssueLBA = 0;
+	INT nPushLBA = 0;
+	*lpFailedLBA = -1;
+	while (bRet && nPushLBA < READ_QUEUE_TEST_SECTOR_NUM) {
+		if (nIssueLBA < READ_QUEUE_TEST_SECTOR_NUM && pQueue->nIssuedNum < nDepth) {
+			GetReadQueueSlot(pQueue);
+			REVERSE_BYTES(&cdb.LogicalBlock, &nIssueLBA);
+			IssueReadQueueSlot(pQueue, &extArg, pDevice
+				, &cdb, CDB12GENERIC_LENGTH, nIssueLBA, READ_QUEUE_TEST_SLOT_SIZE);
+			nIssueLBA += READ_QUEUE_TEST_TRANSFER_LEN;
+			continue;
+		}
+		LPBYTE lpSlot = NULL;
+		INT nLBA = 0;
+		DWORD dwSize = 0;
+		if (!CompleteReadQueueSlot(pQueue, &lpSlot, &nLBA, &dwSize)) {
+			ZeroMemory(lpSlot, dwSize);
+			*lpFailedLBA = nLBA;
+		}
+		if (nLBA != nPushLBA || dwSize != READ_QUEUE_TEST_SLOT_SIZE) {
+			bRet = FALSE;
+		}
+		bRet &= PushReadQueueSlot(pQueue, dwSize);
+		nPushLBA += READ_QUEUE_TEST_TRANSFER_LEN;
+	}
+	TerminateReadQueue(pQueue);
+	QueryPerformanceCounter(&llEnd);
+	bRet &= DetachOutputStream(fp, ".iso");
+	fclose(fp);
+	if (!bRet) {
+		return -1;
+	}
+	return (double)(llEnd.QuadPart - llStart.QuadPart) * 1000 / pQueue->llFreq.QuadPart;
+}
+
+// The output must be the image except the zero-filled slot of nFailedLBA (-1 if no slot failed)
+static BOOL IsReadQueueTestDump(
+	LPCTSTR pszPath,
+	LPBYTE lpImage,
+	INT nFailedLBA
+) {
+	FILE* fp = _tfopen(pszPath, _T("rb"));
+	if (!fp) {
+		return FALSE;
+	}
+	BOOL bRet = TRUE;
+	BYTE aBuf[DISC_RAW_READ_SIZE] = { 0 };
+	BYTE aZero[DISC_RAW_READ_SIZE] = { 0 };
+	for (INT i = 0; i < READ_QUEUE_TEST_SECTOR_NUM; i++) {
+		if (fread(aBuf, sizeof(aBuf), 1, fp) != 1) {
+			bRet = FALSE;
+			break;
+		}
+		BOOL bFailed = nFailedLBA >= 0 && nFailedLBA <= i && i < nFailedLBA + READ_QUEUE_TEST_TRANSFER_LEN;
+		if (memcmp(aBuf, bFailed ? aZero : lpImage + DISC_RAW_READ_SIZE * i, DISC_RAW_READ_SIZE)) {
+			bRet = FALSE;
+		}
+	}
+	fclose(fp);
+	return bRet;
+}
+
+// The image device with the latency completes the commands of the queue out
+// of order after 0 to READ_QUEUE_TEST_LATENCY_MS. The output must stay in
+// order, and the commands in flight must hide the latency.
+VOID TestReadQueue(
+	VOID
+) {
+	_TCHAR szImage[_MAX_PATH] = { 0 };
+	_TCHAR szPath[_MAX_PATH] = { 0 };
+	GetTestTempPath(szImage, _T("DiscImageCreatorTest_readQueueImage.iso"));
+	GetTestTempPath(szPath, _T("DiscImageCreatorTest_readQueue.iso"));
+
+	LPBYTE lpImage = (LPBYTE)calloc(READ_QUEUE_TEST_SECTOR_NUM, DISC_RAW_READ_SIZE);
+	BYTE aErrorNum[READ_QUEUE_TEST_SECTOR_NUM] = { 0 };
+	srand(15);
+	for (INT i = 0; i < READ_QUEUE_TEST_SECTOR_NUM * DISC_RAW_READ_SIZE; i++) {
+		lpImage[i] = (BYTE)rand();
+	}
+	FILE* fp = _tfopen(szImage, _T("wb"));
+	TEST_CHECK(fp != NULL);
+	if (fp) {
+		fwrite(lpImage, DISC_RAW_READ_SIZE, READ_QUEUE_TEST_SECTOR_NUM, fp);
+		fclose(fp);
+	}
+	DEVICE device = { 0 };
+	TEST_CHECK(OpenImage(&device, szImage, _T(".iso")));
+	if (device.IMAGE.fp) {
+		device.IMAGE.dwLatencyMs = READ_QUEUE_TEST_LATENCY_MS;
+		device.IMAGE.lpErrorNum = aErrorNum;
+		READ_QUEUE queue = { 0 };
+		INT nFailedLBA = 0;
+
+		// 1 command waits for each latency
+		double dMs1 = DumpReadQueueTestImage(&device, szPath, 1, &queue, &nFailedLBA);
+		TEST_CHECK(dMs1 >= 0);
+		TEST_CHECK(queue.nOutOfOrderNum == 0);
+		TEST_CHECK(nFailedLBA == -1);
+		TEST_CHECK(IsReadQueueTestDump(szPath, lpImage, -1));
+
+		double dMs4 = DumpReadQueueTestImage(&device, szPath, 4, &queue, &nFailedLBA);
+		TEST_CHECK(dMs4 >= 0);
+		TEST_CHECK(queue.nOutOfOrderNum > 0);
+		TEST_CHECK(nFailedLBA == -1);
+		TEST_CHECK(IsReadQueueTestDump(szPath, lpImage, -1));
+		TEST_CHECK(dMs4 * 2 < dMs1);
+
+		// the failed command is completed in its turn
+		aErrorNum[100] = 0xff;
+		double dMs16 = DumpReadQueueTestImage(&device, szPath, READ_QUEUE_DEPTH_MAX, &queue, &nFailedLBA);
+		TEST_CHECK(dMs16 >= 0);
+		TEST_CHECK(queue.nOutOfOrderNum > 0);
+		TEST_CHECK(nFailedLBA == 96);
+		TEST_CHECK(IsReadQueueTestDump(szPath, lpImage, 96));
+		CloseImage(&device);
+	}
+	free(lpImage);
+	_tremove(szImage);
+	_tremove(szPath);
+}
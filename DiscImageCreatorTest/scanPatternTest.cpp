@@ -0,0 +1,193 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/scanPattern.h"
+#include "test.h"
+
+#define SCAN_TEST_SIZE	(20000)
+#define SCAN_MATCH_MAX	(SCAN_TEST_SIZE * 8)
+
+// Overlapping patterns: a suffix of one is a prefix or the whole of another,
+// and "abcab" overlaps itself
+static CONST BYTE* s_lpPattern[] = {
+	(CONST BYTE*)"abcab",
+	(CONST BYTE*)"bca",
+	(CONST BYTE*)"cab",
+	(CONST BYTE*)"a",
+	(CONST BYTE*)"abcabcab",
+	(CONST BYTE*)"bb",
+	(CONST BYTE*)"cabcabcabc",
+};
+static DWORD s_dwPatternLen[] = { 5, 3, 3, 1, 8, 2, 10 };
+
+// Every position is compared with every pattern. The order is same as the
+// automaton: by the end of the match, and by the pattern index
+static INT ScanPatternByNaive(
+	LPBYTE lpBuf,
+	DWORD dwBufLen,
+	PPATTERN_MATCH pMatch
+) {
+	INT nMatchNum = 0;
+	for (DWORD dwEnd = 1; dwEnd <= dwBufLen; dwEnd++) {
+		for (INT j = 0; j < (INT)(sizeof(s_dwPatternLen) / sizeof(s_dwPatternLen[0])); j++) {
+			if (s_dwPatternLen[j] <= dwEnd &&
+				!memcmp(lpBuf + dwEnd - s_dwPatternLen[j], s_lpPattern[j], s_dwPatternLen[j])) {
+				pMatch[nMatchNum].nPatternIdx = j;
+				pMatch[nMatchNum].ullPos = dwEnd - s_dwPatternLen[j];
+				nMatchNum++;
+			}
+		}
+	}
+	return nMatchNum;
+}
+
+static BOOL IsSameMatch(
+	PPATTERN_MATCH pMatch,
+	INT nMatchNum,
+	PPATTERN_MATCH pExpected,
+	INT nExpectedNum
+) {
+	if (nMatchNum != nExpectedNum) {
+		return FALSE;
+	}
+	for (INT i = 0; i < nMatchNum; i++) {
+		if (pMatch[i].nPatternIdx != pExpected[i].nPatternIdx ||
+			pMatch[i].ullPos != pExpected[i].ullPos) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+// The buffer is given to the scanner in the chunks of 1 to 64 bytes, so many
+// matches span the chunks
+static VOID TestScanPatternAcrossBuffer(
+	VOID
+) {
+	LPBYTE lpBuf = (LPBYTE)calloc(SCAN_TEST_SIZE, sizeof(BYTE));
+	PPATTERN_MATCH pMatch = (PPATTERN_MATCH)calloc(SCAN_MATCH_MAX, sizeof(PATTERN_MATCH));
+	PPATTERN_MATCH pExpected = (PPATTERN_MATCH)calloc(SCAN_MATCH_MAX, sizeof(PATTERN_MATCH));
+	TEST_CHECK(lpBuf && pMatch && pExpected);
+	if (lpBuf && pMatch && pExpected) {
+		srand(6);
+		for (INT i = 0; i < SCAN_TEST_SIZE; i++) {
+			lpBuf[i] = (BYTE)("abc"[rand() % 3]);
+		}
+		// a long run of the self-overlapping pattern
+		for (INT i = 1000; i < 1100; i++) {
+			lpBuf[i] = (BYTE)("abc"[i % 3]);
+		}
+		INT nExpectedNum = ScanPatternByNaive(lpBuf, SCAN_TEST_SIZE, pExpected);
+		TEST_CHECK(nExpectedNum > 0);
+
+		PATTERN_SCANNER scanner = { 0 };
+		TEST_CHECK(InitPatternScanner(&scanner, s_lpPattern, s_dwPatternLen
+			, sizeof(s_dwPatternLen) / sizeof(s_dwPatternLen[0])));
+		INT nMatchNum = 0;
+		DWORD dwPos = 0;
+		while (dwPos < SCAN_TEST_SIZE) {
+			DWORD dwLen = (DWORD)(rand() % 64 + 1);
+			dwLen = min(dwLen, SCAN_TEST_SIZE - dwPos);
+			nMatchNum += ScanPattern(&scanner, lpBuf + dwPos, dwLen
+				, pMatch + nMatchNum, SCAN_MATCH_MAX - nMatchNum);
+			dwPos += dwLen;
+		}
+		TEST_CHECK(scanner.ullPos == SCAN_TEST_SIZE);
+		TEST_CHECK(IsSameMatch(pMatch, nMatchNum, pExpected, nExpectedNum));
+		TerminatePatternScanner(&scanner);
+	}
+	free(pExpected);
+	free(pMatch);
+	free(lpBuf);
+}
+
+// All 256 values of the byte, and the buffer is given byte by byte
+static VOID TestScanPatternBinary(
+	VOID
+) {
+	CONST BYTE aSync[] = { 0x00, 0xff, 0xff, 0x00 };
+	CONST BYTE aFf[] = { 0xff, 0xff };
+	CONST BYTE aHigh[] = { 0x80, 0x00, 0xff };
+	CONST BYTE* lpPattern[] = { aSync, aFf, aHigh };
+	DWORD dwPatternLen[] = { sizeof(aSync), sizeof(aFf), sizeof(aHigh) };
+	BYTE buf[4096] = { 0 };
+	srand(7);
+	for (size_t i = 0; i < sizeof(buf); i++) {
+		buf[i] = (BYTE)rand();
+		// make the patterns frequent
+		if (rand() % 4 == 0) {
+			buf[i] = (BYTE)(rand() % 2 ? 0xff : 0x00);
+		}
+	}
+	PATTERN_SCANNER scanner = { 0 };
+	TEST_CHECK(InitPatternScanner(&scanner, lpPattern, dwPatternLen, 3));
+	static PATTERN_MATCH match[sizeof(buf) * 3];
+	INT nMatchNum = 0;
+	for (size_t i = 0; i < sizeof(buf); i++) {
+		nMatchNum += ScanPattern(&scanner, buf + i, 1, match + nMatchNum, (INT)(sizeof(match) / sizeof(match[0])) - nMatchNum);
+	}
+	INT nFail = 0;
+	INT nExpectedNum = 0;
+	for (size_t dwEnd = 1; dwEnd <= sizeof(buf); dwEnd++) {
+		for (INT j = 0; j < 3; j++) {
+			if (dwPatternLen[j] <= dwEnd &&
+				!memcmp(buf + dwEnd - dwPatternLen[j], lpPattern[j], dwPatternLen[j])) {
+				if (nExpectedNum >= nMatchNum || match[nExpectedNum].nPatternIdx != j ||
+					match[nExpectedNum].ullPos != dwEnd - dwPatternLen[j]) {
+					nFail++;
+				}
+				nExpectedNum++;
+			}
+		}
+	}
+	TEST_CHECK(nFail == 0);
+	TEST_CHECK(nMatchNum == nExpectedNum);
+	TerminatePatternScanner(&scanner);
+}
+
+// The scan stops when pMatch is full, and resumes from the byte after the
+// last scanned one (ullPos tells how many bytes were scanned)
+static VOID TestScanPatternMatchFull(
+	VOID
+) {
+	CONST BYTE aA[] = { 'a' };
+	CONST BYTE* lpPattern[] = { aA };
+	DWORD dwPatternLen[] = { 1 };
+	BYTE buf[] = { 'a', 'x', 'a', 'a', 'x', 'a' };
+	PATTERN_SCANNER scanner = { 0 };
+	TEST_CHECK(InitPatternScanner(&scanner, lpPattern, dwPatternLen, 1));
+	PATTERN_MATCH match[2] = { 0 };
+	INT nPos[4] = { 0 };
+	INT nNum = 0;
+	while (scanner.ullPos < sizeof(buf)) {
+		DWORD dwDone = (DWORD)scanner.ullPos;
+		INT n = ScanPattern(&scanner, buf + dwDone, sizeof(buf) - dwDone, match, 2);
+		for (INT i = 0; i < n && nNum < 4; i++) {
+			nPos[nNum++] = (INT)match[i].ullPos;
+		}
+	}
+	TEST_CHECK(nNum == 4);
+	TEST_CHECK(nPos[0] == 0 && nPos[1] == 2 && nPos[2] == 3 && nPos[3] == 5);
+	TerminatePatternScanner(&scanner);
+}
+
+VOID TestScanPattern(
+	VOID
+) {
+	TestScanPatternAcrossBuffer();
+	TestScanPatternBinary();
+	TestScanPatternMatchFull();
+}
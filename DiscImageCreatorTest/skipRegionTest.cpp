@@ -0,0 +1,149 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/skipRegion.h"
+#include "test.h"
+
+#define SURFACE_SECTOR_NUM	(20000)
+
+// The surface of the simulated disc. The probe reads it instead of the drive
+typedef struct _SIMULATED_SURFACE {
+	BYTE abyReadable[SURFACE_SECTOR_NUM];
+	INT nProbeNum;
+	INT nOutOfRangeNum;
+	INT nBadLBA;
+	INT nEndLBA;
+} SIMULATED_SURFACE, *PSIMULATED_SURFACE;
+
+static BOOL ReadSimulatedSurface(
+	LPVOID lpContext,
+	INT nLBA
+) {
+	PSIMULATED_SURFACE pSurface = (PSIMULATED_SURFACE)lpContext;
+	pSurface->nProbeNum++;
+	if (nLBA <= pSurface->nBadLBA || pSurface->nEndLBA <= nLBA) {
+		pSurface->nOutOfRangeNum++;
+		return FALSE;
+	}
+	return pSurface->abyReadable[nLBA];
+}
+
+static INT ProbeSimulatedSurface(
+	PSIMULATED_SURFACE pSurface,
+	INT nBadLBA,
+	INT nEndLBA
+) {
+	pSurface->nProbeNum = 0;
+	pSurface->nOutOfRangeNum = 0;
+	pSurface->nBadLBA = nBadLBA;
+	pSurface->nEndLBA = nEndLBA;
+	return GetFirstReadableLBA(nBadLBA, nEndLBA, ReadSimulatedSurface, pSurface);
+}
+
+// log2(n) rounded up
+static INT GetCeilLog2(
+	INT n
+) {
+	INT nLog = 0;
+	while ((1 << nLog) < n) {
+		nLog++;
+	}
+	return nLog;
+}
+
+// The unreadable region [nBadLBA, nBadLBA + nLen) between the readable sectors
+// must be skipped exactly, by the probes of O(log(nLen)) + nLen / SKIP_REGION_STEP_MAX
+static VOID TestSkipUnreadableRegion(
+	PSIMULATED_SURFACE pSurface
+) {
+	CONST INT nBadLBA = 100;
+	INT nFail = 0;
+	for (INT nLen = 1; nLen < SURFACE_SECTOR_NUM - nBadLBA - 1; nLen += nLen < 64 ? 1 : 37) {
+		FillMemory(pSurface->abyReadable, sizeof(pSurface->abyReadable), TRUE);
+		ZeroMemory(pSurface->abyReadable + nBadLBA, (size_t)nLen);
+		INT nLBA = ProbeSimulatedSurface(pSurface, nBadLBA, SURFACE_SECTOR_NUM);
+		INT nProbeMax = 2 * GetCeilLog2(min(nLen, SKIP_REGION_STEP_MAX) + 1)
+			+ nLen / SKIP_REGION_STEP_MAX + 2;
+		if (nLBA != nBadLBA + nLen || pSurface->nProbeNum > nProbeMax ||
+			pSurface->nOutOfRangeNum) {
+			fprintf(stderr, "\tlen %d: returned %d, probed %d times\n", nLen, nLBA, pSurface->nProbeNum);
+			nFail++;
+		}
+	}
+	TEST_CHECK(nFail == 0);
+}
+
+// Nothing can be read to the end
+static VOID TestSkipToEnd(
+	PSIMULATED_SURFACE pSurface
+) {
+	FillMemory(pSurface->abyReadable, sizeof(pSurface->abyReadable), TRUE);
+	ZeroMemory(pSurface->abyReadable + 5000, SURFACE_SECTOR_NUM - 5000);
+	TEST_CHECK(ProbeSimulatedSurface(pSurface, 5000, SURFACE_SECTOR_NUM) == SURFACE_SECTOR_NUM);
+	TEST_CHECK(pSurface->nOutOfRangeNum == 0);
+	TEST_CHECK(pSurface->nProbeNum <= 2 * GetCeilLog2(SKIP_REGION_STEP_MAX)
+		+ (SURFACE_SECTOR_NUM - 5000) / SKIP_REGION_STEP_MAX + 1);
+
+	// the bad sector is the last one
+	TEST_CHECK(ProbeSimulatedSurface(pSurface, SURFACE_SECTOR_NUM - 1, SURFACE_SECTOR_NUM) == SURFACE_SECTOR_NUM);
+	TEST_CHECK(pSurface->nProbeNum == 0);
+
+	// the readable sector is the last one
+	pSurface->abyReadable[SURFACE_SECTOR_NUM - 1] = TRUE;
+	TEST_CHECK(ProbeSimulatedSurface(pSurface, 5000, SURFACE_SECTOR_NUM) == SURFACE_SECTOR_NUM - 1);
+	TEST_CHECK(pSurface->nOutOfRangeNum == 0);
+}
+
+// The scratched surface has the readable sectors in the unreadable region. The
+// returned sector must be readable and the sector before it must be unreadable,
+// and the readable sectors skipped by it are retried by the caller
+static VOID TestSkipScratchedSurface(
+	PSIMULATED_SURFACE pSurface
+) {
+	srand(3);
+	INT nFail = 0;
+	for (INT n = 0; n < 500; n++) {
+		// the readable rate of the surface goes from 0% to 50%
+		INT nRate = n % 50;
+		for (INT i = 0; i < SURFACE_SECTOR_NUM; i++) {
+			pSurface->abyReadable[i] = (BYTE)(rand() % 100 < nRate);
+		}
+		INT nBadLBA = rand() % (SURFACE_SECTOR_NUM - 1);
+		pSurface->abyReadable[nBadLBA] = FALSE;
+		INT nLBA = ProbeSimulatedSurface(pSurface, nBadLBA, SURFACE_SECTOR_NUM);
+		if (nLBA < nBadLBA + 1 || SURFACE_SECTOR_NUM < nLBA || pSurface->nOutOfRangeNum) {
+			nFail++;
+		}
+		else if (nLBA < SURFACE_SECTOR_NUM &&
+			(!pSurface->abyReadable[nLBA] || pSurface->abyReadable[nLBA - 1])) {
+			nFail++;
+		}
+	}
+	TEST_CHECK(nFail == 0);
+}
+
+VOID TestSkipRegion(
+	VOID
+) {
+	PSIMULATED_SURFACE pSurface = (PSIMULATED_SURFACE)calloc(1, sizeof(SIMULATED_SURFACE));
+	TEST_CHECK(pSurface != NULL);
+	if (pSurface) {
+		TestSkipUnreadableRegion(pSurface);
+		TestSkipToEnd(pSurface);
+		TestSkipScratchedSurface(pSurface);
+	}
+	free(pSurface);
+}
@@ -0,0 +1,218 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/convert.h"
+#include "../DiscImageCreator/syncSearch.h"
+#include "test.h"
+
+extern BYTE g_aSyncHeader[SYNC_SIZE];
+
+#define SYNC_TEST_LBA	(1000)
+
+static INT FindSyncHeaderByNaive(
+	LPBYTE lpBuf,
+	INT nBufLen,
+	INT nPos
+) {
+	for (; nPos + SYNC_SIZE <= nBufLen; nPos++) {
+		if (!memcmp(lpBuf + nPos, g_aSyncHeader, SYNC_SIZE)) {
+			return nPos;
+		}
+	}
+	return -1;
+}
+
+static VOID FillRandom(
+	LPBYTE lpBuf,
+	INT nBufLen
+) {
+	for (INT i = 0; i < nBufLen; i++) {
+		// 0x00 and 0xff often, so the partial syncs pass the compare of 5 bytes
+		lpBuf[i] = (BYTE)(rand() % 4 ? (rand() % 2 ? 0xff : 0x00) : rand());
+	}
+}
+
+// Sets the sync and the scrambled header of nSectorLBA at nPos as the .scm
+static VOID SetScrambledSector(
+	LPBYTE lpBuf,
+	INT nPos,
+	INT nSectorLBA
+) {
+	BYTE m = 0;
+	BYTE s = 0;
+	BYTE f = 0;
+	LBAtoMSF(nSectorLBA + 150, &m, &s, &f);
+	memcpy(lpBuf + nPos, g_aSyncHeader, SYNC_SIZE);
+	lpBuf[nPos + 12] = (BYTE)(DecToBcd(m) ^ 0x01);
+	lpBuf[nPos + 13] = (BYTE)(DecToBcd(s) ^ 0x80);
+	lpBuf[nPos + 14] = DecToBcd(f);
+	lpBuf[nPos + 15] = (BYTE)(DATA_BLOCK_MODE1 ^ 0x60);
+}
+
+// Every length from the sync size to 6 blocks of 16 bytes and every sync
+// position, so the sync is found by the SSE2 block and by the scalar tail
+// (the last 15 bytes). The random bytes around it have many partial syncs
+static VOID TestFindSyncHeader(
+	VOID
+) {
+	srand(8);
+	INT nFail = 0;
+	BYTE buf[128] = { 0 };
+	for (INT nLen = SYNC_SIZE; nLen <= 96 + SYNC_SIZE; nLen++) {
+		for (INT nSync = -1; nSync <= nLen - SYNC_SIZE; nSync++) {
+			FillRandom(buf, sizeof(buf));
+			if (nSync >= 0) {
+				memcpy(buf + nSync, g_aSyncHeader, SYNC_SIZE);
+			}
+			for (INT nPos = 0; nPos <= nLen; nPos += 5) {
+				if (FindSyncHeader(buf, nLen, nPos) != FindSyncHeaderByNaive(buf, nLen, nPos)) {
+					nFail++;
+				}
+			}
+		}
+	}
+	// the sync at the last byte of the buffer
+	FillMemory(buf, sizeof(buf), 0x5a);
+	memcpy(buf + sizeof(buf) - SYNC_SIZE, g_aSyncHeader, SYNC_SIZE);
+	TEST_CHECK(FindSyncHeader(buf, sizeof(buf), 0) == sizeof(buf) - SYNC_SIZE);
+	// a sync cut by the end of the buffer isn't found
+	TEST_CHECK(FindSyncHeader(buf, sizeof(buf) - 1, 0) == -1);
+	TEST_CHECK(nFail == 0);
+}
+
+// SYNC_SEARCH_SECTOR_NUM sectors, the first of them is nFirstLBA at nShift
+static VOID SetScrambledSectors(
+	LPBYTE lpBuf,
+	INT nBufLen,
+	INT nShift,
+	INT nFirstLBA
+) {
+	FillRandom(lpBuf, nBufLen);
+	for (INT i = 0; nShift + CD_RAW_SECTOR_SIZE * i + 16 <= nBufLen; i++) {
+		SetScrambledSector(lpBuf, nShift + CD_RAW_SECTOR_SIZE * i, nFirstLBA + i);
+	}
+}
+
+// The offset of the known shift has all the votes, for the positive and the
+// negative offsets and the sync in the last bytes of the buffer
+static VOID TestSyncCandidatesOfShift(
+	VOID
+) {
+	CONST INT nBufLen = CD_RAW_SECTOR_SIZE * SYNC_SEARCH_SECTOR_NUM;
+	LPBYTE lpBuf = (LPBYTE)calloc(nBufLen, sizeof(BYTE));
+	TEST_CHECK(lpBuf != NULL);
+	if (!lpBuf) {
+		return;
+	}
+	srand(9);
+	// nShift: position of the first sync. The sector at nShift is the LBA
+	// of the top of the buffer, or the next one if the offset is negative
+	CONST INT aShift[] = { 0, 1, 15, 16, 17, 1176, CD_RAW_SECTOR_SIZE - 16 };
+	for (size_t n = 0; n < sizeof(aShift) / sizeof(aShift[0]); n++) {
+		for (INT nNext = 0; nNext <= 1; nNext++) {
+			SetScrambledSectors(lpBuf, nBufLen, aShift[n], SYNC_TEST_LBA + nNext);
+			SYNC_CANDIDATE candidate[SYNC_CANDIDATE_MAX] = { 0 };
+			INT nNum = GetSyncCandidates(lpBuf, nBufLen, SYNC_TEST_LBA, candidate, SYNC_CANDIDATE_MAX);
+			TEST_CHECK(nNum == 1);
+			TEST_CHECK(candidate[0].nCombinedOffset == aShift[n] - CD_RAW_SECTOR_SIZE * nNext);
+			TEST_CHECK(candidate[0].nVotes == SYNC_SEARCH_SECTOR_NUM);
+			TEST_CHECK(candidate[0].nFirstPos == aShift[n]);
+		}
+	}
+	free(lpBuf);
+}
+
+// One header is broken. A valid but wrong MSF votes for another offset, and
+// an illegal BCD votes for nothing
+static VOID TestSyncCandidatesOfCorruptedHeader(
+	VOID
+) {
+	CONST INT nBufLen = CD_RAW_SECTOR_SIZE * SYNC_SEARCH_SECTOR_NUM;
+	LPBYTE lpBuf = (LPBYTE)calloc(nBufLen, sizeof(BYTE));
+	TEST_CHECK(lpBuf != NULL);
+	if (!lpBuf) {
+		return;
+	}
+	srand(10);
+	CONST INT nShift = 1234;
+	SetScrambledSectors(lpBuf, nBufLen, nShift, SYNC_TEST_LBA);
+	// the frame of the 1st sector is +2
+	lpBuf[nShift + 14] = (BYTE)(lpBuf[nShift + 14] + 2);
+	SYNC_CANDIDATE candidate[SYNC_CANDIDATE_MAX] = { 0 };
+	INT nNum = GetSyncCandidates(lpBuf, nBufLen, SYNC_TEST_LBA, candidate, SYNC_CANDIDATE_MAX);
+	TEST_CHECK(nNum == 2);
+	TEST_CHECK(candidate[0].nCombinedOffset == nShift);
+	TEST_CHECK(candidate[0].nVotes == SYNC_SEARCH_SECTOR_NUM - 1);
+	TEST_CHECK(candidate[0].nFirstPos == nShift + CD_RAW_SECTOR_SIZE);
+	TEST_CHECK(candidate[1].nCombinedOffset == nShift - CD_RAW_SECTOR_SIZE * 2);
+	TEST_CHECK(candidate[1].nVotes == 1);
+
+	// the second of the 1st sector is 0x6a (not BCD)
+	SetScrambledSectors(lpBuf, nBufLen, nShift, SYNC_TEST_LBA);
+	lpBuf[nShift + 13] = (BYTE)(0x6a ^ 0x80);
+	nNum = GetSyncCandidates(lpBuf, nBufLen, SYNC_TEST_LBA, candidate, SYNC_CANDIDATE_MAX);
+	TEST_CHECK(nNum == 1);
+	TEST_CHECK(candidate[0].nCombinedOffset == nShift);
+	TEST_CHECK(candidate[0].nVotes == SYNC_SEARCH_SECTOR_NUM - 1);
+	free(lpBuf);
+}
+
+// 2 offsets have the same votes. The one whose first sync is earlier wins
+// even if the other one leads the votes in the middle of the buffer
+static VOID TestSyncCandidatesOfTie(
+	VOID
+) {
+	CONST INT nBufLen = CD_RAW_SECTOR_SIZE * SYNC_SEARCH_SECTOR_NUM;
+	LPBYTE lpBuf = (LPBYTE)calloc(nBufLen, sizeof(BYTE));
+	TEST_CHECK(lpBuf != NULL);
+	if (!lpBuf) {
+		return;
+	}
+	srand(11);
+	CONST INT nShift = 100;
+	SetScrambledSectors(lpBuf, nBufLen, nShift, SYNC_TEST_LBA);
+	// the sectors 1 and 2 are 10 frames ahead: A B B A
+	for (INT i = 1; i <= 2; i++) {
+		SetScrambledSector(lpBuf, nShift + CD_RAW_SECTOR_SIZE * i, SYNC_TEST_LBA + i + 10);
+	}
+	SYNC_CANDIDATE candidate[SYNC_CANDIDATE_MAX] = { 0 };
+	INT nNum = GetSyncCandidates(lpBuf, nBufLen, SYNC_TEST_LBA, candidate, SYNC_CANDIDATE_MAX);
+	TEST_CHECK(nNum == 2);
+	TEST_CHECK(candidate[0].nCombinedOffset == nShift);
+	TEST_CHECK(candidate[0].nVotes == 2);
+	TEST_CHECK(candidate[0].nFirstPos == nShift);
+	TEST_CHECK(candidate[1].nCombinedOffset == nShift - CD_RAW_SECTOR_SIZE * 10);
+	TEST_CHECK(candidate[1].nVotes == 2);
+
+	// B A A B: the other one is earlier now
+	SetScrambledSectors(lpBuf, nBufLen, nShift, SYNC_TEST_LBA);
+	SetScrambledSector(lpBuf, nShift, SYNC_TEST_LBA + 10);
+	SetScrambledSector(lpBuf, nShift + CD_RAW_SECTOR_SIZE * 3, SYNC_TEST_LBA + 13);
+	nNum = GetSyncCandidates(lpBuf, nBufLen, SYNC_TEST_LBA, candidate, SYNC_CANDIDATE_MAX);
+	TEST_CHECK(nNum == 2);
+	TEST_CHECK(candidate[0].nCombinedOffset == nShift - CD_RAW_SECTOR_SIZE * 10);
+	TEST_CHECK(candidate[1].nCombinedOffset == nShift);
+	free(lpBuf);
+}
+
+VOID TestSyncSearch(
+	VOID
+) {
+	TestFindSyncHeader();
+	TestSyncCandidatesOfShift();
+	TestSyncCandidatesOfCorruptedHeader();
+	TestSyncCandidatesOfTie();
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+// The checks of each test don't stop at the first failure. The failed
+// expression is printed with the file and the line, and counted.
+extern INT g_nTestFailNum;
+
+#define TEST_CHECK(expr) \
+	do { \
+		if (!(expr)) { \
+			fprintf(stderr, "%s(%d): %s\n", __FILE__, __LINE__, #expr); \
+			g_nTestFailNum++; \
+		} \
+	} while (0)
+
+// DiscImageCreatorTest.cpp
+VOID GetTestTempPath(
+	LPTSTR pszPath,
+	LPCTSTR pszFname
+);
+
+// calcHashTest.cpp
+VOID TestCalcHash(
+	VOID
+);
+
+// checkTest.cpp
+VOID TestCheck(
+	VOID
+);
+
+// convertTest.cpp
+VOID TestConvert(
+	VOID
+);
+
+// dvdUnscramblerTest.cpp
+VOID TestDvdUnscrambler(
+	VOID
+);
+
+// eccRtoWTest.cpp
+VOID TestEccRtoW(
+	VOID
+);
+
+// errorMapTest.cpp
+VOID TestErrorMap(
+	VOID
+);
+
+// fileSystemTest.cpp
+VOID TestFileSystem(
+	VOID
+);
+
+// outputMdsTest.cpp
+VOID TestOutputMds(
+	VOID
+);
+
+// rawCacheStrategyTest.cpp
+VOID TestRawCacheStrategy(
+	VOID
+);
+
+// readQueueTest.cpp
+VOID TestReadQueue(
+	VOID
+);
+
+// scanPatternTest.cpp
+VOID TestScanPattern(
+	VOID
+);
+
+// skipRegionTest.cpp
+VOID TestSkipRegion(
+	VOID
+);
+
+// syncSearchTest.cpp
+VOID TestSyncSearch(
+	VOID
+);
+
+// voterTest.cpp
+VOID TestVoter(
+	VOID
+);
+
+// xmlStreamTest.cpp
+VOID TestXmlStream(
+	VOID
+);
@@ -0,0 +1,132 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/struct.h"
+#include "../DiscImageCreator/calcHash.h"
+#include "../DiscImageCreator/fix.h"
+#include "test.h"
+
+// track 3, index 1, RMSF 01:23:45, AMSF 12:34:56 of an audio disc
+static VOID SetSubQ(
+	LPBYTE lpSubQ
+) {
+	CONST BYTE aSubQ[12] = {
+		0x01, 0x03, 0x01, 0x01, 0x23, 0x45, 0x00, 0x12, 0x34, 0x56, 0x00, 0x00
+	};
+	memcpy(lpSubQ, aSubQ, sizeof(aSubQ));
+	WORD crc16 = GetCrc16CCITT(SUBQ_CRC_DATA_SIZE, lpSubQ);
+	lpSubQ[10] = HIBYTE(crc16);
+	lpSubQ[11] = LOBYTE(crc16);
+}
+
+static VOID FlipBit(
+	LPBYTE lpSubQ,
+	INT nBit
+) {
+	lpSubQ[nBit / CHAR_BIT] ^= (BYTE)(0x80 >> (nBit % CHAR_BIT));
+}
+
+// Each read has other broken bits, so every bit is right in the most reads
+static VOID TestVoteMajority(
+	VOID
+) {
+	BYTE org[12] = { 0 };
+	SetSubQ(org);
+	for (INT nNum = 3; nNum <= SUB_Q_VOTE_MAX; nNum += 2) {
+		BYTE candidate[SUB_Q_VOTE_MAX][12] = { 0 };
+		for (INT j = 0; j < nNum; j++) {
+			memcpy(candidate[j], org, sizeof(org));
+			// 3 bits of each read, the crc16 included
+			for (INT k = 0; k < 3; k++) {
+				FlipBit(candidate[j], (j * 3 + k) * 7 % 96);
+			}
+		}
+		BYTE subQ[12] = { 0 };
+		TEST_CHECK(VoteSubQ(subQ, candidate[0], nNum));
+		TEST_CHECK(!memcmp(subQ, org, sizeof(subQ)));
+	}
+}
+
+// Half of the reads have the same broken bits, so these bits are tie. Up to
+// 8 tie bits are tried, and the crc16 decides the right one
+static VOID TestVoteTieBruteForce(
+	VOID
+) {
+	BYTE org[12] = { 0 };
+	SetSubQ(org);
+	for (INT nTieNum = 1; nTieNum <= CHAR_BIT; nTieNum++) {
+		BYTE candidate[4][12] = { 0 };
+		for (INT j = 0; j < 4; j++) {
+			memcpy(candidate[j], org, sizeof(org));
+			if (j & 1) {
+				for (INT t = 0; t < nTieNum; t++) {
+					FlipBit(candidate[j], t * 11 + 5);
+				}
+			}
+		}
+		BYTE subQ[12] = { 0 };
+		TEST_CHECK(VoteSubQ(subQ, candidate[0], 4));
+		TEST_CHECK(!memcmp(subQ, org, sizeof(subQ)));
+	}
+}
+
+// More than 8 tie bits aren't tried, and lpSubQ isn't changed
+static VOID TestVoteTieFallback(
+	VOID
+) {
+	BYTE org[12] = { 0 };
+	SetSubQ(org);
+	BYTE candidate[2][12] = { 0 };
+	memcpy(candidate[0], org, sizeof(org));
+	memcpy(candidate[1], org, sizeof(org));
+	for (INT t = 0; t < CHAR_BIT + 1; t++) {
+		FlipBit(candidate[1], t * 10);
+	}
+	BYTE subQ[12] = { 0 };
+	FillMemory(subQ, sizeof(subQ), 0xcc);
+	TEST_CHECK(!VoteSubQ(subQ, candidate[0], 2));
+	for (size_t i = 0; i < sizeof(subQ); i++) {
+		TEST_CHECK(subQ[i] == 0xcc);
+	}
+}
+
+// A read alone (or none) isn't a vote even if it's valid
+static VOID TestVoteBelowMin(
+	VOID
+) {
+	BYTE candidate[SUB_Q_VOTE_MIN][12] = { 0 };
+	for (INT j = 0; j < SUB_Q_VOTE_MIN; j++) {
+		SetSubQ(candidate[j]);
+	}
+	for (INT nNum = 0; nNum < SUB_Q_VOTE_MIN; nNum++) {
+		BYTE subQ[12] = { 0 };
+		TEST_CHECK(!VoteSubQ(subQ, candidate[0], nNum));
+		for (size_t i = 0; i < sizeof(subQ); i++) {
+			TEST_CHECK(subQ[i] == 0);
+		}
+	}
+	BYTE subQ[12] = { 0 };
+	TEST_CHECK(VoteSubQ(subQ, candidate[0], SUB_Q_VOTE_MIN));
+	TEST_CHECK(!memcmp(subQ, candidate[0], sizeof(subQ)));
+}
+
+VOID TestVoter(
+	VOID
+) {
+	TestVoteMajority();
+	TestVoteTieBruteForce();
+	TestVoteTieFallback();
+	TestVoteBelowMin();
+}
@@ -0,0 +1,197 @@
+/**
+ * Copyright 2011-2018 sarami
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../DiscImageCreator/xmlStream.h"
+#include "test.h"
+
+// The golden files in the data directory are in the format of the dat that
+// XmlLite (XmlWriterProperty_Indent) wrote: the BOM, CRLF, 2 spaces indent,
+// " />" of the empty element, no newline at the end
+#define XML_TEST_TEMPLATE	"data/default.dat"
+#define XML_TEST_EXPECTED	"data/expected.dat"
+#define XML_TEST_ESCAPE		"data/escape.xml"
+
+// "Tom & Jerry <Disc 1> "JP" " + "game" in katakana
+#define XML_TEST_GAME_NAME	"Tom & Jerry <Disc 1> \"JP\" \xe3\x82\xb2\xe3\x83\xbc\xe3\x83\xa0"
+
+static BOOL ReadTestFile(
+	FILE* fp,
+	LPBYTE* lpBuf,
+	LONG* lSize
+) {
+	if (fseek(fp, 0, SEEK_END)) {
+		return FALSE;
+	}
+	*lSize = ftell(fp);
+	rewind(fp);
+	*lpBuf = (LPBYTE)calloc((size_t)*lSize + 1, sizeof(BYTE));
+	if (!*lpBuf) {
+		return FALSE;
+	}
+	return fread(*lpBuf, sizeof(BYTE), (size_t)*lSize, fp) == (size_t)*lSize;
+}
+
+// Compares the output with the golden file byte by byte
+static VOID CheckGoldenFile(
+	FILE* fpOut,
+	LPCSTR szGolden
+) {
+	FILE* fpGolden = fopen(szGolden, "rb");
+	TEST_CHECK(fpGolden != NULL);
+	if (!fpGolden) {
+		return;
+	}
+	LPBYTE lpOut = NULL;
+	LPBYTE lpGolden = NULL;
+	LONG lOutSize = 0;
+	LONG lGoldenSize = 0;
+	TEST_CHECK(ReadTestFile(fpOut, &lpOut, &lOutSize));
+	TEST_CHECK(ReadTestFile(fpGolden, &lpGolden, &lGoldenSize));
+	if (lpOut && lpGolden) {
+		LONG lMin = min(lOutSize, lGoldenSize);
+		LONG i = 0;
+		for (; i < lMin && lpOut[i] == lpGolden[i]; i++) {
+		}
+		if (i != lOutSize || i != lGoldenSize) {
+			fprintf(stderr, "%s: differs at offset %ld (size %ld, expected %ld)\n"
+				, szGolden, i, lOutSize, lGoldenSize);
+		}
+		TEST_CHECK(i == lOutSize && i == lGoldenSize);
+	}
+	free(lpOut);
+	free(lpGolden);
+	fclose(fpGolden);
+}
+
+static INT WriteTestRom(
+	PXML_STREAM_WRITER pWriter,
+	LPVOID lpContext
+) {
+	(*(LPINT)lpContext)++;
+	CONST BYTE md5[2][16] = {
+		{ 0x90, 0x01, 0x50, 0x98, 0x3c, 0xd2, 0x4f, 0xb0, 0xd6, 0x96, 0x3f, 0x7d, 0x28, 0xe1, 0x7f, 0x72 },
+		{ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+	};
+	CONST BYTE sha1[2][20] = {
+		{ 0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e
+		, 0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d },
+		{ 0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9
+		, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff, 0x00, 0x01, 0x02, 0x03 },
+	};
+	return WriteXmlStreamRom(pWriter, "Tom & Jerry (Track 1).bin", 3, 0x352441c2, md5[0], sha1[0]) &&
+		WriteXmlStreamRom(pWriter, "Tom & Jerry (Track 2).bin", 1234567890123ULL, 0xabcd, md5[1], sha1[1]);
+}
+
+// the same path as ReadWriteDat: default.dat is copied and the roms are added to <game>
+static VOID TestXmlStreamDat(
+	VOID
+) {
+	FILE* fpIn = fopen(XML_TEST_TEMPLATE, "rb");
+	TEST_CHECK(fpIn != NULL);
+	if (!fpIn) {
+		return;
+	}
+	XML_STREAM_READER reader;
+	INT bRet = InitXmlStreamReader(&reader, fpIn);
+	fclose(fpIn);
+	TEST_CHECK(bRet);
+	if (!bRet) {
+		return;
+	}
+	FILE* fpOut = tmpfile();
+	TEST_CHECK(fpOut != NULL);
+	if (fpOut) {
+		XML_STREAM_WRITER writer;
+		InitXmlStreamWriter(&writer, fpOut);
+		INT nGameNum = 0;
+		TEST_CHECK(CopyXmlStreamDat(&reader, &writer, XML_TEST_GAME_NAME, WriteTestRom, &nGameNum) == 1);
+		TEST_CHECK(nGameNum == 1);
+		TEST_CHECK(!writer.bErr);
+		CheckGoldenFile(fpOut, XML_TEST_EXPECTED);
+		fclose(fpOut);
+	}
+	TerminateXmlStreamReader(&reader);
+}
+
+// the escape of the text and the attribute, the empty element and the nest
+static VOID TestXmlStreamEscape(
+	VOID
+) {
+	FILE* fpOut = tmpfile();
+	TEST_CHECK(fpOut != NULL);
+	if (!fpOut) {
+		return;
+	}
+	XML_STREAM_WRITER writer;
+	InitXmlStreamWriter(&writer, fpOut);
+	TEST_CHECK(WriteXmlStreamStartDocument(&writer));
+	TEST_CHECK(WriteXmlStreamStartElement(&writer, "root"));
+	TEST_CHECK(WriteXmlStreamStartElement(&writer, "empty"));
+	TEST_CHECK(WriteXmlStreamEndElement(&writer));
+	TEST_CHECK(WriteXmlStreamStartElement(&writer, "attr"));
+	TEST_CHECK(WriteXmlStreamAttribute(&writer, "a", "tab\tlf\ncr\rquot\"apos'amp&lt<gt>"));
+	TEST_CHECK(WriteXmlStreamAttribute(&writer, "b", ""));
+	TEST_CHECK(WriteXmlStreamEndElement(&writer));
+	TEST_CHECK(WriteXmlStreamStartElement(&writer, "text"));
+	TEST_CHECK(WriteXmlStreamString(&writer, "tab\tlf\ncr\rquot\"apos'amp&lt<gt>"));
+	TEST_CHECK(WriteXmlStreamEndElement(&writer));
+	TEST_CHECK(WriteXmlStreamStartElement(&writer, "nest"));
+	TEST_CHECK(WriteXmlStreamStartElement(&writer, "child"));
+	TEST_CHECK(WriteXmlStreamString(&writer, "1"));
+	TEST_CHECK(WriteXmlStreamEndElement(&writer));
+	TEST_CHECK(WriteXmlStreamStartElement(&writer, "child"));
+	// </nest> and </root> are closed by the end of the document
+	TEST_CHECK(WriteXmlStreamEndDocument(&writer));
+	CheckGoldenFile(fpOut, XML_TEST_ESCAPE);
+	fclose(fpOut);
+}
+
+// the malformed template (the unterminated attribute) is an error, not a truncated dat
+static VOID TestXmlStreamMalformed(
+	VOID
+) {
+	CONST CHAR szDat[] = "<datafile>\r\n\t<game name=\">\r\n\t</game>\r\n</datafile>\r\n";
+	FILE* fpIn = tmpfile();
+	TEST_CHECK(fpIn != NULL);
+	if (!fpIn) {
+		return;
+	}
+	fwrite(szDat, sizeof(CHAR), sizeof(szDat) - 1, fpIn);
+	rewind(fpIn);
+	XML_STREAM_READER reader;
+	INT bRet = InitXmlStreamReader(&reader, fpIn);
+	fclose(fpIn);
+	TEST_CHECK(bRet);
+	if (!bRet) {
+		return;
+	}
+	FILE* fpOut = tmpfile();
+	TEST_CHECK(fpOut != NULL);
+	if (fpOut) {
+		XML_STREAM_WRITER writer;
+		InitXmlStreamWriter(&writer, fpOut);
+		TEST_CHECK(CopyXmlStreamDat(&reader, &writer, "x", NULL, NULL) == -1);
+		fclose(fpOut);
+	}
+	TerminateXmlStreamReader(&reader);
+}
+
+VOID TestXmlStream(
+	VOID
+) {
+	TestXmlStreamDat();
+	TestXmlStreamEscape();
+	TestXmlStreamMalformed();
+}